@@ -42,6 +42,7 @@
 #include "dbFldTypes.h"
 #include "dbLock.h"
 #include "dbStaticLib.h"
+#include "dbTracePvt.h"
 #include "epicsExport.h"
 #include "link.h"
 #include "recSup.h"
@@ -220,7 +221,10 @@ static void callbackTask(void *arg)
             if(!epicsRingPointerIsEmpty(mySet->queue))
                 epicsEventMustTrigger(mySet->semWakeUp);
             mySet->queueOverflow = FALSE;
+            dbTrace(dbtCallbackBegin, pcallback,
+                (size_t) pcallback->callback);
             (*pcallback->callback)(pcallback);
+            dbTrace(dbtCallbackEnd, pcallback, 0);
         }
     }
 
@@ -292,13 +296,18 @@ void callbackInit(void)
         epicsThreadId tid;
 
         callbackQueue[i].semWakeUp = epicsEventMustCreate(epicsEventEmpty);
-        callbackQueue[i].queue = epicsRingPointerLockedCreate(callbackQueueSize);
+        if (callbackQueue[i].threadsConfigured == 0)
+            callbackQueue[i].threadsConfigured = callbackThreadsDefault;
+        /* Requests come from any thread, a single callback thread can
+         * take them off a lock-free ring */
+        if (callbackQueue[i].threadsConfigured > 1)
+            callbackQueue[i].queue = epicsRingPointerLockedCreate(callbackQueueSize);
+        else
+            callbackQueue[i].queue = epicsRingPointerMPSCCreate(callbackQueueSize);
         if (callbackQueue[i].queue == 0)
-            cantProceed("epicsRingPointerLockedCreate failed for %s\n",
+            cantProceed("epicsRingPointerCreate failed for %s\n",
                 threadNamePrefix[i]);
         callbackQueue[i].queueOverflow = FALSE;
-        if (callbackQueue[i].threadsConfigured == 0)
-            callbackQueue[i].threadsConfigured = callbackThreadsDefault;
 
         for (j = 0; j < callbackQueue[i].threadsConfigured; j++) {
             if (callbackQueue[i].threadsConfigured > 1 )
@@ -321,6 +330,7 @@ void callbackInit(void)
 /* This routine can be called from interrupt context */
 int callbackRequest(epicsCallback *pcallback)
 {
+    CALLBACKFUNC func;
     int priority;
     int pushOK;
     cbQueueSet *mySet;
@@ -341,9 +351,14 @@ int callbackRequest(epicsCallback *pcallback)
     }
     if (mySet->queueOverflow) return S_db_bufFull;
 
+    /* pcallback may be reused as soon as it has been queued */
+    func = pcallback->callback;
+    /* before the push, a callback thread may run it immediately */
+    dbTrace(dbtCallbackQueue, pcallback, (size_t) func);
     pushOK = epicsRingPointerPush(mySet->queue, pcallback);
 
     if (!pushOK) {
+        dbTrace(dbtCallbackOverflow, pcallback, (size_t) func);
         epicsInterruptContextMessage(fullMessage[priority]);
         mySet->queueOverflow = TRUE;
         epicsAtomicIncrIntT(&mySet->queueOverflows);
@@ -39,6 +39,7 @@
 #include "callback.h"
 #include "dbAccessDefs.h"
 #include "dbAddr.h"
+#include "dbArrayBuffer.h"
 #include "dbBase.h"
 #include "dbBkpt.h"
 #include "dbCommonPvt.h"
@@ -51,6 +52,8 @@
 #include "dbLink.h"
 #include "dbLockPvt.h"
 #include "dbNotify.h"
+#include "dbProcStatsPvt.h"
+#include "dbTracePvt.h"
 #include "dbScan.h"
 #include "dbServer.h"
 #include "dbStaticLib.h"
@@ -605,7 +608,16 @@ long dbProcess(dbCommon *precord)
         printf("%s: dbProcess of '%s'\n", context, precord->name);
 
     /* process record */
-    status = prset->process(precord);
+    dbTrace(dbtProcessBegin, precord, 0);
+    if (dbProcStatsEnabled) {
+        epicsUInt64 start = epicsMonotonicGet();
+
+        status = prset->process(precord);
+        dbProcStatsProcess(precord, epicsMonotonicGet() - start);
+    }
+    else
+        status = prset->process(precord);
+    dbTrace(dbtProcessEnd, precord, 0);
 
     /* Print record's fields if PRINT_MASK set in breakpoint field */
     if (lset_stack_count != 0) {
@@ -1354,6 +1366,9 @@ long dbPut(DBADDR *paddr, short dbrType,
             prset && prset->get_array_info) {
             long dummy;
 
+            /* Don't overwrite data that readers still refer to */
+            status = dbArrayBufferPrepareWrite(precord);
+            if (status) goto done;
             status = prset->get_array_info(paddr, &dummy, &offset);
             /* paddr->pfield may be modified */
             if (status) goto done;
@@ -0,0 +1,281 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* dbArrayBuffer.c */
+/* Reference counted storage for record array fields */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ellLib.h"
+#include "epicsAtomic.h"
+#include "epicsMutex.h"
+
+#include "dbAccessDefs.h"
+#include "dbArrayBuffer.h"
+#include "dbChannel.h"
+#include "dbCommonPvt.h"
+#include "db_field_log.h"
+
+/* At most max buffers are allocated.  While a reader refers to the current
+ * buffer one more must stay available, so that a writer can always replace
+ * it without touching the data the reader sees.  Readers that would use up
+ * that reserve are not given a reference, see dbArrayBufferSnapshot().
+ */
+typedef struct dbArrayPool {
+    epicsMutexId lock;
+    ELLLIST free;           /* arrayBuffer, unused */
+    void **pptr;            /* the record's pointer to the current buffer */
+    size_t size;
+    unsigned allocated;
+    unsigned max;
+} dbArrayPool;
+
+typedef struct arrayBuffer {
+    ELLNODE node;
+    dbArrayPool *pool;
+    int refs;
+} arrayBuffer;
+
+/* Keep the data suitably aligned for any element type */
+#define HEADER_SIZE ((sizeof(arrayBuffer) + 15) & ~(size_t)15)
+
+static arrayBuffer * buf2hdr(void *buf)
+{
+    return (arrayBuffer *)((char *)buf - HEADER_SIZE);
+}
+
+static void * hdr2buf(arrayBuffer *phdr)
+{
+    return (char *)phdr + HEADER_SIZE;
+}
+
+/* Called with the pool locked */
+static arrayBuffer * newBuffer(dbArrayPool *pool)
+{
+    arrayBuffer *phdr;
+
+    if (pool->allocated >= pool->max)
+        return NULL;
+    phdr = calloc(1, HEADER_SIZE + pool->size);
+
+    if (phdr) {
+        phdr->pool = pool;
+        pool->allocated++;
+    }
+    return phdr;
+}
+
+/* Called with the pool locked.  Takes a free buffer unless that would leave
+ * fewer than reserve buffers available.
+ */
+static arrayBuffer * takeBuffer(dbArrayPool *pool, unsigned reserve)
+{
+    arrayBuffer *phdr = NULL;
+
+    if ((unsigned) ellCount(&pool->free) > reserve)
+        phdr = (arrayBuffer *) ellGet(&pool->free);
+    else if (pool->allocated + reserve < pool->max)
+        phdr = newBuffer(pool);
+    if (phdr)
+        phdr->refs = 1;
+    return phdr;
+}
+
+/* Called with the pool locked */
+static int isShared(dbArrayPool *pool)
+{
+    return epicsAtomicGetIntT(&buf2hdr(*pool->pptr)->refs) > 1;
+}
+
+long dbArrayBufferInit(struct dbCommon *prec, void **pptr, size_t size,
+    unsigned count)
+{
+    dbArrayPool *pool = calloc(1, sizeof(dbArrayPool));
+    arrayBuffer *phdr;
+
+    if (!pool)
+        return S_db_noMemory;
+    pool->lock = epicsMutexCreate();
+    if (!pool->lock) {
+        free(pool);
+        return S_db_noMemory;
+    }
+    pool->pptr = pptr;
+    pool->size = size;
+    pool->max = count;
+    while (pool->allocated < count) {
+        phdr = newBuffer(pool);
+        if (!phdr)
+            break;
+        ellAdd(&pool->free, &phdr->node);
+    }
+    phdr = (arrayBuffer *) ellGet(&pool->free);
+    if (!phdr) {
+        epicsMutexDestroy(pool->lock);
+        free(pool);
+        return S_db_noMemory;
+    }
+    phdr->refs = 1;
+    *pptr = hdr2buf(phdr);
+    dbRec2Pvt(prec)->arrayPool = pool;
+    return 0;
+}
+
+void * dbArrayBufferGet(struct dbCommon *prec)
+{
+    dbArrayPool *pool = dbRec2Pvt(prec)->arrayPool;
+    arrayBuffer *phdr;
+
+    if (!pool)
+        return NULL;
+
+    epicsMutexMustLock(pool->lock);
+    phdr = takeBuffer(pool, isShared(pool));
+    epicsMutexUnlock(pool->lock);
+
+    return phdr ? hdr2buf(phdr) : NULL;
+}
+
+void dbArrayBufferRef(void *buf)
+{
+    epicsAtomicIncrIntT(&buf2hdr(buf)->refs);
+}
+
+void dbArrayBufferRelease(void *buf)
+{
+    arrayBuffer *phdr = buf2hdr(buf);
+    dbArrayPool *pool = phdr->pool;
+
+    if (epicsAtomicDecrIntT(&phdr->refs) > 0)
+        return;
+
+    epicsMutexMustLock(pool->lock);
+    ellAdd(&pool->free, &phdr->node);
+    epicsMutexUnlock(pool->lock);
+}
+
+void dbArrayBufferSwap(struct dbCommon *prec, void *buf)
+{
+    dbArrayPool *pool = dbRec2Pvt(prec)->arrayPool;
+    void *old;
+
+    epicsMutexMustLock(pool->lock);
+    old = *pool->pptr;
+    *pool->pptr = buf;
+    epicsMutexUnlock(pool->lock);
+    dbArrayBufferRelease(old);
+}
+
+/* Called with the record locked.  Returns a buffer to replace the current
+ * one with, which is reserved for this while a reader refers to it.
+ */
+static void * getReplacement(dbArrayPool *pool)
+{
+    arrayBuffer *phdr;
+
+    epicsMutexMustLock(pool->lock);
+    phdr = takeBuffer(pool, 0);
+    epicsMutexUnlock(pool->lock);
+
+    return phdr ? hdr2buf(phdr) : NULL;
+}
+
+long dbArrayBufferPrepareWrite(struct dbCommon *prec)
+{
+    dbArrayPool *pool = dbRec2Pvt(prec)->arrayPool;
+    void *cur, *buf;
+
+    if (!pool)
+        return 0;
+
+    cur = *pool->pptr;
+    if (epicsAtomicGetIntT(&buf2hdr(cur)->refs) == 1)
+        return 0;   /* only the record uses it */
+
+    buf = getReplacement(pool);
+    if (!buf)
+        return S_db_noMemory;
+    memcpy(buf, cur, pool->size);
+    dbArrayBufferSwap(prec, buf);
+    return 0;
+}
+
+void * dbArrayBufferPrepareReplace(struct dbCommon *prec, void *pcurrent)
+{
+    dbArrayPool *pool = dbRec2Pvt(prec)->arrayPool;
+
+    if (!pool || epicsAtomicGetIntT(&buf2hdr(pcurrent)->refs) == 1)
+        return pcurrent;    /* only the record uses it */
+
+    return getReplacement(pool);
+}
+
+void dbArrayBufferCompleteReplace(struct dbCommon *prec, void *buf,
+    long status)
+{
+    dbArrayPool *pool = dbRec2Pvt(prec)->arrayPool;
+
+    if (!pool || !buf || buf == *pool->pptr)
+        return;
+    if (status)
+        dbArrayBufferRelease(buf);
+    else
+        dbArrayBufferSwap(prec, buf);
+}
+
+void dbArrayBufferStats(struct dbCommon *prec, unsigned *pallocated,
+    unsigned *pfree)
+{
+    dbArrayPool *pool = dbRec2Pvt(prec)->arrayPool;
+    unsigned allocated = 0, nfree = 0;
+
+    if (pool) {
+        epicsMutexMustLock(pool->lock);
+        allocated = pool->allocated;
+        nfree = (unsigned) ellCount(&pool->free);
+        epicsMutexUnlock(pool->lock);
+    }
+    if (pallocated)
+        *pallocated = allocated;
+    if (pfree)
+        *pfree = nfree;
+}
+
+static void releaseSnapshot(db_field_log *pfl)
+{
+    dbArrayBufferRelease(pfl->u.r.field);
+}
+
+void dbArrayBufferSnapshot(struct dbChannel *chan, struct db_field_log *pfl)
+{
+    dbArrayPool *pool = dbRec2Pvt(dbChannelRecord(chan))->arrayPool;
+    void *pfield = dbChannelField(chan);
+    long nelem = pfl->no_elements;
+    long offset = 0;
+
+    if (!pool)
+        return;
+
+    dbChannelGetArrayInfo(chan, &pfield, &nelem, &offset);
+    if (pfield != *pool->pptr || offset != 0)
+        return;     /* some other field of the record */
+
+    epicsMutexMustLock(pool->lock);
+    if (!isShared(pool) && !ellCount(&pool->free) &&
+        pool->allocated >= pool->max) {
+        /* No buffer left to replace it, read the record on delivery */
+        epicsMutexUnlock(pool->lock);
+        return;
+    }
+    dbArrayBufferRef(pfield);
+    epicsMutexUnlock(pool->lock);
+    pfl->u.r.field = pfield;
+    pfl->u.r.dtor = releaseSnapshot;
+    pfl->u.r.pvt = NULL;
+    if (nelem < pfl->no_elements)
+        pfl->no_elements = nelem;
+}
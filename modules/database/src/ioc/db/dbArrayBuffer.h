@@ -0,0 +1,129 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/** @file dbArrayBuffer.h
+ * @brief Reference counted, swappable storage for a record's array field
+ *
+ * A record type can keep the data of its array field (e.g. the BPTR of a
+ * waveform record) in buffers from a per-record pool instead of a single
+ * allocation.  Device support then fills a spare buffer without holding the
+ * record lock and installs it with dbArrayBufferSwap(), which only exchanges
+ * a pointer.
+ *
+ * Monitor updates of such a field take a reference to the current buffer
+ * rather than reading the record again when the event is delivered, so they
+ * see the data as it was when posted and don't lock the record to copy it.
+ * A buffer returns to the pool when the last reference is dropped.
+ *
+ * A pool never holds more buffers than the count given to
+ * dbArrayBufferInit().  While a reader refers to the current buffer one
+ * more is kept for the next writer; when taking a reference would use up
+ * that reserve the update reads the record on delivery as without a pool.
+ *
+ * Code that writes into the current buffer in place must call
+ * dbArrayBufferPrepareWrite() first; dbPut() does this automatically.
+ * Code that replaces all of its data uses dbArrayBufferPrepareReplace()
+ * and dbArrayBufferCompleteReplace() instead, which avoids copying data
+ * that is about to be overwritten.
+ */
+
+#ifndef INCdbArrayBufferH
+#define INCdbArrayBufferH
+
+#include <stddef.h>
+
+#include "dbCoreAPI.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dbCommon;
+struct dbChannel;
+struct db_field_log;
+
+/** @brief Create the buffer pool of a record.
+ *
+ * Called by record support in init_record() pass 0.  Allocates @p count
+ * zeroed buffers of @p size bytes and stores the first one in @p *pptr,
+ * which is the record's pointer to its array data.  The pool never grows
+ * beyond @p count buffers.
+ * @return 0, or S_db_noMemory.
+ */
+DBCORE_API long dbArrayBufferInit(struct dbCommon *prec, void **pptr,
+    size_t size, unsigned count);
+
+/** @brief Get a spare buffer from the pool of a record.
+ *
+ * May be called from any thread without the record lock.  The caller owns
+ * the returned buffer until it passes it to dbArrayBufferSwap() or
+ * dbArrayBufferRelease().  The buffer kept for writers while a reader
+ * refers to the current one is not handed out here, so device support that
+ * fills spare buffers while monitors are active needs at least 3 buffers.
+ * @return The buffer, or NULL if the record has no pool, all its buffers
+ * are in use, or out of memory.
+ */
+DBCORE_API void * dbArrayBufferGet(struct dbCommon *prec);
+
+/** @brief Take an additional reference to a buffer. */
+DBCORE_API void dbArrayBufferRef(void *buf);
+
+/** @brief Drop a reference to a buffer, the last one returns it to its pool. */
+DBCORE_API void dbArrayBufferRelease(void *buf);
+
+/** @brief Make a buffer the current one.
+ *
+ * Must be called with the record locked.  Takes over the caller's reference
+ * to @p buf and drops the record's reference to the previous buffer.
+ * Record fields like NORD are left to the caller.
+ */
+DBCORE_API void dbArrayBufferSwap(struct dbCommon *prec, void *buf);
+
+/** @brief Prepare the current buffer for an update in place.
+ *
+ * Must be called with the record locked.  If any reader still refers to
+ * the current buffer its contents are copied into a spare one, which then
+ * becomes current.  Does nothing for records without a pool.
+ * @return 0, or S_db_noMemory.
+ */
+DBCORE_API long dbArrayBufferPrepareWrite(struct dbCommon *prec);
+
+/** @brief Get the buffer to write when replacing all of the data.
+ *
+ * Must be called with the record locked, @p pcurrent is the record's
+ * current array pointer.  Returns @p pcurrent if no reader refers to it or
+ * the record has no pool, otherwise a spare buffer whose contents are not
+ * initialized.  Either way the caller then calls
+ * dbArrayBufferCompleteReplace().
+ * @return The buffer, or NULL if out of memory.
+ */
+DBCORE_API void * dbArrayBufferPrepareReplace(struct dbCommon *prec,
+    void *pcurrent);
+
+/** @brief Finish a replacement started by dbArrayBufferPrepareReplace().
+ *
+ * Must be called with the record locked.  A spare buffer @p buf becomes
+ * the current one if @p status is 0 and is released otherwise.  Does
+ * nothing if @p buf is NULL or already current.
+ */
+DBCORE_API void dbArrayBufferCompleteReplace(struct dbCommon *prec,
+    void *buf, long status);
+
+/** @brief Number of buffers allocated by and currently free in a pool. */
+DBCORE_API void dbArrayBufferStats(struct dbCommon *prec,
+    unsigned *pallocated, unsigned *pfree);
+
+/* Used by the event code: make pfl refer to a counted reference of the
+ * channel's current buffer if it has one.
+ */
+DBCORE_API void dbArrayBufferSnapshot(struct dbChannel *chan,
+    struct db_field_log *pfl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INCdbArrayBufferH */
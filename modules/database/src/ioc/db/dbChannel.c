@@ -480,6 +480,7 @@ dbChannel * dbChannelCreate(const char *name)
         goto finish;
 
     /* Handle field modifiers */
+    chan->modifiers = cname + (pname - name);
     if (*pname) {
         short dbfType = paddr->field_type;
 
@@ -6,6 +6,10 @@
 #include "dbCommon.h"
 
 struct epicsThreadOSD;
+struct dbProcStatsRec;
+struct onceWaiter;
+struct dbRecordArena;
+struct dbArrayPool;
 
 /** Base internal additional information for every record
  */
@@ -15,6 +19,19 @@ typedef struct dbCommonPvt {
     /* Thread which is currently processing this record */
     struct epicsThreadOSD* procThread;
 
+    /* Process time statistics, allocated on demand, see dbProcStats.h */
+    struct dbProcStatsRec *procStats;
+
+    /* scanOnce() coalescing state, guarded by a lock in dbScan.c */
+    int onceQueued;
+    struct onceWaiter *onceWaiters;
+
+    /* Shared storage this record lives in, NULL if allocated on its own */
+    struct dbRecordArena *arena;
+
+    /* Array field buffers, see dbArrayBuffer.h, NULL if not used */
+    struct dbArrayPool *arrayPool;
+
     struct dbCommon common;
 } dbCommonPvt;
 
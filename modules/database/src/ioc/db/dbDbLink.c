@@ -44,6 +44,7 @@
 
 #include "alarm.h"
 #include "cantProceed.h"
+#include "compilerDependencies.h"
 #include "cvtFast.h"
 #include "dbDefs.h"
 #include "ellLib.h"
@@ -59,6 +60,7 @@
 #include "dbCommonPvt.h"
 #include "dbConvertFast.h"
 #include "dbConvert.h"
+#include "dbEvent.h"
 #include "db_field_log.h"
 #include "db_access_routines.h"
 #include "dbFldTypes.h"
@@ -74,6 +76,7 @@
 #include "recSup.h"
 #include "special.h"
 #include "dbDbLink.h"
+#include "dbDbLinkPvt.h"
 #include "dbChannel.h"
 
 /***************************** Database Links *****************************/
@@ -83,7 +86,40 @@ static lset dbDb_lset;
 
 static long processTarget(dbCommon *psrc, dbCommon *pdst);
 
-#define linkChannel(plink) ((dbChannel *) (plink)->value.pv_link.pvt)
+#define linkChannel(plink) dbDbLinkChannel(plink)
+#define fastType(plink) (((dbDbLinkPvt *) (plink)->value.pv_link.pvt)->fastType)
+
+/* Numeric scalar fields without filters or special processing can be
+ * read, and written if not special, by copying the value when the link
+ * uses their own type.  Decided once when the link is resolved.
+ */
+static dbDbLinkPvt * newLinkPvt(dbChannel *chan)
+{
+    dbDbLinkPvt *ppvt = callocMustSucceed(1, sizeof(dbDbLinkPvt),
+        "newLinkPvt");
+    short type = dbChannelFieldType(chan);
+
+    ppvt->chan = chan;
+    ppvt->fastType = -1;
+    if (type >= DBF_CHAR && type <= DBF_DOUBLE &&
+        dbChannelElements(chan) == 1 &&
+        dbChannelSpecial(chan) != SPC_DBADDR &&
+        dbChannelSpecial(chan) != SPC_ATTRIBUTE &&
+        !ellCount(&chan->filters))
+        ppvt->fastType = type;
+    return ppvt;
+}
+
+static EPICS_ALWAYS_INLINE void copyScalar(void *pdst, const void *psrc,
+    short size)
+{
+    switch (size) {
+    case 8: *(epicsUInt64 *) pdst = *(const epicsUInt64 *) psrc; break;
+    case 4: *(epicsUInt32 *) pdst = *(const epicsUInt32 *) psrc; break;
+    case 2: *(epicsUInt16 *) pdst = *(const epicsUInt16 *) psrc; break;
+    default: *(epicsUInt8 *) pdst = *(const epicsUInt8 *) psrc; break;
+    }
+}
 
 long dbDbInitLink(struct link *plink, short dbfType)
 {
@@ -102,7 +138,7 @@ long dbDbInitLink(struct link *plink, short dbfType)
 
     plink->lset = &dbDb_lset;
     plink->type = DB_LINK;
-    plink->value.pv_link.pvt = chan;
+    plink->value.pv_link.pvt = newLinkPvt(chan);
     ellAdd(&precord->bklnk, &plink->value.pv_link.backlinknode);
     /* merging into the same lockset is deferred to the caller.
      * cf. initPVLinks()
@@ -117,7 +153,7 @@ void dbDbAddLink(struct dbLocker *locker, struct link *plink, short dbfType,
 {
     plink->lset = &dbDb_lset;
     plink->type = DB_LINK;
-    plink->value.pv_link.pvt = chan;
+    plink->value.pv_link.pvt = newLinkPvt(chan);
     ellAdd(&dbChannelRecord(chan)->bklnk, &plink->value.pv_link.backlinknode);
 
     /* target record is already locked in dbPutFieldLink() */
@@ -126,7 +162,8 @@ void dbDbAddLink(struct dbLocker *locker, struct link *plink, short dbfType,
 
 static void dbDbRemoveLink(struct dbLocker *locker, struct link *plink)
 {
-    dbChannel *chan = linkChannel(plink);
+    dbDbLinkPvt *ppvt = plink->value.pv_link.pvt;
+    dbChannel *chan = ppvt->chan;
     dbCommon *precord = dbChannelRecord(chan);
 
     plink->type = PV_LINK;
@@ -141,6 +178,7 @@ static void dbDbRemoveLink(struct dbLocker *locker, struct link *plink)
         dbLockSetSplit(locker, plink->precord, precord);
     }
     dbChannelDelete(chan);
+    free(ppvt);
 }
 
 static int dbDbIsConnected(const struct link *plink)
@@ -178,7 +216,15 @@ static long dbDbGetValue(struct link *plink, short dbrType, void *pbuffer,
             return status;
     }
 
-    if (ppv_link->getCvt && ppv_link->lastGetdbrType == dbrType)
+    if (dbrType == fastType(plink))
+    {
+        /* shortcut: scalar of the same type, no filter */
+        copyScalar(pbuffer, dbChannelField(chan), dbChannelFieldSize(chan));
+        if (pnRequest)
+            *pnRequest = 1;
+        status = 0;
+    }
+    else if (ppv_link->getCvt && ppv_link->lastGetdbrType == dbrType)
     {
         /* shortcut: scalar with known conversion, no filter */
         status = ppv_link->getCvt(dbChannelField(chan), pbuffer, paddr);
@@ -232,6 +278,53 @@ static long dbDbGetValue(struct link *plink, short dbrType, void *pbuffer,
     return status;
 }
 
+long dbDbGetValueRef(struct link *plink, short dbrType, void **ppbuffer,
+        long *pnRequest)
+{
+    struct pv_link *ppv_link = &plink->value.pv_link;
+    dbChannel *chan = linkChannel(plink);
+    dbCommon *precord = plink->precord;
+    dbCommon *ptarget = dbChannelRecord(chan);
+    void *pfield = dbChannelField(chan);
+    long nelem = dbChannelElements(chan);
+    long offset = 0;
+    long status;
+
+    /* Only unfiltered fields that hold exactly the requested type */
+    if (dbrType < 0 || dbrType > DBR_ENUM ||
+        dbChannelFieldType(chan) != dbrType ||
+        dbChannelFieldSize(chan) != dbValueSize(dbrType) ||
+        ellCount(&chan->filters))
+        return dbDbGetValue(plink, dbrType, *ppbuffer, pnRequest);
+
+    if (ppv_link->pvlMask & pvlOptPP) {
+        status = dbScanPassive(precord, ptarget);
+        if (status)
+            return status;
+    }
+
+    /* Both records are in the same lock set, so the target storage stays
+     * put while the caller holds the lock.  Circular buffers that have
+     * wrapped still have to be copied.
+     */
+    dbChannelGetArrayInfo(chan, &pfield, &nelem, &offset);
+    if (offset == 0) {
+        if (nelem < *pnRequest)
+            *pnRequest = nelem;
+        *ppbuffer = pfield;
+    }
+    else {
+        status = dbChannelGet(chan, dbrType, *ppbuffer, NULL, pnRequest, NULL);
+        if (status)
+            return status;
+    }
+
+    if (precord != ptarget)
+        recGblInheritSevr(ppv_link->pvlMask & pvlOptMsMode, precord,
+            ptarget->stat, ptarget->sevr);
+    return 0;
+}
+
 static long dbDbGetControlLimits(const struct link *plink, double *low,
         double *high)
 {
@@ -374,7 +467,25 @@ static long dbDbPutValue(struct link *plink, short dbrType,
     struct dbCommon *psrce = plink->precord;
     DBADDR *paddr = &chan->addr;
     dbCommon *pdest = dbChannelRecord(chan);
-    long status = dbPut(paddr, dbrType, pbuffer, nRequest);
+    long status = 0;
+
+    if (dbrType == fastType(plink) && nRequest == 1 &&
+        !dbChannelSpecial(chan)) {
+        /* shortcut: scalar of the same type, does what dbPut() would */
+        dbFldDes *pfldDes = paddr->pfldDes;
+        int isValueField = dbIsValueField(pfldDes);
+
+        copyScalar(dbChannelField(chan), pbuffer, dbChannelFieldSize(chan));
+        if (isValueField)
+            pdest->udf = FALSE;
+        if (pdest->mlis.count &&
+            !(isValueField && pfldDes->process_passive))
+            db_post_events(pdest, dbChannelField(chan), DBE_VALUE | DBE_LOG);
+        if (pdest->mlis.count && pfldDes->prop)
+            db_post_events(pdest, NULL, DBE_PROPERTY);
+    }
+    else
+        status = dbPut(paddr, dbrType, pbuffer, nRequest);
 
     recGblInheritSevr(ppv_link->pvlMask & pvlOptMsMode, pdest, psrce->nsta,
         psrce->nsev);
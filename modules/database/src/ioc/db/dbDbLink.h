@@ -28,6 +28,8 @@ struct dbLocker;
 DBCORE_API long dbDbInitLink(struct link *plink, short dbfType);
 DBCORE_API void dbDbAddLink(struct dbLocker *locker, struct link *plink,
     short dbfType, dbChannel *ptarget);
+DBCORE_API long dbDbGetValueRef(struct link *plink, short dbrType,
+    void **ppbuffer, long *pnRequest);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,23 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+/* dbDbLinkPvt.h */
+
+#ifndef INC_dbDbLinkPvt_H
+#define INC_dbDbLinkPvt_H
+
+#include "dbChannel.h"
+
+/* What pv_link.pvt of a DB_LINK points to */
+typedef struct dbDbLinkPvt {
+    dbChannel   *chan;
+    short       fastType;       /* type for direct scalar copies, or -1 */
+} dbDbLinkPvt;
+
+/* The channel of a DB_LINK */
+#define dbDbLinkChannel(plink) \
+    (((dbDbLinkPvt *) (plink)->value.pv_link.pvt)->chan)
+
+#endif /* INC_dbDbLinkPvt_H */
@@ -28,6 +28,7 @@
 #include "cantProceed.h"
 #include "dbDefs.h"
 #include "epicsAssert.h"
+#include "epicsAtomic.h"
 #include "epicsEvent.h"
 #include "epicsMutex.h"
 #include "epicsThread.h"
@@ -39,15 +40,18 @@
 
 #include "dbAccessDefs.h"
 #include "dbAddr.h"
+#include "dbArrayBuffer.h"
 #include "dbBase.h"
 #include "dbChannel.h"
-#include "dbCommon.h"
+#include "dbCommonPvt.h"
 #include "dbEvent.h"
 #include "db_field_log.h"
 #include "dbFldTypes.h"
 #include "dbLock.h"
+#include "dbTracePvt.h"
 #include "link.h"
 #include "special.h"
+#include "epicsExport.h"
 
 /* Queue size based on Ethernet MTU of 1500 bytes.
  * Assume <=66 bytes of ethernet+IP+TCP overhead
@@ -118,6 +122,30 @@ static void *dbevEventUserFreeList;
 static void *dbevEventQueueFreeList;
 static void *dbevEventSubscriptionFreeList;
 static void *dbevFieldLogFreeList;
+static void *dbevSharedLogFreeList;
+
+/* Run identical pre-queue filter chains once per update */
+int dbEventShareFilters = 0;
+epicsExportAddress(int, dbEventShareFilters);
+
+/*
+ * A filter result handed to several subscriptions.  The original field
+ * log is kept here and its destructor called when the last user is done.
+ */
+typedef struct sharedLog {
+    int refs;
+    db_field_log orig;
+} sharedLog;
+
+/* Upper limit of distinct shared chains per db_post_events() call */
+#define MAX_SHARED_CHAINS 8
+
+typedef struct sharedChain {
+    struct evSubscrip *leader;
+    int valid;                  /* leader's chain produced a result */
+    sharedLog *pshared;         /* NULL if the result owns no memory */
+    db_field_log result;        /* template for the followers */
+} sharedChain;
 
 static char *EVENT_PEND_NAME = "eventTask";
 
@@ -280,9 +308,13 @@ void db_init_event_freelists (void)
             sizeof(struct evSubscrip),256);
     }
     if (!dbevFieldLogFreeList) {
-        freeListInitPvt(&dbevFieldLogFreeList,
+        freeListInitPvtCached(&dbevFieldLogFreeList,
             sizeof(struct db_field_log),2048);
     }
+    if (!dbevSharedLogFreeList) {
+        freeListInitPvt(&dbevSharedLogFreeList,
+            sizeof(sharedLog),64);
+    }
 }
 
 /*
@@ -360,6 +392,9 @@ DBCORE_API void db_cleanup_events(void)
 
     if(dbevFieldLogFreeList) freeListCleanup(dbevFieldLogFreeList);
     dbevFieldLogFreeList = NULL;
+
+    if(dbevSharedLogFreeList) freeListCleanup(dbevSharedLogFreeList);
+    dbevSharedLogFreeList = NULL;
 }
 
     /* intentionally leak stopSync to avoid possible shutdown races */
@@ -529,6 +564,82 @@ void db_event_enable (dbEventSubscription event)
     UNLOCKREC (precord);
 }
 
+/*
+ * A subscription can share its pre-queue chain if it has one, given as
+ * a filter specification, and the filters in it don't also run after
+ * the queue.  Handing the filter state over to another subscription
+ * would otherwise move state that the event task is using.
+ */
+static int canShareChain(const struct evSubscrip *pevent)
+{
+    const dbChannel *chan = pevent->chan;
+    ELLNODE *node;
+
+    if (!ellCount(&chan->pre_chain) || !chan->modifiers || !*chan->modifiers)
+        return FALSE;
+    for (node = ellFirst(&chan->pre_chain); node; node = ellNext(node)) {
+        if (CONTAINER(node, chFilter, pre_node)->post_func)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Subscriptions with the same field, event mask, queueing mode and
+ * filter specification get the same output from their pre-queue chain
+ * (as far as it depends on the update alone).
+ */
+static int sameChain(const struct evSubscrip *a, const struct evSubscrip *b)
+{
+    return a->select == b->select &&
+        a->useValque == b->useValque &&
+        dbChannelField(a->chan) == dbChannelField(b->chan) &&
+        !strcmp(a->chan->modifiers, b->chan->modifiers);
+}
+
+/*
+ * The first subscription of a group in mlis runs the shared chain, the
+ * filters of the others see no updates.  When the leader goes away its
+ * filter instances move to the next one, so the new leader continues
+ * with up-to-date filter state (e.g. the window of a "stat" filter).
+ * Called with the scan and mlis locks held, which all pre-chain runs do.
+ */
+static void handOverChain(struct dbCommon *precord, struct evSubscrip *pevent)
+{
+    struct evSubscrip *pnext;
+    ELLNODE *a, *b;
+    int leader = FALSE;
+
+    for (pnext = (struct evSubscrip *) ellFirst(&precord->mlis); pnext;
+        pnext = (struct evSubscrip *) ellNext(&pnext->node)) {
+        if (pnext == pevent)
+            leader = TRUE;
+        else if (canShareChain(pnext) && sameChain(pevent, pnext))
+            break;
+    }
+    /* no other member, or pevent was not the leader */
+    if (!pnext || !leader)
+        return;
+
+    for (a = ellFirst(&pevent->chan->pre_chain), b = ellFirst(&pnext->chan->pre_chain);
+        a && b; a = ellNext(a), b = ellNext(b)) {
+        chFilter *fa = CONTAINER(a, chFilter, pre_node);
+        chFilter *fb = CONTAINER(b, chFilter, pre_node);
+        chPostEventFunc *func = fa->pre_func;
+        void *arg = fa->pre_arg;
+        void *puser = fa->puser;
+
+        if (fa->plug != fb->plug)
+            break;
+        fa->pre_func = fb->pre_func;
+        fa->pre_arg = fb->pre_arg;
+        fa->puser = fb->puser;
+        fb->pre_func = func;
+        fb->pre_arg = arg;
+        fb->puser = puser;
+    }
+}
+
 /*
  * db_event_disable()
  */
@@ -536,13 +647,20 @@ void db_event_disable (dbEventSubscription event)
 {
     struct evSubscrip * const pevent = (struct evSubscrip *) event;
     struct dbCommon * const precord = dbChannelRecord(pevent->chan);
+    int share = dbEventShareFilters && canShareChain(pevent);
 
+    if (share)
+        dbScanLock (precord);
     LOCKREC (precord);
     if ( pevent->enabled ) {
+        if (share)
+            handOverChain(precord, pevent);
         ellDelete(&precord->mlis, &pevent->node);
         pevent->enabled = FALSE;
     }
     UNLOCKREC (precord);
+    if (share)
+        dbScanUnlock (precord);
 }
 
 /*
@@ -734,6 +852,11 @@ static db_field_log* db_create_field_log (struct dbChannel *chan, int use_val)
             pLog->u.r.dtor = NULL;
             /* no private data yet, may be set by a filter */
             pLog->u.r.pvt = NULL;
+
+            /* unless the record can share its current array buffer */
+            if (dbRec2Pvt(prec)->arrayPool &&
+                dbChannelSpecial(chan) == SPC_DBADDR)
+                dbArrayBufferSnapshot(chan, pLog);
         }
     }
     return pLog;
@@ -751,6 +874,9 @@ db_field_log* db_create_event_log (struct evSubscrip *pevent)
     if (pLog) {
         pLog->mask = pevent->select;
         pLog->ctx  = dbfl_context_event;
+        /* a hint for filters, read without the queue lock */
+        pLog->backlog = pevent->npend > 255u ? 255u :
+            (unsigned char) pevent->npend;
     }
     return pLog;
 }
@@ -857,6 +983,72 @@ static void db_queue_event_log (evSubscrip *pevent, db_field_log *pLog)
     }
 }
 
+static void releaseShared(db_field_log *pfl)
+{
+    sharedLog *pshared = (sharedLog *) pfl->u.r.pvt;
+
+    if (epicsAtomicDecrIntT(&pshared->refs) == 0) {
+        pshared->orig.u.r.dtor(&pshared->orig);
+        freeListFree(dbevSharedLogFreeList, pshared);
+    }
+}
+
+static sharedChain* findSharedChain(sharedChain *chains, int nchains,
+    const struct evSubscrip *pevent)
+{
+    int i;
+
+    for (i = 0; i < nchains; i++) {
+        if (sameChain(chains[i].leader, pevent))
+            return &chains[i];
+    }
+    return NULL;
+}
+
+/*
+ * Make the leader's result shareable and remember it.  The chain holds
+ * one reference until db_post_events() is done with it.
+ */
+static void saveSharedResult(sharedChain *psc, db_field_log *pLog)
+{
+    psc->valid = !!pLog;
+    psc->pshared = NULL;
+    if (!pLog)
+        return;
+
+    if (pLog->type == dbfl_type_ref && pLog->u.r.dtor) {
+        sharedLog *pshared = freeListMalloc(dbevSharedLogFreeList);
+
+        if (!pshared) {
+            /* can't share, followers run their own chains */
+            psc->leader = NULL;
+            return;
+        }
+        pshared->refs = 2;
+        pshared->orig = *pLog;
+        pLog->u.r.dtor = releaseShared;
+        pLog->u.r.pvt = pshared;
+        psc->pshared = pshared;
+    }
+    psc->result = *pLog;
+}
+
+static db_field_log* copySharedResult(sharedChain *psc)
+{
+    db_field_log *pLog;
+
+    if (!psc->valid)
+        return NULL;
+
+    pLog = (db_field_log *) freeListMalloc(dbevFieldLogFreeList);
+    if (pLog) {
+        *pLog = psc->result;
+        if (psc->pshared)
+            epicsAtomicIncrIntT(&psc->pshared->refs);
+    }
+    return pLog;
+}
+
 /*
  *  DB_POST_EVENTS()
  *
@@ -871,9 +1063,13 @@ unsigned int    caEventMask
 {
     struct dbCommon   * const prec = (struct dbCommon *) pRecord;
     struct evSubscrip *pevent;
+    sharedChain chains[MAX_SHARED_CHAINS];
+    int nchains = 0;
+    int i;
 
     if (prec->mlis.count == 0) return DB_EVENT_OK;       /* no monitors set */
 
+    dbTrace(dbtPostEvent, prec, caEventMask);
     LOCKREC (prec);
 
     for (pevent = (struct evSubscrip *) prec->mlis.node.next;
@@ -885,14 +1081,41 @@ unsigned int    caEventMask
          */
         if ( (dbChannelField(pevent->chan) == (void *)pField || pField==NULL) &&
             (caEventMask & pevent->select)) {
-            db_field_log *pLog = db_create_event_log(pevent);
+            db_field_log *pLog;
+            sharedChain *psc = NULL;
+            int share = dbEventShareFilters && canShareChain(pevent);
+
+            if (share) {
+                psc = findSharedChain(chains, nchains, pevent);
+                if (psc) {
+                    pLog = copySharedResult(psc);
+                    if (pLog) db_queue_event_log(pevent, pLog);
+                    continue;
+                }
+            }
+
+            pLog = db_create_event_log(pevent);
             if(pLog)
                 pLog->mask = caEventMask & pevent->select;
             pLog = dbChannelRunPreChain(pevent->chan, pLog);
+
+            if (share && nchains < MAX_SHARED_CHAINS) {
+                psc = &chains[nchains];
+                psc->leader = pevent;
+                saveSharedResult(psc, pLog);
+                if (psc->leader)
+                    nchains++;
+            }
             if (pLog) db_queue_event_log(pevent, pLog);
         }
     }
 
+    /* drop the references held by the chains */
+    for (i = 0; i < nchains; i++) {
+        if (chains[i].pshared)
+            releaseShared(&chains[i].result);
+    }
+
     UNLOCKREC (prec);
     return DB_EVENT_OK;
 
@@ -910,6 +1133,8 @@ void db_post_single_event (dbEventSubscription event)
     dbScanLock (prec);
 
     pLog = db_create_event_log(pevent);
+    if (pLog)
+        pLog->single = 1;
     pLog = dbChannelRunPreChain(pevent->chan, pLog);
     if(pLog) db_queue_event_log(pevent, pLog);
 
@@ -1072,12 +1297,14 @@ static void event_task (void *pParm)
         }
         evUser->extraLaborBusy = FALSE;
 
+        dbTrace(dbtEventBegin, evUser, 0);
         for ( ev_que = &evUser->firstque; ev_que;
                 ev_que = ev_que->nextque ) {
             epicsMutexUnlock ( evUser->lock );
             event_read (ev_que);
             epicsMutexMustLock ( evUser->lock );
         }
+        dbTrace(dbtEventEnd, evUser, 0);
         pendexit = evUser->pendexit;
         epicsMutexUnlock ( evUser->lock );
 
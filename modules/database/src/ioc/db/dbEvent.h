@@ -55,6 +55,9 @@ DBCORE_API void db_flush_extra_labor_event (dbEventCtx);
 DBCORE_API int db_post_extra_labor (dbEventCtx ctx);
 DBCORE_API void db_event_change_priority ( dbEventCtx ctx, unsigned epicsPriority );
 
+/* Non-zero: subscriptions with identical filters share one filter run */
+DBCORE_API extern int dbEventShareFilters;
+
 #ifdef EPICS_PRIVATE_API
 DBCORE_API void db_cleanup_events(void);
 DBCORE_API void db_init_event_freelists (void);
@@ -19,6 +19,8 @@
 #include "dbJLink.h"
 #include "dbLock.h"
 #include "dbNotify.h"
+#include "dbProcStats.h"
+#include "dbTrace.h"
 #include "dbScan.h"
 #include "dbServer.h"
 #include "dbState.h"
@@ -331,6 +333,65 @@ static const iocshFuncDef dbLockShowLockedFuncDef =
 static void dbLockShowLockedCallFunc(const iocshArgBuf *args)
 { dbLockShowLocked(args[0].ival);}
 
+/* dbpsEnable */
+static const iocshArg dbpsEnableArg0 = { "enable",iocshArgInt};
+static const iocshArg * const dbpsEnableArgs[1] = {&dbpsEnableArg0};
+static const iocshFuncDef dbpsEnableFuncDef = {"dbpsEnable",1,dbpsEnableArgs,
+    "Start (1) or stop (0) collecting record process time statistics.\n"};
+static void dbpsEnableCallFunc(const iocshArgBuf *args)
+{ dbpsEnable(args[0].ival);}
+
+/* dbpsReset */
+static const iocshFuncDef dbpsResetFuncDef = {"dbpsReset",0,0,
+    "Discard all record process time statistics.\n"};
+static void dbpsResetCallFunc(const iocshArgBuf *args)
+{ dbpsReset();}
+
+/* dbpsr */
+static const iocshArg dbpsrArg0 = { "count",iocshArgInt};
+static const iocshArg dbpsrArg1 = { "record type",iocshArgString};
+static const iocshArg * const dbpsrArgs[2] = {&dbpsrArg0,&dbpsrArg1};
+static const iocshFuncDef dbpsrFuncDef = {"dbpsr",2,dbpsrArgs,
+    "Database process statistics report.\n"
+    "Shows periodic scan list times, a summary per record type\n"
+    "and the 'count' records with the longest process time.\n"};
+static void dbpsrCallFunc(const iocshArgBuf *args)
+{ dbpsr(args[0].ival,args[1].sval);}
+
+/* dbpsDump */
+static const iocshArg dbpsDumpArg0 = { "file name",iocshArgString};
+static const iocshArg * const dbpsDumpArgs[1] = {&dbpsDumpArg0};
+static const iocshFuncDef dbpsDumpFuncDef = {"dbpsDump",1,dbpsDumpArgs,
+    "Write all process statistics to a file (or stdout) as JSON.\n"};
+static void dbpsDumpCallFunc(const iocshArgBuf *args)
+{ iocshSetError(dbpsDump(args[0].sval));}
+
+/* dbTraceEnable */
+static const iocshArg dbTraceEnableArg0 = { "enable",iocshArgInt};
+static const iocshArg * const dbTraceEnableArgs[1] = {&dbTraceEnableArg0};
+static const iocshFuncDef dbTraceEnableFuncDef = {"dbTraceEnable",1,
+    dbTraceEnableArgs,
+    "Start (1) or stop (0) tracing database activity.\n"
+    "Each thread keeps its last dbTraceRingSize events.\n"};
+static void dbTraceEnableCallFunc(const iocshArgBuf *args)
+{ dbTraceEnable(args[0].ival);}
+
+/* dbTraceReset */
+static const iocshFuncDef dbTraceResetFuncDef = {"dbTraceReset",0,0,
+    "Discard all traced events.\n"};
+static void dbTraceResetCallFunc(const iocshArgBuf *args)
+{ dbTraceReset();}
+
+/* dbTraceDump */
+static const iocshArg dbTraceDumpArg0 = { "file name",iocshArgString};
+static const iocshArg * const dbTraceDumpArgs[1] = {&dbTraceDumpArg0};
+static const iocshFuncDef dbTraceDumpFuncDef = {"dbTraceDump",1,
+    dbTraceDumpArgs,
+    "Write the traced events to a file (or stdout) in Chrome trace\n"
+    "JSON format, for viewing with Perfetto or chrome://tracing.\n"};
+static void dbTraceDumpCallFunc(const iocshArgBuf *args)
+{ iocshSetError(dbTraceDump(args[0].sval));}
+
 /* scanOnceSetQueueSize */
 static const iocshArg scanOnceSetQueueSizeArg0 = { "size",iocshArgInt};
 static const iocshArg * const scanOnceSetQueueSizeArgs[1] =
@@ -344,6 +405,31 @@ static void scanOnceSetQueueSizeCallFunc(const iocshArgBuf *args)
     scanOnceSetQueueSize(args[0].ival);
 }
 
+/* scanOnceSetThreads */
+static const iocshArg scanOnceSetThreadsArg0 = { "count",iocshArgInt};
+static const iocshArg * const scanOnceSetThreadsArgs[1] =
+    {&scanOnceSetThreadsArg0};
+static const iocshFuncDef scanOnceSetThreadsFuncDef =
+    {"scanOnceSetThreads",1,scanOnceSetThreadsArgs,
+     "Set number of threads executing Scan once requests.\n"
+     "Must be called before iocInit().\n"};
+static void scanOnceSetThreadsCallFunc(const iocshArgBuf *args)
+{
+    iocshSetError(scanOnceSetThreads(args[0].ival));
+}
+
+/* scanOnceSetCoalesce */
+static const iocshArg scanOnceSetCoalesceArg0 = { "enable",iocshArgInt};
+static const iocshArg * const scanOnceSetCoalesceArgs[1] =
+    {&scanOnceSetCoalesceArg0};
+static const iocshFuncDef scanOnceSetCoalesceFuncDef =
+    {"scanOnceSetCoalesce",1,scanOnceSetCoalesceArgs,
+     "Merge Scan once requests for records which are already queued.\n"};
+static void scanOnceSetCoalesceCallFunc(const iocshArgBuf *args)
+{
+    scanOnceSetCoalesce(args[0].ival);
+}
+
 /* scanOnceQueueShow */
 static const iocshArg scanOnceQueueShowArg0 = { "reset",iocshArgInt};
 static const iocshArg * const scanOnceQueueShowArgs[1] =
@@ -526,7 +612,17 @@ void dbIocRegister(void)
     iocshRegister(&dblsrFuncDef,dblsrCallFunc);
     iocshRegister(&dbLockShowLockedFuncDef,dbLockShowLockedCallFunc);
 
+    iocshRegister(&dbpsEnableFuncDef,dbpsEnableCallFunc);
+    iocshRegister(&dbpsResetFuncDef,dbpsResetCallFunc);
+    iocshRegister(&dbpsrFuncDef,dbpsrCallFunc);
+    iocshRegister(&dbpsDumpFuncDef,dbpsDumpCallFunc);
+    iocshRegister(&dbTraceEnableFuncDef,dbTraceEnableCallFunc);
+    iocshRegister(&dbTraceResetFuncDef,dbTraceResetCallFunc);
+    iocshRegister(&dbTraceDumpFuncDef,dbTraceDumpCallFunc);
+
     iocshRegister(&scanOnceSetQueueSizeFuncDef,scanOnceSetQueueSizeCallFunc);
+    iocshRegister(&scanOnceSetThreadsFuncDef,scanOnceSetThreadsCallFunc);
+    iocshRegister(&scanOnceSetCoalesceFuncDef,scanOnceSetCoalesceCallFunc);
     iocshRegister(&scanOnceQueueShowFuncDef,scanOnceQueueShowCallFunc);
     iocshRegister(&scanpplFuncDef,scanpplCallFunc);
     iocshRegister(&scanpelFuncDef,scanpelCallFunc);
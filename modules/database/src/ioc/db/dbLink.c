@@ -339,6 +339,21 @@ long dbGetLink(struct link *plink, short dbrType, void *pbuffer,
     return status;
 }
 
+long dbGetLinkRef(struct link *plink, short dbrType, void **ppbuffer,
+        long *pnRequest)
+{
+    long status;
+
+    if (plink->type != DB_LINK)
+        return dbGetLink(plink, dbrType, *ppbuffer, 0, pnRequest);
+
+    status = dbDbGetValueRef(plink, dbrType, ppbuffer, pnRequest);
+    if (status)
+        setLinkAlarm(plink);
+
+    return status;
+}
+
 long dbGetControlLimits(const struct link *plink, double *low, double *high)
 {
     lset *plset = plink->lset;
@@ -414,6 +414,12 @@ DBCORE_API long dbTryGetLink(struct link *, short dbrType, void *pbuffer,
         long *nRequest);
 DBCORE_API long dbGetLink(struct link *, short dbrType, void *pbuffer,
         long *options, long *nRequest);
+/* As dbGetLink(), but for a DB link to a field that holds elements of
+ * dbrType it may point *ppbuffer at the target's storage instead of copying.
+ * That data is only valid while the record is locked and must not be written.
+ */
+DBCORE_API long dbGetLinkRef(struct link *, short dbrType, void **ppbuffer,
+        long *nRequest);
 DBCORE_API long dbGetControlLimits(const struct link *plink, double *low,
         double *high);
 DBCORE_API long dbGetGraphicLimits(const struct link *plink, double *low,
@@ -23,6 +23,7 @@
 #include "epicsSpin.h"
 #include "epicsStdio.h"
 #include "epicsThread.h"
+#include "epicsTime.h"
 #include "errMdef.h"
 
 #include "dbAccessDefs.h"
@@ -30,8 +31,11 @@
 #include "dbBase.h"
 #include "dbLink.h"
 #include "dbCommon.h"
+#include "dbDbLinkPvt.h"
 #include "dbFldTypes.h"
 #include "dbLockPvt.h"
+#include "dbProcStatsPvt.h"
+#include "dbTracePvt.h"
 #include "dbStaticLib.h"
 #include "link.h"
 
@@ -183,11 +187,23 @@ unsigned long dbLockGetLockId(dbCommon *precord)
     return id;
 }
 
+size_t dbLockSetChanges(void)
+{
+#ifndef LOCKSET_NOCNT
+    return epicsAtomicGetSizeT(&recomputeCnt);
+#else
+    /* Without the counter, report a change every time */
+    static size_t calls;
+    return epicsAtomicIncrSizeT(&calls);
+#endif
+}
+
 void dbScanLock(dbCommon *precord)
 {
     int cnt;
     lockRecord * const lr = precord->lset;
     lockSet *ls;
+    epicsUInt64 waitNs = 0;
 
     assert(lr);
 
@@ -195,7 +211,16 @@ void dbScanLock(dbCommon *precord)
     assert(epicsAtomicGetIntT(&ls->refcount)>0);
 
 retry:
-    epicsMutexMustLock(ls->lock);
+    if (!dbProcStatsEnabled && !dbTraceEnabled) {
+        epicsMutexMustLock(ls->lock);
+    }
+    else if (epicsMutexTryLock(ls->lock) != epicsMutexLockOK) {
+        /* only time contended locks */
+        epicsUInt64 start = epicsMonotonicGet();
+
+        epicsMutexMustLock(ls->lock);
+        waitNs += epicsMonotonicGet() - start;
+    }
 
     epicsSpinLock(lr->spin);
     if(ls!=lr->plockSet) {
@@ -223,6 +248,12 @@ retry:
     cnt = epicsAtomicDecrIntT(&ls->refcount);
     assert(cnt>0);
 
+    if (waitNs) {
+        if (dbProcStatsEnabled)
+            dbProcStatsLockWait(precord, waitNs);
+        dbTrace(dbtLockWait, precord, waitNs);
+    }
+
 #ifdef LOCKSET_DEBUG
     if(ls->owner) {
         assert(ls->owner==epicsThreadGetIdSelf());
@@ -748,7 +779,7 @@ void dbLockSetSplit(dbLocker *locker, dbCommon *pfirst, dbCommon *psecond)
                 if(plink->type!=DB_LINK)
                     continue;
 
-                chan = plink->value.pv_link.pvt;
+                chan = dbDbLinkChannel(plink);
                 lr = dbChannelRecord(chan)->lset;
                 assert(lr);
 
@@ -926,7 +957,7 @@ long dblsr(char *recordname,int level)
                 pdbFldDes = pdbRecordType->papFldDes[pdbRecordType->link_ind[link]];
                 plink = (DBLINK *)((char *)precord + pdbFldDes->offset);
                 if(plink->type != DB_LINK) continue;
-                pdbAddr = (DBADDR *)(plink->value.pv_link.pvt);
+                pdbAddr = &dbDbLinkChannel(plink)->addr;
                 printf("\t%s",pdbFldDes->name);
                 if(pdbFldDes->field_type==DBF_INLINK) {
                     printf("\t INLINK");
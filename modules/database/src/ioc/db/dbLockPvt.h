@@ -105,6 +105,9 @@ void dbLockerPrepare(struct dbLocker *locker,
                      size_t nrecs);
 void dbLockerFinalize(dbLocker *);
 
+/* Changes whenever a record moves to another lock set */
+size_t dbLockSetChanges(void);
+
 void dbLockSetMerge(struct dbLocker *locker,
                     struct dbCommon *pfirst,
                     struct dbCommon *psecond);
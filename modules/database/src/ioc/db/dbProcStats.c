@@ -0,0 +1,397 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* dbProcStats.c */
+/* Optional record processing time statistics */
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "dbDefs.h"
+#include "epicsStdio.h"
+#include "errlog.h"
+
+#include "dbAccessDefs.h"
+#include "dbBase.h"
+#include "dbCommonPvt.h"
+#include "dbStaticLib.h"
+#include "dbProcStatsPvt.h"
+
+volatile int dbProcStatsEnabled = 0;
+
+void dbProcHistAdd(dbProcHist *phist, epicsUInt64 ns)
+{
+    epicsUInt64 us = ns / 1000u;
+    unsigned bin = 0;
+
+    while (us && bin < DBPS_NBINS - 1) {
+        us >>= 1;
+        bin++;
+    }
+    phist->bins[bin]++;
+    phist->count++;
+    phist->totalNs += ns;
+    if (ns > phist->maxNs)
+        phist->maxNs = ns;
+}
+
+static dbProcStatsRec * recStats(struct dbCommon *prec)
+{
+    dbCommonPvt *ppvt = dbRec2Pvt(prec);
+
+    if (!ppvt->procStats)
+        ppvt->procStats = calloc(1, sizeof(dbProcStatsRec));
+    return ppvt->procStats;
+}
+
+void dbProcStatsProcess(struct dbCommon *prec, epicsUInt64 ns)
+{
+    dbProcStatsRec *pstats = recStats(prec);
+
+    if (pstats)
+        dbProcHistAdd(&pstats->process, ns);
+}
+
+void dbProcStatsLockWait(struct dbCommon *prec, epicsUInt64 ns)
+{
+    dbProcStatsRec *pstats = recStats(prec);
+
+    if (pstats)
+        dbProcHistAdd(&pstats->lockWait, ns);
+}
+
+static void histMerge(dbProcHist *pto, const dbProcHist *pfrom)
+{
+    int i;
+
+    pto->count += pfrom->count;
+    pto->totalNs += pfrom->totalNs;
+    if (pfrom->maxNs > pto->maxNs)
+        pto->maxNs = pfrom->maxNs;
+    for (i = 0; i < DBPS_NBINS; i++)
+        pto->bins[i] += pfrom->bins[i];
+}
+
+double dbProcHistPercentile(const dbProcHist *phist, double fraction)
+{
+    /* the smallest number of samples that makes up the fraction */
+    epicsUInt64 limit = (epicsUInt64) ceil(phist->count * fraction);
+    epicsUInt64 sum = 0;
+    int i;
+
+    if (!phist->count)
+        return 0.0;
+    if (limit < 1)
+        limit = 1;
+    for (i = 0; i < DBPS_NBINS - 1; i++) {
+        sum += phist->bins[i];
+        if (sum >= limit)
+            break;
+    }
+    if (i == DBPS_NBINS - 1)
+        return phist->maxNs / 1e3;
+    return (double)(1u << i);
+}
+
+static double histMeanUs(const dbProcHist *phist)
+{
+    return phist->count ? phist->totalNs / 1e3 / phist->count : 0.0;
+}
+
+static dbProcStatsRec * entryStats(DBENTRY *pdbentry)
+{
+    struct dbCommon *prec = pdbentry->precnode->precord;
+
+    if (!prec || dbIsAlias(pdbentry))
+        return NULL;
+    return dbRec2Pvt(prec)->procStats;
+}
+
+long dbpsEnable(int enable)
+{
+    dbProcStatsEnabled = !!enable;
+    return 0;
+}
+
+static void scanReset(void *arg, const char *name, double period,
+    dbProcHist *phist)
+{
+    memset(phist, 0, sizeof(*phist));
+}
+
+long dbpsReset(void)
+{
+    DBENTRY dbentry;
+    long status;
+
+    if (!pdbbase) {
+        printf("No database loaded\n");
+        return 0;
+    }
+
+    scanPeriodicStats(scanReset, NULL);
+
+    dbInitEntry(pdbbase, &dbentry);
+    for (status = dbFirstRecordType(&dbentry); !status;
+         status = dbNextRecordType(&dbentry)) {
+        for (status = dbFirstRecord(&dbentry); !status;
+             status = dbNextRecord(&dbentry)) {
+            dbProcStatsRec *pstats = entryStats(&dbentry);
+
+            if (pstats)
+                memset(pstats, 0, sizeof(*pstats));
+        }
+    }
+    dbFinishEntry(&dbentry);
+    return 0;
+}
+
+long dbpsGet(const char *pname, dbProcHist *process, dbProcHist *lockWait)
+{
+    DBENTRY dbentry;
+    dbProcStatsRec *pstats = NULL;
+    long status;
+
+    if (!pdbbase)
+        return S_db_notFound;
+
+    dbInitEntry(pdbbase, &dbentry);
+    status = dbFindRecord(&dbentry, pname);
+    if (!status)
+        pstats = dbRec2Pvt(dbentry.precnode->precord)->procStats;
+    dbFinishEntry(&dbentry);
+    if (status)
+        return status;
+
+    if (process) {
+        if (pstats)
+            *process = pstats->process;
+        else
+            memset(process, 0, sizeof(*process));
+    }
+    if (lockWait) {
+        if (pstats)
+            *lockWait = pstats->lockWait;
+        else
+            memset(lockWait, 0, sizeof(*lockWait));
+    }
+    return 0;
+}
+
+static void scanReport(void *arg, const char *name, double period,
+    dbProcHist *phist)
+{
+    if (!phist->count)
+        return;
+    printf("  %-14s %10llu %11.3f %11.3f %11.3f %11.3f\n", name,
+        (unsigned long long) phist->count, histMeanUs(phist) / 1e3,
+        dbProcHistPercentile(phist, 0.99) / 1e3, phist->maxNs / 1e6,
+        period * 1e3);
+}
+
+typedef struct {
+    struct dbCommon *prec;
+    const dbProcStatsRec *pstats;
+} recEntry;
+
+static int cmpMax(const void *a, const void *b)
+{
+    epicsUInt64 ma = ((const recEntry *)a)->pstats->process.maxNs;
+    epicsUInt64 mb = ((const recEntry *)b)->pstats->process.maxNs;
+
+    return ma < mb ? 1 : ma > mb ? -1 : 0;
+}
+
+long dbpsr(int count, const char *recordTypeName)
+{
+    DBENTRY dbentry;
+    recEntry *precs = NULL;
+    size_t nrecs = 0, nalloc = 0;
+    long status;
+    int i;
+
+    if (!pdbbase) {
+        printf("No database loaded\n");
+        return 0;
+    }
+    if (count <= 0)
+        count = 10;
+    if (recordTypeName &&
+        (*recordTypeName == '\0' || !strcmp(recordTypeName, "*")))
+        recordTypeName = NULL;
+
+    if (!dbProcStatsEnabled)
+        printf("Process statistics are disabled, run 'dbpsEnable 1'\n");
+
+    printf("Periodic scan lists:\n"
+           "  %-14s %10s %11s %11s %11s %11s\n",
+           "SCAN", "COUNT", "MEAN(ms)", "P99<(ms)", "MAX(ms)", "PERIOD(ms)");
+    scanPeriodicStats(scanReport, NULL);
+
+    printf("Record types:\n"
+           "  %-14s %8s %12s %11s %11s %11s\n",
+           "TYPE", "RECORDS", "PROCESSED", "MEAN(us)", "MAX(us)", "LOCK(us)");
+
+    dbInitEntry(pdbbase, &dbentry);
+    if (recordTypeName)
+        status = dbFindRecordType(&dbentry, recordTypeName);
+    else
+        status = dbFirstRecordType(&dbentry);
+    if (status)
+        printf("No record type\n");
+
+    while (!status) {
+        dbProcHist process, lockWait;
+        int nrec = 0;
+
+        memset(&process, 0, sizeof(process));
+        memset(&lockWait, 0, sizeof(lockWait));
+
+        for (status = dbFirstRecord(&dbentry); !status;
+             status = dbNextRecord(&dbentry)) {
+            dbProcStatsRec *pstats = entryStats(&dbentry);
+
+            if (!pstats || !pstats->process.count)
+                continue;
+            nrec++;
+            histMerge(&process, &pstats->process);
+            histMerge(&lockWait, &pstats->lockWait);
+
+            if (nrecs == nalloc) {
+                recEntry *pnew;
+
+                nalloc = nalloc ? nalloc * 2 : 256;
+                pnew = realloc(precs, nalloc * sizeof(recEntry));
+                if (!pnew) {
+                    errlogPrintf("dbpsr: Out of memory\n");
+                    free(precs);
+                    dbFinishEntry(&dbentry);
+                    return -1;
+                }
+                precs = pnew;
+            }
+            precs[nrecs].prec = dbentry.precnode->precord;
+            precs[nrecs].pstats = pstats;
+            nrecs++;
+        }
+        if (nrec)
+            printf("  %-14s %8d %12llu %11.2f %11.2f %11.2f\n",
+                dbGetRecordTypeName(&dbentry), nrec,
+                (unsigned long long) process.count, histMeanUs(&process),
+                process.maxNs / 1e3, lockWait.maxNs / 1e3);
+
+        if (recordTypeName)
+            break;
+        status = dbNextRecordType(&dbentry);
+    }
+    dbFinishEntry(&dbentry);
+
+    if (nrecs) {
+        qsort(precs, nrecs, sizeof(recEntry), cmpMax);
+        printf("Slowest records:\n"
+               "  %-28s %10s %11s %11s %11s %11s\n",
+               "RECORD", "PROCESSED", "MEAN(us)", "P99<(us)", "MAX(us)",
+               "LOCK(us)");
+        for (i = 0; i < count && i < (int)nrecs; i++) {
+            const dbProcStatsRec *pstats = precs[i].pstats;
+
+            printf("  %-28s %10llu %11.2f %11.2f %11.2f %11.2f\n",
+                precs[i].prec->name,
+                (unsigned long long) pstats->process.count,
+                histMeanUs(&pstats->process),
+                dbProcHistPercentile(&pstats->process, 0.99),
+                pstats->process.maxNs / 1e3,
+                pstats->lockWait.maxNs / 1e3);
+        }
+    }
+    free(precs);
+    return 0;
+}
+
+static void dumpHist(FILE *fp, const dbProcHist *phist)
+{
+    int i;
+
+    fprintf(fp, "{\"count\":%llu,\"totalNs\":%llu,\"maxNs\":%llu,\"bins\":[",
+        (unsigned long long) phist->count,
+        (unsigned long long) phist->totalNs,
+        (unsigned long long) phist->maxNs);
+    for (i = 0; i < DBPS_NBINS; i++)
+        fprintf(fp, "%s%u", i ? "," : "", (unsigned) phist->bins[i]);
+    fprintf(fp, "]}");
+}
+
+typedef struct {
+    FILE *fp;
+    int n;
+} dumpArg;
+
+static void scanDump(void *arg, const char *name, double period,
+    dbProcHist *phist)
+{
+    dumpArg *pda = arg;
+
+    fprintf(pda->fp, "%s\n  {\"name\":\"%s\",\"period\":%g,\"hist\":",
+        pda->n++ ? "," : "", name, period);
+    dumpHist(pda->fp, phist);
+    fprintf(pda->fp, "}");
+}
+
+long dbpsDump(const char *filename)
+{
+    DBENTRY dbentry;
+    dumpArg da;
+    FILE *fp = stdout;
+    long status;
+
+    if (!pdbbase) {
+        printf("No database loaded\n");
+        return 0;
+    }
+    if (filename && *filename) {
+        fp = fopen(filename, "w");
+        if (!fp) {
+            errlogPrintf("dbpsDump: Can't open '%s' - %s\n",
+                filename, strerror(errno));
+            return -1;
+        }
+    }
+
+    fprintf(fp, "{\"binsUs\":\"log2\",\"scan\":[");
+    da.fp = fp;
+    da.n = 0;
+    scanPeriodicStats(scanDump, &da);
+
+    fprintf(fp, "\n],\"records\":[");
+    da.n = 0;
+    dbInitEntry(pdbbase, &dbentry);
+    for (status = dbFirstRecordType(&dbentry); !status;
+         status = dbNextRecordType(&dbentry)) {
+        for (status = dbFirstRecord(&dbentry); !status;
+             status = dbNextRecord(&dbentry)) {
+            dbProcStatsRec *pstats = entryStats(&dbentry);
+
+            if (!pstats)
+                continue;
+            fprintf(fp, "%s\n  {\"name\":\"%s\",\"type\":\"%s\",\"process\":",
+                da.n++ ? "," : "", dbGetRecordName(&dbentry),
+                dbGetRecordTypeName(&dbentry));
+            dumpHist(fp, &pstats->process);
+            fprintf(fp, ",\"lockWait\":");
+            dumpHist(fp, &pstats->lockWait);
+            fprintf(fp, "}");
+        }
+    }
+    dbFinishEntry(&dbentry);
+    fprintf(fp, "\n]}\n");
+
+    if (fp != stdout)
+        fclose(fp);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/** @file dbProcStats.h
+ * @brief Optional record processing time statistics
+ *
+ * When enabled, dbProcess() measures the time spent in each call to the
+ * record support process() routine and accumulates it into a per-record
+ * histogram.  dbScanLock() additionally records the time spent waiting for
+ * a contended lock set, and every periodic scan thread records the time
+ * taken to execute its scan list once.
+ *
+ * Histogram bins are logarithmic: bin 0 counts durations below 1 us,
+ * bin N counts durations in [2^(N-1), 2^N) us, and the last bin also
+ * counts everything longer.
+ *
+ * Statistics collection is off by default and costs one test of a global
+ * flag per dbProcess() call while disabled.  Memory for the per-record
+ * statistics is only allocated for records processed while enabled.
+ *
+ * <em>The functions declared here are also provided as IOC Shell
+ * commands.</em>
+ */
+
+#ifndef INCdbProcStatsH
+#define INCdbProcStatsH
+
+#include <stdio.h>
+
+#include "epicsTypes.h"
+#include "dbCoreAPI.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of histogram bins */
+#define DBPS_NBINS 24
+
+/** Duration histogram */
+typedef struct dbProcHist {
+    epicsUInt64 count;      /**< Number of samples */
+    epicsUInt64 totalNs;    /**< Sum of all samples in nanoseconds */
+    epicsUInt64 maxNs;      /**< Largest sample in nanoseconds */
+    epicsUInt32 bins[DBPS_NBINS];
+} dbProcHist;
+
+/** Non-zero while statistics are being collected */
+DBCORE_API extern volatile int dbProcStatsEnabled;
+
+/** @brief Add one sample to a histogram. */
+DBCORE_API void dbProcHistAdd(dbProcHist *phist, epicsUInt64 ns);
+
+/** @brief Estimate a percentile of a histogram.
+ *
+ * @param fraction Fraction of the samples, e.g. 0.99.
+ * @return Upper bound in microseconds of the bin that holds the sample
+ *         at that fraction, the largest sample for the last bin, or 0 if
+ *         the histogram is empty.
+ */
+DBCORE_API double dbProcHistPercentile(const dbProcHist *phist,
+    double fraction);
+
+/** @brief Start (enable!=0) or stop (enable==0) collecting statistics. */
+DBCORE_API long dbpsEnable(int enable);
+
+/** @brief Discard all statistics collected so far. */
+DBCORE_API long dbpsReset(void);
+
+/** @brief Copy the statistics of one record.
+ *
+ * @param pname Record name.
+ * @param process Receives the process() time histogram, may be NULL.
+ * @param lockWait Receives the lock wait histogram, may be NULL.
+ * @return 0, or an error status if the record doesn't exist.
+ *         Records without statistics return zeroed histograms.
+ */
+DBCORE_API long dbpsGet(const char *pname, dbProcHist *process,
+    dbProcHist *lockWait);
+
+/** @brief Print a statistics report.
+ *
+ * Shows the periodic scan lists, a summary per record type and the
+ * records with the largest maximum process time.
+ *
+ * @param count Number of records to list, default 10.
+ * @param recordTypeName Restrict the report to one record type, may be NULL.
+ */
+DBCORE_API long dbpsr(int count, const char *recordTypeName);
+
+/** @brief Write all statistics in JSON format.
+ *
+ * @param filename Output file name, or NULL/empty for stdout.
+ */
+DBCORE_API long dbpsDump(const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INCdbProcStatsH */
@@ -0,0 +1,37 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef INCdbProcStatsPvtH
+#define INCdbProcStatsPvtH
+
+#include "dbProcStats.h"
+
+struct dbCommon;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Per-record statistics, hung off dbCommonPvt::procStats */
+typedef struct dbProcStatsRec {
+    dbProcHist process;
+    dbProcHist lockWait;
+} dbProcStatsRec;
+
+/* Callers must hold the record's lock set */
+void dbProcStatsProcess(struct dbCommon *prec, epicsUInt64 ns);
+void dbProcStatsLockWait(struct dbCommon *prec, epicsUInt64 ns);
+
+/* Implemented in dbScan.c, visits every periodic scan list */
+typedef void (*scanStatsFunc)(void *arg, const char *name, double period,
+    dbProcHist *phist);
+void scanPeriodicStats(scanStatsFunc func, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INCdbProcStatsPvtH */
@@ -35,6 +35,7 @@
 #include "epicsString.h"
 #include "epicsThread.h"
 #include "epicsTime.h"
+#include "freeList.h"
 #include "taskwd.h"
 
 #include "callback.h"
@@ -42,13 +43,18 @@
 #include "dbAddr.h"
 #include "dbBase.h"
 #include "dbCommon.h"
+#include "dbCommonPvt.h"
 #include "dbFldTypes.h"
 #include "dbLock.h"
+#include "dbLockPvt.h"
+#include "dbProcStatsPvt.h"
+#include "dbTracePvt.h"
 #include "dbScan.h"
 #include "dbStaticLib.h"
 #include "devSup.h"
 #include "link.h"
 #include "recGbl.h"
+#include "epicsExport.h"
 
 
 /* Task Control */
@@ -62,18 +68,40 @@ static volatile enum ctl scanCtl;
 /* SCAN ONCE */
 
 static int onceQueueSize = 1000;
+static int onceThreads = 1;
+static int onceCoalesce = FALSE;
 static epicsEventId onceSem;
 static epicsRingBytesId onceQ;
 static int onceQOverruns = 0;
-static epicsThreadId onceTaskId;
+static epicsThreadId *onceTaskId;
 static void *exitOnce;
+static epicsMutexId onceLock;   /* guards dbCommonPvt::onceQueued/Waiters */
+static void *onceWaiterFreeList;
+
+/* Request statistics per calling thread name */
+#define MAX_ONCE_SOURCES 32
+typedef struct onceSource {
+    char name[32];
+    int requests;
+    int coalesced;
+    int overflows;
+} onceSource;
+static onceSource onceSources[MAX_ONCE_SOURCES + 1]; /* last is "(other)" */
+static int nOnceSources;
+static epicsMutexId onceSourceLock;
+static epicsThreadPrivateId onceSourceId;
+
+/* Time stamp read once per scan list pass, see dbScanCacheTimeStamp */
+int dbScanCacheTimeStamp = 0;
+epicsExportAddress(int, dbScanCacheTimeStamp);
+static epicsThreadPrivateId scanTimeId;
 
 
 /* All other scan types */
 typedef struct scan_list{
     epicsMutexId        lock;
     ELLLIST             list;
-    short               modified;/*has list been modified?*/
+    unsigned int        modcount;/*incremented when list is changed*/
 } scan_list;
 /*scan_elements are allocated and the address stored in dbCommon.spvt*/
 typedef struct scan_element{
@@ -94,6 +122,7 @@ typedef struct periodic_scan_list {
     unsigned long       overruns;
     volatile enum ctl   scanCtl;
     epicsEventId        loopEvent;
+    dbProcHist          stats;      /* scan list execution times */
 } periodic_scan_list;
 
 static int nPeriodic = 0;
@@ -119,9 +148,23 @@ static epicsMutexId event_lock;
 
 /* IO_EVENT*/
 
-typedef struct io_scan_list {
+#define MAX_IOSCAN_SHARDS 256
+
+struct ioscan_head;
+
+typedef struct io_scan_shard {
     epicsCallback callback;
     scan_list scan_list;
+    struct ioscan_head *piosh;
+    size_t lockChanges;     /* dbLockSetChanges() when last checked */
+} io_scan_shard;
+
+typedef struct io_scan_list {
+    epicsCallback callback;
+    scan_list scan_list;    /* all records, unless sharded */
+    io_scan_shard *shards;  /* nshards entries, or NULL */
+    unsigned int nshards;
+    int pending;            /* shard callbacks queued or running */
 } io_scan_list;
 
 typedef struct ioscan_head {
@@ -144,12 +187,18 @@ static void spawnPeriodic(int ind);
 static void eventCallback(epicsCallback *pcallback);
 static void ioscanInit(void);
 static void ioscanCallback(epicsCallback *pcallback);
+static void ioscanShardCallback(epicsCallback *pcallback);
 static void ioscanDestroy(void);
 static void printList(scan_list *psl, char *message);
 static void scanList(scan_list *psl);
 static void buildScanLists(void);
 static void addToList(struct dbCommon *precord, scan_list *psl);
 static void deleteFromList(struct dbCommon *precord, scan_list *psl);
+static scan_list *ioscanListFor(io_scan_list *piosl, struct dbCommon *precord);
+static scan_list *ioscanListHolding(io_scan_list *piosl,
+    struct dbCommon *precord);
+static void ioscanRegroup(io_scan_list *piosl, scan_list *psl);
+static void insertByPhas(scan_list *psl, scan_element *pse);
 
 void scanStop(void)
 {
@@ -169,8 +218,10 @@ void scanStop(void)
         epicsEventWait(startStopEvent);
     }
 
-    scanOnce((dbCommon *)&exitOnce);
-    epicsEventWait(startStopEvent);
+    for (i = 0; i < onceThreads; i++) {
+        scanOnce((dbCommon *)&exitOnce);
+        epicsEventWait(startStopEvent);
+    }
 }
 
 void scanCleanup(void)
@@ -180,6 +231,11 @@ void scanCleanup(void)
     ioscanDestroy();
 
     epicsRingBytesDelete(onceQ);
+    onceQ = NULL;
+    free(onceTaskId);
+    onceTaskId = NULL;
+    freeListCleanup(onceWaiterFreeList);
+    onceWaiterFreeList = NULL;
 
     free(periodicTaskId);
     papPeriodic = NULL;
@@ -192,6 +248,8 @@ long scanInit(void)
 
     if(!startStopEvent)
         startStopEvent = epicsEventMustCreate(epicsEventEmpty);
+    if (!scanTimeId)
+        scanTimeId = epicsThreadPrivateCreate();
     scanCtl = ctlPause;
 
     initPeriodic();
@@ -292,7 +350,7 @@ void scanAdd(struct dbCommon *precord)
             precord->scan = menuScanPassive;
             return;
         }
-        addToList(precord, &piosh->iosl[prio].scan_list);
+        addToList(precord, ioscanListFor(&piosh->iosl[prio], precord));
     } else if (scan >= SCAN_1ST_PERIODIC) {
         periodic_scan_list *ppsl = papPeriodic[scan - SCAN_1ST_PERIODIC];
 
@@ -353,7 +411,8 @@ void scanDelete(struct dbCommon *precord)
                 "scanDelete: get_ioint_info returned illegal priority");
             return;
         }
-        deleteFromList(precord, &piosh->iosl[prio].scan_list);
+        deleteFromList(precord,
+            ioscanListHolding(&piosh->iosl[prio], precord));
     } else if (scan >= SCAN_1ST_PERIODIC) {
         periodic_scan_list *ppsl = papPeriodic[scan - SCAN_1ST_PERIODIC];
 
@@ -404,6 +463,18 @@ int scanppl(double period)      /* print periodic scan list(s) */
     return 0;
 }
 
+void scanPeriodicStats(scanStatsFunc func, void *arg)
+{
+    int i;
+
+    for (i = 0; i < nPeriodic && papPeriodic; i++) {
+        periodic_scan_list *ppsl = papPeriodic[i];
+
+        if (ppsl)
+            func(arg, ppsl->name, ppsl->period, &ppsl->stats);
+    }
+}
+
 int scanpel(const char* eventname)   /* print event list */
 {
     char message[80];
@@ -437,10 +508,16 @@ int scanpiol(void)                  /* print pioscan_list */
         for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
             io_scan_list *piosl = &piosh->iosl[prio];
             char message[80];
+            unsigned int i;
 
             sprintf(message, "IO Event %p: Priority %s",
                 piosh, priorityName[prio]);
             printList(&piosl->scan_list, message);
+            for (i = 0; i < piosl->nshards; i++) {
+                sprintf(message, "IO Event %p: Priority %s, shard %u",
+                    piosh, priorityName[prio], i);
+                printList(&piosl->shards[i].scan_list, message);
+            }
         }
         piosh = piosh->next;
     }
@@ -572,8 +649,16 @@ static void ioscanDestroy(void)
         int prio;
 
         for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
-            epicsMutexDestroy(piosh->iosl[prio].scan_list.lock);
-            ellFree(&piosh->iosl[prio].scan_list.list);
+            io_scan_list *piosl = &piosh->iosl[prio];
+            unsigned int i;
+
+            for (i = 0; i < piosl->nshards; i++) {
+                epicsMutexDestroy(piosl->shards[i].scan_list.lock);
+                ellFree(&piosl->shards[i].scan_list.list);
+            }
+            free(piosl->shards);
+            epicsMutexDestroy(piosl->scan_list.lock);
+            ellFree(&piosl->scan_list.list);
         }
         free(piosh);
         piosh = pnext;
@@ -602,6 +687,133 @@ void scanIoInit(IOSCANPVT *pioscanpvt)
     *pioscanpvt = piosh;
 }
 
+static unsigned short shardOf(struct dbCommon *precord, unsigned nshards)
+{
+    /* Keep records of one lock set together so they are still
+     * processed in PHAS order by a single thread.
+     */
+    if (nshards <= 1 || !precord->lset)
+        return 0;
+    return dbLockGetLockId(precord) % nshards;
+}
+
+/* The list which a record belongs on */
+static scan_list *ioscanListFor(io_scan_list *piosl, struct dbCommon *precord)
+{
+    if (!piosl->nshards)
+        return &piosl->scan_list;
+    return &piosl->shards[shardOf(precord, piosl->nshards)].scan_list;
+}
+
+/* The list which a record is on now, which differs from ioscanListFor()
+ * while a changed lock set is waiting for its shard to be regrouped.
+ */
+static scan_list *ioscanListHolding(io_scan_list *piosl,
+    struct dbCommon *precord)
+{
+    scan_element *pse = precord->spvt;
+    unsigned int i;
+
+    for (i = 0; pse && i < piosl->nshards; i++) {
+        if (pse->pscan_list == &piosl->shards[i].scan_list)
+            return pse->pscan_list;
+    }
+    return &piosl->scan_list;
+}
+
+/* Number of records on a list and its shards */
+static int ioscanCount(io_scan_list *piosl)
+{
+    int count = ellCount(&piosl->scan_list.list);
+    unsigned int i;
+
+    for (i = 0; i < piosl->nshards; i++)
+        count += ellCount(&piosl->shards[i].scan_list.list);
+    return count;
+}
+
+/* May not be called while a scan request is queued or running */
+long scanIoSetShards(IOSCANPVT piosh, unsigned int nshards)
+{
+    int prio;
+
+    if (nshards > MAX_IOSCAN_SHARDS)
+        return S_db_errArg;
+    if (nshards <= 1)
+        nshards = 0;
+
+    for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
+        io_scan_list *piosl = &piosh->iosl[prio];
+        io_scan_shard *pold = piosl->shards;
+        unsigned int nold = piosl->nshards;
+        io_scan_shard *pshards = NULL;
+        ELLLIST moving = ELLLIST_INIT;
+        scan_element *pse;
+        unsigned int i;
+
+        if (nshards) {
+            pshards = dbCalloc(nshards, sizeof(io_scan_shard));
+            for (i = 0; i < nshards; i++) {
+                callbackSetCallback(ioscanShardCallback, &pshards[i].callback);
+                callbackSetPriority(prio, &pshards[i].callback);
+                callbackSetUser(&pshards[i], &pshards[i].callback);
+                ellInit(&pshards[i].scan_list.list);
+                pshards[i].scan_list.lock = epicsMutexMustCreate();
+                pshards[i].piosh = piosh;
+                pshards[i].lockChanges = dbLockSetChanges();
+            }
+        }
+
+        /* Gather every element, then sort them into the new lists */
+        epicsMutexMustLock(piosl->scan_list.lock);
+        ellConcat(&moving, &piosl->scan_list.list);
+        piosl->scan_list.modcount++;
+        for (i = 0; i < nold; i++) {
+            epicsMutexMustLock(pold[i].scan_list.lock);
+            ellConcat(&moving, &pold[i].scan_list.list);
+            pold[i].scan_list.modcount++;
+            epicsMutexUnlock(pold[i].scan_list.lock);
+        }
+        piosl->shards = pshards;
+        piosl->nshards = nshards;
+        while ((pse = (scan_element *)ellGet(&moving))) {
+            scan_list *psl = ioscanListFor(piosl, pse->precord);
+
+            epicsMutexMustLock(psl->lock);
+            insertByPhas(psl, pse);
+            epicsMutexUnlock(psl->lock);
+        }
+        epicsMutexUnlock(piosl->scan_list.lock);
+
+        for (i = 0; i < nold; i++)
+            epicsMutexDestroy(pold[i].scan_list.lock);
+        free(pold);
+    }
+    return 0;
+}
+
+static int ioscanRequestShards(ioscan_head *piosh, int prio)
+{
+    io_scan_list *piosl = &piosh->iosl[prio];
+    int nshards = piosl->nshards;
+    int i, nqueued = 0;
+
+    epicsAtomicAddIntT(&piosl->pending, nshards);
+    for (i = 0; i < nshards; i++) {
+        if (!callbackRequest(&piosl->shards[i].callback))
+            nqueued++;
+    }
+    /* Drop the count for shards which couldn't be queued.  If the
+     * queued shards have all finished already, complete for them.
+     */
+    if (nqueued < nshards &&
+        !epicsAtomicAddIntT(&piosl->pending, nqueued - nshards) &&
+        nqueued && piosh->cb)
+        piosh->cb(piosh->arg, piosh, prio);
+
+    return nqueued > 0;
+}
+
 /* Return a bit mask indicating each priority level
  * in which a callback request was successfully queued.
  */
@@ -613,12 +825,18 @@ unsigned int scanIoRequest(IOSCANPVT piosh)
     if (scanCtl != ctlRun)
         return 0;
 
+    dbTrace(dbtIoRequest, piosh, 0);
     for (prio = 0; prio < NUM_CALLBACK_PRIORITIES; prio++) {
         io_scan_list *piosl = &piosh->iosl[prio];
 
-        if (ellCount(&piosl->scan_list.list) > 0)
-            if (!callbackRequest(&piosl->callback))
+        if (ioscanCount(piosl) == 0)
+            continue;
+        if (piosl->shards) {
+            if (ioscanRequestShards(piosh, prio))
                 queued |= 1 << prio;
+        }
+        else if (!callbackRequest(&piosl->callback))
+            queued |= 1 << prio;
     }
 
     return queued;
@@ -627,6 +845,7 @@ unsigned int scanIoRequest(IOSCANPVT piosh)
 unsigned int scanIoImmediate(IOSCANPVT piosh, int prio)
 {
     io_scan_list *piosl;
+    unsigned int i;
 
     if (prio<0 || prio>=NUM_CALLBACK_PRIORITIES)
         return S_db_errArg;
@@ -635,10 +854,12 @@ unsigned int scanIoImmediate(IOSCANPVT piosh, int prio)
 
     piosl = &piosh->iosl[prio];
 
-    if (ellCount(&piosl->scan_list.list) == 0)
+    if (ioscanCount(piosl) == 0)
         return 0;
 
     scanList(&piosl->scan_list);
+    for (i = 0; i < piosl->nshards; i++)
+        scanList(&piosl->shards[i].scan_list);
 
     if (piosh->cb)
         piosh->cb(piosh->arg, piosh, prio);
@@ -661,27 +882,112 @@ typedef struct {
     struct dbCommon *prec;
     once_complete cb;
     void *usr;
+    int coalesced;      /* owns the record's onceQueued flag */
 } onceEntry;
 
+/* Callback of a request merged into an already queued entry */
+typedef struct onceWaiter {
+    struct onceWaiter *next;
+    once_complete cb;
+    void *usr;
+} onceWaiter;
+
+/* Find (or create) the statistics entry for the calling thread */
+static onceSource *onceSourceSelf(void)
+{
+    onceSource *psrc = epicsThreadPrivateGet(onceSourceId);
+
+    if (!psrc) {
+        char name[sizeof(psrc->name)];
+        int i;
+
+        strncpy(name, epicsThreadGetNameSelf(), sizeof(name));
+        name[sizeof(name) - 1] = '\0';
+
+        epicsMutexMustLock(onceSourceLock);
+        for (i = 0; i < nOnceSources; i++) {
+            if (!strcmp(onceSources[i].name, name))
+                break;
+        }
+        if (i == nOnceSources) {
+            if (nOnceSources < MAX_ONCE_SOURCES) {
+                strcpy(onceSources[i].name, name);
+                nOnceSources++;
+            }
+            else
+                i = MAX_ONCE_SOURCES;   /* "(other)" */
+        }
+        psrc = &onceSources[i];
+        epicsMutexUnlock(onceSourceLock);
+        epicsThreadPrivateSet(onceSourceId, psrc);
+    }
+    return psrc;
+}
+
 int scanOnceCallback(struct dbCommon *precord, once_complete cb, void *usr)
 {
     static int newOverflow = TRUE;
+    onceSource *psrc = onceSourceSelf();
     onceEntry ent;
     int pushOK;
+    /* the shutdown request is not a record */
+    int isExit = precord == (void*)&exitOnce;
 
     ent.prec = precord;
     ent.cb = cb;
     ent.usr = usr;
-
-    pushOK = epicsRingBytesPut(onceQ, (void*)&ent, sizeof(ent));
+    ent.coalesced = onceCoalesce && !isExit;
+
+    epicsAtomicIncrIntT(&psrc->requests);
+
+    if (ent.coalesced) {
+        dbCommonPvt *ppvt = dbRec2Pvt(precord);
+
+        /* The record's flag and waiter list are guarded by onceLock,
+         * which is also held while pushing so that nothing can be
+         * merged into an entry that failed to queue.
+         */
+        epicsMutexMustLock(onceLock);
+        if (ppvt->onceQueued) {
+            if (cb) {
+                onceWaiter *pw = freeListMalloc(onceWaiterFreeList);
+                onceWaiter **ppw = &ppvt->onceWaiters;
+
+                pw->next = NULL;
+                pw->cb = cb;
+                pw->usr = usr;
+                while (*ppw)
+                    ppw = &(*ppw)->next;
+                *ppw = pw;
+            }
+            epicsMutexUnlock(onceLock);
+            epicsAtomicIncrIntT(&psrc->coalesced);
+            return 0;
+        }
+        /* before the push, the request may run immediately */
+        dbTrace(dbtOnceQueue, precord, 0);
+        pushOK = epicsRingBytesPut(onceQ, (void*)&ent, sizeof(ent));
+        if (pushOK)
+            ppvt->onceQueued = 1;
+        epicsMutexUnlock(onceLock);
+    }
+    else {
+        if (!isExit)
+            dbTrace(dbtOnceQueue, precord, 0);
+        pushOK = epicsRingBytesPut(onceQ, (void*)&ent, sizeof(ent));
+    }
 
     if (!pushOK) {
-        if (newOverflow) errlogPrintf("scanOnce: Ring buffer overflow\n");
+        if (newOverflow)
+            errlogPrintf("scanOnce: Ring buffer overflow, request from '%s'\n",
+                epicsThreadGetNameSelf());
         newOverflow = FALSE;
         epicsAtomicIncrIntT(&onceQOverruns);
-    } else {
+        epicsAtomicIncrIntT(&psrc->overflows);
+        if (!isExit)
+            dbTrace(dbtOnceOverflow, precord, 0);
+    } else
         newOverflow = TRUE;
-    }
     epicsEventSignal(onceSem);
 
     return !pushOK;
@@ -697,6 +1003,7 @@ static void onceTask(void *arg)
         epicsEventMustWait(onceSem);
         while(1) {
             onceEntry ent;
+            onceWaiter *pwaiters = NULL;
             int bytes = epicsRingBytesGet(onceQ, (void*)&ent, sizeof(ent));
             if(bytes==0)
                 break;
@@ -706,11 +1013,35 @@ static void onceTask(void *arg)
                 continue; /* what to do? */
             } else if (ent.prec == (void*)&exitOnce) goto shutdown;
 
+            /* Let another executor thread help with the rest */
+            if (onceThreads > 1 && !epicsRingBytesIsEmpty(onceQ))
+                epicsEventSignal(onceSem);
+
+            if (ent.coalesced) {
+                dbCommonPvt *ppvt = dbRec2Pvt(ent.prec);
+
+                /* Requests arriving from now on need another pass */
+                epicsMutexMustLock(onceLock);
+                ppvt->onceQueued = 0;
+                pwaiters = ppvt->onceWaiters;
+                ppvt->onceWaiters = NULL;
+                epicsMutexUnlock(onceLock);
+            }
+
+            dbTrace(dbtOnceBegin, ent.prec, 0);
             dbScanLock(ent.prec);
             dbProcess(ent.prec);
             dbScanUnlock(ent.prec);
             if(ent.cb)
                 ent.cb(ent.usr, ent.prec);
+            while (pwaiters) {
+                onceWaiter *pnext = pwaiters->next;
+
+                pwaiters->cb(pwaiters->usr, ent.prec);
+                freeListFree(onceWaiterFreeList, pwaiters);
+                pwaiters = pnext;
+            }
+            dbTrace(dbtOnceEnd, ent.prec, 0);
         }
     }
 
@@ -725,21 +1056,51 @@ int scanOnceSetQueueSize(int size)
     return 0;
 }
 
+int scanOnceSetThreads(int nthreads)
+{
+    if (onceQ) {
+        errlogPrintf("scanOnceSetThreads: must be called before iocInit\n");
+        return -1;
+    }
+    if (nthreads < 1)
+        nthreads = 1;
+    onceThreads = nthreads;
+    return 0;
+}
+
+int scanOnceSetCoalesce(int enable)
+{
+    onceCoalesce = !!enable;
+    return 0;
+}
+
 int scanOnceQueueStatus(const int reset, scanOnceQueueStats *result)
 {
     int ret;
     if (!onceQ) return -1;
     if (result) {
+        int i, coalesced = 0;
+
+        for (i = 0; i <= MAX_ONCE_SOURCES; i++)
+            coalesced += epicsAtomicGetIntT(&onceSources[i].coalesced);
         result->size = epicsRingBytesSize(onceQ) / sizeof(onceEntry);
         result->numUsed = epicsRingBytesUsedBytes(onceQ) / sizeof(onceEntry);
         result->maxUsed = epicsRingBytesHighWaterMark(onceQ) / sizeof(onceEntry);
         result->numOverflow = epicsAtomicGetIntT(&onceQOverruns);
+        result->numCoalesced = coalesced;
         ret = 0;
     } else {
         ret = -2;
     }
     if (reset) {
+        int i;
+
         epicsRingBytesResetHighWaterMark(onceQ);
+        for (i = 0; i <= MAX_ONCE_SOURCES; i++) {
+            epicsAtomicSetIntT(&onceSources[i].requests, 0);
+            epicsAtomicSetIntT(&onceSources[i].coalesced, 0);
+            epicsAtomicSetIntT(&onceSources[i].overflows, 0);
+        }
     }
     return ret;
 }
@@ -747,32 +1108,74 @@ int scanOnceQueueStatus(const int reset, scanOnceQueueStats *result)
 void scanOnceQueueShow(const int reset)
 {
     scanOnceQueueStats stats;
-    if (scanOnceQueueStatus(reset, &stats) == -1) {
+    int i;
+
+    if (!onceQ) {
         fprintf(stderr, "scanOnce system not initialized, yet. Please run "
             "iocInit before using this command.\n");
-    } else {
+        return;
+    }
+
+    /* Print before scanOnceQueueStatus() resets the source counters */
+    printf("SOURCE                           REQUESTS  COALESCED  OVERFLOWS\n");
+    for (i = 0; i <= MAX_ONCE_SOURCES; i++) {
+        onceSource *psrc = &onceSources[i];
+        int requests = epicsAtomicGetIntT(&psrc->requests);
+
+        if (!requests)
+            continue;
+        printf("%-31s  %8d  %9d  %9d\n", psrc->name, requests,
+               epicsAtomicGetIntT(&psrc->coalesced),
+               epicsAtomicGetIntT(&psrc->overflows));
+    }
+
+    scanOnceQueueStatus(reset, &stats);
+    {
         double qusage = 100.0 * stats.numUsed / stats.size;
         printf("PRIORITY  HIGH-WATER MARK  ITEMS IN Q  Q SIZE  %% USED  Q OVERFLOWS\n");
         printf("%8s  %15d  %10d  %6d  %6.1f  %11d\n", "scanOnce", stats.maxUsed,
                stats.numUsed, stats.size, qusage,
                epicsAtomicGetIntT(&onceQOverruns));
+        printf("%d executor thread(s), coalescing %s, %d requests coalesced\n",
+               onceThreads, onceCoalesce ? "enabled" : "disabled",
+               stats.numCoalesced);
     }
 }
 
 static void initOnce(void)
 {
+    int i;
+
     if ((onceQ = epicsRingBytesLockedCreate(sizeof(onceEntry)*onceQueueSize)) == NULL) {
         cantProceed("initOnce: Ring buffer create failed\n");
     }
     if(!onceSem)
         onceSem = epicsEventMustCreate(epicsEventEmpty);
-    onceTaskId = epicsThreadCreate("scanOnce",
-        epicsThreadPriorityScanLow + nPeriodic,
-        epicsThreadGetStackSize(epicsThreadStackBig), onceTask, 0);
+    if (!onceLock) {
+        onceLock = epicsMutexMustCreate();
+        onceSourceLock = epicsMutexMustCreate();
+        onceSourceId = epicsThreadPrivateCreate();
+        strcpy(onceSources[MAX_ONCE_SOURCES].name, "(other)");
+    }
+    if (!onceWaiterFreeList)
+        freeListInitPvt(&onceWaiterFreeList, sizeof(onceWaiter), 64);
 
-    epicsEventWait(startStopEvent);
+    onceTaskId = dbCalloc(onceThreads, sizeof(epicsThreadId));
+    for (i = 0; i < onceThreads; i++) {
+        char taskName[20];
+
+        if (onceThreads == 1)
+            strcpy(taskName, "scanOnce");
+        else
+            sprintf(taskName, "scanOnce-%d", i);
+        onceTaskId[i] = epicsThreadCreate(taskName,
+            epicsThreadPriorityScanLow + nPeriodic,
+            epicsThreadGetStackSize(epicsThreadStackBig), onceTask, 0);
+
+        epicsEventWait(startStopEvent);
+    }
 }
-
+
 static void periodicTask(void *arg)
 {
     periodic_scan_list *ppsl = (periodic_scan_list *)arg;
@@ -794,8 +1197,16 @@ static void periodicTask(void *arg)
         double delay;
         epicsTimeStamp now;
 
-        if (ppsl->scanCtl == ctlRun)
-            scanList(&ppsl->scan_list);
+        if (ppsl->scanCtl == ctlRun) {
+            if (dbProcStatsEnabled) {
+                epicsUInt64 start = epicsMonotonicGet();
+
+                scanList(&ppsl->scan_list);
+                dbProcHistAdd(&ppsl->stats, epicsMonotonicGet() - start);
+            }
+            else
+                scanList(&ppsl->scan_list);
+        }
 
         epicsTimeAddSeconds(&next, ppsl->period);
         epicsTimeGetMonotonic(&now);
@@ -956,6 +1367,35 @@ static void ioscanCallback(epicsCallback *pcallback)
         piosh->cb(piosh->arg, piosh, prio);
 }
 
+static void ioscanShardCallback(epicsCallback *pcallback)
+{
+    io_scan_shard *pshard;
+    ioscan_head *piosh;
+    io_scan_list *piosl;
+    size_t changes = dbLockSetChanges();
+    int prio;
+
+    callbackGetUser(pshard, pcallback);
+    callbackGetPriority(prio, pcallback);
+    piosh = pshard->piosh;
+    piosl = &piosh->iosl[prio];
+    scanList(&pshard->scan_list);
+
+    /* Lock sets merged or split at run time may have left records of one
+     * lock set in different shards.  They were processed safely under
+     * dbScanLock(), but move them now so later requests keep each lock set
+     * on one thread again.
+     */
+    if (changes != epicsAtomicGetSizeT(&pshard->lockChanges)) {
+        ioscanRegroup(piosl, &pshard->scan_list);
+        epicsAtomicSetSizeT(&pshard->lockChanges, changes);
+    }
+
+    /* The last shard to finish reports completion */
+    if (!epicsAtomicDecrIntT(&piosl->pending) && piosh->cb)
+        piosh->cb(piosh->arg, piosh, prio);
+}
+
 static void printList(scan_list *psl, char *message)
 {
     scan_element *pse;
@@ -981,18 +1421,65 @@ static void printList(scan_list *psl, char *message)
     }
 }
 
+/* Move records which no longer belong on the shard list psl */
+static void ioscanRegroup(io_scan_list *piosl, scan_list *psl)
+{
+    for (;;) {
+        struct dbCommon *precord = NULL;
+        scan_element *pse;
+
+        epicsMutexMustLock(psl->lock);
+        for (pse = (scan_element *)ellFirst(&psl->list); pse;
+             pse = (scan_element *)ellNext(&pse->node)) {
+            if (ioscanListFor(piosl, pse->precord) != psl) {
+                precord = pse->precord;
+                break;
+            }
+        }
+        epicsMutexUnlock(psl->lock);
+        if (!precord)
+            break;
+
+        /* scanAdd() and scanDelete() are called with the record locked */
+        dbScanLock(precord);
+        pse = precord->spvt;
+        if (pse->pscan_list == psl) {
+            scan_list *pdest = ioscanListFor(piosl, precord);
+
+            if (pdest != psl) {
+                deleteFromList(precord, psl);
+                addToList(precord, pdest);
+            }
+        }
+        dbScanUnlock(precord);
+    }
+}
+
 static void scanList(scan_list *psl)
 {
     /* When reading this code remember that the call to dbProcess can result
      * in the SCAN field being changed in an arbitrary number of records.
+     * A list may be scanned by several callback threads at once, so each
+     * caller keeps its own copy of the list's modification count.
      */
 
     scan_element *pse;
     scan_element *prev = NULL;
     scan_element *next = NULL;
+    unsigned int modcount;
+    epicsTimeStamp now;
+    epicsTimeStamp *pouter = NULL;
+    int cacheTime = dbScanCacheTimeStamp && scanTimeId &&
+        epicsTimeGetCurrent(&now) == epicsTimeOK;
+
+    if (cacheTime) {
+        /* scanIoImmediate() may nest scanList() calls, restore at exit */
+        pouter = epicsThreadPrivateGet(scanTimeId);
+        epicsThreadPrivateSet(scanTimeId, &now);
+    }
 
     epicsMutexMustLock(psl->lock);
-    psl->modified = FALSE;
+    modcount = psl->modcount;
     pse = (scan_element *)ellFirst(&psl->list);
     if (pse) next = (scan_element *)ellNext(&pse->node);
     epicsMutexUnlock(psl->lock);
@@ -1005,39 +1492,50 @@ static void scanList(scan_list *psl)
         dbScanUnlock(precord);
 
         epicsMutexMustLock(psl->lock);
-        if (!psl->modified) {
+        if (psl->modcount == modcount) {
             prev = pse;
             pse = (scan_element *)ellNext(&pse->node);
-            if (pse) next = (scan_element *)ellNext(&pse->node);
         } else if (pse->pscan_list == psl) {
             /*This scan element is still in same scan list*/
             prev = pse;
             pse = (scan_element *)ellNext(&pse->node);
-            if (pse) next = (scan_element *)ellNext(&pse->node);
-            psl->modified = FALSE;
+            modcount = psl->modcount;
         } else if (prev && prev->pscan_list == psl) {
             /*Previous scan element is still in same scan list*/
             pse = (scan_element *)ellNext(&prev->node);
-            if (pse) {
+            if (pse)
                 prev = (scan_element *)ellPrevious(&pse->node);
-                next = (scan_element *)ellNext(&pse->node);
-            }
-            psl->modified = FALSE;
+            modcount = psl->modcount;
         } else if (next && next->pscan_list == psl) {
             /*Next scan element is still in same scan list*/
             pse = next;
             prev = (scan_element *)ellPrevious(&pse->node);
-            next = (scan_element *)ellNext(&pse->node);
-            psl->modified = FALSE;
+            modcount = psl->modcount;
         } else {
             /*Too many changes. Just wait till next period*/
             epicsMutexUnlock(psl->lock);
-            return;
+            break;
         }
+        if (pse) next = (scan_element *)ellNext(&pse->node);
         epicsMutexUnlock(psl->lock);
     }
+    if (cacheTime)
+        epicsThreadPrivateSet(scanTimeId, pouter);
 }
-
+
+int scanTimeStampGet(epicsTimeStamp *pts)
+{
+    epicsTimeStamp *pcached;
+
+    if (!scanTimeId)
+        return -1;
+    pcached = epicsThreadPrivateGet(scanTimeId);
+    if (!pcached)
+        return -1;
+    *pts = *pcached;
+    return 0;
+}
+
 static void buildScanLists(void)
 {
     dbRecordType *pdbRecordType;
@@ -1061,9 +1559,23 @@ static void buildScanLists(void)
     }
 }
 
+/* Insert in PHAS order, psl->lock must be held */
+static void insertByPhas(scan_list *psl, scan_element *pse)
+{
+    scan_element *ptemp = (scan_element *)ellLast(&psl->list);
+
+    while (ptemp) {
+        if (ptemp->precord->phas <= pse->precord->phas) break;
+        ptemp = (scan_element *)ellPrevious(&ptemp->node);
+    }
+    pse->pscan_list = psl;
+    ellInsert(&psl->list, (ptemp ? &ptemp->node : NULL), &pse->node);
+    psl->modcount++;
+}
+
 static void addToList(struct dbCommon *precord, scan_list *psl)
 {
-    scan_element *pse, *ptemp;
+    scan_element *pse;
 
     epicsMutexMustLock(psl->lock);
     pse = precord->spvt;
@@ -1072,14 +1584,7 @@ static void addToList(struct dbCommon *precord, scan_list *psl)
         precord->spvt = pse;
         pse->precord = precord;
     }
-    pse->pscan_list = psl;
-    ptemp = (scan_element *)ellLast(&psl->list);
-    while (ptemp) {
-        if (ptemp->precord->phas <= precord->phas) break;
-        ptemp = (scan_element *)ellPrevious(&ptemp->node);
-    }
-    ellInsert(&psl->list, (ptemp ? &ptemp->node : NULL), &pse->node);
-    psl->modified = TRUE;
+    insertByPhas(psl, pse);
     epicsMutexUnlock(psl->lock);
 }
 
@@ -1105,6 +1610,6 @@ static void deleteFromList(struct dbCommon *precord, scan_list *psl)
     }
     pse->pscan_list = NULL;
     ellDelete(&psl->list, &pse->node);
-    psl->modified = TRUE;
+    psl->modcount++;
     epicsMutexUnlock(psl->lock);
 }
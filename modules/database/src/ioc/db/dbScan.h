@@ -48,6 +48,7 @@ typedef struct scanOnceQueueStats {
     int numUsed;
     int maxUsed;
     int numOverflow;
+    int numCoalesced;
 } scanOnceQueueStats;
 
 DBCORE_API long scanInit(void);
@@ -65,6 +66,13 @@ DBCORE_API double scanPeriod(int scan);
 DBCORE_API int scanOnce(struct dbCommon *);
 DBCORE_API int scanOnceCallback(struct dbCommon *, once_complete cb, void *usr);
 DBCORE_API int scanOnceSetQueueSize(int size);
+/* Number of threads executing scanOnce requests, set before iocInit */
+DBCORE_API int scanOnceSetThreads(int nthreads);
+/* While enabled, a request for a record which is already queued and not
+ * yet being processed is merged into the queued request.  Any callback
+ * is run after that request has processed the record.
+ */
+DBCORE_API int scanOnceSetCoalesce(int enable);
 DBCORE_API int scanOnceQueueStatus(const int reset, scanOnceQueueStats *result);
 DBCORE_API void scanOnceQueueShow(const int reset);
 
@@ -81,6 +89,25 @@ DBCORE_API void scanIoInit(IOSCANPVT *ppios);
 DBCORE_API unsigned int scanIoRequest(IOSCANPVT pios);
 DBCORE_API unsigned int scanIoImmediate(IOSCANPVT pios, int prio);
 DBCORE_API void scanIoSetComplete(IOSCANPVT, io_scan_complete, void *usr);
+/* Split each priority's I/O Intr list into nshards parts that are queued
+ * as separate callbacks, so they run concurrently when callbackParallelThreads
+ * provides enough workers.  Records sharing a lock set go into one shard.
+ * The io_scan_complete callback runs once, after the last shard finishes.
+ * May not be called while a scan request is queued or running.
+ */
+DBCORE_API long scanIoSetShards(IOSCANPVT, unsigned int nshards);
+
+/* Non-zero: records processed in one pass over a scan list get the same
+ * current time stamp, read once at the start of the pass */
+DBCORE_API extern int dbScanCacheTimeStamp;
+
+#ifdef EPICS_PRIVATE_API
+struct epicsTimeStamp;
+/* Copy the time stamp cached by the scan list pass running on this thread.
+ * Returns non-zero if there is none.
+ */
+DBCORE_API int scanTimeStampGet(struct epicsTimeStamp *pts);
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,374 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* dbTrace.c */
+/* Per-thread event trace rings */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "dbDefs.h"
+#include "ellLib.h"
+#include "epicsAtomic.h"
+#include "epicsExit.h"
+#include "epicsInterrupt.h"
+#include "epicsMutex.h"
+#include "epicsThread.h"
+#include "epicsTime.h"
+#include "errlog.h"
+#include "epicsExport.h"
+
+#include "dbCommon.h"
+#include "dbTracePvt.h"
+
+volatile int dbTraceEnabled = 0;
+
+int dbTraceRingSize = 8192;
+epicsExportAddress(int, dbTraceRingSize);
+
+typedef struct traceEntry {
+    epicsUInt64 ns;
+    const void *obj;
+    epicsUInt64 arg;
+    epicsUInt32 type;
+} traceEntry;
+
+/* Only the owning thread writes entries and head.  A reader copies entries
+ * and then discards those the owner may have overwritten meanwhile.
+ * When the owner exits its ring is kept for dumping until another thread
+ * takes it over.
+ */
+typedef struct traceRing {
+    ELLNODE node;
+    unsigned tid;
+    char name[32];
+    int unused;             /* owner has exited */
+    size_t mask;
+    size_t head;            /* count of entries ever added */
+    traceEntry ent[1];
+} traceRing;
+
+static epicsThreadOnceId traceOnce = EPICS_THREAD_ONCE_INIT;
+static epicsThreadPrivateId traceRingId;
+static epicsMutexId traceLock;
+static ELLLIST traceRings = ELLLIST_INIT;   /* traceRing */
+static unsigned traceNextTid = 1;
+static epicsUInt64 traceStart;              /* ignore entries older */
+
+static void traceInit(void *arg)
+{
+    traceRingId = epicsThreadPrivateCreate();
+    traceLock = epicsMutexMustCreate();
+    traceStart = epicsMonotonicGet();
+}
+
+static void ringRelease(void *arg)
+{
+    traceRing *ring = arg;
+
+    epicsThreadPrivateSet(traceRingId, NULL);
+    epicsMutexMustLock(traceLock);
+    ring->unused = 1;
+    epicsMutexUnlock(traceLock);
+}
+
+/* Take over the ring of an exited thread, or NULL if there is none */
+static traceRing * ringReuse(size_t size)
+{
+    traceRing *ring;
+
+    for (ring = (traceRing *) ellFirst(&traceRings); ring;
+         ring = (traceRing *) ellNext(&ring->node)) {
+        if (!ring->unused)
+            continue;
+        if (ring->mask + 1 != size) {
+            /* dbTraceRingSize was changed */
+            ellDelete(&traceRings, &ring->node);
+            free(ring);
+            return NULL;
+        }
+        ring->unused = 0;
+        ring->head = 0;
+        return ring;
+    }
+    return NULL;
+}
+
+static traceRing * ringSelf(void)
+{
+    traceRing *ring = epicsThreadPrivateGet(traceRingId);
+    size_t size = 16;
+
+    if (ring)
+        return ring;
+
+    while (size < (size_t) dbTraceRingSize)
+        size <<= 1;
+
+    epicsMutexMustLock(traceLock);
+    ring = ringReuse(size);
+    if (!ring) {
+        ring = calloc(1, sizeof(traceRing) + (size - 1) * sizeof(traceEntry));
+        if (!ring) {
+            epicsMutexUnlock(traceLock);
+            return NULL;
+        }
+        ring->mask = size - 1;
+        ellAdd(&traceRings, &ring->node);
+    }
+    ring->tid = traceNextTid++;
+    strncpy(ring->name, epicsThreadGetNameSelf(), sizeof(ring->name));
+    ring->name[sizeof(ring->name) - 1] = '\0';
+    epicsMutexUnlock(traceLock);
+
+    epicsThreadPrivateSet(traceRingId, ring);
+    epicsAtThreadExit(ringRelease, ring);
+    return ring;
+}
+
+void dbTraceAdd(dbTraceType type, const void *obj, epicsUInt64 arg)
+{
+    traceRing *ring;
+    traceEntry *pent;
+    size_t head;
+
+    /* callbackRequest() and scanIoRequest() may be called from an ISR */
+    if (epicsInterruptIsInterruptContext())
+        return;
+    ring = ringSelf();
+    if (!ring)
+        return;
+
+    head = ring->head;
+    pent = &ring->ent[head & ring->mask];
+    pent->ns = epicsMonotonicGet();
+    pent->obj = obj;
+    pent->arg = arg;
+    pent->type = type;
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetSizeT(&ring->head, head + 1);
+}
+
+long dbTraceEnable(int enable)
+{
+    epicsThreadOnce(&traceOnce, traceInit, NULL);
+    dbTraceEnabled = !!enable;
+    return 0;
+}
+
+long dbTraceReset(void)
+{
+    epicsThreadOnce(&traceOnce, traceInit, NULL);
+    epicsMutexMustLock(traceLock);
+    traceStart = epicsMonotonicGet();
+    epicsMutexUnlock(traceLock);
+    return 0;
+}
+
+static void putString(FILE *fp, const char *str)
+{
+    putc('"', fp);
+    for (; *str; str++) {
+        unsigned char c = *str;
+
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            putc(c, fp);
+    }
+    putc('"', fp);
+}
+
+static const char * recName(const traceEntry *pent)
+{
+    return ((const dbCommon *) pent->obj)->name;
+}
+
+/* Start a Chrome trace event object, the caller adds the rest */
+static void eventHead(FILE *fp, int *pn, const traceRing *ring,
+    const traceEntry *pent, epicsUInt64 t0, const char *ph)
+{
+    fprintf(fp, "%s\n{\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"ph\":\"%s\"",
+        (*pn)++ ? "," : "", ring->tid, (pent->ns - t0) / 1e3, ph);
+}
+
+static void flow(FILE *fp, int *pn, const traceRing *ring,
+    const traceEntry *pent, epicsUInt64 t0, const char *cat, int start)
+{
+    eventHead(fp, pn, ring, pent, t0, start ? "s" : "f");
+    fprintf(fp, ",\"cat\":\"%s\",\"name\":\"%s\",\"id\":\"%p\"%s}",
+        cat, cat, pent->obj, start ? "" : ",\"bp\":\"e\"");
+}
+
+static void dumpEntry(FILE *fp, int *pn, const traceRing *ring,
+    const traceEntry *pent, epicsUInt64 t0)
+{
+    epicsUInt64 start;
+
+    switch ((dbTraceType) pent->type) {
+    case dbtProcessBegin:
+    case dbtProcessEnd:
+        eventHead(fp, pn, ring, pent, t0,
+            pent->type == dbtProcessBegin ? "B" : "E");
+        fprintf(fp, ",\"cat\":\"process\",\"name\":");
+        putString(fp, recName(pent));
+        fprintf(fp, "}");
+        break;
+    case dbtOnceQueue:
+        eventHead(fp, pn, ring, pent, t0, "i");
+        fprintf(fp, ",\"s\":\"t\",\"cat\":\"scanOnce\",\"name\":");
+        putString(fp, recName(pent));
+        fprintf(fp, "}");
+        flow(fp, pn, ring, pent, t0, "scanOnce", 1);
+        break;
+    case dbtOnceOverflow:
+        eventHead(fp, pn, ring, pent, t0, "i");
+        fprintf(fp, ",\"s\":\"t\",\"cat\":\"scanOnce\",\"name\":"
+            "\"overflow\",\"args\":{\"record\":");
+        putString(fp, recName(pent));
+        fprintf(fp, "}}");
+        break;
+    case dbtOnceBegin:
+        eventHead(fp, pn, ring, pent, t0, "B");
+        fprintf(fp, ",\"cat\":\"scanOnce\",\"name\":\"scanOnce\","
+            "\"args\":{\"record\":");
+        putString(fp, recName(pent));
+        fprintf(fp, "}}");
+        flow(fp, pn, ring, pent, t0, "scanOnce", 0);
+        break;
+    case dbtCallbackQueue:
+        eventHead(fp, pn, ring, pent, t0, "i");
+        fprintf(fp, ",\"s\":\"t\",\"cat\":\"callback\",\"name\":"
+            "\"callbackRequest\",\"args\":{\"func\":\"0x%llx\"}}",
+            (unsigned long long) pent->arg);
+        flow(fp, pn, ring, pent, t0, "callback", 1);
+        break;
+    case dbtCallbackOverflow:
+        eventHead(fp, pn, ring, pent, t0, "i");
+        fprintf(fp, ",\"s\":\"t\",\"cat\":\"callback\",\"name\":"
+            "\"overflow\",\"args\":{\"func\":\"0x%llx\"}}",
+            (unsigned long long) pent->arg);
+        break;
+    case dbtCallbackBegin:
+        eventHead(fp, pn, ring, pent, t0, "B");
+        fprintf(fp, ",\"cat\":\"callback\",\"name\":\"callback\","
+            "\"args\":{\"func\":\"0x%llx\"}}", (unsigned long long) pent->arg);
+        flow(fp, pn, ring, pent, t0, "callback", 0);
+        break;
+    case dbtOnceEnd:
+    case dbtCallbackEnd:
+    case dbtEventEnd:
+        eventHead(fp, pn, ring, pent, t0, "E");
+        fprintf(fp, "}");
+        break;
+    case dbtIoRequest:
+        eventHead(fp, pn, ring, pent, t0, "i");
+        fprintf(fp, ",\"s\":\"t\",\"cat\":\"ioscan\",\"name\":"
+            "\"scanIoRequest\",\"args\":{\"ioscan\":\"%p\"}}", pent->obj);
+        break;
+    case dbtLockWait:
+        /* Recorded when the lock was obtained */
+        start = pent->ns - pent->arg;
+        if (start < t0)
+            start = t0;
+        fprintf(fp, "%s\n{\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+            "\"ph\":\"X\",\"cat\":\"lock\",\"name\":\"lock wait\","
+            "\"args\":{\"record\":", (*pn)++ ? "," : "", ring->tid,
+            (start - t0) / 1e3, (pent->ns - start) / 1e3);
+        putString(fp, recName(pent));
+        fprintf(fp, "}}");
+        break;
+    case dbtPostEvent:
+        eventHead(fp, pn, ring, pent, t0, "i");
+        fprintf(fp, ",\"s\":\"t\",\"cat\":\"post\",\"name\":\"post\","
+            "\"args\":{\"record\":");
+        putString(fp, recName(pent));
+        fprintf(fp, ",\"mask\":%u}}", (unsigned) pent->arg);
+        break;
+    case dbtEventBegin:
+        eventHead(fp, pn, ring, pent, t0, "B");
+        fprintf(fp, ",\"cat\":\"event\",\"name\":\"event_read\"}");
+        break;
+    }
+}
+
+static void dumpRing(FILE *fp, int *pn, traceRing *ring, epicsUInt64 t0,
+    traceEntry *pcopy)
+{
+    size_t size = ring->mask + 1;
+    size_t head, first, valid, i;
+
+    head = epicsAtomicGetSizeT(&ring->head);
+    epicsAtomicReadMemoryBarrier();
+    first = head > size ? head - size : 0;
+    for (i = first; i < head; i++)
+        pcopy[i - first] = ring->ent[i & ring->mask];
+    epicsAtomicReadMemoryBarrier();
+
+    /* The slot of entry N is reused by entry N + size */
+    valid = epicsAtomicGetSizeT(&ring->head);
+    valid = valid >= size ? valid - size + 1 : 0;
+
+    fprintf(fp, "%s\n{\"pid\":1,\"tid\":%u,\"ph\":\"M\","
+        "\"name\":\"thread_name\",\"args\":{\"name\":",
+        (*pn)++ ? "," : "", ring->tid);
+    putString(fp, ring->name);
+    fprintf(fp, "}}");
+
+    for (i = first > valid ? first : valid; i < head; i++) {
+        const traceEntry *pent = &pcopy[i - first];
+
+        if (pent->ns >= t0)
+            dumpEntry(fp, pn, ring, pent, t0);
+    }
+}
+
+long dbTraceDump(const char *filename)
+{
+    FILE *fp = stdout;
+    traceRing *ring;
+    traceEntry *pcopy = NULL;
+    size_t ncopy = 0;
+    int n = 0;
+
+    epicsThreadOnce(&traceOnce, traceInit, NULL);
+    if (filename && *filename) {
+        fp = fopen(filename, "w");
+        if (!fp) {
+            errlogPrintf("dbTraceDump: Can't open '%s' - %s\n",
+                filename, strerror(errno));
+            return -1;
+        }
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    epicsMutexMustLock(traceLock);
+    for (ring = (traceRing *) ellFirst(&traceRings); ring;
+         ring = (traceRing *) ellNext(&ring->node)) {
+        if (ncopy <= ring->mask) {
+            free(pcopy);
+            ncopy = ring->mask + 1;
+            pcopy = malloc(ncopy * sizeof(traceEntry));
+            if (!pcopy) {
+                ncopy = 0;
+                errlogPrintf("dbTraceDump: Out of memory\n");
+                break;
+            }
+        }
+        dumpRing(fp, &n, ring, traceStart, pcopy);
+    }
+    epicsMutexUnlock(traceLock);
+    free(pcopy);
+    fprintf(fp, "\n]}\n");
+
+    if (fp != stdout)
+        fclose(fp);
+    return 0;
+}
@@ -0,0 +1,73 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/** @file dbTrace.h
+ * @brief Low overhead event trace of database activity
+ *
+ * When enabled, every thread appends binary records of what it does to its
+ * own ring buffer of fixed size, overwriting the oldest entries when full:
+ * - entry and exit of dbProcess(),
+ * - scanOnce() requests, and the execution of each by the scanOnce thread,
+ * - callbackRequest() calls, and the execution of each callback,
+ * - scanIoRequest() calls,
+ * - contended waits for a lock set in dbScanLock(),
+ * - db_post_events() calls, and the delivery of monitor updates by the
+ *   event tasks.
+ *
+ * Each entry carries a monotonic timestamp with nanosecond resolution.
+ * Adding one takes no locks, so tracing can stay enabled in a production
+ * IOC to capture the events leading up to a latency problem.
+ *
+ * The rings can be written out in the Chrome trace event JSON format, as
+ * read by Perfetto (https://ui.perfetto.dev) and chrome://tracing.  Queue
+ * and execution of a request are joined by flow arrows, which follow the
+ * chain from an I/O interrupt through record processing to monitor posts.
+ *
+ * Tracing is off by default and costs one test of a global flag per trace
+ * point while disabled.  Rings are allocated by each thread when it first
+ * records an event, with dbTraceRingSize entries of 32 bytes, and are kept
+ * until the process exits.
+ *
+ * <em>The functions declared here are also provided as IOC Shell
+ * commands.</em>
+ */
+
+#ifndef INCdbTraceH
+#define INCdbTraceH
+
+#include "dbCoreAPI.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Non-zero while tracing */
+DBCORE_API extern volatile int dbTraceEnabled;
+
+/** Number of entries in each ring allocated from now on, rounded up to a
+ * power of 2.  Default 8192.
+ */
+DBCORE_API extern int dbTraceRingSize;
+
+/** @brief Start (enable!=0) or stop (enable==0) tracing. */
+DBCORE_API long dbTraceEnable(int enable);
+
+/** @brief Discard all events traced so far. */
+DBCORE_API long dbTraceReset(void);
+
+/** @brief Write the traced events to a file in Chrome trace JSON format.
+ *
+ * May be called while tracing is enabled.
+ * @param filename Output file name, stdout if NULL or empty.
+ * @return 0, or -1 if the file can't be written.
+ */
+DBCORE_API long dbTraceDump(const char *filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INCdbTraceH */
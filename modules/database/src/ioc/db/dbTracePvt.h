@@ -0,0 +1,48 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#ifndef INCdbTracePvtH
+#define INCdbTracePvtH
+
+#include "epicsTypes.h"
+#include "dbTrace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* What a trace entry's obj and arg refer to is given in brackets */
+typedef enum {
+    dbtProcessBegin,    /* record */
+    dbtProcessEnd,      /* record */
+    dbtOnceQueue,       /* record */
+    dbtOnceOverflow,    /* record */
+    dbtOnceBegin,       /* record */
+    dbtOnceEnd,         /* record */
+    dbtCallbackQueue,   /* epicsCallback, callback function */
+    dbtCallbackOverflow, /* epicsCallback, callback function */
+    dbtCallbackBegin,   /* epicsCallback, callback function */
+    dbtCallbackEnd,     /* epicsCallback */
+    dbtIoRequest,       /* IOSCANPVT */
+    dbtLockWait,        /* record, wait time in ns */
+    dbtPostEvent,       /* record, event mask */
+    dbtEventBegin,      /* event queue */
+    dbtEventEnd         /* event queue */
+} dbTraceType;
+
+void dbTraceAdd(dbTraceType type, const void *obj, epicsUInt64 arg);
+
+#define dbTrace(type, obj, arg) \
+    do { \
+        if (dbTraceEnabled) \
+            dbTraceAdd(type, obj, arg); \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INCdbTracePvtH */
@@ -110,7 +110,9 @@ typedef struct db_field_log {
     /* ctx is used for all types */
     unsigned int      ctx:1;  /* context (operation type) */
     /* only for dbfl_context_event */
+    unsigned int   single:1;  /* from db_post_single_event(), not a change */
     unsigned char      mask;  /* DBE_* mask */
+    unsigned char   backlog;  /* updates of this subscription still queued */
     /* the following are used for value and reference types */
     epicsTimeStamp     time;  /* Time stamp */
     epicsUTag          utag;
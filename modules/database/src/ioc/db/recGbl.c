@@ -13,6 +13,8 @@
  *                       Andrew Johnson <anj@aps.anl.gov>
  */
 
+#define EPICS_PRIVATE_API
+
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
@@ -312,6 +314,9 @@ void recGblGetTimeStampSimm(void *pvoid, const epicsEnum16 simm, struct link *si
         dbGetLink(plink, DBR_SHORT, &prec->tse, 0, 0);
     }
     if (prec->tse != epicsTimeEventDeviceTime) {
+        if (prec->tse == epicsTimeEventCurrentTime &&
+            scanTimeStampGet(&prec->time) == 0)
+            return;
         if (epicsTimeGetEvent(&prec->time, prec->tse))
             errlogPrintf("recGblGetTimeStampSimm: epicsTimeGetEvent failed, %s.TSE = %d\n",
                          prec->name, prec->tse);
@@ -157,6 +157,10 @@ typedef struct dbRecordType {
     short           *link_ind;      /* addr of array of ind in papFldDes*/
     char            **papsortFldName;/* ptr to array of ptr to fld names*/
     short           *sortFldInd;    /* addr of array of ind in papFldDes*/
+    short           *fldHashInd;    /* ind in papFldDes by hash slot, or -1*/
+    unsigned short  *fldHashDisp;   /* displacement of each hash bucket */
+    unsigned short  fldHashMask;    /* number of hash slots - 1 */
+    unsigned short  fldHashBucketMask; /* number of hash buckets - 1 */
     dbFldDes        *pvalFldDes;    /*pointer dbFldDes for VAL field*/
     short           indvalFlddes;   /*ind in papFldDes*/
     dbFldDes        **papFldDes;    /* ptr to array of ptr to fldDes*/
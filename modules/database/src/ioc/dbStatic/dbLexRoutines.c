@@ -339,6 +339,7 @@ cleanup:
     if(my_buffer) free((void *)my_buffer);
     my_buffer = NULL;
     freeInputFileList();
+    dbmfFreeChunks();
     if(fp)
         fclose(fp);
     return(status);
@@ -777,6 +778,7 @@ static void dbRecordtypeBody(void)
             }
         }
     }
+    dbBuildFieldHash(pdbRecordType);
     /*Initialize lists*/
     ellInit(&pdbRecordType->attributeList);
     ellInit(&pdbRecordType->recList);
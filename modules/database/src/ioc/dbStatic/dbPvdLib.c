@@ -17,30 +17,27 @@
 
 #include "dbDefs.h"
 #include "ellLib.h"
+#include "epicsAtomic.h"
 #include "epicsMutex.h"
 #include "epicsStdio.h"
 #include "epicsString.h"
+#include "gpHash.h"
 
 #include "dbBase.h"
 #include "dbStaticLib.h"
 #include "dbStaticPvt.h"
 
-typedef struct {
-    ELLLIST      list;
-    epicsMutexId lock;
-} dbPvdBucket;
-
+/* Record names are kept in a gpHash table, so dbPvdFind() takes no lock */
 typedef struct dbPvd {
-    unsigned int size;
-    unsigned int mask;
-    dbPvdBucket **buckets;
+    struct gphPvt *phash;
+    ELLLIST      list;      /* PVDENTRY, for dbPvdFreeMem() */
+    epicsMutexId lock;      /* list */
 } dbPvd;
 
 unsigned int dbPvdHashTableSize = 0;
 
 #define MIN_SIZE 256
 #define DEFAULT_SIZE 512
-#define MAX_SIZE 65536
 
 
 int dbPvdTableSize(int size)
@@ -50,12 +47,10 @@ int dbPvdTableSize(int size)
         return -1;
     }
 
+    /* This is only the initial size, the table grows as needed */
     if (size < MIN_SIZE)
         size = MIN_SIZE;
 
-    if (size > MAX_SIZE)
-        size = MAX_SIZE;
-
     dbPvdHashTableSize = size;
     return 0;
 }
@@ -70,10 +65,10 @@ void dbPvdInitPvt(dbBase *pdbbase)
         dbPvdHashTableSize = DEFAULT_SIZE;
     }
 
-    ppvd = (dbPvd *)dbMalloc(sizeof(dbPvd));
-    ppvd->size    = dbPvdHashTableSize;
-    ppvd->mask    = dbPvdHashTableSize - 1;
-    ppvd->buckets = dbCalloc(ppvd->size, sizeof(dbPvdBucket *));
+    ppvd = (dbPvd *)dbCalloc(1, sizeof(dbPvd));
+    gphInitPvt(&ppvd->phash, dbPvdHashTableSize);
+    ellInit(&ppvd->list);
+    ppvd->lock = epicsMutexMustCreate();
 
     pdbbase->ppvd = ppvd;
     return;
@@ -81,120 +76,87 @@ void dbPvdInitPvt(dbBase *pdbbase)
 
 PVDENTRY *dbPvdFind(dbBase *pdbbase, const char *name, size_t lenName)
 {
-    dbPvd *ppvd = pdbbase->ppvd;
-    dbPvdBucket *pbucket;
-    PVDENTRY *ppvdNode;
+    GPHENTRY *pgph = gphFindParse(pdbbase->ppvd->phash, name, lenName, NULL);
 
-    pbucket = ppvd->buckets[epicsMemHash(name, lenName, 0) & ppvd->mask];
-    if (pbucket == NULL) return NULL;
-
-    epicsMutexMustLock(pbucket->lock);
-    ppvdNode = (PVDENTRY *) ellFirst(&pbucket->list);
-    while (ppvdNode) {
-        const char *recordname = ppvdNode->precnode->recordname;
-
-        if (strncmp(name, recordname, lenName) == 0 &&
-            strlen(recordname) == lenName)
-            break;
-        ppvdNode = (PVDENTRY *) ellNext((ELLNODE *)ppvdNode);
-    }
-    epicsMutexUnlock(pbucket->lock);
-    return ppvdNode;
+    return pgph ? (PVDENTRY *) pgph->userPvt : NULL;
 }
-
+
 PVDENTRY *dbPvdAdd(dbBase *pdbbase, dbRecordType *precordType,
     dbRecordNode *precnode)
 {
     dbPvd *ppvd = pdbbase->ppvd;
-    dbPvdBucket *pbucket;
     PVDENTRY *ppvdNode;
-    char *name = precnode->recordname;
-    unsigned int h;
-
-    h = epicsStrHash(name, 0) & ppvd->mask;
-    pbucket = ppvd->buckets[h];
-    if (pbucket == NULL) {
-        pbucket = dbCalloc(1, sizeof(dbPvdBucket));
-        ellInit(&pbucket->list);
-        pbucket->lock = epicsMutexCreate();
-        ppvd->buckets[h] = pbucket;
-    }
+    GPHENTRY *pgph;
 
-    epicsMutexMustLock(pbucket->lock);
-    ppvdNode = (PVDENTRY *) ellFirst(&pbucket->list);
-    while (ppvdNode) {
-        if (strcmp(name, ppvdNode->precnode->recordname) == 0) {
-            epicsMutexUnlock(pbucket->lock);
-            return NULL;
-        }
-        ppvdNode = (PVDENTRY *) ellNext((ELLNODE *)ppvdNode);
-    }
     ppvdNode = dbCalloc(1, sizeof(PVDENTRY));
     ppvdNode->precordType = precordType;
     ppvdNode->precnode = precnode;
-    ellAdd(&pbucket->list, (ELLNODE *)ppvdNode);
-    epicsMutexUnlock(pbucket->lock);
+
+    pgph = gphAdd(ppvd->phash, precnode->recordname, NULL);
+    if (!pgph) {
+        free(ppvdNode);
+        return NULL;
+    }
+    epicsAtomicWriteMemoryBarrier();
+    pgph->userPvt = ppvdNode;
+
+    epicsMutexMustLock(ppvd->lock);
+    ellAdd(&ppvd->list, &ppvdNode->node);
+    epicsMutexUnlock(ppvd->lock);
     return ppvdNode;
 }
 
 void dbPvdDelete(dbBase *pdbbase, dbRecordNode *precnode)
 {
     dbPvd *ppvd = pdbbase->ppvd;
-    dbPvdBucket *pbucket;
-    PVDENTRY *ppvdNode;
     char *name = precnode->recordname;
+    PVDENTRY *ppvdNode;
+    GPHENTRY *pgph;
 
-    pbucket = ppvd->buckets[epicsStrHash(name, 0) & ppvd->mask];
-    if (pbucket == NULL) return;
-
-    epicsMutexMustLock(pbucket->lock);
-    ppvdNode = (PVDENTRY *) ellFirst(&pbucket->list);
-    while (ppvdNode) {
-        if (ppvdNode->precnode &&
-            ppvdNode->precnode->recordname &&
-            strcmp(name, ppvdNode->precnode->recordname) == 0) {
-            ellDelete(&pbucket->list, (ELLNODE *)ppvdNode);
-            free(ppvdNode);
-            break;
-        }
-        ppvdNode = (PVDENTRY *) ellNext((ELLNODE *)ppvdNode);
-    }
-    epicsMutexUnlock(pbucket->lock);
+    if (!name) return;
+    pgph = gphFind(ppvd->phash, name, NULL);
+    if (!pgph) return;
+    ppvdNode = (PVDENTRY *) pgph->userPvt;
+
+    /* Waits for lookups which could still return ppvdNode */
+    gphDelete(ppvd->phash, name, NULL);
+    if (!ppvdNode) return;
+
+    epicsMutexMustLock(ppvd->lock);
+    ellDelete(&ppvd->list, &ppvdNode->node);
+    epicsMutexUnlock(ppvd->lock);
+    free(ppvdNode);
     return;
 }
 
+/* The record name is now stored at newname */
+void dbPvdMove(dbBase *pdbbase, dbRecordNode *precnode, char *newname)
+{
+    GPHENTRY *pgph = gphFind(pdbbase->ppvd->phash, precnode->recordname, NULL);
+
+    if (pgph)
+        pgph->name = newname;
+    precnode->recordname = newname;
+}
+
 void dbPvdFreeMem(dbBase *pdbbase)
 {
     dbPvd *ppvd = pdbbase->ppvd;
-    unsigned int h;
 
     if (ppvd == NULL) return;
     pdbbase->ppvd = NULL;
 
-    for (h = 0; h < ppvd->size; h++) {
-        dbPvdBucket *pbucket = ppvd->buckets[h];
-        PVDENTRY *ppvdNode;
-
-        if (pbucket == NULL) continue;
-        epicsMutexMustLock(pbucket->lock);
-        ppvd->buckets[h] = NULL;
-        while ((ppvdNode = (PVDENTRY *) ellFirst(&pbucket->list))) {
-            ellDelete(&pbucket->list, (ELLNODE *)ppvdNode);
-            free(ppvdNode);
-        }
-        epicsMutexUnlock(pbucket->lock);
-        epicsMutexDestroy(pbucket->lock);
-        free(pbucket);
-    }
-    free(ppvd->buckets);
+    gphFreeMem(ppvd->phash);
+    ellFree(&ppvd->list);
+    epicsMutexDestroy(ppvd->lock);
     free(ppvd);
 }
 
 void dbPvdDump(dbBase *pdbbase, int verbose)
 {
-    unsigned int empty = 0;
     dbPvd *ppvd;
-    unsigned int h;
+    PVDENTRY *ppvdNode;
+    int i = 0;
 
     if (!pdbbase) {
         fprintf(stderr,"pdbbase not specified\n");
@@ -203,27 +165,18 @@ void dbPvdDump(dbBase *pdbbase, int verbose)
     ppvd = pdbbase->ppvd;
     if (ppvd == NULL) return;
 
-    printf("Process Variable Directory has %u buckets", ppvd->size);
-
-    for (h = 0; h < ppvd->size; h++) {
-        dbPvdBucket *pbucket = ppvd->buckets[h];
-        PVDENTRY *ppvdNode;
-        int i = 1;
-
-        if (pbucket == NULL) {
-            empty++;
-            continue;
-        }
-        epicsMutexMustLock(pbucket->lock);
-        ppvdNode = (PVDENTRY *) ellFirst(&pbucket->list);
-        printf("\n [%4u] %4d  ", h, ellCount(&pbucket->list));
-        while (ppvdNode && verbose) {
-            if (!(++i % 4))
-                printf("\n         ");
-            printf("  %s", ppvdNode->precnode->recordname);
-            ppvdNode = (PVDENTRY *) ellNext((ELLNODE*)ppvdNode);
-        }
-        epicsMutexUnlock(pbucket->lock);
+    epicsMutexMustLock(ppvd->lock);
+    printf("Process Variable Directory has %d entries",
+        ellCount(&ppvd->list));
+    ppvdNode = (PVDENTRY *) ellFirst(&ppvd->list);
+    while (ppvdNode && verbose) {
+        if (!(i++ % 4))
+            printf("\n ");
+        printf("  %s", ppvdNode->precnode->recordname);
+        ppvdNode = (PVDENTRY *) ellNext(&ppvdNode->node);
     }
-    printf("\n%u buckets empty.\n", empty);
+    epicsMutexUnlock(ppvd->lock);
+    printf("\n");
+    if (verbose > 1)
+        gphDump(ppvd->phash);
 }
@@ -0,0 +1,290 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* dbRecordArena.c */
+/* Contiguous storage for record instances */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__linux__)
+#  include <sys/mman.h>
+#endif
+
+#include "dbDefs.h"
+#include "ellLib.h"
+#include "errlog.h"
+
+#include "dbBase.h"
+#include "dbCommonPvt.h"
+#include "dbStaticLib.h"
+#include "dbStaticPvt.h"
+#include "epicsExport.h"
+
+/* 0: records are allocated individually (default)
+ * 1: records are moved into one arena at iocInit
+ * 2: as 1, and ask the OS to back the arena with huge pages
+ */
+int dbRecordArenaMode = 0;
+epicsExportAddress(int, dbRecordArenaMode);
+
+/* Each record starts on its own cache line */
+#define ARENA_ALIGN 64
+#define HUGE_PAGE_SIZE (2u * 1024 * 1024)
+
+typedef struct dbRecordArena {
+    ELLNODE node;
+    void *mem;              /* as returned by the allocator */
+    char *base;             /* first record slot */
+    size_t size;            /* bytes allocated */
+    size_t used;            /* bytes occupied by records */
+    int nrecords;           /* live records, freed when zero */
+    int hugePages;
+} dbRecordArena;
+
+static ELLLIST arenaList = ELLLIST_INIT;
+
+typedef struct arenaRec {
+    dbRecordNode *precnode;
+    dbCommonPvt *ppvt;
+    size_t slot;
+    unsigned short scan;
+    unsigned short type;
+    short phas;
+    unsigned seq;
+} arenaRec;
+
+static size_t slotSize(const dbRecordType *prt)
+{
+    size_t size = offsetof(dbCommonPvt, common) + prt->rec_size;
+
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/* Records that share a scan list and type end up next to each other,
+ * in the order the scan list will visit them.
+ */
+static int cmpRec(const void *a, const void *b)
+{
+    const arenaRec *pa = a, *pb = b;
+
+    if (pa->scan != pb->scan)
+        return pa->scan < pb->scan ? -1 : 1;
+    if (pa->phas != pb->phas)
+        return pa->phas < pb->phas ? -1 : 1;
+    if (pa->type != pb->type)
+        return pa->type < pb->type ? -1 : 1;
+    return pa->seq < pb->seq ? -1 : pa->seq > pb->seq;
+}
+
+static int arenaAlloc(dbRecordArena *parena)
+{
+    size_t size = parena->used;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (parena->hugePages) {
+        void *ptr;
+
+        size = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+        if (!posix_memalign(&ptr, HUGE_PAGE_SIZE, size)) {
+            /* Advisory only, the arena works either way */
+            parena->hugePages = !madvise(ptr, size, MADV_HUGEPAGE);
+            memset(ptr, 0, size);
+            parena->mem = parena->base = ptr;
+            parena->size = size;
+            return 0;
+        }
+    }
+#endif
+    parena->hugePages = 0;
+    size += ARENA_ALIGN;
+    parena->mem = calloc(1, size);
+    if (!parena->mem)
+        return -1;
+    parena->base = (char *)(((size_t)parena->mem + ARENA_ALIGN - 1) &
+        ~(size_t)(ARENA_ALIGN - 1));
+    parena->size = size;
+    return 0;
+}
+
+long dbRecordArenaBuild(DBBASE *pdbbase)
+{
+    dbRecordType *prt;
+    dbRecordArena *parena;
+    arenaRec *precs;
+    size_t nrecs = 0, total = 0, offset = 0, i;
+    unsigned short type = 0;
+
+    if (!pdbbase || dbRecordArenaMode <= 0)
+        return 0;
+
+    for (prt = (dbRecordType *)ellFirst(&pdbbase->recordTypeList); prt;
+         prt = (dbRecordType *)ellNext(&prt->node)) {
+        dbRecordNode *precnode;
+
+        for (precnode = (dbRecordNode *)ellFirst(&prt->recList); precnode;
+             precnode = (dbRecordNode *)ellNext(&precnode->node)) {
+            if (!precnode->precord || precnode->flags & DBRN_FLAGS_ISALIAS ||
+                dbRec2Pvt(precnode->precord)->arena)
+                continue;
+            nrecs++;
+            total += slotSize(prt);
+        }
+    }
+    if (!nrecs)
+        return 0;
+
+    precs = calloc(nrecs, sizeof(arenaRec));
+    parena = calloc(1, sizeof(dbRecordArena));
+    if (precs && parena) {
+        parena->used = total;
+        parena->hugePages = dbRecordArenaMode >= 2;
+    }
+    if (!precs || !parena || arenaAlloc(parena)) {
+        errlogPrintf("dbRecordArenaBuild: Can't allocate %lu bytes,"
+            " records left in place\n", (unsigned long) total);
+        free(precs);
+        free(parena);
+        return -1;
+    }
+
+    nrecs = 0;
+    for (prt = (dbRecordType *)ellFirst(&pdbbase->recordTypeList); prt;
+         prt = (dbRecordType *)ellNext(&prt->node), type++) {
+        dbRecordNode *precnode;
+
+        for (precnode = (dbRecordNode *)ellFirst(&prt->recList); precnode;
+             precnode = (dbRecordNode *)ellNext(&precnode->node)) {
+            dbCommon *prec = precnode->precord;
+            arenaRec *pr = &precs[nrecs];
+
+            if (!prec || precnode->flags & DBRN_FLAGS_ISALIAS ||
+                dbRec2Pvt(prec)->arena)
+                continue;
+            pr->precnode = precnode;
+            pr->ppvt = dbRec2Pvt(prec);
+            pr->slot = slotSize(prt);
+            pr->scan = prec->scan;
+            pr->phas = prec->phas;
+            pr->type = type;
+            pr->seq = (unsigned) nrecs++;
+        }
+    }
+    qsort(precs, nrecs, sizeof(arenaRec), cmpRec);
+
+    /* Nothing but the record nodes and the PVD refer to a record before
+     * its links have been initialized, so moving it only means updating
+     * those.
+     */
+    for (i = 0; i < nrecs; i++) {
+        arenaRec *pr = &precs[i];
+        dbRecordType *prt = pr->ppvt->common.rdes;
+        dbCommonPvt *pnew = (dbCommonPvt *)(parena->base + offset);
+
+        memcpy(pnew, pr->ppvt, offsetof(dbCommonPvt, common) + prt->rec_size);
+        pnew->arena = parena;
+        pr->precnode->precord = &pnew->common;
+        dbPvdMove(pdbbase, pr->precnode, pnew->common.name);
+        offset += pr->slot;
+    }
+    parena->nrecords = (int) nrecs;
+
+    for (prt = (dbRecordType *)ellFirst(&pdbbase->recordTypeList); prt;
+         prt = (dbRecordType *)ellNext(&prt->node)) {
+        dbRecordNode *precnode;
+
+        for (precnode = (dbRecordNode *)ellFirst(&prt->recList); precnode;
+             precnode = (dbRecordNode *)ellNext(&precnode->node)) {
+            if (precnode->flags & DBRN_FLAGS_ISALIAS)
+                precnode->precord = precnode->aliasedRecnode->precord;
+        }
+    }
+
+    for (i = 0; i < nrecs; i++)
+        free(precs[i].ppvt);
+    free(precs);
+
+    ellAdd(&arenaList, &parena->node);
+    return 0;
+}
+
+void dbRecordArenaRelease(struct dbRecordArena *parena)
+{
+    if (--parena->nrecords > 0)
+        return;
+    ellDelete(&arenaList, &parena->node);
+    free(parena->mem);
+    free(parena);
+}
+
+long dbRecordMemReport(DBBASE *pdbbase, const char *recordTypeName)
+{
+    dbRecordType *prt;
+    dbRecordArena *parena;
+    size_t totalBytes = 0;
+    unsigned long totalRecs = 0;
+
+    if (!pdbbase) {
+        printf("No database loaded\n");
+        return 0;
+    }
+    if (recordTypeName &&
+        (*recordTypeName == '\0' || !strcmp(recordTypeName, "*")))
+        recordTypeName = NULL;
+
+    printf("%-16s %8s %8s %9s %9s %12s %8s\n", "TYPE", "RECORDS", "ALIASES",
+        "REC_SIZE", "SLOT", "BYTES", "IN_ARENA");
+    for (prt = (dbRecordType *)ellFirst(&pdbbase->recordTypeList); prt;
+         prt = (dbRecordType *)ellNext(&prt->node)) {
+        dbRecordNode *precnode;
+        unsigned long nrec = 0, nalias = 0, narena = 0;
+        size_t bytes;
+
+        if (recordTypeName && strcmp(recordTypeName, prt->name))
+            continue;
+        for (precnode = (dbRecordNode *)ellFirst(&prt->recList); precnode;
+             precnode = (dbRecordNode *)ellNext(&precnode->node)) {
+            if (precnode->flags & DBRN_FLAGS_ISALIAS) {
+                nalias++;
+                continue;
+            }
+            if (!precnode->precord)
+                continue;
+            nrec++;
+            if (dbRec2Pvt(precnode->precord)->arena)
+                narena++;
+        }
+        if (!nrec && !nalias)
+            continue;
+
+        /* Record node, record and private part; link and info strings
+         * are not included.
+         */
+        bytes = (nrec + nalias) * sizeof(dbRecordNode) +
+            narena * slotSize(prt) +
+            (nrec - narena) * (offsetof(dbCommonPvt, common) + prt->rec_size);
+        printf("%-16s %8lu %8lu %9u %9lu %12lu %8lu\n", prt->name, nrec,
+            nalias, (unsigned) prt->rec_size, (unsigned long) slotSize(prt),
+            (unsigned long) bytes, narena);
+        totalRecs += nrec;
+        totalBytes += bytes;
+    }
+    printf("%-16s %8lu %8s %9s %9s %12lu\n", "Total", totalRecs, "", "", "",
+        (unsigned long) totalBytes);
+
+    for (parena = (dbRecordArena *)ellFirst(&arenaList); parena;
+         parena = (dbRecordArena *)ellNext(&parena->node)) {
+        printf("Arena %p: %d records, %lu of %lu bytes used%s\n",
+            (void *)parena->base, parena->nrecords,
+            (unsigned long) parena->used, (unsigned long) parena->size,
+            parena->hugePages ? ", huge pages" : "");
+    }
+    if (!ellCount(&arenaList))
+        printf("No record arena, set dbRecordArenaMode before iocInit\n");
+    return 0;
+}
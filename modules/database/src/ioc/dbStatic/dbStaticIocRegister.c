@@ -181,6 +181,18 @@ static void dbReportDeviceConfigCallFunc(const iocshArgBuf *args)
     dbReportDeviceConfig(*iocshPpdbbase,stdout);
 }
 
+/* dbRecordMemReport */
+static const iocshArg * const dbRecordMemReportArgs[] =
+    {&argPdbbase, &argRecType};
+static const iocshFuncDef dbRecordMemReportFuncDef = {"dbRecordMemReport",2,dbRecordMemReportArgs,
+                          "Show the memory used by the records of each type,\n"
+                          "and the record arena when dbRecordArenaMode is set.\n"
+                          "Example: dbRecordMemReport pdbbase ai\n"};
+static void dbRecordMemReportCallFunc(const iocshArgBuf *args)
+{
+    dbRecordMemReport(*iocshPpdbbase,args[1].sval);
+}
+
 void dbStaticIocRegister(void)
 {
     iocshRegister(&dbDumpPathFuncDef, dbDumpPathCallFunc);
@@ -198,4 +210,5 @@ void dbStaticIocRegister(void)
     iocshRegister(&dbPvdDumpFuncDef, dbPvdDumpCallFunc);
     iocshRegister(&dbPvdTableSizeFuncDef,dbPvdTableSizeCallFunc);
     iocshRegister(&dbReportDeviceConfigFuncDef, dbReportDeviceConfigCallFunc);
+    iocshRegister(&dbRecordMemReportFuncDef, dbRecordMemReportCallFunc);
 }
@@ -511,6 +511,8 @@ void dbFreeBase(dbBase *pdbbase)
         free((void *)pdbRecordType->link_ind);
         free((void *)pdbRecordType->papsortFldName);
         free((void *)pdbRecordType->sortFldInd);
+        free((void *)pdbRecordType->fldHashInd);
+        free((void *)pdbRecordType->fldHashDisp);
         free((void *)pdbRecordType->papFldDes);
         free((void *)pdbRecordType);
         pdbRecordType = pdbRecordTypeNext;
@@ -1759,6 +1761,115 @@ long dbCopyRecord(DBENTRY *pdbentry,const char *newRecordName,int overWriteOK)
     return(dbFindRecord(pdbentry,newRecordName));
 }
 
+/* Field names are looked up through a minimal perfect hash built when the
+ * record type is defined: the first hash picks a bucket, and each bucket has
+ * a displacement that was chosen so the second hash puts all of its names in
+ * free slots.  A lookup then needs exactly one string compare.
+ */
+static epicsUInt32 fieldNameHash(const char *pname, size_t nameLen)
+{
+    epicsUInt32 h = 2166136261u;
+
+    while (nameLen--) {
+        h ^= (unsigned char) *pname++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static unsigned fieldHashSlot(epicsUInt32 h, unsigned disp, unsigned mask)
+{
+    h += disp * 0x9e3779b9u;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h & mask;
+}
+
+void dbBuildFieldHash(dbRecordType *pdbRecordType)
+{
+    short no_fields = pdbRecordType->no_fields;
+    unsigned nslots = 8, nbuckets = 4, i, b;
+    epicsUInt32 *hashes;
+    short *ind;
+    unsigned short *disp;
+    unsigned char *bucketSize;
+
+    pdbRecordType->fldHashInd = NULL;
+    pdbRecordType->fldHashDisp = NULL;
+    if (no_fields <= 0)
+        return;
+    while (nslots < 2u * no_fields)
+        nslots <<= 1;
+    while (nbuckets < (unsigned) no_fields / 2)
+        nbuckets <<= 1;
+
+    hashes = dbCalloc(no_fields, sizeof(epicsUInt32));
+    bucketSize = dbCalloc(nbuckets, 1);
+    ind = dbMalloc(nslots * sizeof(short));
+    disp = dbCalloc(nbuckets, sizeof(unsigned short));
+    for (i = 0; i < nslots; i++)
+        ind[i] = -1;
+    for (i = 0; i < (unsigned) no_fields; i++) {
+        const char *name = pdbRecordType->papFldDes[i]->name;
+
+        hashes[i] = fieldNameHash(name, strlen(name));
+        if (bucketSize[hashes[i] & (nbuckets - 1)] < 255)
+            bucketSize[hashes[i] & (nbuckets - 1)]++;
+    }
+
+    /* Place the fullest buckets first, while most slots are still free */
+    for (;;) {
+        unsigned largest = 0, d;
+
+        for (b = 0; b < nbuckets; b++)
+            if (bucketSize[b] > bucketSize[largest])
+                largest = b;
+        if (!bucketSize[largest])
+            break;
+        b = largest;
+        bucketSize[b] = 0;
+
+        for (d = 1; d <= USHRT_MAX; d++) {
+            for (i = 0; i < (unsigned) no_fields; i++) {
+                unsigned slot;
+
+                if ((hashes[i] & (nbuckets - 1)) != b)
+                    continue;
+                slot = fieldHashSlot(hashes[i], d, nslots - 1);
+                if (ind[slot] >= 0)
+                    break;
+                ind[slot] = i;
+            }
+            if (i == (unsigned) no_fields)
+                break;
+            /* Collision, undo this attempt */
+            while (i-- > 0) {
+                if ((hashes[i] & (nbuckets - 1)) == b)
+                    ind[fieldHashSlot(hashes[i], d, nslots - 1)] = -1;
+            }
+        }
+        if (d > USHRT_MAX) {
+            /* Not expected to happen, dbFindFieldPart() falls back to
+             * a binary search of the sorted names.
+             */
+            free(ind);
+            free(disp);
+            ind = NULL;
+            disp = NULL;
+            break;
+        }
+        disp[b] = d;
+    }
+    free(hashes);
+    free(bucketSize);
+
+    pdbRecordType->fldHashInd = ind;
+    pdbRecordType->fldHashDisp = disp;
+    pdbRecordType->fldHashMask = nslots - 1;
+    pdbRecordType->fldHashBucketMask = nbuckets - 1;
+}
+
 long dbFindFieldPart(DBENTRY *pdbentry,const char **ppname)
 {
     dbRecordType *precordType = pdbentry->precordType;
@@ -1795,6 +1906,27 @@ long dbFindFieldPart(DBENTRY *pdbentry,const char **ppname)
         return dbGetFieldAddress(pdbentry);
     }
 
+    if (precordType->fldHashInd) {
+        epicsUInt32 h = fieldNameHash(pname, nameLen);
+        unsigned disp = precordType->fldHashDisp[h & precordType->fldHashBucketMask];
+        short ind = precordType->fldHashInd[
+            fieldHashSlot(h, disp, precordType->fldHashMask)];
+        dbFldDes *pflddes;
+
+        if (ind < 0)
+            return S_dbLib_fieldNotFound;
+        pflddes = precordType->papFldDes[ind];
+        if (!pflddes)
+            return S_dbLib_recordTypeNotFound;
+        if (strncmp(pflddes->name, pname, nameLen) != 0 ||
+            pflddes->name[nameLen] != '\0')
+            return S_dbLib_fieldNotFound;
+        pdbentry->pflddes = pflddes;
+        pdbentry->indfield = ind;
+        *ppname = &pname[nameLen];
+        return dbGetFieldAddress(pdbentry);
+    }
+
     /* binary search through ordered field names */
     top = precordType->no_fields - 1;
     bottom = 0;
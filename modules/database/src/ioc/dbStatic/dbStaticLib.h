@@ -242,6 +242,8 @@ DBCORE_API void dbDumpBreaktable(DBBASE *pdbbase,
 DBCORE_API void dbPvdDump(DBBASE *pdbbase, int verbose);
 DBCORE_API void dbReportDeviceConfig(DBBASE *pdbbase,
     FILE *report);
+DBCORE_API long dbRecordMemReport(DBBASE *pdbbase,
+    const char *recordTypeName);
 
 /* Misc useful routines*/
 #define dbCalloc(nobj,size) callocMustSucceed(nobj,size,"dbCalloc")
@@ -251,6 +253,7 @@ DBCORE_API void dbCatString(char **string, int *stringLength,
 
 extern int dbStaticDebug;
 extern int dbConvertStrict;
+DBCORE_API extern int dbRecordArenaMode;
 
 #define S_dbLib_recordTypeNotFound (M_dbLib|1) /* Record Type does not exist */
 #define S_dbLib_recExists (M_dbLib|3)          /* Record Already exists */
@@ -27,12 +27,18 @@ extern "C" {
 dbDeviceMenu *dbGetDeviceMenu(DBENTRY *pdbentry);
 void dbFreeLinkContents(struct link *plink);
 void dbFreePath(DBBASE *pdbbase);
+void dbBuildFieldHash(dbRecordType *pdbRecordType);
 int dbIsMacroOk(DBENTRY *pdbentry);
 
 /*The following routines have different versions for run-time no-run-time*/
 long dbAllocRecord(DBENTRY *pdbentry,const char *precordName);
 long dbFreeRecord(DBENTRY *pdbentry);
 
+/*Record arena, see dbRecordArena.c*/
+struct dbRecordArena;
+long dbRecordArenaBuild(DBBASE *pdbbase);
+void dbRecordArenaRelease(struct dbRecordArena *parena);
+
 long dbGetFieldAddress(DBENTRY *pdbentry);
 char *dbRecordName(DBENTRY *pdbentry);
 
@@ -113,6 +119,7 @@ void dbPvdInitPvt(DBBASE *pdbbase);
 PVDENTRY *dbPvdFind(DBBASE *pdbbase,const char *name,size_t lenname);
 PVDENTRY *dbPvdAdd(DBBASE *pdbbase,dbRecordType *precordType,dbRecordNode *precnode);
 void dbPvdDelete(DBBASE *pdbbase,dbRecordNode *precnode);
+void dbPvdMove(DBBASE *pdbbase,dbRecordNode *precnode,char *newname);
 void dbPvdFreeMem(DBBASE *pdbbase);
 
 #ifdef __cplusplus
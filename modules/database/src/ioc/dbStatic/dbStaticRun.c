@@ -176,11 +176,17 @@ long dbFreeRecord(DBENTRY *pdbentry)
 {
     dbRecordType *pdbRecordType = pdbentry->precordType;
     dbRecordNode *precnode = pdbentry->precnode;
+    dbCommonPvt *ppvt;
 
     if(!pdbRecordType) return(S_dbLib_recordTypeNotFound);
     if(!precnode) return(S_dbLib_recNotFound);
     if(!precnode->precord) return(S_dbLib_recNotFound);
-    free(dbRec2Pvt(precnode->precord));
+    ppvt = dbRec2Pvt(precnode->precord);
+    free(ppvt->procStats);
+    if(ppvt->arena)
+        dbRecordArenaRelease(ppvt->arena);
+    else
+        free(ppvt);
     precnode->precord = NULL;
     return(0);
 }
@@ -129,6 +129,8 @@ static int iocBuild_1(void)
         errlogPrintf("iocBuild: Aborting, bad database definition (DBD)!\n");
         return -1;
     }
+    /* Must run before anything holds on to record addresses */
+    dbRecordArenaBuild(pdbbase);
     epicsSignalInstallSigHupIgnore();
     initHookAnnounce(initHookAtBeginning);
 
@@ -23,6 +23,7 @@
 #include "alarm.h"
 #include "dbDefs.h"
 #include "dbAccess.h"
+#include "dbArrayBuffer.h"
 #include "dbConstLink.h"
 #include "dbEvent.h"
 #include "recGbl.h"
@@ -70,7 +71,12 @@ static long readLocked(struct link *pinp, void *dummy)
 {
     aaiRecord *prec = (aaiRecord *) pinp->precord;
     long nRequest = prec->nelm;
-    long status = dbGetLink(pinp, prec->ftvl, prec->bptr, 0, &nRequest);
+    void *buf = dbArrayBufferPrepareReplace((dbCommon *) prec, prec->bptr);
+    long status = S_db_noMemory;
+
+    if (buf)
+        status = dbGetLink(pinp, prec->ftvl, buf, 0, &nRequest);
+    dbArrayBufferCompleteReplace((dbCommon *) prec, buf, status);
 
     if (!status) {
         prec->nord = nRequest;
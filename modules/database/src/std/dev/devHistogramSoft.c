@@ -49,6 +49,25 @@ static long init_record(dbCommon *pcommon)
 
 static long read_histogram(histogramRecord *prec)
 {
+    long nRequest = 0;
+
+    /* An array input adds all of its elements */
+    if (!dbLinkIsConstant(&prec->svl) &&
+        !dbGetNelements(&prec->svl, &nRequest) && nRequest > 1) {
+        if ((epicsUInt32) nRequest > prec->smax) {
+            free(prec->sptr);
+            prec->sptr = calloc(nRequest, sizeof(double));
+            prec->smax = prec->sptr ? nRequest : 0;
+        }
+        if (prec->sptr) {
+            if (dbGetLink(&prec->svl, DBR_DOUBLE, prec->sptr, 0, &nRequest))
+                nRequest = 0;
+            prec->snum = nRequest;
+            return nRequest ? 0 : 2;
+        }
+    }
+
+    prec->snum = 0;
     dbGetLink(&prec->svl, DBR_DOUBLE, &prec->sgnl, 0, 0);
     return 0; /*add count*/
 }
@@ -20,6 +20,7 @@
 #include "alarm.h"
 #include "dbDefs.h"
 #include "dbAccess.h"
+#include "dbArrayBuffer.h"
 #include "dbEvent.h"
 #include "recGbl.h"
 #include "devSup.h"
@@ -60,7 +61,12 @@ static long readLocked(struct link *pinp, void *vrt)
 {
     waveformRecord *prec = (waveformRecord *) pinp->precord;
     struct wfrt *prt = (struct wfrt *) vrt;
-    long status = dbGetLink(pinp, prec->ftvl, prec->bptr, 0, &prt->nRequest);
+    void *buf = dbArrayBufferPrepareReplace((dbCommon *) prec, prec->bptr);
+    long status = S_db_noMemory;
+
+    if (buf)
+        status = dbGetLink(pinp, prec->ftvl, buf, 0, &prt->nRequest);
+    dbArrayBufferCompleteReplace((dbCommon *) prec, buf, status);
 
     if (!status && prt->ptime)
         dbGetTimeStamp(pinp, prt->ptime);
@@ -15,6 +15,7 @@
 #include <stdio.h>
 
 #include <epicsMath.h>
+#include <epicsTime.h>
 #include <freeList.h>
 #include <dbConvertFast.h>
 #include <chfPlugin.h>
@@ -23,24 +24,46 @@
 #include <dbAccess.h>
 #include <epicsExport.h>
 
+typedef enum {
+    modeAbs,
+    modeRel,
+    modeRate,   /* adaptive, cval is updates per second */
+    modeBps     /* adaptive, cval is bytes per second */
+} dbndMode;
+
 typedef struct myStruct {
     int    mode;
     double cval;
     double hyst;
     double last;
+    /* adaptive modes only */
+    double noise;           /* average change between input updates */
+    double prev;            /* previous input value */
+    epicsUInt64 winStart;   /* start of the rate measurement, in ns */
+    unsigned nsent;         /* updates sent since winStart */
 } myStruct;
 
 static void *myStructFreeList;
 
+/* Seconds between adjustments of an adaptive deadband */
+#define ADAPT_PERIOD 0.25
+/* Weight of a new sample in the noise average */
+#define NOISE_WEIGHT 0.1
+/* Bytes sent per update on top of the data: CA header and DBR_TIME_xxx */
+#define UPDATE_OVERHEAD 32
+
 static const
-chfPluginEnumType modeEnum[] = { {"abs", 0}, {"rel", 1}, {NULL,0} };
+chfPluginEnumType modeEnum[] = { {"abs", modeAbs}, {"rel", modeRel},
+    {"rate", modeRate}, {"bps", modeBps}, {NULL,0} };
 
 static const
 chfPluginArgDef opts[] = {
     chfDouble    (myStruct, cval, "d", 0, 1),
     chfEnum      (myStruct, mode, "m", 0, 1, modeEnum),
-    chfTagDouble (myStruct, cval, "abs", mode, 0, 0, 1),
-    chfTagDouble (myStruct, cval, "rel", mode, 1, 0, 1),
+    chfTagDouble (myStruct, cval, "abs", mode, modeAbs, 0, 1),
+    chfTagDouble (myStruct, cval, "rel", mode, modeRel, 0, 1),
+    chfTagDouble (myStruct, cval, "rate", mode, modeRate, 0, 1),
+    chfTagDouble (myStruct, cval, "bps", mode, modeBps, 0, 1),
     chfPluginArgEnd
 };
 
@@ -57,11 +80,71 @@ static void freePvt(void *pvt)
 static int parse_ok(void *pvt)
 {
     myStruct *my = (myStruct*) pvt;
-    my->hyst = my->cval;
     my->last = epicsNAN;
+    if (my->mode == modeRate || my->mode == modeBps) {
+        if (!(my->cval > 0.))
+            return -1;
+        /* start wide open, the first measurement narrows it down */
+        my->hyst = 0.;
+        my->noise = 0.;
+        my->prev = epicsNAN;
+        my->winStart = epicsMonotonicGet();
+        my->nsent = 0;
+    }
+    else
+        my->hyst = my->cval;
     return 0;
 }
 
+static double targetRate(const myStruct *my, const db_field_log *pfl)
+{
+    if (my->mode == modeRate)
+        return my->cval;
+    return my->cval /
+        (UPDATE_OVERHEAD + (double) pfl->field_size * pfl->no_elements);
+}
+
+/* Track how much the signal moves between updates */
+static void adaptInput(myStruct *my, double val)
+{
+    if (!isnan(my->prev))
+        my->noise += NOISE_WEIGHT * (fabs(val - my->prev) - my->noise);
+    my->prev = val;
+}
+
+/* Scale the deadband so the updates sent approach the target rate */
+static void adaptDeadband(myStruct *my, const db_field_log *pfl, unsigned send)
+{
+    epicsUInt64 now = epicsMonotonicGet();
+    double elapsed = (now - my->winStart) * 1e-9;
+    double rate, target;
+
+    if (send) {
+        my->nsent++;
+        /* The subscriber's queue holds unsent updates: back off now */
+        if (pfl->backlog > 1)
+            my->hyst = 2. * my->hyst > my->noise ? 2. * my->hyst : my->noise;
+    }
+    if (elapsed < ADAPT_PERIOD)
+        return;
+
+    rate = my->nsent / elapsed;
+    target = targetRate(my, pfl);
+    if (rate > target) {
+        double factor = rate / target;
+
+        if (factor > 4.) factor = 4.;
+        my->hyst = my->hyst > 0. ? my->hyst * factor : my->noise;
+    }
+    else if (rate < 0.5 * target) {
+        my->hyst *= 0.5;
+        if (my->hyst < 1e-3 * my->noise)
+            my->hyst = 0.;
+    }
+    my->winStart = now;
+    my->nsent = 0;
+}
+
 static db_field_log* filter(void* pvt, dbChannel *chan, db_field_log *pfl) {
     myStruct *my = (myStruct*) pvt;
     long status;
@@ -81,11 +164,17 @@ static db_field_log* filter(void* pvt, dbChannel *chan, db_field_log *pfl) {
         status = dbFastGetConvertRoutine[pfl->field_type][DBR_DOUBLE]
                  (localAddr.pfield, (void*) &val, &localAddr);
         if (!status) {
+            int adaptive = my->mode == modeRate || my->mode == modeBps;
+
+            if (adaptive)
+                adaptInput(my, val);
             send = pfl->mask & ~(DBE_VALUE|DBE_LOG);
             recGblCheckDeadband(&my->last, val, my->hyst, &send, pfl->mask & (DBE_VALUE|DBE_LOG));
-            if (send && my->mode == 1) {
+            if (send && my->mode == modeRel) {
                 my->hyst = val * my->cval/100.;
             }
+            if (adaptive)
+                adaptDeadband(my, pfl, send);
         }
     }
     if (!send) {
@@ -104,9 +193,15 @@ static void channelRegisterPre(dbChannel *chan, void *pvt,
 static void channel_report(dbChannel *chan, void *pvt, int level, const unsigned short indent)
 {
     myStruct *my = (myStruct*) pvt;
-    printf("%*sDeadband (dbnd): mode=%s, delta=%g%s\n", indent, "",
-           chfPluginEnumString(modeEnum, my->mode, "n/a"), my->cval,
-           my->mode == 1 ? "%" : "");
+    if (my->mode == modeRate || my->mode == modeBps)
+        printf("%*sDeadband (dbnd): mode=%s, target=%g%s, delta=%g\n",
+               indent, "", chfPluginEnumString(modeEnum, my->mode, "n/a"),
+               my->cval, my->mode == modeRate ? "/s" : " bytes/s",
+               my->hyst);
+    else
+        printf("%*sDeadband (dbnd): mode=%s, delta=%g%s\n", indent, "",
+               chfPluginEnumString(modeEnum, my->mode, "n/a"), my->cval,
+               my->mode == modeRel ? "%" : "");
 }
 
 static chfPluginIf pif = {
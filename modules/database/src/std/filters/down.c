@@ -0,0 +1,402 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/*
+ *  Downsampling filter: reduces an array to a fixed number of points
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "chfPlugin.h"
+#include "dbAccessDefs.h"
+#include "dbExtractArray.h"
+#include "db_field_log.h"
+#include "dbLock.h"
+#include "epicsExit.h"
+#include "epicsMutex.h"
+#include "freeList.h"
+#include "epicsExport.h"
+
+typedef enum {
+    modeMinMax,
+    modeLttb
+} downMode;
+
+typedef struct myStruct {
+    epicsInt32 n;
+    int mode;
+    void *arrayFreeList;
+    /* for wrapped input, sized when registered */
+    epicsMutexId lock;
+    void *linear;
+    size_t linearSize;
+} myStruct;
+
+static void *myStructFreeList;
+
+static const
+chfPluginEnumType modeEnum[] = { {"minmax", modeMinMax}, {"lttb", modeLttb},
+    {NULL, 0} };
+
+static const
+chfPluginArgDef opts[] = {
+    chfInt32 (myStruct, n, "n", 1, 1),
+    chfEnum  (myStruct, mode, "m", 0, 1, modeEnum),
+    chfPluginArgEnd
+};
+
+static void * allocPvt(void)
+{
+    myStruct *my = (myStruct*) freeListCalloc(myStructFreeList);
+    if (!my) return NULL;
+
+    my->lock = epicsMutexCreate();
+    if (!my->lock) {
+        freeListFree(myStructFreeList, my);
+        return NULL;
+    }
+    return (void *) my;
+}
+
+static void freePvt(void *pvt)
+{
+    myStruct *my = (myStruct*) pvt;
+
+    if (my->arrayFreeList) freeListCleanup(my->arrayFreeList);
+    free(my->linear);
+    epicsMutexDestroy(my->lock);
+    freeListFree(myStructFreeList, pvt);
+}
+
+static int parse_ok(void *pvt)
+{
+    myStruct *my = (myStruct*) pvt;
+
+    if (my->n < (my->mode == modeLttb ? 3 : 2))
+        return -1;
+    return 0;
+}
+
+/* Number of output points for nSource input points */
+static long outputPoints(const myStruct *my, long nSource)
+{
+    if (nSource <= my->n)
+        return nSource;
+    if (my->mode == modeMinMax)
+        return my->n & ~1L;
+    return my->n;
+}
+
+/* The kernels keep LANES independent minima, maxima and sums so that the
+ * compiler can vectorize them, and compute the LTTB triangle areas in
+ * blocks of CHUNK before picking the largest.
+ */
+#define LANES 4
+#define CHUNK 64
+
+/* Min/max envelope: split the input into n/2 buckets and keep the smallest
+ * and the largest element of each, in their original order.
+ */
+#define MINMAX(T, name) \
+static void name(const T *src, T *dst, long nSource, long nTarget) \
+{ \
+    long nBuckets = nTarget / 2, b; \
+ \
+    for (b = 0; b < nBuckets; b++) { \
+        long lo = (long) ((double) b * nSource / nBuckets); \
+        long hi = (long) ((double) (b + 1) * nSource / nBuckets); \
+        T vmin[LANES], vmax[LANES]; \
+        long k; \
+        int j; \
+ \
+        for (j = 0; j < LANES; j++) \
+            vmin[j] = vmax[j] = src[lo]; \
+        for (k = lo; k + LANES <= hi; k += LANES) \
+            for (j = 0; j < LANES; j++) { \
+                T v = src[k + j]; \
+                vmin[j] = v < vmin[j] ? v : vmin[j]; \
+                vmax[j] = v > vmax[j] ? v : vmax[j]; \
+            } \
+        for (; k < hi; k++) { \
+            T v = src[k]; \
+            vmin[0] = v < vmin[0] ? v : vmin[0]; \
+            vmax[0] = v > vmax[0] ? v : vmax[0]; \
+        } \
+        for (j = 1; j < LANES; j++) { \
+            vmin[0] = vmin[j] < vmin[0] ? vmin[j] : vmin[0]; \
+            vmax[0] = vmax[j] > vmax[0] ? vmax[j] : vmax[0]; \
+        } \
+        /* whichever extreme occurs first comes first */ \
+        for (k = lo; k < hi; k++) \
+            if (src[k] == vmin[0] || src[k] == vmax[0]) \
+                break; \
+        if (k < hi && src[k] != vmin[0]) { \
+            *dst++ = vmax[0]; *dst++ = vmin[0]; \
+        } else { \
+            *dst++ = vmin[0]; *dst++ = vmax[0]; \
+        } \
+    } \
+}
+
+/* Largest-Triangle-Three-Buckets (Steinarsson 2013): keep the first and
+ * last point, and from each of the nTarget-2 buckets in between the point
+ * forming the largest triangle with the previously kept point and the
+ * average of the next bucket.
+ */
+#define LTTB(T, name) \
+static void name(const T *src, T *dst, long nSource, long nTarget) \
+{ \
+    double every = (double) (nSource - 2) / (nTarget - 2); \
+    long a = 0, b; \
+ \
+    *dst++ = src[0]; \
+    for (b = 0; b < nTarget - 2; b++) { \
+        long lo = (long) (b * every) + 1; \
+        long hi = (long) ((b + 1) * every) + 1; \
+        long nlo = hi; \
+        long nhi = (long) ((b + 2) * every) + 1; \
+        double ax = (double) a, ay = (double) src[a]; \
+        double sum[LANES] = {0.0, 0.0, 0.0, 0.0}; \
+        double cx, cy, dx, dy, maxArea = -1.0; \
+        long k, keep = lo; \
+        int j, n; \
+ \
+        if (nhi > nSource) nhi = nSource; \
+        if (nlo >= nhi) { \
+            nlo = nSource - 1; \
+            nhi = nSource; \
+        } \
+        for (k = nlo; k + LANES <= nhi; k += LANES) \
+            for (j = 0; j < LANES; j++) \
+                sum[j] += (double) src[k + j]; \
+        for (; k < nhi; k++) \
+            sum[0] += (double) src[k]; \
+        cx = (double) (nlo + nhi - 1) / 2; \
+        cy = ((sum[0] + sum[1]) + (sum[2] + sum[3])) / (nhi - nlo); \
+        dx = ax - cx; \
+        dy = cy - ay; \
+ \
+        for (k = lo; k < hi; k += n) { \
+            double area[CHUNK], x = ax - (double) k; \
+            const T *y = src + k; \
+ \
+            n = hi - k < CHUNK ? (int) (hi - k) : CHUNK; \
+            for (j = 0; j < n; j++) \
+                area[j] = fabs(dx * ((double) y[j] - ay) - (x - j) * dy); \
+            for (j = 0; j < n; j++) \
+                if (area[j] > maxArea) { \
+                    maxArea = area[j]; \
+                    keep = k + j; \
+                } \
+        } \
+        *dst++ = src[keep]; \
+        a = keep; \
+    } \
+    *dst = src[nSource - 1]; \
+}
+
+#define KERNELS(T, name) \
+    MINMAX(T, minMax##name) \
+    LTTB(T, lttb##name)
+KERNELS(epicsInt8, Int8)
+KERNELS(epicsUInt8, UInt8)
+KERNELS(epicsInt16, Int16)
+KERNELS(epicsUInt16, UInt16)
+KERNELS(epicsInt32, Int32)
+KERNELS(epicsUInt32, UInt32)
+KERNELS(epicsInt64, Int64)
+KERNELS(epicsUInt64, UInt64)
+KERNELS(epicsFloat32, Float32)
+KERNELS(epicsFloat64, Float64)
+KERNELS(epicsEnum16, Enum16)
+
+#define DOWN(kernel, name, T) \
+    kernel##name((const T *) pSource, (T *) pTarget, nSource, nTarget)
+#define DISPATCH(kernel) \
+    switch (field_type) { \
+    case DBF_CHAR:   DOWN(kernel, Int8, epicsInt8);       break; \
+    case DBF_UCHAR:  DOWN(kernel, UInt8, epicsUInt8);     break; \
+    case DBF_SHORT:  DOWN(kernel, Int16, epicsInt16);     break; \
+    case DBF_USHORT: DOWN(kernel, UInt16, epicsUInt16);   break; \
+    case DBF_LONG:   DOWN(kernel, Int32, epicsInt32);     break; \
+    case DBF_ULONG:  DOWN(kernel, UInt32, epicsUInt32);   break; \
+    case DBF_INT64:  DOWN(kernel, Int64, epicsInt64);     break; \
+    case DBF_UINT64: DOWN(kernel, UInt64, epicsUInt64);   break; \
+    case DBF_FLOAT:  DOWN(kernel, Float32, epicsFloat32); break; \
+    case DBF_DOUBLE: DOWN(kernel, Float64, epicsFloat64); break; \
+    case DBF_ENUM: \
+    case DBF_MENU: \
+    case DBF_DEVICE: DOWN(kernel, Enum16, epicsEnum16);   break; \
+    default: \
+        break; \
+    }
+
+static void minMax(const void *pSource, void *pTarget, short field_type,
+    long nSource, long nTarget)
+{
+    DISPATCH(minMax)
+}
+
+static void lttb(const void *pSource, void *pTarget, short field_type,
+    long nSource, long nTarget)
+{
+    DISPATCH(lttb)
+}
+
+static void freeArray(db_field_log *pfl)
+{
+    if (pfl->type == dbfl_type_ref) {
+        freeListFree(pfl->u.r.pvt, pfl->u.r.field);
+    }
+}
+
+static db_field_log* filter(void* pvt, dbChannel *chan, db_field_log *pfl)
+{
+    myStruct *my = (myStruct*) pvt;
+    int must_lock;
+    long nSource = pfl->no_elements;
+    long offset = 0;
+    long nTarget;
+    void *pSource = pfl->u.r.field;
+    void *pTarget;
+
+    if (pfl->type != dbfl_type_ref)
+        return pfl;
+
+    must_lock = !pfl->u.r.dtor;
+    if (must_lock) {
+        dbScanLock(dbChannelRecord(chan));
+        dbChannelGetArrayInfo(chan, &pSource, &nSource, &offset);
+    }
+    if (nSource > pfl->no_elements)
+        nSource = pfl->no_elements;
+    nTarget = outputPoints(my, nSource);
+
+    if (nTarget > 0) {
+        pTarget = freeListMalloc(my->arrayFreeList);
+        if (!pTarget) goto done;
+
+        offset %= pfl->no_elements;
+        if (nTarget == nSource) {
+            dbExtractArray(pSource, pTarget, pfl->field_size,
+                nTarget, pfl->no_elements, offset, 1);
+        } else {
+            int wrapped = offset + nSource > pfl->no_elements;
+
+            /* The kernels want contiguous data.  Reads and monitors of a
+             * channel may run in different threads, so the buffer for
+             * wrapped data is locked while in use.
+             */
+            if (wrapped) {
+                epicsMutexMustLock(my->lock);
+                if ((size_t) nSource * pfl->field_size > my->linearSize) {
+                    epicsMutexUnlock(my->lock);
+                    freeListFree(my->arrayFreeList, pTarget);
+                    goto done;
+                }
+                dbExtractArray(pSource, my->linear, pfl->field_size,
+                    nSource, pfl->no_elements, offset, 1);
+                pSource = my->linear;
+            } else {
+                pSource = (char *) pSource + offset * pfl->field_size;
+            }
+            if (my->mode == modeLttb)
+                lttb(pSource, pTarget, pfl->field_type, nSource, nTarget);
+            else
+                minMax(pSource, pTarget, pfl->field_type, nSource, nTarget);
+            if (wrapped)
+                epicsMutexUnlock(my->lock);
+        }
+        if (pfl->u.r.dtor) pfl->u.r.dtor(pfl);
+        pfl->u.r.field = pTarget;
+        pfl->u.r.dtor = freeArray;
+        pfl->u.r.pvt = my->arrayFreeList;
+    }
+    pfl->no_elements = nTarget;
+done:
+    if (must_lock)
+        dbScanUnlock(dbChannelRecord(chan));
+    return pfl;
+}
+
+static void channelRegisterPost(dbChannel *chan, void *pvt,
+    chPostEventFunc **cb_out, void **arg_out, db_field_log *probe)
+{
+    myStruct *my = (myStruct*) pvt;
+    size_t linearSize;
+    long max;
+
+    /* numeric arrays longer than the output only */
+    if (probe->no_elements <= my->n ||
+        probe->field_type <= DBF_STRING || probe->field_type > DBF_DEVICE)
+        return;
+
+    max = my->n;
+    if (!my->arrayFreeList)
+        freeListInitPvt(&my->arrayFreeList, max * probe->field_size, 2);
+    if (!my->arrayFreeList) return;
+
+    linearSize = (size_t) probe->no_elements * probe->field_size;
+    epicsMutexMustLock(my->lock);
+    if (linearSize > my->linearSize) {
+        void *linear = malloc(linearSize);
+
+        if (!linear) {
+            epicsMutexUnlock(my->lock);
+            return;
+        }
+        free(my->linear);
+        my->linear = linear;
+        my->linearSize = linearSize;
+    }
+    epicsMutexUnlock(my->lock);
+
+    probe->no_elements = max;
+    *cb_out = filter;
+    *arg_out = pvt;
+}
+
+static void channel_report(dbChannel *chan, void *pvt, int level,
+    const unsigned short indent)
+{
+    myStruct *my = (myStruct*) pvt;
+    printf("%*sDownsample (down): n=%d, mode=%s\n", indent, "",
+           my->n, chfPluginEnumString(modeEnum, my->mode, "n/a"));
+}
+
+static chfPluginIf pif = {
+    allocPvt,
+    freePvt,
+
+    NULL, /* parse_error, */
+    parse_ok,
+
+    NULL, /* channel_open, */
+    NULL, /* channelRegisterPre, */
+    channelRegisterPost,
+    channel_report,
+    NULL /* channel_close */
+};
+
+static void downShutdown(void* ignore)
+{
+    if(myStructFreeList)
+        freeListCleanup(myStructFreeList);
+    myStructFreeList = NULL;
+}
+
+static void downInitialize(void)
+{
+    if (!myStructFreeList)
+        freeListInitPvt(&myStructFreeList, sizeof(myStruct), 64);
+
+    chfPluginRegister("down", &pif, opts);
+    epicsAtExit(downShutdown, NULL);
+}
+
+epicsExportRegistrar(downInitialize);
@@ -0,0 +1,401 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/*
+ *  Statistics filter: reduces a window of updates to one summary
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "caeventmask.h"
+#include "chfPlugin.h"
+#include "dbAccessDefs.h"
+#include "db_field_log.h"
+#include "dbLock.h"
+#include "epicsExit.h"
+#include "epicsMath.h"
+#include "freeList.h"
+#include "epicsExport.h"
+
+typedef enum {
+    statMean,
+    statRms,
+    statStd,
+    statMin,
+    statMax,
+    statSum,
+    statCount,
+    statNKinds
+} statKind;
+
+static const char * const statNames[statNKinds] = {
+    "mean", "rms", "std", "min", "max", "sum", "n"
+};
+
+#define MAX_OUT 8
+
+typedef struct statAcc {
+    double mean;
+    double m2;          /* sum of squared differences from the mean */
+    double sum;
+    double min;
+    double max;
+    epicsUInt32 count;
+} statAcc;
+
+typedef struct myStruct {
+    epicsInt32 n;
+    char out[64];
+    int nout;
+    statKind kind[MAX_OUT];
+    void *arrayFreeList;
+    /* window state, only touched by the event context */
+    epicsInt32 i;
+    statAcc acc;
+    unsigned short stat;
+    unsigned short sevr;
+    char amsg[40];
+} myStruct;
+
+static void *myStructFreeList;
+
+static const
+chfPluginArgDef opts[] = {
+    chfInt32  (myStruct, n, "n", 1, 1),
+    chfString (myStruct, out, "out", 0, 1),
+    chfPluginArgEnd
+};
+
+static void * allocPvt(void)
+{
+    myStruct *my = (myStruct*) freeListCalloc(myStructFreeList);
+    if (!my) return NULL;
+
+    strcpy(my->out, "mean");
+    return (void *) my;
+}
+
+static void freePvt(void *pvt)
+{
+    myStruct *my = (myStruct*) pvt;
+
+    if (my->arrayFreeList) freeListCleanup(my->arrayFreeList);
+    freeListFree(myStructFreeList, pvt);
+}
+
+static void accReset(statAcc *acc)
+{
+    acc->mean = acc->m2 = acc->sum = 0.0;
+    acc->min = epicsINF;
+    acc->max = -epicsINF;
+    acc->count = 0;
+}
+
+/* Parse a list of output names separated by commas or spaces */
+static int parse_ok(void *pvt)
+{
+    myStruct *my = (myStruct*) pvt;
+    const char *p = my->out;
+
+    if (my->n < 1)
+        return -1;
+
+    my->nout = 0;
+    while (*p) {
+        size_t len = strcspn(p, ", ");
+        int k;
+
+        if (len) {
+            for (k = 0; k < statNKinds; k++) {
+                if (strlen(statNames[k]) == len &&
+                    !strncmp(statNames[k], p, len))
+                    break;
+            }
+            if (k == statNKinds || my->nout == MAX_OUT)
+                return -1;
+            my->kind[my->nout++] = (statKind) k;
+        }
+        p += len;
+        if (*p) p++;
+    }
+    if (!my->nout)
+        return -1;
+
+    accReset(&my->acc);
+    return 0;
+}
+
+/* Add a block of count values with the given sum, extremes and sum of
+ * squared differences from their mean.  This is Welford's update extended
+ * to blocks (Chan et al.); for a single value it is Welford's update.
+ */
+static void accMerge(statAcc *acc, long count, double sum, double m2,
+    double mn, double mx)
+{
+    double mean, delta, n;
+
+    if (count <= 0)
+        return;
+    mean = sum / count;
+    n = (double) acc->count + count;
+    delta = mean - acc->mean;
+    acc->mean += delta * count / n;
+    acc->m2 += m2 + delta * delta * acc->count * count / n;
+    acc->sum += sum;
+    acc->min = mn < acc->min ? mn : acc->min;
+    acc->max = mx > acc->max ? mx : acc->max;
+    acc->count += count;
+}
+
+/* Two simple loops over the native type, so they vectorize: the sum and
+ * extremes, then the squared differences from the mean of the block.
+ */
+#define ACCUMULATE(T) { \
+    const T *pv = (const T *) pfield + start; \
+    double sum = 0.0, m2 = 0.0, mean, mn = epicsINF, mx = -epicsINF; \
+    long k; \
+    for (k = 0; k < count; k++) { \
+        double v = pv[k]; \
+        sum += v; \
+        mn = v < mn ? v : mn; \
+        mx = v > mx ? v : mx; \
+    } \
+    mean = count ? sum / count : 0.0; \
+    for (k = 0; k < count; k++) { \
+        double d = pv[k] - mean; \
+        m2 += d * d; \
+    } \
+    accMerge(acc, count, sum, m2, mn, mx); \
+    }
+
+static void accumulate(statAcc *acc, const void *pfield, short field_type,
+    long start, long count)
+{
+    switch (field_type) {
+    case DBF_CHAR:   ACCUMULATE(epicsInt8);    break;
+    case DBF_UCHAR:  ACCUMULATE(epicsUInt8);   break;
+    case DBF_SHORT:  ACCUMULATE(epicsInt16);   break;
+    case DBF_USHORT: ACCUMULATE(epicsUInt16);  break;
+    case DBF_LONG:   ACCUMULATE(epicsInt32);   break;
+    case DBF_ULONG:  ACCUMULATE(epicsUInt32);  break;
+    case DBF_INT64:  ACCUMULATE(epicsInt64);   break;
+    case DBF_UINT64: ACCUMULATE(epicsUInt64);  break;
+    case DBF_FLOAT:  ACCUMULATE(epicsFloat32); break;
+    case DBF_DOUBLE: ACCUMULATE(epicsFloat64); break;
+    case DBF_ENUM:
+    case DBF_MENU:
+    case DBF_DEVICE: ACCUMULATE(epicsEnum16);  break;
+    default:
+        break;
+    }
+}
+
+/* Add the data of one field_log to acc, the array may wrap around */
+static void accumulateLog(statAcc *acc, dbChannel *chan, db_field_log *pfl)
+{
+    long nSource = pfl->no_elements;
+    long offset = 0;
+    void *pSource;
+    int must_lock;
+
+    if (pfl->type == dbfl_type_val) {
+        accumulate(acc, &pfl->u.v.field, pfl->field_type, 0, 1);
+        return;
+    }
+
+    pSource = pfl->u.r.field;
+    must_lock = !pfl->u.r.dtor;
+    if (must_lock) {
+        dbScanLock(dbChannelRecord(chan));
+        dbChannelGetArrayInfo(chan, &pSource, &nSource, &offset);
+    }
+    if (nSource > pfl->no_elements)
+        nSource = pfl->no_elements;
+    offset %= pfl->no_elements ? pfl->no_elements : 1;
+    if (offset + nSource > pfl->no_elements) {
+        long first = pfl->no_elements - offset;
+
+        accumulate(acc, pSource, pfl->field_type, offset, first);
+        accumulate(acc, pSource, pfl->field_type, 0, nSource - first);
+    } else {
+        accumulate(acc, pSource, pfl->field_type, offset, nSource);
+    }
+    if (must_lock)
+        dbScanUnlock(dbChannelRecord(chan));
+}
+
+static double statValue(const statAcc *acc, statKind kind)
+{
+    if (kind == statCount)
+        return acc->count;
+    if (kind == statSum)
+        return acc->sum;
+    if (!acc->count)
+        return epicsNAN;
+
+    switch (kind) {
+    case statMean: return acc->mean;
+    case statRms:
+        return sqrt(acc->m2 / acc->count + acc->mean * acc->mean);
+    case statStd:  return sqrt(acc->m2 / acc->count);
+    case statMin:  return acc->min;
+    case statMax:  return acc->max;
+    default:       return epicsNAN;
+    }
+}
+
+static void freeArray(db_field_log *pfl)
+{
+    if (pfl->type == dbfl_type_ref) {
+        freeListFree(pfl->u.r.pvt, pfl->u.r.field);
+    }
+}
+
+/* Replace the data of pfl by the selected statistics of acc */
+static db_field_log* summarize(myStruct *my, const statAcc *acc,
+    db_field_log *pfl)
+{
+    epicsFloat64 vals[MAX_OUT];
+    epicsFloat64 *pout = NULL;
+    int k;
+
+    for (k = 0; k < my->nout; k++)
+        vals[k] = statValue(acc, my->kind[k]);
+    if (my->nout > 1) {
+        pout = freeListMalloc(my->arrayFreeList);
+        if (!pout) {
+            db_delete_field_log(pfl);
+            return NULL;
+        }
+        memcpy(pout, vals, my->nout * sizeof(epicsFloat64));
+    }
+
+    if (pfl->type == dbfl_type_ref && pfl->u.r.dtor)
+        pfl->u.r.dtor(pfl);
+    if (pout) {
+        pfl->type = dbfl_type_ref;
+        pfl->u.r.field = pout;
+        pfl->u.r.dtor = freeArray;
+        pfl->u.r.pvt = my->arrayFreeList;
+    } else {
+        pfl->type = dbfl_type_val;
+        pfl->u.v.field.dbf_double = vals[0];
+    }
+    pfl->field_type = DBF_DOUBLE;
+    pfl->field_size = sizeof(epicsFloat64);
+    pfl->no_elements = my->nout;
+    return pfl;
+}
+
+static db_field_log* filter(void* pvt, dbChannel *chan, db_field_log *pfl)
+{
+    myStruct *my = (myStruct*) pvt;
+    int isValue = pfl->ctx == dbfl_context_event && !pfl->single &&
+        (pfl->mask & (DBE_VALUE | DBE_LOG)) && !(pfl->mask & DBE_PROPERTY);
+
+    /* A read only sees its own sample, and so do the initial update of a
+     * subscription and property or alarm only updates, which don't enter
+     * the window.
+     */
+    if (!isValue) {
+        statAcc acc;
+
+        accReset(&acc);
+        accumulateLog(&acc, chan, pfl);
+        return summarize(my, &acc, pfl);
+    }
+
+    accumulateLog(&my->acc, chan, pfl);
+    if (my->i == 0 || pfl->sevr > my->sevr) {
+        my->stat = pfl->stat;
+        my->sevr = pfl->sevr;
+        strcpy(my->amsg, pfl->amsg);
+    }
+    if (++my->i < my->n) {
+        db_delete_field_log(pfl);
+        return NULL;
+    }
+
+    /* Emit the summary with the timestamp of the last update and the
+     * highest severity seen in the window.
+     */
+    pfl->stat = my->stat;
+    pfl->sevr = my->sevr;
+    strcpy(pfl->amsg, my->amsg);
+    pfl = summarize(my, &my->acc, pfl);
+    my->i = 0;
+    accReset(&my->acc);
+    return pfl;
+}
+
+static void channelRegisterPre(dbChannel *chan, void *pvt,
+    chPostEventFunc **cb_out, void **arg_out, db_field_log *probe)
+{
+    myStruct *my = (myStruct*) pvt;
+
+    /* numeric data only */
+    if (probe->field_type <= DBF_STRING || probe->field_type > DBF_DEVICE)
+        return;
+
+    if (my->nout > 1) {
+        if (!my->arrayFreeList)
+            freeListInitPvt(&my->arrayFreeList,
+                my->nout * sizeof(epicsFloat64), 2);
+        if (!my->arrayFreeList) return;
+    }
+    probe->field_type = DBF_DOUBLE;
+    probe->field_size = sizeof(epicsFloat64);
+    probe->no_elements = my->nout;
+    *cb_out = filter;
+    *arg_out = pvt;
+}
+
+static void channel_report(dbChannel *chan, void *pvt, int level,
+    const unsigned short indent)
+{
+    myStruct *my = (myStruct*) pvt;
+    int k;
+
+    printf("%*sStatistics (stat): n=%d, i=%d, out=", indent, "",
+           my->n, my->i);
+    for (k = 0; k < my->nout; k++)
+        printf("%s%s", k ? "," : "", statNames[my->kind[k]]);
+    printf("\n");
+}
+
+static chfPluginIf pif = {
+    allocPvt,
+    freePvt,
+
+    NULL, /* parse_error, */
+    parse_ok,
+
+    NULL, /* channel_open, */
+    channelRegisterPre,
+    NULL, /* channelRegisterPost, */
+    channel_report,
+    NULL /* channel_close */
+};
+
+static void statShutdown(void* ignore)
+{
+    if(myStructFreeList)
+        freeListCleanup(myStructFreeList);
+    myStructFreeList = NULL;
+}
+
+static void statInitialize(void)
+{
+    if (!myStructFreeList)
+        freeListInitPvt(&myStructFreeList, sizeof(myStruct), 64);
+
+    chfPluginRegister("stat", &pif, opts);
+    epicsAtExit(statShutdown, NULL);
+}
+
+epicsExportRegistrar(statInitialize);
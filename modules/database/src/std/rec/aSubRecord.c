@@ -25,6 +25,7 @@
 #include "dbEvent.h"
 #include "dbAccess.h"
 #include "dbFldTypes.h"
+#include "dbLink.h"
 #include "dbStaticLib.h"
 #include "errMdef.h"
 #include "errlog.h"
@@ -88,9 +89,20 @@ static long initFields(epicsEnum16 *pft, epicsUInt32 *pno, epicsUInt32 *pne,
 static long fetch_values(aSubRecord *prec);
 static void monitor(aSubRecord *);
 static long do_sub(aSubRecord *);
+static void restore_inputs(aSubRecord *);
+static void copy_inputs(aSubRecord *);
 
 #define NUM_ARGS        21
 
+/* With ZCPY the input pointers A..U may refer to the storage of the link
+ * targets while the record is active, this keeps the record's own buffers.
+ */
+typedef struct aSubInputs {
+    void *buf[NUM_ARGS];
+    epicsUInt32 ne[NUM_ARGS];
+    char mapped[NUM_ARGS];
+} aSubInputs;
+
 /* These are the names of the Input fields */
 static const char *Ifldnames[] = {
     "A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K",
@@ -118,6 +130,14 @@ static long init_record(struct dbCommon *pcommon, int pass)
             Ifldnames, &prec->a,    NULL);
         initFields(&prec->ftva, &prec->nova, &prec->neva, &prec->onva,
             Ofldnames, &prec->vala, &prec->ovla);
+        if (prec->zcpy) {
+            aSubInputs *pin = callocMustSucceed(1, sizeof(aSubInputs),
+                "aSubRecord::init_record");
+
+            for (i = 0; i < NUM_ARGS; i++)
+                pin->buf[i] = (&prec->a)[i];
+            prec->zpvt = pin;
+        }
         return 0;
     }
 
@@ -223,12 +243,17 @@ static long process(struct dbCommon *pcommon)
         prec->val = status;
     }
 
-    if (!pact && prec->pact)
+    if (!pact && prec->pact) {
+        /* The targets are not locked until the subroutine completes */
+        copy_inputs(prec);
         return 0;
+    }
 
     prec->pact = TRUE;
     recGblGetTimeStamp(prec);
 
+    restore_inputs(prec);
+
     /* Push the output link values */
     if (!status) {
         int i;
@@ -276,8 +301,22 @@ static long fetch_values(aSubRecord *prec)
     /* Get the input link values */
     for (i = 0; i < NUM_ARGS; i++) {
         long nRequest = (&prec->noa)[i];
-        status = dbGetLink(&(&prec->inpa)[i], (&prec->fta)[i], (&prec->a)[i], 0,
-            &nRequest);
+        aSubInputs *pin = (aSubInputs *)prec->zpvt;
+
+        if (pin) {
+            void *pbuf = pin->buf[i];
+
+            status = dbGetLinkRef(&(&prec->inpa)[i], (&prec->fta)[i], &pbuf,
+                &nRequest);
+            if (!status && pbuf != pin->buf[i]) {
+                pin->ne[i] = (&prec->nea)[i];
+                pin->mapped[i] = 1;
+                (&prec->a)[i] = pbuf;
+            }
+        }
+        else
+            status = dbGetLink(&(&prec->inpa)[i], (&prec->fta)[i],
+                (&prec->a)[i], 0, &nRequest);
         if (status)
             return status;
         (&prec->nea)[i] = nRequest;
@@ -285,6 +324,43 @@ static long fetch_values(aSubRecord *prec)
     return 0;
 }
 
+/* Point the input fields back at the record's own buffers */
+static void restore_inputs(aSubRecord *prec)
+{
+    aSubInputs *pin = (aSubInputs *)prec->zpvt;
+    int i;
+
+    if (!pin)
+        return;
+
+    for (i = 0; i < NUM_ARGS; i++) {
+        if (pin->mapped[i]) {
+            (&prec->a)[i] = pin->buf[i];
+            (&prec->nea)[i] = pin->ne[i];
+            pin->mapped[i] = 0;
+        }
+    }
+}
+
+/* Copy mapped inputs into the record's own buffers */
+static void copy_inputs(aSubRecord *prec)
+{
+    aSubInputs *pin = (aSubInputs *)prec->zpvt;
+    int i;
+
+    if (!pin)
+        return;
+
+    for (i = 0; i < NUM_ARGS; i++) {
+        if (pin->mapped[i]) {
+            memcpy(pin->buf[i], (&prec->a)[i],
+                (&prec->nea)[i] * dbValueSize((&prec->fta)[i]));
+            (&prec->a)[i] = pin->buf[i];
+            pin->mapped[i] = 0;
+        }
+    }
+}
+
 #define indexof(field) aSubRecord##field
 
 static long get_inlinkNumber(int fieldIndex) {
@@ -508,7 +584,11 @@ static long get_array_info(DBADDR *paddr, long *no_elements, long *offset)
 
     if (fieldIndex >= aSubRecordA &&
         fieldIndex <= aSubRecordU) {
-        *no_elements = (&prec->nea)[fieldIndex - aSubRecordA];
+        int i = fieldIndex - aSubRecordA;
+
+        /* differs from cvt_dbaddr() only while ZCPY inputs are mapped */
+        paddr->pfield = (&prec->a)[i];
+        *no_elements = (&prec->nea)[i];
     }
     else if (fieldIndex >= aSubRecordVALA &&
              fieldIndex <= aSubRecordVALU) {
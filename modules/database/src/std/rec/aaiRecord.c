@@ -42,6 +42,7 @@
 #include "recSup.h"
 #include "recGbl.h"
 #include "cantProceed.h"
+#include "dbArrayBuffer.h"
 #include "special.h"
 #include "menuYesNo.h"
 
@@ -126,6 +127,15 @@ static long init_record(struct dbCommon *pcommon, int pass)
             else if (status)
                 return status;
         }
+        if (!prec->bptr && prec->nbuf > 1) {
+            long status = dbArrayBufferInit(pcommon, &prec->bptr,
+                prec->nelm * dbValueSize(prec->ftvl), prec->nbuf);
+
+            if (status) {
+                recGblRecordError(status, prec, "aai: init_record");
+                return status;
+            }
+        }
         if (!prec->bptr) {
             /* device support did not allocate memory so we must do it */
             prec->bptr = callocMustSucceed(prec->nelm, dbValueSize(prec->ftvl),
@@ -92,6 +92,12 @@ static void reset(compressRecord *prec)
     if (prec->alg == compressALG_Average && prec->sptr == NULL) {
         prec->sptr = calloc(prec->nsam, sizeof(double));
     }
+    /* and for the samples of a scalar median, N may have changed */
+    free(prec->mptr);
+    prec->mptr = NULL;
+    if (prec->alg == compressALG_N_to_1_Median) {
+        prec->mptr = calloc(prec->n > 0 ? prec->n : 1, sizeof(double));
+    }
 
     if (prec->bptr && prec->nsam)
         memset(prec->bptr, 0, prec->nsam * sizeof(double));
@@ -120,41 +126,205 @@ static void put_value(compressRecord *prec, double *psource, int n)
     if (nuse > nsam)
         nuse = nsam;
 
-    while (n--) {
-        /* for LIFO, pre-decrement modulo nsam */
-        if (!fifo)
-            offset = (offset + nsam - 1) % nsam;
-
-        prec->bptr[offset] = *psource++;
+    /* only the last nsam values survive, skip the others */
+    if ((epicsUInt32) n > nsam) {
+        epicsUInt32 skip = n - nsam;
 
-        /* for FIFO, post-increment modulo nsam */
         if (fifo)
-            offset = (offset + 1) % nsam;
+            offset = (offset + skip) % nsam;
+        else
+            offset = (offset + nsam - skip % nsam) % nsam;
+        psource += skip;
+        n = nsam;
+    }
+
+    if (fifo) {
+        /* post-increment: copy up to the end, then wrap around */
+        epicsUInt32 first = nsam - offset;
+
+        if (first > (epicsUInt32) n)
+            first = n;
+        memcpy(prec->bptr + offset, psource, first * sizeof(double));
+        memcpy(prec->bptr, psource + first, (n - first) * sizeof(double));
+        offset = (offset + n) % nsam;
+    }
+    else {
+        /* pre-decrement: the newest value ends up at the offset */
+        double *pdest = prec->bptr + offset;
+
+        while (n--) {
+            if (pdest == prec->bptr)
+                pdest += nsam;
+            *--pdest = *psource++;
+        }
+        offset = pdest - prec->bptr;
     }
 
     prec->off = offset;
     prec->nuse = nuse;
 }
 
+/* Reductions over one group of samples.  Independent partial results
+ * let the compiler use SIMD instructions and overlap the additions.
+ */
+#define LANES 4
 
-/* qsort comparison function (for median calculation) */
-static int compare(const void *arg1, const void *arg2)
+static double group_low(const double *psource, epicsInt32 n)
 {
-    double a = *(double *)arg1;
-    double b = *(double *)arg2;
+    double low[LANES];
+    epicsInt32 i, k;
+
+    for (k = 0; k < LANES; k++)
+        low[k] = psource[0];
+    for (i = 0; i + LANES <= n; i += LANES)
+        for (k = 0; k < LANES; k++)
+            low[k] = psource[i + k] < low[k] ? psource[i + k] : low[k];
+    for (; i < n; i++)
+        low[0] = psource[i] < low[0] ? psource[i] : low[0];
+    for (k = 1; k < LANES; k++)
+        low[0] = low[k] < low[0] ? low[k] : low[0];
+    return low[0];
+}
 
-    if      ( a <  b ) return -1;
-    else if ( a == b ) return  0;
-    else               return  1;
+static double group_high(const double *psource, epicsInt32 n)
+{
+    double high[LANES];
+    epicsInt32 i, k;
+
+    for (k = 0; k < LANES; k++)
+        high[k] = psource[0];
+    for (i = 0; i + LANES <= n; i += LANES)
+        for (k = 0; k < LANES; k++)
+            high[k] = psource[i + k] > high[k] ? psource[i + k] : high[k];
+    for (; i < n; i++)
+        high[0] = psource[i] > high[0] ? psource[i] : high[0];
+    for (k = 1; k < LANES; k++)
+        high[0] = high[k] > high[0] ? high[k] : high[0];
+    return high[0];
+}
+
+static double group_sum(const double *psource, epicsInt32 n)
+{
+    double sum[LANES] = {0.0, 0.0, 0.0, 0.0};
+    epicsInt32 i, k;
+
+    for (i = 0; i + LANES <= n; i += LANES)
+        for (k = 0; k < LANES; k++)
+            sum[k] += psource[i + k];
+    for (; i < n; i++)
+        sum[0] += psource[i];
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+/* Return the k-th smallest of n values, reordering them (Hoare's
+ * selection, linear on average where sorting was n log n).
+ */
+static double group_select(double *psource, epicsInt32 n, epicsInt32 k)
+{
+    epicsInt32 lo = 0, hi = n - 1;
+
+    while (lo < hi) {
+        double pivot = psource[k];
+        epicsInt32 i = lo, j = hi;
+
+        do {
+            while (psource[i] < pivot)
+                i++;
+            while (pivot < psource[j])
+                j--;
+            if (i <= j) {
+                double tmp = psource[i];
+
+                psource[i++] = psource[j];
+                psource[j--] = tmp;
+            }
+        } while (i <= j);
+        if (j < k)
+            lo = i;
+        if (k < i)
+            hi = j;
+    }
+    return psource[k];
+}
+
+/* Binary min-heap of size values, used by the streaming scalar median */
+static void heap_push(double *heap, epicsInt32 size, double value)
+{
+    epicsInt32 i = size;
+
+    while (i > 0) {
+        epicsInt32 parent = (i - 1) / 2;
+
+        if (heap[parent] <= value)
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = value;
+}
+
+/* Replace the smallest of size values and restore the heap order */
+static void heap_replace(double *heap, epicsInt32 size, double value)
+{
+    epicsInt32 i = 0;
+
+    for (;;) {
+        epicsInt32 child = 2 * i + 1;
+
+        if (child >= size)
+            break;
+        if (child + 1 < size && heap[child + 1] < heap[child])
+            child++;
+        if (value <= heap[child])
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = value;
+}
+
+/* Add the sample number count (from 0) of a group of n to the median.
+ * The lower count/2 samples are kept negated in a heap at the start of
+ * the buffer, the others in a heap from n/2 on, so the smallest of the
+ * upper heap is always the (count/2)-th smallest sample, the same one
+ * group_select() picks.  Each sample costs O(log n).
+ */
+static double median_add(double *pbuf, epicsInt32 n, epicsInt32 count,
+    double value)
+{
+    double *lower = pbuf, *upper = pbuf + n / 2;
+    epicsInt32 nlower = count / 2, nupper = count - nlower;
+
+    if (count % 2 == 0) {
+        /* upper half grows */
+        if (nlower > 0 && value < -lower[0]) {
+            double top = -lower[0];
+
+            heap_replace(lower, nlower, -value);
+            value = top;
+        }
+        heap_push(upper, nupper, value);
+    }
+    else {
+        /* lower half grows */
+        if (value > upper[0]) {
+            double top = upper[0];
+
+            heap_replace(upper, nupper, value);
+            value = top;
+        }
+        heap_push(lower, nlower, -value);
+    }
+    return upper[0];
 }
 
 static int compress_array(compressRecord *prec,
     double *psource, int no_elements)
 {
-    epicsInt32 i,j;
+    epicsInt32 i;
     epicsInt32 n, nnew;
     epicsInt32 nsam = prec->nsam;
-    double value;
+    double *presult;
 
     /* skip out of limit data */
     if (prec->ilil < prec->ihil) {
@@ -175,51 +345,37 @@ static int compress_array(compressRecord *prec,
         nnew = (no_elements / n);
     else nnew = nsam;
 
+    /* The results are collected at the start of the work buffer, in
+     * samples already consumed, and written to the ring in one go.
+     */
+    presult = psource;
+
     /* compress according to specified algorithm */
     switch (prec->alg){
     case compressALG_N_to_1_Low_Value:
         /* compress N to 1 keeping the lowest value */
-        for (i = 0; i < nnew; i++) {
-            value = *psource++;
-            for (j = 1; j < n; j++, psource++) {
-                if (value > *psource)
-                    value = *psource;
-            }
-            put_value(prec, &value, 1);
-        }
+        for (i = 0; i < nnew; i++, psource += n)
+            presult[i] = group_low(psource, n);
         break;
     case compressALG_N_to_1_High_Value:
         /* compress N to 1 keeping the highest value */
-        for (i = 0; i < nnew; i++){
-            value = *psource++;
-            for (j = 1; j < n; j++, psource++) {
-                if (value < *psource)
-                    value = *psource;
-            }
-            put_value(prec, &value, 1);
-        }
+        for (i = 0; i < nnew; i++, psource += n)
+            presult[i] = group_high(psource, n);
         break;
     case compressALG_N_to_1_Average:
         /* compress N to 1 keeping the average value */
-        for (i = 0; i < nnew; i++) {
-            value = 0;
-            for (j = 0; j < n; j++, psource++)
-                value += *psource;
-            value /= n;
-            put_value(prec, &value, 1);
-        }
+        for (i = 0; i < nnew; i++, psource += n)
+            presult[i] = group_sum(psource, n) / n;
         break;
 
     case compressALG_N_to_1_Median:
         /* compress N to 1 keeping the median value */
-        /* note: sorts source array (OK; it's a work pointer) */
-        for (i = 0; i < nnew; i++, psource += nnew) {
-            qsort(psource, n, sizeof(double), compare);
-            value = psource[n / 2];
-            put_value(prec, &value, 1);
-        }
+        /* note: reorders source array (OK; it's a work pointer) */
+        for (i = 0; i < nnew; i++, psource += n)
+            presult[i] = group_select(psource, n, n / 2);
         break;
     }
+    put_value(prec, presult, nnew);
     return 0;
 }
 
@@ -289,9 +445,16 @@ static int compress_scalar(struct compressRecord *prec,double *psource)
         if ((value > *pdest) || (inx == 0))
             *pdest = value;
         break;
-    /* for scalars, Median not implemented => use average */
-    case (compressALG_N_to_1_Average):
     case (compressALG_N_to_1_Median):
+        /* keep a running median of the samples seen so far */
+        if (prec->mptr) {
+            epicsInt32 n = prec->n > 0 ? prec->n : 1;
+
+            *pdest = median_add(prec->mptr, n, inx, value);
+            break;
+        }
+        /* no buffer => use average */
+    case (compressALG_N_to_1_Average):
         if (inx == 0)
             *pdest = value;
         else {
@@ -25,6 +25,8 @@
 #include "dbDefs.h"
 #include "epicsPrint.h"
 #include "alarm.h"
+#include "epicsAtomic.h"
+#include "epicsTime.h"
 #include "callback.h"
 #include "dbAccess.h"
 #include "dbEvent.h"
@@ -92,9 +94,12 @@ epicsExportAddress(int, histogramSDELprecision);
 typedef struct myCallback {
     epicsCallback callback;
     histogramRecord *prec;
+    int pending;        /* flush requested, guarded by the record lock */
 } myCallback;
 
 static long add_count(histogramRecord *);
+static long add_samples(histogramRecord *, const double *, epicsUInt32);
+static void add_pending(histogramRecord *);
 static long clear_histogram(histogramRecord *);
 static void monitor(histogramRecord *);
 static long readValue(histogramRecord *);
@@ -113,6 +118,7 @@ static void wdogCallback(epicsCallback *arg)
         recGblGetTimeStamp(prec);
         db_post_events(prec, (void*)&prec->val, DBE_VALUE | DBE_LOG);
         prec->mcnt = 0;
+        prec->mlst = epicsMonotonicGet();
         dbScanUnlock((struct dbCommon *)prec);
     }
 
@@ -124,6 +130,60 @@ static void wdogCallback(epicsCallback *arg)
     return;
 }
 
+/* Posts counts held back by MMIN */
+static void flushCallback(epicsCallback *arg)
+{
+    myCallback *pcallback;
+    histogramRecord *prec;
+
+    callbackGetUser(pcallback, arg);
+    prec = pcallback->prec;
+    dbScanLock((struct dbCommon *)prec);
+    pcallback->pending = FALSE;
+    if (prec->mcnt > prec->mdel) {
+        db_post_events(prec, (void*)&prec->val, DBE_VALUE | DBE_LOG);
+        prec->mcnt = 0;
+        prec->mlst = epicsMonotonicGet();
+    }
+    dbScanUnlock((struct dbCommon *)prec);
+}
+
+/* Returns TRUE if a count monitor must wait for MMIN to pass */
+static int rateLimited(histogramRecord *prec)
+{
+    epicsUInt64 now, interval;
+    myCallback *pcallback = prec->mpvt;
+
+    if (prec->mmin <= 0.)
+        return FALSE;
+
+    now = epicsMonotonicGet();
+    interval = (epicsUInt64) (prec->mmin * 1e9);
+    if (now - prec->mlst >= interval) {
+        prec->mlst = now;
+        return FALSE;
+    }
+
+    if (!pcallback) {
+        pcallback = calloc(1, sizeof(myCallback));
+        if (!pcallback)
+            return FALSE;
+
+        pcallback->prec = prec;
+        callbackSetCallback(flushCallback, &pcallback->callback);
+        callbackSetUser(pcallback, &pcallback->callback);
+        callbackSetPriority(priorityLow, &pcallback->callback);
+        prec->mpvt = pcallback;
+    }
+    /* a pending flush already has this deadline, don't restart its timer */
+    if (!pcallback->pending) {
+        pcallback->pending = TRUE;
+        callbackRequestDelayed(&pcallback->callback,
+            (prec->mlst + interval - now) * 1e-9);
+    }
+    return TRUE;
+}
+
 static void wdogInit(histogramRecord *prec)
 {
     if (prec->sdel > 0) {
@@ -159,6 +219,8 @@ static long init_record(struct dbCommon *pcommon, int pass)
                 prec->nelm = 1;
             prec->bptr = calloc(prec->nelm, sizeof(epicsUInt32));
         }
+        if (!prec->pend)
+            prec->pend = calloc(prec->nelm, sizeof(int));
 
         /* calculate width of array element */
         prec->wdth = (prec->ulim - prec->llim) / prec->nelm;
@@ -215,10 +277,15 @@ static long process(struct dbCommon *pcommon)
 
     recGblGetTimeStampSimm(prec, prec->simm, &prec->siol);
 
-    if (status == 0)
-        add_count(prec);
+    if (status == 0) {
+        if (prec->snum > 0)
+            add_samples(prec, prec->sptr, prec->snum);
+        else
+            add_count(prec);
+    }
     else if (status == 2)
         status = 0;
+    add_pending(prec);
 
     monitor(prec);
     recGblFwdLink(prec);
@@ -284,7 +351,7 @@ static void monitor(histogramRecord *prec)
     unsigned short monitor_mask = recGblResetAlarms(prec);
 
     /* post events for count change */
-    if (prec->mcnt > prec->mdel){
+    if (prec->mcnt > prec->mdel && !rateLimited(prec)){
         monitor_mask |= DBE_VALUE | DBE_LOG;
         /* reset counts since monitor */
         prec->mcnt = 0;
@@ -317,11 +384,64 @@ static long get_array_info(DBADDR *paddr, long *no_elements, long *offset)
     return 0;
 }
 
+/* Number of samples binned per pass */
+#define BIN_BLOCK 256
+
+/* Find the element of each sample, -1 if it is outside [LLIM, ULIM) or
+ * NaN.  A sample on the boundary of two elements belongs to the lower one.
+ * The loop has no branches so it vectorizes; the correction steps make the
+ * result identical to comparing with each boundary i * WDTH in turn.  A NaN
+ * fails every comparison, so it is never converted to int.
+ */
+static void bin_samples(const histogramRecord *prec, const double *psample,
+    int *pindex, int n)
+{
+    const double llim = prec->llim, ulim = prec->ulim, wdth = prec->wdth;
+    const int last = prec->nelm - 1;
+    int j;
+
+    for (j = 0; j < n; j++) {
+        double temp = psample[j] - llim;
+        double upper = ceil(temp / wdth);
+        int i = !(upper >= 1.) ? 0 : upper > last ? last : (int) upper - 1;
+
+        i = (i > 0 && temp <= (double) i * wdth) ? i - 1 : i;
+        i = (i < last && temp > (double) (i + 1) * wdth) ? i + 1 : i;
+        pindex[j] = (psample[j] >= llim && psample[j] < ulim) ? i : -1;
+    }
+}
+
+/* Counts saturate at the maximum of their type */
+static void add_saturated(epicsUInt32 *pdest, epicsUInt32 n)
+{
+    *pdest = n > (epicsUInt32) UINT_MAX - *pdest ?
+        (epicsUInt32) UINT_MAX : *pdest + n;
+}
+
+static void increment(epicsUInt32 *pdest)
+{
+    if (*pdest < (epicsUInt32) UINT_MAX)
+        (*pdest)++;
+}
+
+/* MCNT is a short, it saturates */
+static void count_monitor(histogramRecord *prec, epicsUInt32 n)
+{
+    epicsInt32 mcnt = prec->mcnt + (n > SHRT_MAX ? SHRT_MAX : (epicsInt32) n);
+
+    prec->mcnt = mcnt > SHRT_MAX ? SHRT_MAX : (epicsInt16) mcnt;
+}
+
 static long add_count(histogramRecord *prec)
 {
-    double temp;
-    epicsUInt32 *pdest;
-    int i;
+    return add_samples(prec, &prec->sgnl, 1);
+}
+
+static long add_samples(histogramRecord *prec, const double *psample,
+    epicsUInt32 count)
+{
+    int index[BIN_BLOCK];
+    epicsUInt32 added = 0;
 
     if (prec->csta == FALSE)
         return 0;
@@ -332,31 +452,98 @@ static long add_count(histogramRecord *prec)
             prec->sevr = INVALID_ALARM;
             return -1;
         }
-    }
-    if (prec->sgnl < prec->llim ||
-        prec->sgnl >= prec->ulim)
         return 0;
+    }
 
-    temp = prec->sgnl - prec->llim;
-    for (i = 1; i <= prec->nelm; i++){
-        if (temp <= (double) i * prec->wdth)
-            break;
+    while (count > 0) {
+        int n = count > BIN_BLOCK ? BIN_BLOCK : (int) count;
+        int j;
+
+        bin_samples(prec, psample, index, n);
+        for (j = 0; j < n; j++) {
+            if (index[j] >= 0) {
+                increment(prec->bptr + index[j]);
+                added++;
+            }
+        }
+        psample += n;
+        count -= n;
     }
-    pdest = prec->bptr + i - 1;
-    if (*pdest == (epicsUInt32) UINT_MAX)
-        *pdest = 0;
-    (*pdest)++;
-    prec->mcnt++;
+    count_monitor(prec, added);
 
     return 0;
 }
 
+void histogramAddSamples(histogramRecord *prec, const double *psample,
+    size_t count)
+{
+    int index[BIN_BLOCK];
+    int added = 0;
+
+    /* LLIM, ULIM and WDTH are read without the lock, as are the counts */
+    if (!prec->pend || prec->csta == FALSE || prec->llim >= prec->ulim)
+        return;
+
+    while (count > 0) {
+        int n = count > BIN_BLOCK ? BIN_BLOCK : (int) count;
+        int j;
+
+        bin_samples(prec, psample, index, n);
+        for (j = 0; j < n; j++) {
+            if (index[j] >= 0) {
+                epicsAtomicIncrIntT(&prec->pend[index[j]]);
+                if (added < INT_MAX)
+                    added++;
+            }
+        }
+        psample += n;
+        count -= n;
+    }
+    while (added) {
+        int old = epicsAtomicGetIntT(&prec->pcnt);
+        int pcnt = added > INT_MAX - old ? INT_MAX : old + added;
+
+        if (epicsAtomicCmpAndSwapIntT(&prec->pcnt, old, pcnt) == old)
+            break;
+    }
+}
+
+/* Move the counts of histogramAddSamples() into the array.  A pending
+ * count is taken modulo 2^32, it can't saturate without a compare and
+ * swap for every sample.
+ */
+static void add_pending(histogramRecord *prec)
+{
+    epicsUInt32 added = 0;
+    int total = epicsAtomicGetIntT(&prec->pcnt);
+    int i;
+
+    if (!total)
+        return;
+    epicsAtomicAddIntT(&prec->pcnt, -total);
+
+    for (i = 0; i < prec->nelm; i++) {
+        int n = epicsAtomicGetIntT(&prec->pend[i]);
+
+        if (n) {
+            epicsAtomicAddIntT(&prec->pend[i], -n);
+            add_saturated(&prec->bptr[i], (epicsUInt32) n);
+            add_saturated(&added, (epicsUInt32) n);
+        }
+    }
+    count_monitor(prec, added);
+}
+
 static long clear_histogram(histogramRecord *prec)
 {
     int i;
 
-    for (i = 0; i < prec->nelm; i++)
+    for (i = 0; i < prec->nelm; i++) {
         prec->bptr[i] = 0;
+        if (prec->pend)
+            epicsAtomicSetIntT(&prec->pend[i], 0);
+    }
+    epicsAtomicSetIntT(&prec->pcnt, 0);
     prec->mcnt = prec->mdel + 1;
     prec->udf = FALSE;
 
@@ -384,6 +571,7 @@ static long readValue(histogramRecord *prec)
             status = dbGetLink(&prec->siol, DBR_DOUBLE, &prec->sval, 0, 0);
             if (status == 0) {
                 prec->sgnl = prec->sval;
+                prec->snum = 0;
                 prec->udf = FALSE;
             }
             prec->pact = FALSE;
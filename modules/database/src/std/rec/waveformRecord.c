@@ -35,6 +35,7 @@
 #include "recGbl.h"
 #include "special.h"
 #include "cantProceed.h"
+#include "dbArrayBuffer.h"
 #include "menuYesNo.h"
 
 #define GEN_SIZE_OFFSET
@@ -95,8 +96,18 @@ static long init_record(struct dbCommon *pcommon, int pass)
             prec->nelm = 1;
         if (prec->ftvl > DBF_ENUM)
             prec->ftvl = DBF_UCHAR;
-        prec->bptr = callocMustSucceed(prec->nelm, dbValueSize(prec->ftvl),
-            "waveform calloc failed");
+        if (prec->nbuf > 1) {
+            long status = dbArrayBufferInit(pcommon, &prec->bptr,
+                prec->nelm * dbValueSize(prec->ftvl), prec->nbuf);
+
+            if (status) {
+                recGblRecordError(status, (void *)prec, "wf: init_record");
+                return status;
+            }
+        }
+        else
+            prec->bptr = callocMustSucceed(prec->nelm,
+                dbValueSize(prec->ftvl), "waveform calloc failed");
         prec->nord = (prec->nelm == 1);
         return 0;
     }
@@ -347,7 +358,14 @@ static long readValue(waveformRecord *prec)
 
         recGblSetSevr(prec, SIMM_ALARM, prec->sims);
         if (prec->pact || (prec->sdly < 0)) {
-            status = dbGetLink(&prec->siol, prec->ftvl, prec->bptr, 0, &nRequest);
+            void *buf = dbArrayBufferPrepareReplace((dbCommon *)prec,
+                prec->bptr);
+
+            status = S_db_noMemory;
+            if (buf)
+                status = dbGetLink(&prec->siol, prec->ftvl, buf, 0,
+                    &nRequest);
+            dbArrayBufferCompleteReplace((dbCommon *)prec, buf, status);
             if (status == 0)
                 prec->udf = FALSE;
 
@@ -15,6 +15,7 @@
 
 #include <dbLock.h>
 #include <dbAccess.h>
+#include <dbDbLinkPvt.h>
 #include <recGbl.h>
 #include <alarm.h>
 
@@ -109,9 +110,52 @@ void checkAlarm(void)
     testOk1(strcmp(amsg, "a me")==0);
 }
 
+#define linkFastType(plink) \
+    (((dbDbLinkPvt *) (plink)->value.pv_link.pvt)->fastType)
+
+static
+void checkFastPath(void)
+{
+    xRecord *target = (xRecord *) testdbRecordPtr("target");
+    xRecord *fast = (xRecord *) testdbRecordPtr("fast");
+    testMonitor *mon;
+    epicsFloat64 dval = 0.0;
+    epicsInt32 lval = 0;
+    long nReq = 1;
+
+    testDiag("checkFastPath()");
+
+    testOk(linkFastType(&fast->inp) == DBF_DOUBLE,
+        "DOUBLE scalar target selects the direct copy");
+    testOk(linkFastType(&fast->lnk) == -1,
+        "MENU target does not");
+
+    testdbPutFieldOk("target.F64", DBF_DOUBLE, 1.5);
+    dbScanLock((dbCommon *) fast);
+    testOk1(0 == dbGetLink(&fast->inp, DBR_DOUBLE, &dval, 0, &nReq));
+    testOk1(0 == dbGetLink(&fast->inp, DBR_LONG, &lval, 0, 0));
+    dbScanUnlock((dbCommon *) fast);
+    testOk(dval == 1.5 && nReq == 1, "direct get %g", dval);
+    testOk(lval == 1, "converted get %d", (int) lval);
+
+    mon = testMonitorCreate("target.F64", DBE_VALUE, 0);
+    dval = 2.5;
+    dbScanLock((dbCommon *) fast);
+    testOk1(0 == dbPutLink(&fast->inp, DBR_DOUBLE, &dval, 1));
+    dbScanUnlock((dbCommon *) fast);
+    testMonitorWait(mon);
+    testOk1(testMonitorCount(mon, 1) == 1);
+    testMonitorDestroy(mon);
+    testOk1(target->f64 == 2.5);
+
+    testdbPutFieldOk("fast.INP", DBF_STRING, "target.F32");
+    testOk(linkFastType(&fast->inp) == DBF_FLOAT,
+        "retargeted link selects FLOAT");
+}
+
 MAIN(dbDbLinkTest)
 {
-    testPlan(18);
+    testPlan(30);
 
     testdbPrepare();
 
@@ -127,6 +171,7 @@ MAIN(dbDbLinkTest)
 
     checkTime();
     checkAlarm();
+    checkFastPath();
 
     testIocShutdownOk();
 
@@ -0,0 +1,130 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include <string.h>
+
+#include "dbAccess.h"
+#include "dbProcStats.h"
+#include "dbUnitTest.h"
+#include "errlog.h"
+#include "testMain.h"
+
+void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+static
+epicsUInt64 binSum(const dbProcHist *phist)
+{
+    epicsUInt64 sum = 0;
+    int i;
+
+    for (i = 0; i < DBPS_NBINS; i++)
+        sum += phist->bins[i];
+    return sum;
+}
+
+static
+void testHist(void)
+{
+    dbProcHist hist;
+
+    testDiag("Histogram binning");
+
+    memset(&hist, 0, sizeof(hist));
+    dbProcHistAdd(&hist, 500);          /* < 1 us */
+    dbProcHistAdd(&hist, 1500);         /* [1, 2) us */
+    dbProcHistAdd(&hist, 3000000);      /* 3 ms, [2048, 4096) us */
+    dbProcHistAdd(&hist, 100000000000ull);  /* 100 s */
+
+    testOk(hist.count == 4, "count == 4 (got %u)", (unsigned)hist.count);
+    testOk(hist.bins[0] == 1, "sub-microsecond bin");
+    testOk(hist.bins[1] == 1, "1 us bin");
+    testOk(hist.bins[12] == 1, "3 ms bin");
+    testOk(hist.bins[DBPS_NBINS - 1] == 1, "overflow bin");
+    testOk(hist.maxNs == 100000000000ull, "maxNs");
+    testOk(hist.totalNs == 100003002000ull, "totalNs");
+}
+
+static
+void testPercentile(void)
+{
+    dbProcHist hist;
+
+    testDiag("Percentiles of few samples");
+
+    memset(&hist, 0, sizeof(hist));
+    testOk(dbProcHistPercentile(&hist, 0.99) == 0.0, "empty histogram");
+
+    dbProcHistAdd(&hist, 3000000);      /* [2048, 4096) us */
+    testOk(dbProcHistPercentile(&hist, 0.99) == 4096.0,
+        "1 sample: p99 is its bin (got %g)", dbProcHistPercentile(&hist, 0.99));
+    testOk(dbProcHistPercentile(&hist, 0.0) == 4096.0,
+        "1 sample: p0 is its bin");
+
+    dbProcHistAdd(&hist, 500);          /* < 1 us */
+    testOk(dbProcHistPercentile(&hist, 0.5) == 1.0,
+        "2 samples: p50 is the lower bin (got %g)",
+        dbProcHistPercentile(&hist, 0.5));
+    testOk(dbProcHistPercentile(&hist, 0.99) == 4096.0,
+        "2 samples: p99 is the upper bin (got %g)",
+        dbProcHistPercentile(&hist, 0.99));
+
+    dbProcHistAdd(&hist, 100000000000ull);  /* overflow bin */
+    testOk(dbProcHistPercentile(&hist, 0.99) == 1e8,
+        "p99 in the overflow bin is the maximum");
+}
+
+static
+void testRecord(void)
+{
+    dbProcHist process, lockWait;
+
+    testDiag("Per-record statistics");
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("xRecord.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testOk(dbpsGet("x", &process, &lockWait) == 0, "dbpsGet(x)");
+    testOk(process.count == 0, "not counted while disabled");
+    testOk(dbpsGet("nonexistent", &process, NULL) != 0,
+        "dbpsGet(nonexistent) fails");
+
+    dbpsEnable(1);
+    testdbPutFieldOk("x.PROC", DBR_LONG, 1);
+    testdbPutFieldOk("x.PROC", DBR_LONG, 1);
+    dbpsEnable(0);
+    testdbPutFieldOk("x.PROC", DBR_LONG, 1);
+
+    testOk(dbpsGet("x", &process, &lockWait) == 0, "dbpsGet(x)");
+    testOk(process.count == 2, "process.count == 2 (got %u)",
+        (unsigned)process.count);
+    testOk(binSum(&process) == 2, "bins add up");
+    testOk(process.maxNs <= process.totalNs, "maxNs <= totalNs");
+    testOk(lockWait.count == 0, "no lock contention");
+
+    dbpsReset();
+    testOk(dbpsGet("x", &process, NULL) == 0 && process.count == 0,
+        "dbpsReset clears counts");
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+}
+
+MAIN(dbProcStatsTest)
+{
+    testPlan(25);
+    testHist();
+    testPercentile();
+    testRecord();
+    return testDone();
+}
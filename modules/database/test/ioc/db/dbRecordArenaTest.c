@@ -0,0 +1,85 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+
+#include "dbAccess.h"
+#include "dbCommonPvt.h"
+#include "dbStaticLib.h"
+#include "dbUnitTest.h"
+#include "errlog.h"
+#include "testMain.h"
+
+void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+static
+dbCommon * findRecord(const char *name)
+{
+    DBENTRY dbentry;
+    dbCommon *prec = NULL;
+
+    dbInitEntry(pdbbase, &dbentry);
+    if (!dbFindRecord(&dbentry, name))
+        prec = dbentry.precnode->precord;
+    dbFinishEntry(&dbentry);
+    return prec;
+}
+
+static
+void testArena(int mode)
+{
+    dbCommon *a0, *a1, *p1, *p2;
+    ptrdiff_t slot;
+
+    testDiag("dbRecordArenaMode = %d", mode);
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("dbRecordArenaTest.db", NULL, NULL);
+
+    dbRecordArenaMode = mode;
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+    dbRecordArenaMode = 0;
+
+    a0 = findRecord("a0");
+    a1 = findRecord("a1");
+    p1 = findRecord("p1");
+    p2 = findRecord("p2");
+    testOk(a0 && a1 && p1 && p2, "records found");
+    testOk(findRecord("a0alias") == a0, "alias follows its record");
+    testOk(dbRec2Pvt(a0)->arena != NULL, "record in arena");
+    testOk(((size_t)a0 - offsetof(dbCommonPvt, common)) % 64 == 0,
+        "record slot is cache line aligned");
+
+    /* Passive records first, then the periodic ones in PHAS order */
+    slot = (char *)p2 - (char *)p1;
+    testOk(slot > 0 && (char *)a0 - (char *)p2 == slot &&
+        (char *)a1 - (char *)a0 == slot, "records laid out in scan order");
+
+    testdbGetFieldEqual("p1", DBR_LONG, 42);
+    testdbGetFieldEqual("a0alias.NAME", DBR_STRING, "a0");
+    testdbPutFieldOk("a0.PROC", DBR_LONG, 1);
+    testdbGetFieldEqual("a0", DBR_LONG, 42);
+
+    testOk(dbRecordMemReport(pdbbase, "x") == 0, "dbRecordMemReport");
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+}
+
+MAIN(dbRecordArenaTest)
+{
+    testPlan(20);
+    testArena(1);
+    testArena(2);
+    return testDone();
+}
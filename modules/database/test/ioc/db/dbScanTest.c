@@ -19,7 +19,10 @@
 #include "testMain.h"
 
 #include "dbAccess.h"
+#include "epicsAtomic.h"
+#include "epicsThread.h"
 #include "errlog.h"
+#include "xRecord.h"
 
 void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
 
@@ -66,9 +69,225 @@ static void testOnce(void)
     epicsEventDestroy(waiter);
 }
 
+static epicsEventId blockStarted, blockRelease, countDone;
+static int count;
+
+static void blockComp(void *junk, dbCommon *prec)
+{
+    epicsEventMustTrigger(blockStarted);
+    epicsEventMustWait(blockRelease);
+}
+
+static void countComp(void *junk, dbCommon *prec)
+{
+    if (++count == 3)
+        epicsEventMustTrigger(countDone);
+}
+
+static void testCoalesce(void)
+{
+    scanOnceQueueStats stats;
+
+    testDiag("check scanOnce() coalescing");
+    blockStarted = epicsEventMustCreate(epicsEventEmpty);
+    blockRelease = epicsEventMustCreate(epicsEventEmpty);
+    countDone = epicsEventMustCreate(epicsEventEmpty);
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("dbLockTest.db", NULL, NULL);
+
+    scanOnceSetCoalesce(1);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    scanOnceQueueStatus(1, &stats);
+
+    testDiag("Block the scanOnce thread");
+    scanOnceCallback(testdbRecordPtr("reca"), blockComp, NULL);
+    epicsEventMustWait(blockStarted);
+
+    testOk1(scanOnceCallback(testdbRecordPtr("recb"), countComp, NULL)==0);
+    testOk1(scanOnce(testdbRecordPtr("recb"))==0);
+    testOk1(scanOnceCallback(testdbRecordPtr("recb"), countComp, NULL)==0);
+    testOk1(scanOnce(testdbRecordPtr("recb"))==0);
+    testOk1(scanOnceCallback(testdbRecordPtr("recb"), countComp, NULL)==0);
+
+    testOk1(scanOnceQueueStatus(0, &stats)==0);
+    testOk(stats.numUsed==1, "numUsed==1 (%d)", stats.numUsed);
+    testOk(stats.numCoalesced==4, "numCoalesced==4 (%d)", stats.numCoalesced);
+
+    testDiag("Release and wait for all callbacks");
+    epicsEventMustTrigger(blockRelease);
+    epicsEventMustWait(countDone);
+    testOk(count==3, "count==3 (%d)", count);
+
+    testIocShutdownOk();
+
+    scanOnceSetCoalesce(0);
+
+    testdbCleanup();
+    epicsEventDestroy(blockStarted);
+    epicsEventDestroy(blockRelease);
+    epicsEventDestroy(countDone);
+}
+
+static epicsEventId release[3], orderDone, shutdownDone;
+static epicsThreadId blockIds[3];
+static int nBlocked, processed, processedAtCallback;
+static int order[3], nOrder;
+static int nQueued;
+
+static void threadBlockComp(void *usr, dbCommon *prec)
+{
+    blockIds[nBlocked++] = epicsThreadGetIdSelf();
+    epicsEventMustTrigger(blockStarted);
+    epicsEventMustWait((epicsEventId)usr);
+}
+
+static void blockAll(void)
+{
+    static const char *names[3] = {"reca", "recd", "recc"};
+    int i;
+
+    nBlocked = 0;
+    for (i = 0; i < 3; i++) {
+        scanOnceCallback(testdbRecordPtr(names[i]), threadBlockComp,
+            release[i]);
+        epicsEventMustWait(blockStarted);
+    }
+}
+
+static void releaseAll(void)
+{
+    int i;
+
+    for (i = 0; i < 3; i++)
+        epicsEventMustTrigger(release[i]);
+}
+
+static void countProc(xRecord *prec)
+{
+    processed++;
+}
+
+static void handoffComp(void *junk, dbCommon *prec)
+{
+    blockIds[2] = epicsThreadGetIdSelf();
+    epicsEventMustTrigger(countDone);
+}
+
+static void orderComp(void *usr, dbCommon *prec)
+{
+    order[nOrder++] = *(int*)usr;
+    if (processed != processedAtCallback + 1)
+        processedAtCallback = -1;
+    if (nOrder == 3)
+        epicsEventMustTrigger(orderDone);
+}
+
+static void shutdownComp(void *junk, dbCommon *prec)
+{
+    if (epicsAtomicDecrIntT(&nQueued) == 0)
+        epicsEventMustTrigger(shutdownDone);
+}
+
+static void testThreads(void)
+{
+    static int tags[3] = {1, 2, 3};
+    static const char *names[4] = {"recb", "rece", "recf", "recg"};
+    xRecord *precb;
+    int i;
+
+    testDiag("check scanOnce() with several executor threads");
+    blockStarted = epicsEventMustCreate(epicsEventEmpty);
+    countDone = epicsEventMustCreate(epicsEventEmpty);
+    orderDone = epicsEventMustCreate(epicsEventEmpty);
+    shutdownDone = epicsEventMustCreate(epicsEventEmpty);
+    for (i = 0; i < 3; i++)
+        release[i] = epicsEventMustCreate(epicsEventEmpty);
+
+    testdbPrepare();
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("dbLockTest.db", NULL, NULL);
+
+    testOk1(scanOnceSetThreads(3)==0);
+    scanOnceSetCoalesce(1);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    eltc(0);
+    testOk1(scanOnceSetThreads(1)!=0);
+    eltc(1);
+
+    precb = (xRecord*)testdbRecordPtr("recb");
+    precb->clbk = countProc;
+
+    testDiag("Two blocked executors leave the work to the third");
+    nBlocked = 0;
+    scanOnceCallback(testdbRecordPtr("reca"), threadBlockComp, release[0]);
+    epicsEventMustWait(blockStarted);
+    scanOnceCallback(testdbRecordPtr("recd"), threadBlockComp, release[1]);
+    epicsEventMustWait(blockStarted);
+    testOk1(blockIds[0]!=blockIds[1]);
+
+    scanOnceCallback((dbCommon*)precb, handoffComp, NULL);
+    testOk(epicsEventWaitWithTimeout(countDone, 10.0)==epicsEventOK,
+        "recb processed while two executors are blocked");
+    testOk(blockIds[2]!=blockIds[0] && blockIds[2]!=blockIds[1],
+        "by the third executor");
+    epicsEventMustTrigger(release[0]);
+    epicsEventMustTrigger(release[1]);
+
+    testDiag("Merged requests complete in order, after processing");
+    blockAll();
+    processedAtCallback = processed;
+    for (i = 0; i < 3; i++)
+        testOk1(scanOnceCallback((dbCommon*)precb, orderComp, &tags[i])==0);
+    releaseAll();
+    testOk1(epicsEventWaitWithTimeout(orderDone, 10.0)==epicsEventOK);
+    testOk(nOrder==3 && order[0]==1 && order[1]==2 && order[2]==3,
+        "order %d %d %d", order[0], order[1], order[2]);
+    testOk(processedAtCallback!=-1 && processed==processedAtCallback + 1,
+        "processed once before the callbacks (%d)", processed);
+
+    testDiag("Shut down with requests queued for all executors");
+    blockAll();
+    nQueued = 20;
+    for (i = 0; i < 20; i++)
+        scanOnceCallback(testdbRecordPtr(names[i % 4]), shutdownComp, NULL);
+    releaseAll();
+
+    testIocShutdownOk();
+
+    testOk(epicsEventTryWait(shutdownDone)==epicsEventOK,
+        "queued requests done (%d left)", nQueued);
+
+    scanOnceSetCoalesce(0);
+    scanOnceSetThreads(1);
+
+    testdbCleanup();
+    epicsEventDestroy(blockStarted);
+    epicsEventDestroy(countDone);
+    epicsEventDestroy(orderDone);
+    epicsEventDestroy(shutdownDone);
+    for (i = 0; i < 3; i++)
+        epicsEventDestroy(release[i]);
+}
+
 MAIN(dbScanTest)
 {
-    testPlan(3);
+    testPlan(24);
     testOnce();
+    testCoalesce();
+    testThreads();
     return testDone();
 }
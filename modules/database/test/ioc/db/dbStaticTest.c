@@ -291,6 +291,51 @@ static void testDbVerify(const char *record)
     dbFinishEntry(&entry);
 }
 
+static void testFieldHash(void)
+{
+    DBENTRY entry;
+    dbRecordType *prt;
+    long status;
+    int nfields = 0, nfound = 0, nhashed = 0, ntypes = 0;
+    short i;
+
+    testDiag("testFieldHash()");
+
+    dbInitEntry(pdbbase, &entry);
+    for (status = dbFirstRecordType(&entry); !status;
+         status = dbNextRecordType(&entry)) {
+        ntypes++;
+        if (entry.precordType->fldHashInd)
+            nhashed++;
+    }
+    testOk(nhashed == ntypes, "%d of %d record types have a field hash",
+        nhashed, ntypes);
+
+    testOk1(dbFindRecord(&entry, "testrec")==0);
+    prt = entry.precordType;
+    for (i = 0; i < prt->no_fields; i++) {
+        const char *name = prt->papFldDes[i]->name;
+        const char *pname = name;
+
+        nfields++;
+        if (dbFindFieldPart(&entry, &pname) == 0 &&
+            entry.pflddes == prt->papFldDes[i] &&
+            entry.indfield == i && *pname == '\0')
+            nfound++;
+    }
+    testOk(nfound == nfields, "%d of %d fields found", nfound, nfields);
+
+    testOk1(dbFindField(&entry, "VA")!=0);
+    testOk1(dbFindField(&entry, "VALX")!=0);
+    testOk1(dbFindField(&entry, "NOSUCHFIELD")!=0);
+    testOk1(dbFindField(&entry, "VAL")==0 &&
+        strcmp(entry.pflddes->name, "VAL")==0);
+    testOk1(dbFindField(&entry, "PHAS")==0 &&
+        strcmp(entry.pflddes->name, "PHAS")==0);
+
+    dbFinishEntry(&entry);
+}
+
 void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
 
 MAIN(dbStaticTest)
@@ -298,7 +343,7 @@ MAIN(dbStaticTest)
     const char *ldir;
     FILE *fp = NULL;
 
-    testPlan(310);
+    testPlan(318);
     testdbPrepare();
 
     testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
@@ -324,6 +369,7 @@ MAIN(dbStaticTest)
     testRec2Entry("testalias");
     testRec2Entry("testalias2");
     testRec2Entry("testalias3");
+    testFieldHash();
 
     eltc(0);
     testIocInitOk();
@@ -0,0 +1,187 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "caeventmask.h"
+#include "dbAccess.h"
+#include "dbScan.h"
+#include "dbTrace.h"
+#include "dbUnitTest.h"
+#include "epicsEvent.h"
+#include "epicsThread.h"
+#include "errlog.h"
+#include "testMain.h"
+
+void dbTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+#define DUMPFILE "dbTraceTest.json"
+
+static char *trace;
+
+static void readDump(void)
+{
+    FILE *fp;
+    long len;
+
+    free(trace);
+    trace = NULL;
+    testOk(dbTraceDump(DUMPFILE) == 0, "dbTraceDump()");
+    fp = fopen(DUMPFILE, "r");
+    if (!fp)
+        testAbort("Can't open " DUMPFILE);
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    rewind(fp);
+    trace = calloc(1, len + 1);
+    if (!trace || fread(trace, 1, len, fp) != (size_t) len)
+        testAbort("Can't read " DUMPFILE);
+    fclose(fp);
+    remove(DUMPFILE);
+}
+
+static int count(const char *str)
+{
+    const char *p = trace;
+    int n = 0;
+
+    while ((p = strstr(p, str)) != NULL) {
+        n++;
+        p += strlen(str);
+    }
+    return n;
+}
+
+static void onceDone(void *usr, struct dbCommon *prec)
+{
+    epicsEventMustTrigger((epicsEventId) usr);
+}
+
+static void tracer(void *arg)
+{
+    scanOnce(testdbRecordPtr("x"));
+}
+
+/* Threads that exit hand their ring to the next new thread */
+static void testRingReuse(void)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    int nrings, i;
+
+    readDump();
+    nrings = count("\"name\":\"thread_name\"");
+
+    opts.joinable = 1;
+    dbTraceEnable(1);
+    for (i = 0; i < 5; i++) {
+        epicsThreadId tid = epicsThreadCreateOpt("tracer", tracer, NULL, &opts);
+
+        epicsThreadMustJoin(tid);
+    }
+    dbTraceEnable(0);
+
+    readDump();
+    testOk(count("\"name\":\"thread_name\"") == nrings + 1 &&
+           count("\"args\":{\"name\":\"tracer\"}") == 1,
+        "5 short-lived threads used 1 ring");
+}
+
+/* Requests that don't fit into the scanOnce queue are traced */
+static void testOverflow(epicsEventId done)
+{
+    struct dbCommon *prec = testdbRecordPtr("x");
+    int i;
+
+    dbTraceReset();
+    dbTraceEnable(1);
+    eltc(0);
+    /* the scanOnce task waits for the lock with the first request */
+    dbScanLock(prec);
+    for (i = 0; i < 20; i++)
+        scanOnce(prec);
+    dbScanUnlock(prec);
+    while (scanOnceCallback(prec, onceDone, done))
+        epicsThreadSleep(0.01);
+    epicsEventMustWait(done);
+    eltc(1);
+    dbTraceEnable(0);
+
+    readDump();
+    testOk(count("\"cat\":\"scanOnce\",\"name\":\"overflow\","
+        "\"args\":{\"record\":\"x\"}") >= 1, "scanOnce overflow");
+}
+
+#define PROCESS_X "\"ph\":\"B\",\"cat\":\"process\",\"name\":\"x\""
+
+MAIN(dbTraceTest)
+{
+    epicsEventId done = epicsEventMustCreate(epicsEventEmpty);
+    testMonitor *mon;
+
+    testPlan(21);
+
+    testdbPrepare();
+    scanOnceSetQueueSize(10);
+
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("xRecord.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testdbPutFieldOk("x.PROC", DBR_LONG, 1);
+    readDump();
+    testOk(count(PROCESS_X) == 0, "nothing traced while disabled");
+
+    dbTraceEnable(1);
+    mon = testMonitorCreate("x.VAL", DBE_VALUE, 0);
+    testdbPutFieldOk("x.VAL", DBR_LONG, 42);
+    testdbPutFieldOk("x.PROC", DBR_LONG, 1);
+    scanOnceCallback(testdbRecordPtr("x"), onceDone, done);
+    epicsEventMustWait(done);
+    testMonitorWait(mon);
+    testMonitorDestroy(mon);
+    dbTraceEnable(0);
+    testdbPutFieldOk("x.PROC", DBR_LONG, 1);
+
+    readDump();
+    testOk(count(PROCESS_X) == 2, "x processed twice (got %d)",
+        count(PROCESS_X));
+    testOk(count("\"ph\":\"s\",\"cat\":\"scanOnce\"") == 1 &&
+           count("\"ph\":\"f\",\"cat\":\"scanOnce\"") == 1,
+        "scanOnce queue and execution are joined");
+    testOk(count("\"cat\":\"post\",\"name\":\"post\","
+        "\"args\":{\"record\":\"x\",\"mask\":") >= 1, "post of x");
+    testOk(count("\"name\":\"thread_name\"") >= 2, "thread names");
+    testOk(strstr(trace, "]}\n") != NULL, "dump is complete");
+
+    dbTraceReset();
+    readDump();
+    testOk(count(PROCESS_X) == 0, "dbTraceReset discards events");
+
+    testRingReuse();
+    testOverflow(done);
+
+    /* Stopping the scanOnce task queues a request without a record */
+    dbTraceReset();
+    dbTraceEnable(1);
+    testIocShutdownOk();
+    dbTraceEnable(0);
+    readDump();
+    testOk(count("\"cat\":\"scanOnce\"") == 0,
+        "shutdown request is not traced");
+
+    testdbCleanup();
+    scanOnceSetQueueSize(1000);
+
+    free(trace);
+    epicsEventDestroy(done);
+    return testDone();
+}
@@ -23,6 +23,9 @@ int callbackParallelTest(void);
 int dbStateTest(void);
 int dbServerTest(void);
 int dbCaStatsTest(void);
+int dbProcStatsTest(void);
+int dbTraceTest(void);
+int dbRecordArenaTest(void);
 int dbShutdownTest(void);
 int dbScanTest(void);
 int scanIoTest(void);
@@ -46,6 +49,9 @@ void epicsRunDbTests(void)
     runTest(dbStateTest);
     runTest(dbServerTest);
     runTest(dbCaStatsTest);
+    runTest(dbProcStatsTest);
+    runTest(dbTraceTest);
+    runTest(dbRecordArenaTest);
     runTest(dbShutdownTest);
     runTest(dbScanTest);
     runTest(scanIoTest);
@@ -16,8 +16,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "epicsAtomic.h"
 #include "epicsEvent.h"
 #include "epicsMessageQueue.h"
+#include "epicsThread.h"
 #include "epicsPrint.h"
 #include "epicsMath.h"
 #include "alarm.h"
@@ -296,14 +298,180 @@ static void testMultiThreading(void)
     }
 }
 
+typedef struct {
+    int nprocd[4];
+    epicsThreadId thread[4];
+    int ncomplete;
+    epicsEventId done;
+    int nstarted;
+    int parallel;
+    epicsEventId both;
+} testshard;
+
+static void testcbshard(xpriv *priv, void *raw)
+{
+    testshard *td = raw;
+
+    /* The first record of each shard waits until the other starts */
+    if (td->both) {
+        int n = epicsAtomicIncrIntT(&td->nstarted);
+
+        if (n == 1)
+            td->parallel = epicsEventWaitWithTimeout(td->both, 5.0) ==
+                epicsEventOK;
+        else if (n == 2)
+            epicsEventMustTrigger(td->both);
+    }
+    td->thread[priv->member] = epicsThreadGetIdSelf();
+    epicsAtomicIncrIntT(&td->nprocd[priv->member]);
+}
+
+static void testcompshard(void *raw, IOSCANPVT scan, int prio)
+{
+    testshard *td = raw;
+
+    epicsAtomicIncrIntT(&td->ncomplete);
+    epicsEventMustTrigger(td->done);
+}
+
+static void testSharding(void)
+{
+    int i;
+    testshard data;
+    xdrv *drv;
+    dbCommon *prec[2];
+
+    memset(&data, 0, sizeof(data));
+    data.done = epicsEventMustCreate(epicsEventEmpty);
+    data.both = epicsEventMustCreate(epicsEventEmpty);
+
+    testDiag("Test sharded I/O Intr scanning");
+
+    testdbPrepare();
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+
+    /* one scan list with four records, each in its own lock set */
+    for(i=0; i<NELEMENTS(data.nprocd); i++)
+        loadRecord(0, i, "LOW");
+
+    drv = xdrv_add(0, &testcbshard, &data);
+    scanIoSetComplete(drv->scan, &testcompshard, &data);
+    testOk1(scanIoSetShards(drv->scan, 100000)!=0);
+    testOk1(scanIoSetShards(drv->scan, 2)==0);
+
+    callbackParallelThreads(2, "LOW");
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    prec[0] = testdbRecordPtr("g0m0");
+    prec[1] = testdbRecordPtr("g0m1");
+    testOk(dbLockGetLockId(prec[0])%2 != dbLockGetLockId(prec[1])%2,
+           "g0m0 and g0m1 start in different shards");
+
+    testOk1(scanIoRequest(drv->scan)==0x1);
+    epicsEventMustWait(data.done);
+
+    testDiag("Wait one more second");
+    epicsThreadSleep(1.0);
+
+    for(i=0; i<NELEMENTS(data.nprocd); i++)
+        testOk(data.nprocd[i]==1, "record %d processed once (%d)",
+               i, data.nprocd[i]);
+    testOk(data.ncomplete==1, "completed once (%d)", data.ncomplete);
+    testOk(data.parallel, "shards processed concurrently");
+    epicsEventDestroy(data.both);
+    data.both = NULL;
+
+    testDiag("Processed in the caller's thread by scanIoImmediate()");
+    testOk1(scanIoImmediate(drv->scan, 0)==0x1);
+    for(i=0; i<NELEMENTS(data.nprocd); i++)
+        testOk(data.nprocd[i]==2, "record %d processed twice (%d)",
+               i, data.nprocd[i]);
+    testOk(data.ncomplete==2, "completed twice (%d)", data.ncomplete);
+
+    testDiag("Merge the lock sets of g0m0 and g0m1 at run time");
+    testdbPutFieldOk("g0m0.FLNK", DBF_STRING, "g0m1");
+    testOk1(dbLockGetLockId(prec[0])==dbLockGetLockId(prec[1]));
+
+    /* scanIoImmediate() signalled done too */
+    epicsEventTryWait(data.done);
+
+    /* The first pass moves g0m0 or g0m1 into its new shard */
+    for(i=0; i<2; i++) {
+        testOk1(scanIoRequest(drv->scan)==0x1);
+        epicsEventMustWait(data.done);
+        epicsThreadSleep(0.1);
+    }
+    for(i=0; i<NELEMENTS(data.nprocd); i++)
+        testOk(data.nprocd[i]==4, "record %d processed four times (%d)",
+               i, data.nprocd[i]);
+    testOk(data.thread[0]==data.thread[1],
+           "one lock set processed by one thread");
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+
+    xdrv_reset();
+
+    epicsEventDestroy(data.done);
+}
+
+static void testCachedTimeStamp(void)
+{
+    int i;
+    xdrv *drv;
+    dbCommon *prec[4];
+
+    testDiag("Test time stamp cached for a scan list pass");
+
+    testdbPrepare();
+    testdbReadDatabase("dbTestIoc.dbd", NULL, NULL);
+    dbTestIoc_registerRecordDeviceDriver(pdbbase);
+
+    for(i=0; i<NELEMENTS(prec); i++)
+        loadRecord(0, i, "LOW");
+
+    drv = xdrv_add(0, NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    for(i=0; i<NELEMENTS(prec); i++) {
+        char name[20];
+        sprintf(name, "g0m%d", i);
+        prec[i] = testdbRecordPtr(name);
+    }
+
+    dbScanCacheTimeStamp = 1;
+    testOk1(scanIoImmediate(drv->scan, 0)==0x1);
+    dbScanCacheTimeStamp = 0;
+
+    for(i=1; i<NELEMENTS(prec); i++)
+        testOk(epicsTimeEqual(&prec[i]->time, &prec[0]->time),
+               "record %d has the same time stamp as record 0", i);
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+
+    xdrv_reset();
+}
+
 MAIN(scanIoTest)
 {
-    testPlan(152);
+    testPlan(181);
     testSingleThreading();
     testDiag("run a second time to verify shutdown and restart works");
     testSingleThreading();
     testMultiThreading();
     testDiag("run a second time to verify shutdown and restart works");
     testMultiThreading();
+    testSharding();
+    testCachedTimeStamp();
     return testDone();
 }
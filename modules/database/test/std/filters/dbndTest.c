@@ -24,6 +24,7 @@
 #include "epicsUnitTest.h"
 #include "dbUnitTest.h"
 #include "epicsTime.h"
+#include "epicsThread.h"
 #include "dbmf.h"
 #include "testMain.h"
 #include "osiFileName.h"
@@ -112,6 +113,18 @@ static void mustPassTwice(dbChannel *pch, db_field_log *pfl2, char* m, double d,
         oldFree, newFree);
 }
 
+/* Returns non-zero if the update passed */
+static int runAdaptive(dbChannel *pch, long val, unsigned char backlog) {
+    db_field_log *pfl = db_create_read_log(pch);
+
+    fl_setup(pch, pfl);
+    pfl->u.v.field.dbf_long = val;
+    pfl->backlog = backlog;
+    pfl = dbChannelRunPreChain(pch, pfl);
+    db_delete_field_log(pfl);
+    return pfl != NULL;
+}
+
 static void testHead (char* title) {
     testDiag("--------------------------------------------------------");
     testDiag("%s", title);
@@ -132,7 +145,7 @@ MAIN(dbndTest)
     dbEventCtx evtctx;
     int logsFree, logsFinal;
 
-    testPlan(72);
+    testPlan(79);
 
     testdbPrepare();
 
@@ -301,6 +314,42 @@ MAIN(dbndTest)
 
     dbChannelDelete(pch);
 
+    testDiag("%d field_logs on free-list", db_available_logs());
+
+    /* Adaptive deadband */
+
+    testHead("Adaptive deadband");
+    testOk(!dbChannelCreate("x.VAL{dbnd:{rate:0}}"),
+           "dbChannel with plugin dbnd (rate=0) rejected");
+    testOk(!!(pch = dbChannelCreate("x.VAL{dbnd:{rate:10}}")),
+           "dbChannel with plugin dbnd (rate=10) created");
+    testOk(!(dbChannelOpen(pch)), "dbChannel with plugin dbnd opened");
+
+    {
+        int i, first = 0, last = 0;
+
+        /* A backed up subscriber widens the deadband */
+        for (i = 0; i < 20; i++) {
+            int sent = runAdaptive(pch, i & 1, 3);
+
+            if (i < 10) first += sent;
+            else last += sent;
+        }
+        testOk(first > 0, "%d of the first 10 toggles pass", first);
+        testOk(last == 0, "%d of the next 10 toggles pass", last);
+
+        /* Slow updates narrow it again */
+        for (i = 0; i < 60 && !runAdaptive(pch, i & 1, 0); i++)
+            epicsThreadSleep(0.05);
+        testOk(i < 60, "toggle passes again after %d slow updates", i);
+    }
+
+    dbChannelDelete(pch);
+
+    testOk(!!(pch = dbChannelCreate("x.VAL{dbnd:{bps:1000}}")),
+           "dbChannel with plugin dbnd (bps=1000) created");
+    dbChannelDelete(pch);
+
     logsFinal = db_available_logs();
     testOk(logsFree == logsFinal, "%d field_logs on free-list", logsFinal);
 
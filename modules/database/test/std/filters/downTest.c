@@ -0,0 +1,110 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include <string.h>
+
+#include "dbAccessDefs.h"
+#include "dbChannel.h"
+#include "errlog.h"
+#include "epicsUnitTest.h"
+#include "dbUnitTest.h"
+#include "testMain.h"
+
+void filterTest_registerRecordDeviceDriver(struct dbBase *);
+
+static void testChannel(const char *name, long nFinal, int nPost)
+{
+    dbChannel *pch = dbChannelCreate(name);
+
+    testOk(pch && !dbChannelOpen(pch) &&
+        dbChannelFinalElements(pch) == nFinal &&
+        ellCount(&pch->post_chain) == nPost,
+        "%s has %ld elements, %d post filter", name, nFinal, nPost);
+    if (pch)
+        dbChannelDelete(pch);
+}
+
+MAIN(downTest)
+{
+    epicsFloat64 wave[100];
+    epicsInt32 ramp[100];
+    epicsFloat64 expRamp[10], expSpike[10];
+    const epicsInt32 expLttb[] = {0, 32, 500, 66, 99};
+    const epicsInt32 expLine[] = {0, 1, 33, 66, 99};
+    const epicsFloat64 shortArr[] = {3.0, 1.0, 2.0};
+    const epicsFloat64 expWrap[] = {50, 69, 70, 89, 99, 0, 10, 29, 30, 49};
+    int i;
+
+    testPlan(22);
+
+    testdbPrepare();
+    testdbReadDatabase("filterTest.dbd", NULL, NULL);
+    filterTest_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("downTest.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testOk(!dbChannelCreate("w.{down:{n:1}}"), "n=1 rejected");
+    testOk(!dbChannelCreate("w.{down:{n:2,m:\"lttb\"}}"), "lttb n=2 rejected");
+    testOk(!dbChannelCreate("w.{down:{n:10,m:\"median\"}}"), "bad mode rejected");
+    testChannel("w.{down:{n:10}}", 10, 1);
+    testChannel("s.{down:{n:10}}", 8, 0);
+
+    testDiag("min/max envelope");
+
+    for (i = 0; i < 100; i++)
+        wave[i] = i;
+    for (i = 0; i < 5; i++) {
+        expRamp[2 * i] = 20 * i;
+        expRamp[2 * i + 1] = 20 * i + 19;
+    }
+    testdbPutArrFieldOk("w", DBR_DOUBLE, 100, wave);
+    testdbGetArrFieldEqual("w.{down:{n:10}}", DBR_DOUBLE, 10, 10, expRamp);
+    testdbGetArrFieldEqual("w.{down:{n:11}}", DBR_DOUBLE, 11, 10, expRamp);
+
+    /* single sample spikes survive */
+    wave[37] = 1000.0;
+    wave[62] = -1000.0;
+    memcpy(expSpike, expRamp, sizeof(expSpike));
+    expSpike[2] = 20.0;
+    expSpike[3] = 1000.0;
+    expSpike[6] = -1000.0;
+    expSpike[7] = 79.0;
+    testdbPutArrFieldOk("w", DBR_DOUBLE, 100, wave);
+    testdbGetArrFieldEqual("w.{down:{n:10}}", DBR_DOUBLE, 10, 10, expSpike);
+
+    /* data starting in the middle of the buffer, so it wraps around */
+    wave[37] = 37.0;
+    wave[62] = 62.0;
+    testdbPutArrFieldOk("w", DBR_DOUBLE, 100, wave);
+    testdbPutFieldOk("w.OFF", DBR_ULONG, 50);
+    testdbGetArrFieldEqual("w.{down:{n:10}}", DBR_DOUBLE, 10, 10, expWrap);
+    testdbPutFieldOk("w.OFF", DBR_ULONG, 0);
+
+    testDiag("Largest-Triangle-Three-Buckets");
+
+    for (i = 0; i < 100; i++)
+        ramp[i] = i;
+    testdbPutArrFieldOk("l", DBR_LONG, 100, ramp);
+    testdbGetArrFieldEqual("l.{down:{n:5,m:\"lttb\"}}", DBR_LONG, 5, 5, expLine);
+    ramp[50] = 500;
+    testdbPutArrFieldOk("l", DBR_LONG, 100, ramp);
+    testdbGetArrFieldEqual("l.{down:{n:5,m:\"lttb\"}}", DBR_LONG, 5, 5, expLttb);
+
+    testDiag("Short arrays");
+
+    testdbPutArrFieldOk("l", DBR_LONG, 3, ramp);
+    testdbGetArrFieldEqual("l.{down:{n:5}}", DBR_LONG, 5, 3, ramp);
+    testdbPutArrFieldOk("s", DBR_DOUBLE, 3, shortArr);
+    testdbGetArrFieldEqual("s.{down:{n:10}}", DBR_DOUBLE, 8, 3, shortArr);
+
+    testIocShutdownOk();
+    testdbCleanup();
+
+    return testDone();
+}
@@ -19,6 +19,9 @@ int dbndTest(void);
 int syncTest(void);
 int arrTest(void);
 int decTest(void);
+int statTest(void);
+int downTest(void);
+int shareTest(void);
 
 void epicsRunFilterTests(void)
 {
@@ -29,6 +32,9 @@ void epicsRunFilterTests(void)
     runTest(syncTest);
     runTest(arrTest);
     runTest(decTest);
+    runTest(statTest);
+    runTest(downTest);
+    runTest(shareTest);
 
     dbmfFreeChunks();
 
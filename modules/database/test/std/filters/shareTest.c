@@ -0,0 +1,107 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include "dbAccess.h"
+#include "dbEvent.h"
+#include "dbLock.h"
+#include "caeventmask.h"
+#include "errlog.h"
+#include "epicsUnitTest.h"
+#include "dbUnitTest.h"
+#include "testMain.h"
+
+#include "xRecord.h"
+
+void filterTest_registerRecordDeviceDriver(struct dbBase *);
+
+#define STATS "x.VAL{stat:{n:2,out:\"mean,max\"}}"
+
+static void post(epicsInt32 val)
+{
+    xRecord *prec = (xRecord *) testdbRecordPtr("x");
+    testMonitor *sync;
+
+    dbScanLock((dbCommon *) prec);
+    prec->val = val;
+    db_post_events(prec, &prec->val, DBE_VALUE);
+    dbScanUnlock((dbCommon *) prec);
+
+    /* Queued last, so its update is delivered after all others */
+    sync = testMonitorCreate("x.DESC", DBE_VALUE, 0);
+    dbScanLock((dbCommon *) prec);
+    db_post_events(prec, &prec->desc, DBE_VALUE);
+    dbScanUnlock((dbCommon *) prec);
+    testMonitorWait(sync);
+    testMonitorDestroy(sync);
+}
+
+static void testShare(int share)
+{
+    testMonitor *first, *second, *other;
+
+    testDiag("dbEventShareFilters = %d", share);
+
+    testdbPrepare();
+    testdbReadDatabase("filterTest.dbd", NULL, NULL);
+    filterTest_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("xRecord.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    dbEventShareFilters = share;
+
+    /* The window of 'first' is half full when 'second' joins */
+    first = testMonitorCreate(STATS, DBE_VALUE, 0);
+    post(1);
+    second = testMonitorCreate(STATS, DBE_VALUE, 0);
+    other = testMonitorCreate("x.VAL{stat:{n:2}}", DBE_VALUE, 0);
+    post(2);
+
+    testOk(testMonitorCount(first, 1) == 1, "first subscription: 1 summary");
+    if (share)
+        testOk(testMonitorCount(second, 1) == 1,
+            "second subscription gets the shared summary");
+    else
+        testOk(testMonitorCount(second, 1) == 0,
+            "second subscription: own window not full");
+    testOk(testMonitorCount(other, 1) == 0,
+        "different filter options are not shared");
+
+    /* Shared subscriptions follow the window of the first one */
+    post(3);
+    testOk(testMonitorCount(first, 1) == 0 && testMonitorCount(second, 1) ==
+        (share ? 0 : 1), "second subscription %s the first",
+        share ? "follows" : "is independent of");
+
+    /* The second one takes over the window when the first one leaves */
+    testMonitorDestroy(first);
+    post(4);
+    testOk(testMonitorCount(second, 1) == (share ? 1 : 0),
+        "second subscription %s", share ?
+        "continues the window of the removed first one" :
+        "keeps its own window");
+    post(5);
+    testOk(testMonitorCount(second, 1) == (share ? 0 : 1),
+        "second subscription's window starts over");
+
+    testMonitorDestroy(second);
+    testMonitorDestroy(other);
+
+    dbEventShareFilters = 0;
+
+    testIocShutdownOk();
+    testdbCleanup();
+}
+
+MAIN(shareTest)
+{
+    testPlan(12);
+    testShare(0);
+    testShare(1);
+    return testDone();
+}
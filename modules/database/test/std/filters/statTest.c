@@ -0,0 +1,270 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include <string.h>
+#include <math.h>
+
+#include "dbStaticLib.h"
+#include "dbAccessDefs.h"
+#include "db_field_log.h"
+#include "dbCommon.h"
+#include "dbChannel.h"
+#include "chfPlugin.h"
+#include "errlog.h"
+#include "alarm.h"
+#include "caeventmask.h"
+#include "epicsUnitTest.h"
+#include "dbUnitTest.h"
+#include "testMain.h"
+
+void filterTest_registerRecordDeviceDriver(struct dbBase *);
+
+static db_field_log * fl_create(dbChannel *chan, long val,
+    unsigned short sevr)
+{
+    db_field_log *pfl = db_create_read_log(chan);
+
+    pfl->ctx  = dbfl_context_event;
+    pfl->mask = DBE_VALUE;
+    pfl->type = dbfl_type_val;
+    pfl->sevr = sevr;
+    pfl->stat = sevr ? HIGH_ALARM : NO_ALARM;
+    pfl->field_type  = DBF_LONG;
+    pfl->field_size  = sizeof(epicsInt32);
+    pfl->no_elements = 1;
+    pfl->u.v.field.dbf_long = val;
+    return pfl;
+}
+
+static void mustDrop(dbChannel *pch, long val, unsigned short sevr)
+{
+    db_field_log *pfl = dbChannelRunPreChain(pch, fl_create(pch, val, sevr));
+
+    testOk(pfl == NULL, "update %ld dropped", val);
+    db_delete_field_log(pfl);
+}
+
+static db_field_log * mustPass(dbChannel *pch, long val, unsigned short sevr)
+{
+    db_field_log *pfl = dbChannelRunPreChain(pch, fl_create(pch, val, sevr));
+
+    testOk(pfl != NULL, "update %ld produces a summary", val);
+    return pfl;
+}
+
+/* What db_post_single_event() sends when a subscription starts */
+static db_field_log * fl_initial(dbChannel *chan, long val)
+{
+    db_field_log *pfl = fl_create(chan, val, NO_ALARM);
+
+    pfl->single = 1;
+    return pfl;
+}
+
+static void initialUpdate(dbChannel *pch)
+{
+    db_field_log *pfl = dbChannelRunPreChain(pch, fl_initial(pch, 0));
+
+    testOk(pfl != NULL, "initial update passed on");
+    db_delete_field_log(pfl);
+}
+
+static void testScalar(void)
+{
+    dbChannel *pch;
+    db_field_log *pfl;
+    const epicsFloat64 *pval;
+    int logsFree;
+
+    testDiag("Scalar updates");
+
+    testdbPrepare();
+    testdbReadDatabase("filterTest.dbd", NULL, NULL);
+    filterTest_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("xRecord.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testOk(!!dbFindFilter("stat", 4), "plugin 'stat' registered");
+
+    testOk(!dbChannelCreate("x.VAL{stat:{n:0}}"), "n=0 rejected");
+    testOk(!dbChannelCreate("x.VAL{stat:{out:\"mean\"}}"), "missing n rejected");
+    testOk(!dbChannelCreate("x.VAL{stat:{n:2,out:\"median\"}}"),
+        "unknown output rejected");
+
+    pch = dbChannelCreate("x.VAL{stat:{n:4,out:\"mean,min,max,n\"}}");
+    testOk(!!pch, "channel with 4 outputs created");
+    if (!pch)
+        testAbort("Can't continue");
+
+    /* Start the free-list */
+    db_delete_field_log(db_create_read_log(pch));
+    logsFree = db_available_logs();
+
+    testOk(!dbChannelOpen(pch), "channel opened");
+    testOk(dbChannelFinalFieldType(pch) == DBF_DOUBLE &&
+        dbChannelFinalElements(pch) == 4,
+        "channel type DOUBLE[4] (got %d[%ld])",
+        dbChannelFinalFieldType(pch), dbChannelFinalElements(pch));
+    testOk(ellCount(&pch->pre_chain) == 1 && ellCount(&pch->post_chain) == 0,
+        "filter in pre chain");
+
+    /* the initial update of a subscription stays out of the window */
+    pfl = dbChannelRunPreChain(pch, fl_initial(pch, 7));
+    testOk(pfl != NULL, "initial update passed on");
+    if (pfl) {
+        pval = pfl->u.r.field;
+        testOk(pval[0] == 7.0 && pval[3] == 1.0,
+            "with its own value, mean=%g n=%g", pval[0], pval[3]);
+        db_delete_field_log(pfl);
+    } else {
+        testSkip(1, "no summary");
+    }
+
+    mustDrop(pch, 1, NO_ALARM);
+    mustDrop(pch, 2, MAJOR_ALARM);
+
+    /* and so do property updates */
+    pfl = fl_create(pch, 100, NO_ALARM);
+    pfl->mask = DBE_PROPERTY;
+    pfl = dbChannelRunPreChain(pch, pfl);
+    testOk(pfl && ((epicsFloat64 *) pfl->u.r.field)[3] == 1.0,
+        "property update passed on alone");
+    db_delete_field_log(pfl);
+
+    mustDrop(pch, 3, NO_ALARM);
+    pfl = mustPass(pch, 6, MINOR_ALARM);
+    if (pfl) {
+        testOk(pfl->type == dbfl_type_ref && pfl->field_type == DBF_DOUBLE &&
+            pfl->no_elements == 4, "summary is a DOUBLE[4] array");
+        pval = pfl->u.r.field;
+        testOk(pval[0] == 3.0 && pval[1] == 1.0 && pval[2] == 6.0 &&
+            pval[3] == 4.0, "mean=%g min=%g max=%g n=%g",
+            pval[0], pval[1], pval[2], pval[3]);
+        testOk(pfl->sevr == MAJOR_ALARM, "highest severity in window");
+        db_delete_field_log(pfl);
+    } else {
+        testSkip(3, "no summary");
+    }
+
+    /* the next window starts afresh */
+    mustDrop(pch, 10, NO_ALARM);
+    mustDrop(pch, 10, NO_ALARM);
+    mustDrop(pch, 10, NO_ALARM);
+    pfl = mustPass(pch, 10, NO_ALARM);
+    if (pfl) {
+        pval = pfl->u.r.field;
+        testOk(pval[0] == 10.0 && pval[1] == 10.0 && pval[2] == 10.0 &&
+            pval[3] == 4.0 && pfl->sevr == NO_ALARM, "window was reset");
+        db_delete_field_log(pfl);
+    } else {
+        testSkip(1, "no summary");
+    }
+    dbChannelDelete(pch);
+
+    pch = dbChannelCreate("x.VAL{stat:{n:2}}");
+    testOk(pch && !dbChannelOpen(pch) && dbChannelFinalElements(pch) == 1,
+        "default output is one element");
+    initialUpdate(pch);
+    mustDrop(pch, 1, NO_ALARM);
+    pfl = mustPass(pch, 4, NO_ALARM);
+    if (pfl) {
+        testOk(pfl->type == dbfl_type_val &&
+            pfl->u.v.field.dbf_double == 2.5,
+            "mean %g", pfl->u.v.field.dbf_double);
+        db_delete_field_log(pfl);
+    } else {
+        testSkip(1, "no summary");
+    }
+    dbChannelDelete(pch);
+
+    pch = dbChannelCreate("x.VAL{stat:{n:2,out:\"rms std sum\"}}");
+    testOk(pch && !dbChannelOpen(pch), "channel with rms, std and sum");
+    initialUpdate(pch);
+    mustDrop(pch, 3, NO_ALARM);
+    pfl = mustPass(pch, 4, NO_ALARM);
+    if (pfl) {
+        pval = pfl->u.r.field;
+        testOk(fabs(pval[0] - sqrt(12.5)) < 1e-12 && pval[1] == 0.5 &&
+            pval[2] == 7.0, "rms=%g std=%g sum=%g", pval[0], pval[1], pval[2]);
+        db_delete_field_log(pfl);
+    } else {
+        testSkip(1, "no summary");
+    }
+    dbChannelDelete(pch);
+
+    /* a large offset would swamp the sum of squares */
+    pch = dbChannelCreate("x.VAL{stat:{n:4,out:\"mean std\"}}");
+    testOk(pch && !dbChannelOpen(pch), "channel with mean and std");
+    initialUpdate(pch);
+    mustDrop(pch, 1000000004, NO_ALARM);
+    mustDrop(pch, 1000000007, NO_ALARM);
+    mustDrop(pch, 1000000013, NO_ALARM);
+    pfl = mustPass(pch, 1000000016, NO_ALARM);
+    if (pfl) {
+        pval = pfl->u.r.field;
+        testOk(pval[0] == 1000000010.0 && fabs(pval[1] - sqrt(22.5)) < 1e-6,
+            "mean=%.1f std=%g", pval[0], pval[1]);
+        db_delete_field_log(pfl);
+    } else {
+        testSkip(1, "no summary");
+    }
+    dbChannelDelete(pch);
+
+    testOk(logsFree == db_available_logs(), "%d field_logs on free-list",
+        db_available_logs());
+
+    testIocShutdownOk();
+    testdbCleanup();
+}
+
+static void testArray(void)
+{
+    const epicsFloat64 dbl[] = {1.0, 2.0, 3.0, 6.0};
+    const epicsInt32 lng[] = {-2, 4, 1};
+    const epicsFloat64 expDbl[] = {1.0, 6.0, 3.0};
+    const epicsFloat64 expLng[] = {-2.0, 4.0, 1.0, 3.0};
+    dbChannel *pch;
+
+    testDiag("Array reads");
+
+    testdbPrepare();
+    testdbReadDatabase("filterTest.dbd", NULL, NULL);
+    filterTest_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("arrTest.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testdbPutArrFieldOk("y", DBR_DOUBLE, 4, dbl);
+    testdbGetArrFieldEqual("y.{stat:{n:1,out:\"min,max,mean\"}}",
+        DBR_DOUBLE, 3, 3, expDbl);
+
+    testdbPutArrFieldOk("x", DBR_LONG, 3, lng);
+    testdbGetArrFieldEqual("x.{stat:{n:1,out:\"min,max,mean,n\"}}",
+        DBR_DOUBLE, 4, 4, expLng);
+
+    pch = dbChannelCreate("z.{stat:{n:1}}");
+    testOk(pch && !dbChannelOpen(pch) &&
+        dbChannelFinalFieldType(pch) == DBF_STRING,
+        "string array passed through unchanged");
+    if (pch)
+        dbChannelDelete(pch);
+
+    testIocShutdownOk();
+    testdbCleanup();
+}
+
+MAIN(statTest)
+{
+    testPlan(46);
+    testScalar();
+    testArray();
+    return testDone();
+}
@@ -0,0 +1,135 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include "dbAccess.h"
+#include "dbLock.h"
+#include "recSup.h"
+#include "dbUnitTest.h"
+#include "errlog.h"
+#include "registryFunction.h"
+#include "testMain.h"
+
+#include "aSubRecord.h"
+#include "waveformRecord.h"
+
+void recTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+/* What the subroutine saw during the last call */
+static void *seenA, *seenB;
+static epicsUInt32 seenNEA;
+static double sumA;
+static epicsInt32 lastB;
+
+static
+long aSubCapture(aSubRecord *prec)
+{
+    const double *a = (const double *) prec->a;
+    epicsUInt32 i;
+
+    seenA = prec->a;
+    seenB = prec->b;
+    seenNEA = prec->nea;
+    sumA = 0.0;
+    for (i = 0; i < prec->nea; i++)
+        sumA += a[i];
+    lastB = prec->neb ? ((epicsInt32 *) prec->b)[prec->neb - 1] : -1;
+    return 0;
+}
+
+/* Goes asynchronous on the first call and sums A when it completes */
+static
+long aSubAsync(aSubRecord *prec)
+{
+    if (!prec->pact) {
+        seenA = prec->a;
+        prec->pact = TRUE;
+        return 0;
+    }
+    return aSubCapture(prec);
+}
+
+static
+void testAsync(void)
+{
+    static const double input[4] = {1, 2, 3, 4};
+    static const double later[4] = {10, 20, 30, 40};
+    waveformRecord *psrc = (waveformRecord *) testdbRecordPtr("src");
+    aSubRecord *prec = (aSubRecord *) testdbRecordPtr("async");
+    dbCommon *pcommon = (dbCommon *) prec;
+    void *ownA = prec->a;
+
+    testDiag("ZCPY=YES with an asynchronous subroutine");
+    testdbPutArrFieldOk("src", DBF_DOUBLE, 4, input);
+    testdbPutFieldOk("async.PROC", DBF_LONG, 1);
+    testOk(seenA == psrc->bptr, "A refers to the source array at first");
+    testOk(prec->pact && prec->a == ownA,
+        "A is copied to its own buffer while active");
+
+    /* change the source before the subroutine completes */
+    testdbPutArrFieldOk("src", DBF_DOUBLE, 4, later);
+
+    dbScanLock(pcommon);
+    pcommon->rset->process(pcommon);
+    dbScanUnlock(pcommon);
+
+    testOk(!prec->pact, "completed");
+    testOk(seenA == ownA && seenNEA == 4, "completion sees its own buffer");
+    testOk(sumA == 10.0, "sum of A = %g, the value when processing started",
+        sumA);
+}
+
+static
+void testZeroCopy(void)
+{
+    static const double input[4] = {1, 2, 3, 4};
+    waveformRecord *psrc = (waveformRecord *) testdbRecordPtr("src");
+    aSubRecord *pzcpy = (aSubRecord *) testdbRecordPtr("zcpy");
+    aSubRecord *pcopy = (aSubRecord *) testdbRecordPtr("copy");
+    void *ownA = pzcpy->a;
+
+    testdbPutArrFieldOk("src", DBF_DOUBLE, 4, input);
+
+    testDiag("ZCPY=YES");
+    testdbPutFieldOk("zcpy.PROC", DBF_LONG, 1);
+    testOk(seenA == psrc->bptr, "A refers to the source array");
+    testOk(seenNEA == 4, "NEA = %u", seenNEA);
+    testOk(sumA == 10.0, "sum of A = %g", sumA);
+    testOk(seenB != psrc->bptr && lastB == 4,
+        "B of a different type is copied, B[3] = %d", lastB);
+    testOk(pzcpy->a == ownA, "A points to its own buffer afterwards");
+    testdbGetFieldEqual("zcpy.SEVR", DBF_SHORT, 0);
+
+    testDiag("ZCPY=NO");
+    testdbPutFieldOk("copy.PROC", DBF_LONG, 1);
+    testOk(seenA == pcopy->a && seenA != psrc->bptr,
+        "A is copied into its own buffer");
+    testOk(sumA == 10.0, "sum of A = %g", sumA);
+    testdbGetArrFieldEqual("copy.A", DBF_DOUBLE, 8, 4, input);
+}
+
+MAIN(aSubTest)
+{
+    testPlan(20);
+
+    testdbPrepare();
+    testdbReadDatabase("recTestIoc.dbd", NULL, NULL);
+    recTestIoc_registerRecordDeviceDriver(pdbbase);
+    registryFunctionAdd("aSubCapture", (REGISTRYFUNCTION) aSubCapture);
+    registryFunctionAdd("aSubAsync", (REGISTRYFUNCTION) aSubAsync);
+    testdbReadDatabase("aSubTest.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testZeroCopy();
+    testAsync();
+
+    testIocShutdownOk();
+    testdbCleanup();
+
+    return testDone();
+}
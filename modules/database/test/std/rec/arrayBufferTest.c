@@ -0,0 +1,236 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include <string.h>
+
+#include "dbAccess.h"
+#include "dbArrayBuffer.h"
+#include "dbChannel.h"
+#include "dbEvent.h"
+#include "db_field_log.h"
+#include "dbLock.h"
+#include "dbUnitTest.h"
+#include "errlog.h"
+#include "testMain.h"
+
+#include "waveformRecord.h"
+
+void recTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+static
+void testPool(dbCommon *prec, unsigned allocated, unsigned nfree)
+{
+    unsigned a, f;
+
+    dbArrayBufferStats(prec, &a, &f);
+    testOk(a == allocated && f == nfree, "%s: %u buffers, %u free",
+        prec->name, a, f);
+}
+
+static
+void testSnapshot(void)
+{
+    static const double first[3] = {1, 2, 3};
+    static const double second[2] = {4, 5};
+    static const double third[1] = {6};
+    waveformRecord *prec = (waveformRecord *) testdbRecordPtr("wf");
+    dbChannel *chan;
+    db_field_log *pfl;
+    void *pold;
+
+    testDiag("Readers keep the buffer they refer to");
+
+    testdbPutArrFieldOk("wf", DBF_DOUBLE, 3, first);
+    testPool((dbCommon *) prec, 2, 1);
+
+    chan = dbChannelCreate("wf");
+    testOk1(chan && !dbChannelOpen(chan));
+    if (!chan)
+        return;
+
+    dbScanLock((dbCommon *) prec);
+    pfl = db_create_read_log(chan);
+    dbScanUnlock((dbCommon *) prec);
+    testOk(pfl && pfl->u.r.dtor && pfl->u.r.field == prec->bptr &&
+        pfl->no_elements == 3, "read log refers to the current buffer");
+    if (!pfl) {
+        dbChannelDelete(chan);
+        return;
+    }
+    pold = pfl->u.r.field;
+
+    testdbPutArrFieldOk("wf", DBF_DOUBLE, 2, second);
+    testOk(prec->bptr != pold, "put went to another buffer");
+    testOk(!memcmp(pfl->u.r.field, first, sizeof(first)),
+        "read log still sees the old data");
+    testdbGetArrFieldEqual("wf", DBF_DOUBLE, 4, 2, second);
+    testPool((dbCommon *) prec, 2, 0);
+
+    db_delete_field_log(pfl);
+    testPool((dbCommon *) prec, 2, 1);
+
+    pold = prec->bptr;
+    testdbPutArrFieldOk("wf", DBF_DOUBLE, 1, third);
+    testOk(prec->bptr == pold, "unshared buffer is written in place");
+
+    dbChannelDelete(chan);
+}
+
+static
+void testSwap(void)
+{
+    static const double data[4] = {7, 8, 9, 10};
+    waveformRecord *prec = (waveformRecord *) testdbRecordPtr("wf");
+    void *buf;
+
+    testDiag("Device support swaps in a filled buffer");
+
+    buf = dbArrayBufferGet((dbCommon *) prec);
+    testOk(buf && buf != prec->bptr, "got a spare buffer");
+    if (!buf)
+        return;
+    memcpy(buf, data, sizeof(data));
+
+    dbScanLock((dbCommon *) prec);
+    dbArrayBufferSwap((dbCommon *) prec, buf);
+    prec->nord = 4;
+    dbScanUnlock((dbCommon *) prec);
+
+    testOk(prec->bptr == buf, "BPTR is the new buffer");
+    testdbGetArrFieldEqual("wf", DBF_DOUBLE, 4, 4, data);
+    testPool((dbCommon *) prec, 2, 1);
+}
+
+static
+void testCap(void)
+{
+    static const double data[2] = {13, 14};
+    waveformRecord *prec = (waveformRecord *) testdbRecordPtr("wf");
+    dbChannel *chan;
+    db_field_log *pfl, *pfl2;
+    void *pold;
+
+    testDiag("The pool does not grow beyond NBUF buffers");
+
+    chan = dbChannelCreate("wf");
+    testOk1(chan && !dbChannelOpen(chan));
+    if (!chan)
+        return;
+
+    dbScanLock((dbCommon *) prec);
+    pfl = db_create_read_log(chan);
+    dbScanUnlock((dbCommon *) prec);
+    testOk(pfl && pfl->u.r.dtor, "first reader gets a reference");
+    testOk(!dbArrayBufferGet((dbCommon *) prec),
+        "the spare buffer is kept for writers");
+
+    testdbPutArrFieldOk("wf", DBF_DOUBLE, 2, data);
+    testPool((dbCommon *) prec, 2, 0);
+
+    dbScanLock((dbCommon *) prec);
+    pfl2 = db_create_read_log(chan);
+    dbScanUnlock((dbCommon *) prec);
+    testOk(pfl2 && !pfl2->u.r.dtor,
+        "second reader reads the record, no buffer left");
+
+    pold = prec->bptr;
+    testdbPutArrFieldOk("wf", DBF_DOUBLE, 2, data);
+    testOk(prec->bptr == pold, "unshared buffer is written in place");
+    testPool((dbCommon *) prec, 2, 0);
+
+    if (pfl2)
+        db_delete_field_log(pfl2);
+    if (pfl)
+        db_delete_field_log(pfl);
+    testPool((dbCommon *) prec, 2, 1);
+
+    dbChannelDelete(chan);
+}
+
+static
+void testSoftReplace(void)
+{
+    static const double first[3] = {1, 2, 3};
+    static const double second[1] = {9};
+    waveformRecord *prec = (waveformRecord *) testdbRecordPtr("soft");
+    dbChannel *chan;
+    db_field_log *pfl;
+    void *pold;
+
+    testDiag("Soft Channel input replaces a shared buffer without a copy");
+
+    testdbPutArrFieldOk("src", DBF_DOUBLE, 3, first);
+    dbScanLock((dbCommon *) prec);
+    dbProcess((dbCommon *) prec);
+    dbScanUnlock((dbCommon *) prec);
+    testdbGetArrFieldEqual("soft", DBF_DOUBLE, 4, 3, first);
+
+    chan = dbChannelCreate("soft");
+    testOk1(chan && !dbChannelOpen(chan));
+    if (!chan)
+        return;
+
+    dbScanLock((dbCommon *) prec);
+    pfl = db_create_read_log(chan);
+    dbScanUnlock((dbCommon *) prec);
+    testOk(pfl && pfl->u.r.dtor, "reader gets a reference");
+
+    testdbPutArrFieldOk("src", DBF_DOUBLE, 1, second);
+    pold = prec->bptr;
+    dbScanLock((dbCommon *) prec);
+    dbProcess((dbCommon *) prec);
+    dbScanUnlock((dbCommon *) prec);
+    testOk(prec->bptr != pold, "input went to the spare buffer");
+    testOk(((double *) prec->bptr)[1] == 0.0,
+        "old data was not copied into it");
+    testdbGetArrFieldEqual("soft", DBF_DOUBLE, 4, 1, second);
+    if (pfl) {
+        testOk(!memcmp(pfl->u.r.field, first, sizeof(first)),
+            "reader still sees the old data");
+        db_delete_field_log(pfl);
+    }
+    else
+        testSkip(1, "no read log");
+    testPool((dbCommon *) prec, 2, 1);
+
+    dbChannelDelete(chan);
+}
+
+static
+void testAai(void)
+{
+    static const double data[2] = {11, 12};
+
+    testDiag("aai record");
+    testPool(testdbRecordPtr("aai"), 2, 1);
+    testdbPutArrFieldOk("aai", DBF_DOUBLE, 2, data);
+    testdbGetArrFieldEqual("aai", DBF_DOUBLE, 4, 2, data);
+}
+
+MAIN(arrayBufferTest)
+{
+    testPlan(39);
+
+    testdbPrepare();
+    testdbReadDatabase("recTestIoc.dbd", NULL, NULL);
+    recTestIoc_registerRecordDeviceDriver(pdbbase);
+    testdbReadDatabase("arrayBufferTest.db", NULL, NULL);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testSnapshot();
+    testSwap();
+    testCap();
+    testSoftReplace();
+    testAai();
+
+    testIocShutdownOk();
+    testdbCleanup();
+
+    return testDone();
+}
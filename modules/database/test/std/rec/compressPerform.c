@@ -0,0 +1,88 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+/* Measures the time each compress record algorithm takes to process a
+ * large array input.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dbUnitTest.h"
+#include "testMain.h"
+#include "dbLock.h"
+#include "errlog.h"
+#include "dbAccess.h"
+#include "epicsMath.h"
+#include "epicsTime.h"
+
+void recTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+static
+void timeAlgorithm(const char *alg, long nelm, const double *input, int nproc)
+{
+    char macros[80];
+    dbCommon *crec;
+    epicsTimeStamp start, end;
+    int j;
+
+    sprintf(macros, "NELM=%ld,N=10,NSAM=%ld,ALG=%s", nelm, nelm, alg);
+
+    testdbPrepare();
+
+    testdbReadDatabase("recTestIoc.dbd", NULL, NULL);
+
+    recTestIoc_registerRecordDeviceDriver(pdbbase);
+
+    testdbReadDatabase("compressArrayTest.db", NULL, macros);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testdbPutArrFieldOk("wf", DBF_DOUBLE, nelm, input);
+    crec = testdbRecordPtr("comp");
+
+    epicsTimeGetMonotonic(&start);
+    dbScanLock(crec);
+    for (j = 0; j < nproc; j++)
+        dbProcess(crec);
+    dbScanUnlock(crec);
+    epicsTimeGetMonotonic(&end);
+    testDiag("%-18s %10.1f", alg,
+        epicsTimeDiffInSeconds(&end, &start) * 1e6 / nproc);
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+}
+
+MAIN(compressPerform)
+{
+    static const char * const algs[] = {
+        "N to 1 Low Value", "N to 1 High Value", "N to 1 Average",
+        "N to 1 Median", "Average", "Circular Buffer"
+    };
+    const long nelm = 100000;
+    double *input;
+    unsigned i;
+    long k;
+
+    testPlan(0);
+
+    input = malloc(nelm * sizeof(double));
+    if (!input)
+        testAbort("Can't allocate input");
+    for (k = 0; k < nelm; k++)
+        input[k] = sin(k * 0.001) + (k % 7) * 0.01;
+
+    testDiag("Per process times (us) with %ld samples", nelm);
+    for (i = 0; i < NELEMENTS(algs); i++)
+        timeAlgorithm(algs[i], nelm, input, 20);
+
+    free(input);
+    return testDone();
+}
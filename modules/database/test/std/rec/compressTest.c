@@ -5,6 +5,8 @@
 * in file LICENSE that is included with this distribution.
 \*************************************************************************/
 
+#include <stdio.h>
+
 #include "dbUnitTest.h"
 #include "testMain.h"
 #include "dbLock.h"
@@ -346,10 +348,159 @@ void testLIFOCirc(void)
     testdbCleanup();
 }
 
+static
+void startArrayIoc(const char *macros)
+{
+    testdbPrepare();
+
+    testdbReadDatabase("recTestIoc.dbd", NULL, NULL);
+
+    recTestIoc_registerRecordDeviceDriver(pdbbase);
+
+    testdbReadDatabase("compressArrayTest.db", NULL, macros);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+}
+
+static
+void stopArrayIoc(void)
+{
+    testIocShutdownOk();
+
+    testdbCleanup();
+}
+
+static
+void processComp(void)
+{
+    dbCommon *crec = testdbRecordPtr("comp");
+
+    dbScanLock(crec);
+    dbProcess(crec);
+    dbScanUnlock(crec);
+}
+
+static
+void testArrayNto1(const char *alg, double a, double b, double c, double d)
+{
+    static const double input[12] = {5, 1, 3,  2, 8, 4,  9, 7, 6,  0, 11, 10};
+    char macros[80];
+
+    testDiag("Test %s of an array", alg);
+
+    sprintf(macros, "NELM=12,N=3,NSAM=4,ALG=%s", alg);
+    startArrayIoc(macros);
+
+    testdbPutArrFieldOk("wf", DBF_DOUBLE, 12, input);
+    processComp();
+    checkArrD("comp", 4, a, b, c, d);
+
+    stopArrayIoc();
+}
+
+static
+void testArrayCirc(const char *balg, double a, double b, double c, double d)
+{
+    double input[12];
+    char macros[80];
+    int i;
+
+    testDiag("Test %s of an array longer than NSAM", balg);
+
+    sprintf(macros, "NELM=12,NSAM=5,ALG=Circular Buffer,BALG=%s", balg);
+    startArrayIoc(macros);
+
+    for (i = 0; i < 12; i++)
+        input[i] = i;
+    testdbPutArrFieldOk("wf", DBF_DOUBLE, 12, input);
+    processComp();
+    checkArrD("comp", 4, a, b, c, d);
+
+    stopArrayIoc();
+}
+
+static
+void testScalarMedian(void)
+{
+    static const double input[3] = {9, 1, 2};
+    static const double input6[12] = {3, 9, -1, 9, 0, 4,
+                                      10, 9, 8, 7, 6, 5};
+    static const double input5[5] = {2, 8, 1, 7, 3};
+    aiRecord *vrec;
+    compressRecord *crec;
+    int i;
+
+    testDiag("Test median of scalars");
+
+    testdbPrepare();
+
+    testdbReadDatabase("recTestIoc.dbd", NULL, NULL);
+
+    recTestIoc_registerRecordDeviceDriver(pdbbase);
+
+    testdbReadDatabase("compressTest.db", NULL,
+        "ALG=N to 1 Median,BALG=FIFO Buffer,NSAM=4");
+
+    vrec = (aiRecord*)testdbRecordPtr("val");
+    crec = (compressRecord*)testdbRecordPtr("comp");
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+
+    testdbPutFieldOk("comp.N", DBF_LONG, 3);
+
+    dbScanLock((dbCommon*)crec);
+    for (i = 0; i < 3; i++) {
+        vrec->val = input[i];
+        dbProcess((dbCommon*)crec);
+    }
+    testOk1(crec->nuse==1);
+    testDEq(crec->bptr[0], 2.0, 0.01);
+    dbScanUnlock((dbCommon*)crec);
+
+    /* even N takes the upper of the two middle samples */
+    testdbPutFieldOk("comp.N", DBF_LONG, 6);
+
+    dbScanLock((dbCommon*)crec);
+    for (i = 0; i < 12; i++) {
+        vrec->val = input6[i];
+        dbProcess((dbCommon*)crec);
+    }
+    testOk1(crec->nuse==2);
+    testDEq(crec->bptr[0], 4.0, 0.01);
+    testDEq(crec->bptr[1], 8.0, 0.01);
+    dbScanUnlock((dbCommon*)crec);
+
+    testdbPutFieldOk("comp.N", DBF_LONG, 5);
+
+    dbScanLock((dbCommon*)crec);
+    for (i = 0; i < 5; i++) {
+        vrec->val = input5[i];
+        dbProcess((dbCommon*)crec);
+    }
+    testOk1(crec->nuse==1);
+    testDEq(crec->bptr[0], 3.0, 0.01);
+    dbScanUnlock((dbCommon*)crec);
+
+    testIocShutdownOk();
+
+    testdbCleanup();
+}
+
 MAIN(compressTest)
 {
-    testPlan(116);
+    testPlan(138);
     testFIFOCirc();
     testLIFOCirc();
+    testArrayNto1("N to 1 Low Value", 1, 2, 6, 0);
+    testArrayNto1("N to 1 High Value", 5, 8, 9, 11);
+    testArrayNto1("N to 1 Average", 3, 14.0/3, 22.0/3, 7);
+    testArrayNto1("N to 1 Median", 3, 4, 7, 10);
+    testArrayCirc("FIFO Buffer", 7, 8, 9, 10);
+    testArrayCirc("LIFO Buffer", 11, 10, 9, 8);
+    testScalarMedian();
     return testDone();
 }
@@ -15,6 +15,9 @@
 
 int analogMonitorTest(void);
 int compressTest(void);
+int histogramTest(void);
+int aSubTest(void);
+int arrayBufferTest(void);
 int recMiscTest(void);
 int arrayOpTest(void);
 int asTest(void);
@@ -33,6 +36,12 @@ void epicsRunRecordTests(void)
 
     runTest(compressTest);
 
+    runTest(histogramTest);
+
+    runTest(aSubTest);
+
+    runTest(arrayBufferTest);
+
     runTest(recMiscTest);
 
     runTest(arrayOpTest);
@@ -0,0 +1,191 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include <limits.h>
+
+#include "dbAccess.h"
+#include "dbUnitTest.h"
+#include "epicsMath.h"
+#include "epicsThread.h"
+#include "errlog.h"
+#include "testMain.h"
+
+#include "histogramRecord.h"
+
+void recTestIoc_registerRecordDeviceDriver(struct dbBase *);
+
+static
+void startIoc(const char *macros)
+{
+    testdbPrepare();
+
+    testdbReadDatabase("recTestIoc.dbd", NULL, NULL);
+
+    recTestIoc_registerRecordDeviceDriver(pdbbase);
+
+    testdbReadDatabase("histogramTest.db", NULL, macros);
+
+    eltc(0);
+    testIocInitOk();
+    eltc(1);
+}
+
+static
+void stopIoc(void)
+{
+    testIocShutdownOk();
+
+    testdbCleanup();
+}
+
+static
+void testArrayInput(void)
+{
+    /* boundaries belong to the lower element, 4 and -1 are out of range */
+    static const double input[8] = {0, 0.5, 1, 1.5, 2, 3.9, 4, -1};
+    static const epicsUInt32 expect[4] = {3, 2, 0, 1};
+
+    testDiag("Array input");
+
+    startIoc("MMIN=0");
+
+    testdbPutArrFieldOk("wf", DBF_DOUBLE, 8, input);
+    testdbPutFieldOk("hist.PROC", DBF_LONG, 1);
+    testdbGetArrFieldEqual("hist", DBF_ULONG, 4, 4, expect);
+    testdbGetFieldEqual("hist.SNUM", DBF_ULONG, 8);
+    testdbGetFieldEqual("hist.MCNT", DBF_SHORT, 0);
+
+    testDiag("Scalar SGNL writes still add one count");
+    testdbPutFieldOk("hist.SGNL", DBF_DOUBLE, 2.5);
+    {
+        static const epicsUInt32 expect2[4] = {3, 2, 1, 1};
+
+        testdbGetArrFieldEqual("hist", DBF_ULONG, 4, 4, expect2);
+    }
+
+    stopIoc();
+}
+
+static
+void testAddSamples(void)
+{
+    static const epicsUInt32 zero[4] = {0, 0, 0, 0};
+    /* processing also adds SGNL, which is 0 */
+    static const epicsUInt32 expect[4] = {251, 250, 250, 250};
+    double samples[1000];
+    histogramRecord *prec;
+    int i;
+
+    testDiag("histogramAddSamples()");
+
+    startIoc("MMIN=0");
+    prec = (histogramRecord *) testdbRecordPtr("intr");
+
+    for (i = 0; i < 1000; i++)
+        samples[i] = (i % 4) + 0.5;
+    histogramAddSamples(prec, samples, 1000);
+    testOk(prec->pcnt == 1000, "1000 counts pending (%d)", prec->pcnt);
+    testdbGetArrFieldEqual("intr", DBF_ULONG, 4, 4, zero);
+
+    testdbPutFieldOk("intr.PROC", DBF_LONG, 1);
+    testdbGetArrFieldEqual("intr", DBF_ULONG, 4, 4, expect);
+    testOk(prec->pcnt == 0, "no counts pending");
+
+    testDiag("Non-finite samples are not counted");
+    samples[0] = epicsNAN;
+    samples[1] = epicsINF;
+    samples[2] = -epicsINF;
+    samples[3] = 1.5;
+    histogramAddSamples(prec, samples, 4);
+    testOk(prec->pcnt == 1, "1 count pending (%d)", prec->pcnt);
+
+    testdbPutFieldOk("intr.SGNL", DBF_DOUBLE, epicsNAN);
+    testdbGetArrFieldEqual("intr", DBF_ULONG, 4, 4, expect);
+
+    stopIoc();
+}
+
+static
+void testSaturation(void)
+{
+    static const double samples[3] = {0.5, 0.5, 0.5};
+    histogramRecord *prec;
+
+    testDiag("Counts saturate");
+
+    startIoc("MMIN=0");
+    prec = (histogramRecord *) testdbRecordPtr("intr");
+
+    /* SGNL 1.5 counts in the second element */
+    prec->bptr[0] = UINT_MAX - 2;
+    prec->bptr[1] = UINT_MAX;
+    testdbPutFieldOk("intr.SGNL", DBF_DOUBLE, 1.5);
+    testOk(prec->bptr[1] == UINT_MAX, "SGNL count saturates");
+
+    histogramAddSamples(prec, samples, 3);
+    testdbPutFieldOk("intr.PROC", DBF_LONG, 1);
+    testOk(prec->bptr[0] == UINT_MAX, "pending counts saturate (%u)",
+        prec->bptr[0]);
+
+    prec->pcnt = INT_MAX - 1;
+    histogramAddSamples(prec, samples, 3);
+    testOk(prec->pcnt == INT_MAX, "pending total saturates (%d)", prec->pcnt);
+
+    stopIoc();
+}
+
+static
+void testRateLimit(void)
+{
+    testDiag("Monitor rate limit");
+
+    startIoc("MMIN=100");
+
+    testdbPutFieldOk("intr.SGNL", DBF_DOUBLE, 1.5);
+    testdbPutFieldOk("intr.PROC", DBF_LONG, 1);
+    testdbGetFieldEqual("intr.MCNT", DBF_SHORT, 0);
+
+    /* held back for 100 seconds */
+    testdbPutFieldOk("intr.SGNL", DBF_DOUBLE, 2.5);
+    testdbPutFieldOk("intr.PROC", DBF_LONG, 1);
+    testdbGetFieldEqual("intr.MCNT", DBF_SHORT, 2);
+
+    stopIoc();
+}
+
+static
+void testRateLimitFlush(void)
+{
+    testDiag("Held back counts are posted after MMIN");
+
+    startIoc("MMIN=1");
+
+    testdbPutFieldOk("intr.PROC", DBF_LONG, 1);
+    testdbPutFieldOk("intr.PROC", DBF_LONG, 1);
+    testdbPutFieldOk("intr.PROC", DBF_LONG, 1);
+    testdbGetFieldEqual("intr.MCNT", DBF_SHORT, 2);
+    epicsThreadSleep(1.5);
+    testdbGetFieldEqual("intr.MCNT", DBF_SHORT, 0);
+
+    /* within 1 second of the flush, so a new one is needed */
+    testdbPutFieldOk("intr.PROC", DBF_LONG, 1);
+    testdbGetFieldEqual("intr.MCNT", DBF_SHORT, 1);
+    epicsThreadSleep(1.5);
+    testdbGetFieldEqual("intr.MCNT", DBF_SHORT, 0);
+
+    stopIoc();
+}
+
+MAIN(histogramTest)
+{
+    testPlan(34);
+    testArrayInput();
+    testAddSamples();
+    testSaturation();
+    testRateLimit();
+    testRateLimitFlush();
+    return testDone();
+}
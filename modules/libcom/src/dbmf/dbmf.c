@@ -30,7 +30,9 @@
 #endif
 
 #include "cantProceed.h"
+#include "dbDefs.h"
 #include "epicsMutex.h"
+#include "epicsStdio.h"
 #include "ellLib.h"
 #include "dbmf.h"
 /*
@@ -38,39 +40,73 @@
 */
 #ifndef DBMF_FREELIST_DEBUG
 
-/*Default values for dblfInit */
-#define DBMF_SIZE               64
-#define DBMF_INITIAL_ITEMS      10
+/*Default values for dbmfInit */
+#define DBMF_SIZE               1024
+#define DBMF_INITIAL_ITEMS      64
 
-typedef struct chunkNode {/*control block for each set of chunkItems*/
+/* The first block after a full release holds what the previous load
+ * needed, within limits */
+#define DBMF_MIN_BLOCK          0x10000
+#define DBMF_MAX_BLOCK          0x400000
+
+/*
+ * Items are carved from large blocks by advancing a pointer, and freed
+ * items are kept on a free list for their size class.  dbmfFreeChunks()
+ * releases the blocks with no items in use.
+ */
+static const size_t classSize[] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 192, 256, 384, 512, 768, 1024
+};
+#define NCLASSES NELEMENTS(classSize)
+
+typedef struct chunkNode {/*control block for each block*/
     ELLNODE    node;
-    void       *pchunk;
+    char       *pchunk;
+    size_t     size;
+    size_t     used;
     int        nNotFree;
 }chunkNode;
 
 typedef struct itemHeader{
-    void       *pnextFree;
-    chunkNode  *pchunkNode;
+    union {
+        void   *pnextFree;  /* while free */
+        size_t sizeClass;   /* while in use, or bytes from malloc() */
+    } u;
+    chunkNode  *pchunkNode; /* NULL if allocated by malloc() */
 }itemHeader;
 
 typedef struct dbmfPrivate {
     ELLLIST    chunkList;
     epicsMutexId lock;
     size_t     size;
-    size_t     allocSize;
-    int        chunkItems;
-    size_t     chunkSize;
+    int        nClasses;
+    size_t     blockSize;
+    size_t     firstBlock;  /* size of the next block if larger, or 0 */
+    size_t     carved;      /* bytes carved since all blocks were released */
+    chunkNode  *pcurrent;   /* block being carved */
     int        nAlloc;
     int        nFree;
     int        nGtSize;
-    void       *freeList;
+    void       *freeList[NCLASSES];
+    int        nClassFree[NCLASSES];
+    /* statistics */
+    unsigned long nMalloc;      /* calls of dbmfMalloc() */
+    unsigned long nFallback;    /* larger than size, used malloc() */
+    size_t     bytesInUse;
+    size_t     bytesPeak;
+    size_t     blockBytes;
+    size_t     blockPeak;
 } dbmfPrivate;
 dbmfPrivate dbmfPvt;
 static dbmfPrivate *pdbmfPvt = NULL;
 int dbmfDebug=0;
-
+
+#define ITEM_SIZE(cls) (sizeof(itemHeader) + 2*REDZONE + classSize[cls])
+
 int dbmfInit(size_t size, int chunkItems)
 {
+    int cls;
+
     if(pdbmfPvt) {
         printf("dbmfInit: Already initialized\n");
         return(-1);
@@ -78,81 +114,106 @@ int dbmfInit(size_t size, int chunkItems)
     pdbmfPvt = &dbmfPvt;
     ellInit(&pdbmfPvt->chunkList);
     pdbmfPvt->lock = epicsMutexMustCreate();
-    /*allign to at least a double*/
-    pdbmfPvt->size = size + size%sizeof(double);
+    /* Larger requests are passed to malloc() */
+    for(cls = 0; cls < (int)NCLASSES - 1 && classSize[cls] < size; cls++);
+    pdbmfPvt->nClasses = cls + 1;
+    pdbmfPvt->size = classSize[cls];
     /* layout is
      * | itemHeader | REDZONE | size | REDZONE |
      */
-    pdbmfPvt->allocSize = pdbmfPvt->size + sizeof(itemHeader) + 2*REDZONE;
-    pdbmfPvt->chunkItems = chunkItems;
-    pdbmfPvt->chunkSize = pdbmfPvt->allocSize * pdbmfPvt->chunkItems;
+    pdbmfPvt->blockSize = ITEM_SIZE(cls) * chunkItems;
+    if(pdbmfPvt->blockSize < DBMF_MIN_BLOCK)
+        pdbmfPvt->blockSize = DBMF_MIN_BLOCK;
+    pdbmfPvt->pcurrent = NULL;
     pdbmfPvt->nAlloc = 0;
     pdbmfPvt->nFree = 0;
     pdbmfPvt->nGtSize = 0;
-    pdbmfPvt->freeList = NULL;
     VALGRIND_CREATE_MEMPOOL(pdbmfPvt, REDZONE, 0);
     return(0);
 }
 
-
-void* dbmfMalloc(size_t size)
+/* Requires pdbmfPvt->lock */
+static itemHeader * itemCarve(int cls)
 {
-    void      **pnextFree;
-    void      **pfreeList;
-    char       *pmem = NULL;
-    chunkNode  *pchunkNode;
+    chunkNode *pchunkNode = pdbmfPvt->pcurrent;
+    size_t need = ITEM_SIZE(cls);
     itemHeader *pitemHeader;
 
-    if(!pdbmfPvt) dbmfInit(DBMF_SIZE,DBMF_INITIAL_ITEMS);
-    epicsMutexMustLock(pdbmfPvt->lock);
-    pfreeList = &pdbmfPvt->freeList;
-    if(*pfreeList == NULL) {
-        int         i;
-        size_t      nbytesTotal;
+    if(!pchunkNode || pchunkNode->size - pchunkNode->used < need) {
+        size_t size = pdbmfPvt->blockSize;
 
-        if(dbmfDebug) printf("dbmfMalloc allocating new storage\n");
-        nbytesTotal = pdbmfPvt->chunkSize + sizeof(chunkNode);
-        pmem = (char *)malloc(nbytesTotal);
-        if(!pmem) {
-            epicsMutexUnlock(pdbmfPvt->lock);
-            cantProceed("dbmfMalloc malloc failed\n");
-            return(NULL);
+        if(pdbmfPvt->firstBlock) {
+            size = pdbmfPvt->firstBlock;
+            pdbmfPvt->firstBlock = 0;
         }
-        pchunkNode = (chunkNode *)(pmem + pdbmfPvt->chunkSize);
-        pchunkNode->pchunk = pmem;
-        pchunkNode->nNotFree=0;
+        if(dbmfDebug) printf("dbmfMalloc allocating new storage\n");
+        pchunkNode = (chunkNode *)malloc(sizeof(chunkNode) + size);
+        if(!pchunkNode) return NULL;
+        pchunkNode->pchunk = (char *)(pchunkNode + 1);
+        pchunkNode->size = size;
+        pchunkNode->used = 0;
+        pchunkNode->nNotFree = 0;
         ellAdd(&pdbmfPvt->chunkList,&pchunkNode->node);
-        for(i=0; i<pdbmfPvt->chunkItems; i++) {
-            pitemHeader = (itemHeader *)pmem;
-            pitemHeader->pchunkNode = pchunkNode;
-            pnextFree = &pitemHeader->pnextFree;
-            *pnextFree = *pfreeList; *pfreeList = (void *)pmem;
-            pdbmfPvt->nFree++;
-            pmem += pdbmfPvt->allocSize;
-        }
+        pdbmfPvt->pcurrent = pchunkNode;
+        pdbmfPvt->blockBytes += size;
+        if(pdbmfPvt->blockBytes > pdbmfPvt->blockPeak)
+            pdbmfPvt->blockPeak = pdbmfPvt->blockBytes;
     }
+    pitemHeader = (itemHeader *)(pchunkNode->pchunk + pchunkNode->used);
+    pitemHeader->pchunkNode = pchunkNode;
+    pchunkNode->used += need;
+    pdbmfPvt->carved += need;
+    return pitemHeader;
+}
+
+void* dbmfMalloc(size_t size)
+{
+    char       *pmem = NULL;
+    itemHeader *pitemHeader;
+
+    if(!pdbmfPvt) dbmfInit(DBMF_SIZE,DBMF_INITIAL_ITEMS);
+    epicsMutexMustLock(pdbmfPvt->lock);
+    pdbmfPvt->nMalloc++;
     if(size<=pdbmfPvt->size) {
-        pnextFree = *pfreeList; *pfreeList = *pnextFree;
-        pmem = (void *)pnextFree;
-        pdbmfPvt->nAlloc++; pdbmfPvt->nFree--;
-        pitemHeader = (itemHeader *)pnextFree;
+        int cls;
+
+        for(cls = 0; classSize[cls] < size; cls++);
+        pitemHeader = pdbmfPvt->freeList[cls];
+        if(pitemHeader) {
+            pdbmfPvt->freeList[cls] = pitemHeader->u.pnextFree;
+            pdbmfPvt->nClassFree[cls]--;
+            pdbmfPvt->nFree--;
+        } else {
+            pitemHeader = itemCarve(cls);
+            if(!pitemHeader) {
+                epicsMutexUnlock(pdbmfPvt->lock);
+                cantProceed("dbmfMalloc malloc failed\n");
+                return(NULL);
+            }
+        }
+        pitemHeader->u.sizeClass = cls;
         pitemHeader->pchunkNode->nNotFree += 1;
+        pdbmfPvt->bytesInUse += classSize[cls];
     } else {
-        pmem = malloc(sizeof(itemHeader) + 2*REDZONE + size);
-        if(!pmem) {
+        pitemHeader = malloc(sizeof(itemHeader) + 2*REDZONE + size);
+        if(!pitemHeader) {
             epicsMutexUnlock(pdbmfPvt->lock);
             cantProceed("dbmfMalloc malloc failed\n");
             return(NULL);
         }
-        pdbmfPvt->nAlloc++;
         pdbmfPvt->nGtSize++;
-        pitemHeader = (itemHeader *)pmem;
+        pdbmfPvt->nFallback++;
+        pitemHeader->u.sizeClass = size;
         pitemHeader->pchunkNode = NULL; /* not part of free list */
+        pdbmfPvt->bytesInUse += size;
         if(dbmfDebug) printf("dbmfMalloc: size %lu mem %p\n",
-                             (unsigned long)size,pmem);
+                             (unsigned long)size,(void *)pitemHeader);
     }
+    pdbmfPvt->nAlloc++;
+    if(pdbmfPvt->bytesInUse > pdbmfPvt->bytesPeak)
+        pdbmfPvt->bytesPeak = pdbmfPvt->bytesInUse;
     epicsMutexUnlock(pdbmfPvt->lock);
-    pmem += sizeof(itemHeader) + REDZONE;
+    pmem = (char *)pitemHeader + sizeof(itemHeader) + REDZONE;
     VALGRIND_MEMPOOL_ALLOC(pdbmfPvt, pmem, size);
     return((void *)pmem);
 }
@@ -176,7 +237,6 @@ char * dbmfStrndup(const char *str, size_t len)
 void dbmfFree(void* mem)
 {
     char       *pmem = (char *)mem;
-    chunkNode  *pchunkNode;
     itemHeader *pitemHeader;
 
     if(!mem) return;
@@ -190,79 +250,127 @@ void dbmfFree(void* mem)
     pitemHeader = (itemHeader *)pmem;
     if(!pitemHeader->pchunkNode) {
         if(dbmfDebug) printf("dbmfGree: mem %p\n",pmem);
+        pdbmfPvt->bytesInUse -= pitemHeader->u.sizeClass;
         free((void *)pmem); pdbmfPvt->nAlloc--;
     }else {
-        void **pfreeList = &pdbmfPvt->freeList;
-        void **pnextFree = &pitemHeader->pnextFree;
+        size_t cls = pitemHeader->u.sizeClass;
 
-        pchunkNode = pitemHeader->pchunkNode;
-        pchunkNode->nNotFree--;
-        *pnextFree = *pfreeList; *pfreeList = pnextFree;
+        pitemHeader->pchunkNode->nNotFree--;
+        pdbmfPvt->bytesInUse -= classSize[cls];
+        pitemHeader->u.pnextFree = pdbmfPvt->freeList[cls];
+        pdbmfPvt->freeList[cls] = pitemHeader;
+        pdbmfPvt->nClassFree[cls]++;
         pdbmfPvt->nAlloc--; pdbmfPvt->nFree++;
     }
     epicsMutexUnlock(pdbmfPvt->lock);
 }
-
+
 int dbmfShow(int level)
 {
     if(pdbmfPvt==NULL) {
         printf("Never initialized\n");
         return(0);
     }
-    printf("size %lu allocSize %lu chunkItems %d ",
+    epicsMutexMustLock(pdbmfPvt->lock);
+    printf("size %lu blockSize %lu firstBlock %lu ",
         (unsigned long)pdbmfPvt->size,
-        (unsigned long)pdbmfPvt->allocSize,pdbmfPvt->chunkItems);
+        (unsigned long)pdbmfPvt->blockSize,
+        (unsigned long)pdbmfPvt->firstBlock);
     printf("nAlloc %d nFree %d nChunks %d nGtSize %d\n",
         pdbmfPvt->nAlloc,pdbmfPvt->nFree,
         ellCount(&pdbmfPvt->chunkList),pdbmfPvt->nGtSize);
+    printf("%lu bytes in use, peak %lu, in blocks of %lu bytes, peak %lu\n",
+        (unsigned long)pdbmfPvt->bytesInUse,
+        (unsigned long)pdbmfPvt->bytesPeak,
+        (unsigned long)pdbmfPvt->blockBytes,
+        (unsigned long)pdbmfPvt->blockPeak);
+    printf("%lu calls, %lu larger than size used malloc\n",
+        pdbmfPvt->nMalloc, pdbmfPvt->nFallback);
     if(level>0) {
         chunkNode  *pchunkNode;
+        int cls;
 
+        for(cls = 0; cls < pdbmfPvt->nClasses; cls++) {
+            if(pdbmfPvt->nClassFree[cls])
+                printf("size %4lu nFree %d\n",
+                    (unsigned long)classSize[cls], pdbmfPvt->nClassFree[cls]);
+        }
         pchunkNode = (chunkNode *)ellFirst(&pdbmfPvt->chunkList);
         while(pchunkNode) {
-            printf("pchunkNode %p nNotFree %d\n",
-                (void*)pchunkNode,pchunkNode->nNotFree);
+            printf("pchunkNode %p nNotFree %d used %lu of %lu\n",
+                (void*)pchunkNode,pchunkNode->nNotFree,
+                (unsigned long)pchunkNode->used,
+                (unsigned long)pchunkNode->size);
             pchunkNode = (chunkNode *)ellNext(&pchunkNode->node);
         }
     }
     if(level>1) {
-        void **pnextFree;;
+        int cls;
+
+        for(cls = 0; cls < pdbmfPvt->nClasses; cls++) {
+            itemHeader *pitemHeader = pdbmfPvt->freeList[cls];
 
-        epicsMutexMustLock(pdbmfPvt->lock);
-        pnextFree = (void**)pdbmfPvt->freeList;
-        while(pnextFree) {
-            printf("%p\n",*pnextFree);
-            pnextFree = (void**)*pnextFree;
+            while(pitemHeader) {
+                printf("%p\n",(void *)pitemHeader);
+                pitemHeader = pitemHeader->u.pnextFree;
+            }
         }
-        epicsMutexUnlock(pdbmfPvt->lock);
     }
+    epicsMutexUnlock(pdbmfPvt->lock);
     return(0);
 }
 
 void dbmfFreeChunks(void)
 {
     chunkNode  *pchunkNode;
-    chunkNode  *pnext;;
+    chunkNode  *pnext;
+    int cls;
 
     if(!pdbmfPvt) {
         printf("dbmfFreeChunks called but dbmfInit never called\n");
         return;
     }
     epicsMutexMustLock(pdbmfPvt->lock);
-    if(pdbmfPvt->nFree
-            != (pdbmfPvt->chunkItems * ellCount(&pdbmfPvt->chunkList))) {
-        printf("dbmfFinish: not all free\n");
-        epicsMutexUnlock(pdbmfPvt->lock);
-        return;
+    /* Unlink free items which are in blocks about to be released */
+    for(cls = 0; cls < pdbmfPvt->nClasses; cls++) {
+        itemHeader **ppitem = (itemHeader **)&pdbmfPvt->freeList[cls];
+
+        while(*ppitem) {
+            itemHeader *pitemHeader = *ppitem;
+
+            if(pitemHeader->pchunkNode->nNotFree == 0) {
+                *ppitem = pitemHeader->u.pnextFree;
+                pdbmfPvt->nClassFree[cls]--;
+                pdbmfPvt->nFree--;
+            } else {
+                ppitem = (itemHeader **)&pitemHeader->u.pnextFree;
+            }
+        }
     }
     pchunkNode = (chunkNode *)ellFirst(&pdbmfPvt->chunkList);
     while(pchunkNode) {
         pnext = (chunkNode *)ellNext(&pchunkNode->node);
-        ellDelete(&pdbmfPvt->chunkList,&pchunkNode->node);
-        free(pchunkNode->pchunk);
+        if(pchunkNode->nNotFree == 0) {
+            ellDelete(&pdbmfPvt->chunkList,&pchunkNode->node);
+            if(pchunkNode == pdbmfPvt->pcurrent)
+                pdbmfPvt->pcurrent = NULL;
+            pdbmfPvt->blockBytes -= pchunkNode->size;
+            free(pchunkNode);
+        }
         pchunkNode = pnext;
     }
-    pdbmfPvt->nFree = 0; pdbmfPvt->freeList = NULL;
+    if(ellCount(&pdbmfPvt->chunkList) == 0 && pdbmfPvt->carved) {
+        /* Start the next load with one block as large as this load needed.
+         * Any further blocks are blockSize again.
+         */
+        size_t size = pdbmfPvt->carved;
+
+        if(size > DBMF_MAX_BLOCK)
+            size = DBMF_MAX_BLOCK;
+        pdbmfPvt->firstBlock = size > pdbmfPvt->blockSize ? size : 0;
+        pdbmfPvt->carved = 0;
+        pdbmfPvt->blockPeak = 0;
+    }
     epicsMutexUnlock(pdbmfPvt->lock);
 }
 
@@ -45,13 +45,15 @@ extern "C" {
 /**
  * \brief Initialize the facility
  * \param size The maximum size request from dbmfMalloc() that will be
- * allocated from the dbmf pool (Size is always made a multiple of 8).
- * \param chunkItems Each time malloc() must be called size*chunkItems bytes
- * are allocated.
+ * allocated from the dbmf pool, at most 1024.  Requests are rounded up to
+ * one of several size classes.
+ * \param chunkItems Each time malloc() must be called at least
+ * size*chunkItems bytes are allocated.  After dbmfFreeChunks() released
+ * all memory, the next block is as large as the previous load needed.
  * \return 0 on success, -1 if already initialized
  *
  * \note If dbmfInit() is not called before one of the other routines then it
- * is automatically called with size=64 and chunkItems=10
+ * is automatically called with size=1024 and chunkItems=64
  */
 LIBCOM_API int dbmfInit(size_t size, int chunkItems);
 /**
@@ -98,10 +100,15 @@ LIBCOM_API char * dbmfStrcat3(const char *lhs, const char *mid,
 LIBCOM_API void dbmfFree(void *bytes);
 /**
  * \brief Free all chunks that contain only free items.
+ *
+ * dbLoadDatabase() and dbLoadRecords() call this after each file.
  */
 LIBCOM_API void dbmfFreeChunks(void);
 /**
  * \brief Show the status of the dbmf memory pool.
+ *
+ * Shows the bytes in use and their peak, the memory held in chunks and
+ * how many requests were too large and passed on to malloc().
  * \param level Detail level.
  * \return 0.
  */
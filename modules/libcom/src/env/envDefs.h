@@ -73,6 +73,8 @@ LIBCOM_API extern const ENV_PARAM EPICS_IOC_LOG_INET;
 LIBCOM_API extern const ENV_PARAM EPICS_IOC_LOG_FILE_LIMIT;
 LIBCOM_API extern const ENV_PARAM EPICS_IOC_LOG_FILE_NAME;
 LIBCOM_API extern const ENV_PARAM EPICS_IOC_LOG_FILE_COMMAND;
+LIBCOM_API extern const ENV_PARAM EPICS_IOC_LOG_SPOOL_FILE;
+LIBCOM_API extern const ENV_PARAM EPICS_IOC_LOG_SPOOL_LIMIT;
 LIBCOM_API extern const ENV_PARAM IOCSH_PS1;
 LIBCOM_API extern const ENV_PARAM IOCSH_HISTSIZE;
 LIBCOM_API extern const ENV_PARAM IOCSH_HISTEDIT_DISABLE;
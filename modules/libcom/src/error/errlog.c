@@ -27,6 +27,8 @@
 #define ERRLOG_INIT
 #include "dbDefs.h"
 #include "epicsThread.h"
+#include "epicsAtomic.h"
+#include "epicsTime.h"
 #include "cantProceed.h"
 #include "epicsMutex.h"
 #include "epicsEvent.h"
@@ -45,9 +47,11 @@
 #define MIN_MESSAGE_SIZE 256
 #define MAX_MESSAGE_SIZE 0x00ffffff
 
-/* errlog buffers contain null terminated strings, each prefixed
- * with a 1 byte header containing flags.
+/* errlog buffers contain entries, each prefixed with a 4 byte header.
+ * The first byte holds flags, the other three the length of the entry.
+ * Most entries are null terminated strings.
  */
+#define ERL_HEADER      4u
 /* State of entries in a buffer. */
 #define ERL_STATE_MASK  0xc0
 #define ERL_STATE_FREE  0x00
@@ -55,6 +59,14 @@
 #define ERL_STATE_READY 0x40
 /* should this message be echoed to the console? */
 #define ERL_LOCALECHO   0x20
+/* entry is an errRecord, formatted by errlogThread */
+#define ERL_ERRPRINTF   0x10
+
+/* An errPrintf() entry, followed by the file name and the message */
+typedef struct {
+    long status;
+    int lineno;
+} errRecord;
 
 /*Declare storage for errVerbose */
 int errVerbose = 0;
@@ -68,9 +80,14 @@ typedef struct listenerNode{
     void *pPrivate;
 } listenerNode;
 
+/* Writers reserve space by advancing pos, and are counted in writers
+ * while they fill it in.  Only errlogThread swaps buffers, after which
+ * it waits for the writers to leave the old buffer before reading it.
+ */
 typedef struct {
     char *base;
     size_t pos;
+    size_t writers;
 } buffer_t;
 
 static struct {
@@ -79,6 +96,10 @@ static struct {
     /* alloc size of both buffer_t::base */
     size_t bufSize;
     int    errlogInitFailed;
+    /* per-thread buffers of maxMsgSize bytes to format messages in */
+    epicsThreadPrivateId stageId;
+    /* errlogThread's buffer for formatting errRecord entries */
+    char *scratch;
 
     epicsMutexId listenerLock;
     ELLLIST      listenerList;
@@ -99,9 +120,16 @@ static struct {
     /* A loop counter maintained by errlogThread. */
     epicsUInt32 flushSeq;
     size_t nFlushers;
+    /* atomic */
     size_t nLost;
 
-    /* 'log' and 'print' combine to form a double buffer. */
+    /* rate limited sites which have suppressed messages */
+    epicsMutexId rateLock;
+    errlogRateLimit *rateSites;
+
+    /* 'log' and 'print' combine to form a double buffer.
+     * 'log' is swapped atomically, 'print' belongs to errlogThread.
+     */
     buffer_t *log;
     buffer_t *print;
 
@@ -109,78 +137,231 @@ static struct {
     buffer_t bufs[2];
 } pvt;
 
-/* Returns an pointer to pvt.maxMsgSize bytes, or NULL if ring buffer is full.
- * When !NULL, caller _must_ later msgbufCommit()
+static
+void msgbufStageFree(void *raw)
+{
+    epicsThreadPrivateSet(pvt.stageId, NULL);
+    free(raw);
+}
+
+/* Returns the calling thread's buffer of pvt.maxMsgSize bytes, or NULL.
+ * Messages are formatted there without holding any lock.  The buffer is
+ * freed when an EPICS thread exits.
  */
 static
-char* msgbufAlloc(void)
+char* msgbufStage(void)
 {
-    char *ret = NULL;
+    char *ret;
 
     if (epicsInterruptIsInterruptContext()) {
         epicsInterruptContextMessage
             ("errlog called from interrupt level\n");
-        return ret;
+        return NULL;
     }
 
     errlogInit(0);
-    epicsMutexMustLock(pvt.msgQueueLock); /* matched in msgbufCommit() */
-    if(pvt.bufSize - pvt.log->pos >= 1+pvt.maxMsgSize) {
-        /* there is enough space for the worst cast */
-        ret = pvt.log->base + pvt.log->pos;
-        ret[0] = ERL_STATE_WRITE;
-        ret++;
-    }
-
+    ret = epicsThreadPrivateGet(pvt.stageId);
     if(!ret) {
-        pvt.nLost++;
-        epicsMutexUnlock(pvt.msgQueueLock);
+        /* Not a *Must* alloc, cantProceed() would recurse */
+        ret = malloc(pvt.maxMsgSize);
+        if(ret) {
+            epicsThreadPrivateSet(pvt.stageId, ret);
+            epicsAtThreadExit(msgbufStageFree, ret);
+        }
+        else
+            epicsAtomicIncrSizeT(&pvt.nLost);
     }
     return ret;
 }
 
+/* nchar returned by snprintf() is >= size when truncated */
 static
-size_t msgbufCommit(size_t nchar, int localEcho)
+size_t msgTruncate(char *msg, size_t size, size_t nchar)
 {
-    int isOkToBlock = epicsThreadIsOkToBlock();
-    int wasEmpty = pvt.log->pos==0;
-    int atExit = pvt.atExit;
-    char *start = pvt.log->base + pvt.log->pos;
-
-    /* nchar returned by snprintf() is >= maxMsgSize when truncated */
-    if(nchar >= pvt.maxMsgSize) {
+    if(nchar >= size) {
         const char *trunc = "<<TRUNCATED>>\n";
-        nchar = pvt.maxMsgSize - 1u;
+        nchar = size - 1u;
 
-        strcpy(start + 1u + nchar - strlen(trunc), trunc);
-        /* assert(strlen(start+1u)==nchar); */
+        strcpy(msg + nchar - strlen(trunc), trunc);
     }
+    return nchar;
+}
 
-    start[1u + nchar] = '\0';
+/* Copy an entry of len bytes into the log buffer without locking.
+ * Returns 1 if the buffer was empty, 0 if not, or -1 if there was
+ * no room and the entry was lost.
+ */
+static
+int msgbufPut(const char *msg, size_t len, unsigned flags)
+{
+    size_t need = ERL_HEADER + len;
+    buffer_t *log;
+    size_t pos;
+    char *start;
 
-    if(localEcho && isOkToBlock && atExit) {
-        /* errlogThread is not running, so we print directly
-         * and then abandon the buffer.
-         */
-        fprintf(pvt.console, "%s", start);
+    /* enter the current log buffer */
+    while(1) {
+        log = epicsAtomicGetPtrT((EpicsAtomicPtrT *)&pvt.log);
+        epicsAtomicIncrSizeT(&log->writers);
+        if(log == epicsAtomicGetPtrT((EpicsAtomicPtrT *)&pvt.log))
+            break;
+        epicsAtomicDecrSizeT(&log->writers);
+    }
+
+    do {
+        pos = epicsAtomicGetSizeT(&log->pos);
+        if(pvt.bufSize - pos < need) {
+            epicsAtomicDecrSizeT(&log->writers);
+            epicsAtomicIncrSizeT(&pvt.nLost);
+            return -1;
+        }
+    } while(epicsAtomicCmpAndSwapSizeT(&log->pos, pos, pos + need) != pos);
+
+    start = log->base + pos;
+    start[1] = (char)(len >> 16);
+    start[2] = (char)(len >> 8);
+    start[3] = (char)len;
+    memcpy(start + ERL_HEADER, msg, len);
+    epicsAtomicWriteMemoryBarrier();
+    start[0] = ERL_STATE_READY | flags;
+    epicsAtomicDecrSizeT(&log->writers);
+
+    return pos == 0u;
+}
 
-    } else {
-        start[0u] = ERL_STATE_READY | (localEcho ? ERL_LOCALECHO : 0);
+static
+size_t msgFormatRecord(const char *rec, char *out)
+{
+    errRecord hdr;
+    const char *file = rec + sizeof(hdr);
+    char name[256] = "";
+    int nchar;
 
-        pvt.log->pos += 1u + nchar + 1u;
+    memcpy(&hdr, rec, sizeof(hdr));
+    if (hdr.status > 0) {
+        errSymLookup(hdr.status, name, sizeof(name));
     }
 
-    epicsMutexUnlock(pvt.msgQueueLock); /* matched in msgbufAlloc() */
+    nchar = epicsSnprintf(out, pvt.maxMsgSize, "%s%sfilename=\"%s\" line number=%d%s",
+                          name, hdr.status ? " " : "", file, hdr.lineno,
+                          file + strlen(file) + 1u);
+    return msgTruncate(out, pvt.maxMsgSize, nchar);
+}
 
-    if(wasEmpty && !atExit)
+/* Queue an entry of len bytes from a staging buffer */
+static
+void msgbufCommit(const char *msg, size_t len, unsigned flags)
+{
+    int isOkToBlock = epicsThreadIsOkToBlock();
+    int localEcho = (flags & ERL_LOCALECHO) != 0;
+
+    if(pvt.atExit) {
+        /* errlogThread is not running, so we print directly
+         * and then abandon the message.
+         */
+        if(localEcho && isOkToBlock) {
+            char *text = NULL;
+
+            if(flags & ERL_ERRPRINTF) {
+                text = malloc(pvt.maxMsgSize);
+                if(text)
+                    msgFormatRecord(msg, text);
+            }
+            fprintf(pvt.console, "%s", text ? text : msg);
+            free(text);
+        }
+        return;
+    }
+
+    if(msgbufPut(msg, len, flags) == 1)
         epicsEventMustTrigger(pvt.waitForWork);
 
-    if(localEcho && isOkToBlock && !atExit)
+    if(localEcho && isOkToBlock)
         errlogFlush();
+}
 
+/* Returns the length of the formatted message */
+static
+size_t msgbufCommitText(char *buf, size_t nchar, int localEcho)
+{
+    nchar = msgTruncate(buf, pvt.maxMsgSize, nchar);
+    buf[nchar] = '\0';
+    msgbufCommit(buf, nchar + 1u, localEcho ? ERL_LOCALECHO : 0);
     return nchar;
 }
 
+/* Called with pvt.rateLock held */
+static
+void rateSummary(const errlogRateLimit *site, unsigned long count)
+{
+    char msg[256];
+    int nchar = epicsSnprintf(msg, sizeof(msg),
+        "errlog: %lu messages suppressed from %s line %d\n",
+        count, site->file, site->line);
+
+    nchar = msgTruncate(msg, sizeof(msg), nchar);
+    if(msgbufPut(msg, nchar + 1u, pvt.toConsole ? ERL_LOCALECHO : 0) == 1)
+        epicsEventMustTrigger(pvt.waitForWork);
+}
+
+/* Returns non-zero if the site may log another message now.
+ * A message ending a period of suppression is preceded by a summary.
+ */
+static
+int rateAllow(errlogRateLimit *site)
+{
+    epicsUInt64 now = epicsMonotonicGet();
+    int allow;
+
+    epicsMutexMustLock(pvt.rateLock);
+    if(!site->start || now - site->start >= site->interval * 1e9) {
+        if(site->suppressed)
+            rateSummary(site, site->suppressed);
+        site->suppressed = 0;
+        site->start = now;
+        site->count = 0;
+    }
+
+    allow = site->count < site->burst;
+    if(allow) {
+        site->count++;
+    }
+    else if(!site->suppressed++ && !site->registered) {
+        site->registered = 1;
+        site->next = pvt.rateSites;
+        pvt.rateSites = site;
+    }
+    epicsMutexUnlock(pvt.rateLock);
+    return allow;
+}
+
+/* Called by errlogThread to log summaries for sites which went quiet.
+ * Returns non-zero while any site is still suppressing messages.
+ */
+static
+int rateSweep(void)
+{
+    epicsUInt64 now = epicsMonotonicGet();
+    errlogRateLimit *site;
+    int pending = 0;
+
+    epicsMutexMustLock(pvt.rateLock);
+    for(site = pvt.rateSites; site; site = site->next) {
+        if(!site->suppressed)
+            continue;
+        if(now - site->start >= site->interval * 1e9) {
+            rateSummary(site, site->suppressed);
+            site->suppressed = 0;
+            site->start = 0;
+        }
+        else {
+            pending = 1;
+        }
+    }
+    epicsMutexUnlock(pvt.rateLock);
+    return pending;
+}
+
 static
 void errlogSequence(void)
 {
@@ -320,15 +501,33 @@ int errlogPrintf(const char *pFormat, ...)
 int errlogVprintf(const char *pFormat,va_list pvar)
 {
     int nchar = 0;
-    char *buf = msgbufAlloc();
+    char *buf = msgbufStage();
 
     if(buf) {
         nchar = epicsVsnprintf(buf, pvt.maxMsgSize, pFormat, pvar);
-        nchar = msgbufCommit(nchar, pvt.toConsole);
+        nchar = msgbufCommitText(buf, nchar, pvt.toConsole);
     }
     return nchar;
 }
 
+int errlogRatePrintf(errlogRateLimit *site, const char *pFormat, ...)
+{
+    int ret;
+    va_list args;
+    va_start(args, pFormat);
+    ret = errlogRateVprintf(site, pFormat, args);
+    va_end(args);
+    return ret;
+}
+
+int errlogRateVprintf(errlogRateLimit *site, const char *pFormat, va_list pvar)
+{
+    errlogInit(0);
+    if(!rateAllow(site))
+        return 0;
+    return errlogVprintf(pFormat, pvar);
+}
+
 int errlogMessage(const char *message)
 {
     errlogPrintf("%s", message);
@@ -348,11 +547,11 @@ int errlogPrintfNoConsole(const char *pFormat, ...)
 int errlogVprintfNoConsole(const char *pFormat, va_list pvar)
 {
     int nchar = 0;
-    char *buf = msgbufAlloc();
+    char *buf = msgbufStage();
 
     if(buf) {
         nchar = epicsVsnprintf(buf, pvt.maxMsgSize, pFormat, pvar);
-        nchar = msgbufCommit(nchar, 0);
+        nchar = msgbufCommitText(buf, nchar, 0);
     }
     return nchar;
 }
@@ -371,13 +570,13 @@ int errlogSevPrintf(errlogSevEnum severity, const char *pFormat, ...)
 int errlogSevVprintf(errlogSevEnum severity, const char *pFormat, va_list pvar)
 {
     int nchar = 0;
-    char *buf = msgbufAlloc();
+    char *buf = msgbufStage();
 
     if(buf) {
         nchar = sprintf(buf, "sevr=%s ", errlogGetSevEnumString(severity));
         if(nchar < pvt.maxMsgSize)
             nchar += epicsVsnprintf(buf + nchar, pvt.maxMsgSize - nchar, pFormat, pvar);
-        nchar = msgbufCommit(nchar, pvt.toConsole);
+        nchar = msgbufCommitText(buf, nchar, pvt.toConsole);
     }
     return nchar;
 }
@@ -477,23 +676,32 @@ void errPrintf(long status, const char *pFileName, int lineno,
     const char *pformat, ...)
 {
     va_list pvar;
-    int     nchar = 0;
-    char *buf = msgbufAlloc();
+    char *buf = msgbufStage();
 
     va_start(pvar, pformat);
 
+    /* The status lookup and the final message are done by errlogThread */
     if(buf) {
-        char    name[256] = "";
-
-        if (status > 0) {
-            errSymLookup(status, name, sizeof(name));
-        }
-
-        nchar = epicsSnprintf(buf, pvt.maxMsgSize, "%s%sfilename=\"%s\" line number=%d",
-                              name, status ? " " : "", pFileName, lineno);
-        if(nchar < pvt.maxMsgSize)
-            nchar += epicsVsnprintf(buf + nchar, pvt.maxMsgSize - nchar, pformat, pvar);
-        msgbufCommit(nchar, pvt.toConsole);
+        errRecord hdr;
+        size_t flen, pos;
+        int nchar;
+
+        if (!pFileName)
+            pFileName = "";
+        flen = epicsStrnLen(pFileName, pvt.maxMsgSize / 4u);
+
+        hdr.status = status;
+        hdr.lineno = lineno;
+        memcpy(buf, &hdr, sizeof(hdr));
+        memcpy(buf + sizeof(hdr), pFileName, flen);
+        buf[sizeof(hdr) + flen] = '\0';
+        pos = sizeof(hdr) + flen + 1u;
+
+        nchar = epicsVsnprintf(buf + pos, pvt.maxMsgSize - pos, pformat, pvar);
+        nchar = msgTruncate(buf + pos, pvt.maxMsgSize - pos, nchar);
+        buf[pos + nchar] = '\0';
+        msgbufCommit(buf, pos + nchar + 1u,
+                     ERL_ERRPRINTF | (pvt.toConsole ? ERL_LOCALECHO : 0));
     }
 
     va_end(pvar);
@@ -546,6 +754,9 @@ static void errlogInitPvt(void *arg)
     pvt.listenerLock = epicsMutexCreate();
     pvt.msgQueueLock = epicsMutexCreate();
     pvt.waitForSeq = epicsEventCreate(epicsEventEmpty);
+    pvt.rateLock = epicsMutexCreate();
+    pvt.stageId = epicsThreadPrivateCreate();
+    pvt.scratch = malloc(pvt.maxMsgSize);
     pvt.log = &pvt.bufs[0];
     pvt.print = &pvt.bufs[1];
     pvt.log->base = calloc(1, pvt.bufSize);
@@ -557,6 +768,9 @@ static void errlogInitPvt(void *arg)
             && pvt.listenerLock
             && pvt.msgQueueLock
             && pvt.waitForSeq
+            && pvt.rateLock
+            && pvt.stageId
+            && pvt.scratch
             && pvt.log->base
             && pvt.print->base
             ) {
@@ -614,69 +828,87 @@ static void errlogThread(void)
 {
     epicsMutexMustLock(pvt.msgQueueLock);
     while (!pvt.atExit) {
+        buffer_t *print = pvt.log;
+
         pvt.flushSeq++;
 
-        if(pvt.log->pos==0u) {
+        if(epicsAtomicGetSizeT(&print->pos)==0u) {
             int wakeFlusher = pvt.nFlushers!=0;
             epicsMutexUnlock(pvt.msgQueueLock);
             if(wakeFlusher)
                 epicsEventMustTrigger(pvt.waitForSeq);
-            epicsEventMustWait(pvt.waitForWork);
+            /* wake up to summarize suppressed messages */
+            if(rateSweep())
+                epicsEventWaitWithTimeout(pvt.waitForWork, 1.0);
+            else
+                epicsEventMustWait(pvt.waitForWork);
             epicsMutexMustLock(pvt.msgQueueLock);
 
         } else {
             /* snapshot and swap buffers for use while unlocked */
-            size_t nLost = pvt.nLost;
             FILE *console = pvt.toConsole ? pvt.console : NULL;
             int ttyConsole = pvt.ttyConsole;
-            size_t pos = 0u;
-            buffer_t *print;
+            size_t nLost, end, pos = 0u;
 
-            {
-                buffer_t *temp = pvt.log;
-                pvt.log = pvt.print;
-                pvt.print = print = temp;
-            }
+            /* full barrier, new writers now see the other buffer */
+            epicsAtomicCmpAndSwapPtrT((EpicsAtomicPtrT *)&pvt.log, print, pvt.print);
+            pvt.print = print;
 
-            pvt.nLost = 0u;
+            nLost = epicsAtomicGetSizeT(&pvt.nLost);
+            epicsAtomicSubSizeT(&pvt.nLost, nLost);
             epicsMutexUnlock(pvt.msgQueueLock);
 
-            while(pos < print->pos) {
+            /* writers are only delayed by being preempted */
+            while(epicsAtomicGetSizeT(&print->writers))
+                epicsThreadSleep(epicsThreadSleepQuantum());
+            epicsAtomicReadMemoryBarrier();
+            end = print->pos;
+
+            while(pos < end) {
                 listenerNode *plistenerNode;
                 char* base = print->base + pos;
-                size_t mlen = epicsStrnLen(base+1u, pvt.bufSize - pos);
+                char* msg = base + ERL_HEADER;
+                size_t mlen = (size_t)(epicsUInt8)base[1] << 16 |
+                              (size_t)(epicsUInt8)base[2] << 8 |
+                              (size_t)(epicsUInt8)base[3];
                 int stripped = 0;
 
-                if((base[0]&ERL_STATE_MASK) != ERL_STATE_READY || mlen>=pvt.bufSize - pos) {
+                if((base[0]&ERL_STATE_MASK) != ERL_STATE_READY ||
+                        mlen == 0u || mlen > end - pos - ERL_HEADER) {
                     fprintf(stderr, "Logic Error: errlog buffer corruption. %02x, %zu\n",
                             (unsigned)base[0], mlen);
                     /* try to reset and recover */
                     break;
                 }
 
+                if(base[0]&ERL_ERRPRINTF) {
+                    msgFormatRecord(msg, pvt.scratch);
+                    msg = pvt.scratch;
+                }
+
                 if(base[0]&ERL_LOCALECHO && console) {
                     if(!ttyConsole) {
-                        errlogStripANSI(base+1u);
+                        errlogStripANSI(msg);
                         stripped = 1;
                     }
-                    fprintf(console, "%s", base+1u);
+                    fprintf(console, "%s", msg);
                 }
 
                 if(!stripped)
-                    errlogStripANSI(base+1u);
+                    errlogStripANSI(msg);
 
                 epicsMutexMustLock(pvt.listenerLock);
                 plistenerNode = (listenerNode *)ellFirst(&pvt.listenerList);
                 while (plistenerNode) {
-                    (*plistenerNode->listener)(plistenerNode->pPrivate, base+1u);
+                    (*plistenerNode->listener)(plistenerNode->pPrivate, msg);
                     plistenerNode = (listenerNode *)ellNext(&plistenerNode->node);
                 }
                 epicsMutexUnlock(pvt.listenerLock);
 
-                pos += 1u + mlen+1u;
+                pos += ERL_HEADER + mlen;
             }
 
-            memset(print->base, 0, pvt.bufSize);
+            memset(print->base, 0, end);
             print->pos = 0u;
 
             if(nLost && console)
@@ -685,6 +917,7 @@ static void errlogThread(void)
             if(console)
                 fflush(console);
 
+            rateSweep();
             epicsMutexMustLock(pvt.msgQueueLock);
 
         }
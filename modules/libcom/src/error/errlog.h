@@ -31,6 +31,7 @@
 
 #include "libComAPI.h"
 #include "compilerDependencies.h"
+#include "epicsTypes.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -105,6 +106,70 @@ LIBCOM_API int errlogPrintf(const char *pformat, ...)
  */
 LIBCOM_API int errlogVprintf(const char *pformat, va_list pvar);
 
+/**
+ * @brief State of one rate limited errlog call site.
+ *
+ * Give each call site its own instance with static storage, initialized
+ * with ::ERRLOG_RATE_LIMIT_INIT, and pass it to errlogRatePrintf().
+ * Only the first four members may be set by the user.
+ *
+ * @since UNRELEASED
+ */
+typedef struct errlogRateLimit {
+    /** Number of messages allowed in each interval */
+    unsigned int burst;
+    /** Length of the interval in seconds */
+    double interval;
+    /** Source file shown in the summary of suppressed messages */
+    const char *file;
+    /** Source line shown in the summary of suppressed messages */
+    int line;
+
+    /* private to errlog */
+    struct errlogRateLimit *next;
+    epicsUInt64 start;
+    unsigned int count;
+    unsigned long suppressed;
+    int registered;
+} errlogRateLimit;
+
+/**
+ * Initializer for an ::errlogRateLimit which allows at most BURST messages
+ * every INTERVAL seconds.  Records the location of the declaration.
+ * @code
+ * static errlogRateLimit badData = ERRLOG_RATE_LIMIT_INIT(5, 60.0);
+ * errlogRatePrintf(&badData, "%s: bad data from device\n", prec->name);
+ * @endcode
+ *
+ * @since UNRELEASED
+ */
+#define ERRLOG_RATE_LIMIT_INIT(BURST, INTERVAL) \
+    {BURST, INTERVAL, __FILE__, __LINE__, NULL, 0u, 0u, 0ul, 0}
+
+/**
+ * Like ::errlogPrintf, but drops messages once the call site has logged
+ * its burst of messages for the current interval.  The number of
+ * messages dropped is logged as a single line, when the next message
+ * is allowed or soon after the interval ends.  Dropped messages are
+ * not formatted.
+ *
+ * \param site The state of this call site
+ * \param pformat The message to log or print
+ * \return The number of characters logged, 0 if the message was dropped
+ *
+ * @since UNRELEASED
+ */
+LIBCOM_API int errlogRatePrintf(errlogRateLimit *site,
+    const char *pformat, ...) EPICS_PRINTF_STYLE(2,3);
+
+/**
+ * Like ::errlogRatePrintf, but takes a va_list.
+ *
+ * @since UNRELEASED
+ */
+LIBCOM_API int errlogRateVprintf(errlogRateLimit *site,
+    const char *pformat, va_list pvar);
+
 /**
  * This function is like ::errlogPrintf except that it adds the severity to the beginning
  * of the message in the form `sevr=<value>` where value is one of the enumerated
@@ -233,6 +298,9 @@ LIBCOM_API void errlogFlush(void);
  *
  * The remaining arguments are just like the arguments to the C printf routine.
  * ::errVerbose determines if the filename and line number are shown.
+ *
+ * The status lookup and the final formatting of the message are done later,
+ * by the errlog task.
  */
 LIBCOM_API void errPrintf(long status, const char *pFileName, int lineno,
     const char *pformat, ...) EPICS_PRINTF_STYLE(4,5);
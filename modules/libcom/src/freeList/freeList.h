@@ -36,6 +36,30 @@ LIBCOM_API void epicsStdCall freeListFree(void *pvt,void*pmem);
 LIBCOM_API void epicsStdCall freeListCleanup(void *pvt);
 LIBCOM_API size_t epicsStdCall freeListItemsAvail(void *pvt);
 
+/**
+ * \brief Create a free list with per-thread caches.
+ *
+ * Like freeListInitPvt(), but each thread keeps up to twice
+ * min(malloc, 32) free elements of its own, which it allocates and frees
+ * without any locking.  The shared list and its lock are only used to
+ * move a batch of elements at a time when a thread's cache runs empty or
+ * full.  Use this for lists allocated from and freed to by several busy
+ * threads.
+ *
+ * Elements cached by a thread are not available to the others, and
+ * freeListItemsAvail() includes them in its count.
+ */
+LIBCOM_API void epicsStdCall freeListInitPvtCached(void **ppvt, int size,
+    int malloc);
+
+/**
+ * \brief Print the occupancy of a free list.
+ *
+ * Level 1 adds the number of elements held in thread caches and how often
+ * the list's lock was found taken by another thread.
+ */
+LIBCOM_API void epicsStdCall freeListShow(void *pvt, unsigned level);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,6 +9,7 @@
 \*************************************************************************/
 /* Author:  Marty Kraimer Date:    04-19-94 */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -23,14 +24,29 @@
 #endif
 
 #include "cantProceed.h"
+#include "epicsExit.h"
 #include "epicsMutex.h"
+#include "epicsThread.h"
 #include "freeList.h"
 #include "adjustment.h"
 
+/* Threads with a magazine, any others always use the shared list */
+#define MAG_THREADS 256
+/* Largest number of blocks moved between a magazine and the shared list */
+#define MAG_SIZE 32
+
 typedef struct allocMem {
     struct allocMem     *next;
     void                *memory;
 }allocMem;
+
+/* Free blocks cached for one thread, only touched by that thread */
+typedef struct magazine {
+    void        *head;
+    unsigned    count;
+    char        pad[64 - sizeof(void *) - sizeof(unsigned)];
+}magazine;
+
 typedef struct {
     int         size;
     int         nmalloc;
@@ -38,9 +54,87 @@ typedef struct {
     allocMem    *mallochead;
     size_t      nBlocksAvailable;
     epicsMutexId lock;
+    /* lists created by freeListInitPvtCached() only */
+    unsigned    magSize;        /* blocks moved per transfer */
+    magazine    **mags;         /* [MAG_THREADS] by thread index */
+    /* statistics, guarded by lock */
+    size_t      nBlocks;
+    size_t      nLocks;
+    size_t      nContended;
 }FREELISTPVT;
 
-LIBCOM_API void epicsStdCall 
+static epicsThreadOnceId magOnce = EPICS_THREAD_ONCE_INIT;
+static epicsThreadPrivateId magIndexId;
+static epicsMutexId magIndexLock;
+static int magIndexNext;
+static int magIndexFree[MAG_THREADS];
+static int nMagIndexFree;
+
+static void magInit(void *arg)
+{
+    magIndexId = epicsThreadPrivateCreate();
+    magIndexLock = epicsMutexMustCreate();
+}
+
+/* The next thread to need an index takes over this one's magazines */
+static void magIndexRelease(void *arg)
+{
+    epicsMutexMustLock(magIndexLock);
+    magIndexFree[nMagIndexFree++] = (int)(size_t)arg;
+    epicsMutexUnlock(magIndexLock);
+}
+
+/* Index of the calling thread's magazines, or -1 */
+static int magIndexSelf(void)
+{
+    /* stored as index + 2, so that NULL means not yet assigned */
+    void *ptr = epicsThreadPrivateGet(magIndexId);
+    int index;
+
+    if (ptr)
+        return (int)(size_t)ptr - 2;
+
+    epicsMutexMustLock(magIndexLock);
+    if (nMagIndexFree)
+        index = magIndexFree[--nMagIndexFree];
+    else if (magIndexNext < MAG_THREADS)
+        index = magIndexNext++;
+    else
+        index = -1;
+    epicsMutexUnlock(magIndexLock);
+
+    /* Only EPICS threads run their exit routines, others keep the index */
+    if (index >= 0)
+        epicsAtThreadExit(magIndexRelease, (void *)(size_t)index);
+    epicsThreadPrivateSet(magIndexId, (void *)(size_t)(index + 2));
+    return index;
+}
+
+static magazine * magSelf(FREELISTPVT *pfl)
+{
+    int index = magIndexSelf();
+    magazine *pmag;
+
+    if (index < 0)
+        return NULL;
+    pmag = pfl->mags[index];
+    if (!pmag) {
+        pmag = calloc(1, sizeof(magazine));
+        pfl->mags[index] = pmag;
+    }
+    return pmag;
+}
+
+static void lockList(FREELISTPVT *pfl)
+{
+    if (epicsMutexTryLock(pfl->lock) != epicsMutexLockOK) {
+        epicsMutexMustLock(pfl->lock);
+        pfl->nContended++;
+    }
+    pfl->nLocks++;
+}
+
+LIBCOM_API void epicsStdCall
     freeListInitPvt(void **ppvt,int size,int nmalloc)
 {
     FREELISTPVT *pfl;
@@ -57,6 +151,19 @@ LIBCOM_API void epicsStdCall
     return;
 }
 
+LIBCOM_API void epicsStdCall
+    freeListInitPvtCached(void **ppvt,int size,int nmalloc)
+{
+    FREELISTPVT *pfl;
+
+    freeListInitPvt(ppvt, size, nmalloc);
+    pfl = *ppvt;
+    epicsThreadOnce(&magOnce, magInit, NULL);
+    pfl->magSize = nmalloc < 1 ? 1 : nmalloc < MAG_SIZE ? nmalloc : MAG_SIZE;
+    pfl->mags = callocMustSucceed(MAG_THREADS, sizeof(magazine *),
+        "freeListInitPvtCached");
+}
+
 LIBCOM_API void * epicsStdCall freeListCalloc(void *pvt)
 {
     FREELISTPVT *pfl = pvt;
@@ -70,19 +177,15 @@ LIBCOM_API void * epicsStdCall freeListCalloc(void *pvt)
     return(ptemp);
 #   endif
 }
-
-LIBCOM_API void * epicsStdCall freeListMalloc(void *pvt)
+
+/* Take a block from the shared list, called with the list locked */
+static void * listGet(FREELISTPVT *pfl)
 {
-    FREELISTPVT *pfl = pvt;
-#   ifdef EPICS_FREELIST_DEBUG
-    return callocMustSucceed(1,pfl->size,"freeList Debug Malloc");
-#   else
     void        *ptemp;
     void        **ppnext;
     allocMem    *pallocmem;
     int         i;
 
-    epicsMutexMustLock(pfl->lock);
     ptemp = pfl->head;
     if(ptemp==0) {
         /* layout of each block. nmalloc+1 REDZONEs for nmallocs.
@@ -94,12 +197,10 @@ LIBCOM_API void * epicsStdCall freeListMalloc(void *pvt)
          */
         ptemp = (void *)malloc(pfl->nmalloc*(pfl->size+REDZONE)+REDZONE);
         if(ptemp==0) {
-            epicsMutexUnlock(pfl->lock);
             return(0);
         }
         pallocmem = (allocMem *)calloc(1,sizeof(allocMem));
         if(pallocmem==0) {
-            epicsMutexUnlock(pfl->lock);
             free(ptemp);
             return(0);
         }
@@ -117,11 +218,77 @@ LIBCOM_API void * epicsStdCall freeListMalloc(void *pvt)
         }
         ptemp = pfl->head;
         pfl->nBlocksAvailable += pfl->nmalloc;
+        pfl->nBlocks += pfl->nmalloc;
     }
     ppnext = pfl->head;
     pfl->head = *ppnext;
     pfl->nBlocksAvailable--;
+    return(ptemp);
+}
+
+/* Refill an empty magazine from the shared list */
+static void magFill(FREELISTPVT *pfl, magazine *pmag)
+{
+    lockList(pfl);
+    while (pmag->count < pfl->magSize) {
+        void **ppnext = listGet(pfl);
+
+        if (!ppnext)
+            break;
+        *ppnext = pmag->head;
+        pmag->head = ppnext;
+        pmag->count++;
+    }
     epicsMutexUnlock(pfl->lock);
+}
+
+/* Return magSize blocks from a full magazine to the shared list */
+static void magDrain(FREELISTPVT *pfl, magazine *pmag)
+{
+    void **ppfirst = pmag->head;
+    void **pplast = ppfirst;
+    unsigned n;
+
+    for (n = 1; n < pfl->magSize; n++)
+        pplast = *pplast;
+    pmag->head = *pplast;
+    pmag->count -= pfl->magSize;
+
+    lockList(pfl);
+    *pplast = pfl->head;
+    pfl->head = ppfirst;
+    pfl->nBlocksAvailable += pfl->magSize;
+    epicsMutexUnlock(pfl->lock);
+}
+
+LIBCOM_API void * epicsStdCall freeListMalloc(void *pvt)
+{
+    FREELISTPVT *pfl = pvt;
+#   ifdef EPICS_FREELIST_DEBUG
+    return callocMustSucceed(1,pfl->size,"freeList Debug Malloc");
+#   else
+    void        *ptemp;
+    magazine    *pmag = pfl->mags ? magSelf(pfl) : NULL;
+
+    if (pmag) {
+        void **ppnext;
+
+        if (!pmag->count)
+            magFill(pfl, pmag);
+        ppnext = pmag->head;
+        if (!ppnext)
+            return(0);
+        pmag->head = *ppnext;
+        pmag->count--;
+        ptemp = ppnext;
+    }
+    else {
+        lockList(pfl);
+        ptemp = listGet(pfl);
+        epicsMutexUnlock(pfl->lock);
+        if(ptemp==0)
+            return(0);
+    }
     VALGRIND_MEMPOOL_FREE(pfl, ptemp);
     VALGRIND_MEMPOOL_ALLOC(pfl, ptemp, pfl->size);
     return(ptemp);
@@ -136,12 +303,22 @@ LIBCOM_API void epicsStdCall freeListFree(void *pvt,void*pmem)
     free(pmem);
 #   else
     void        **ppnext;
+    magazine    *pmag = pfl->mags ? magSelf(pfl) : NULL;
 
     VALGRIND_MEMPOOL_FREE(pvt, pmem);
     VALGRIND_MEMPOOL_ALLOC(pvt, pmem, sizeof(void*));
 
-    epicsMutexMustLock(pfl->lock);
     ppnext = pmem;
+    if (pmag) {
+        *ppnext = pmag->head;
+        pmag->head = pmem;
+        /* keep up to two transfers worth, for alternating malloc/free */
+        if (++pmag->count >= 2 * pfl->magSize)
+            magDrain(pfl, pmag);
+        return;
+    }
+
+    lockList(pfl);
     *ppnext = pfl->head;
     pfl->head = pmem;
     pfl->nBlocksAvailable++;
@@ -164,10 +341,41 @@ LIBCOM_API void epicsStdCall freeListCleanup(void *pvt)
         free(phead);
         phead = pnext;
     }
+    if (pfl->mags) {
+        int i;
+
+        for (i = 0; i < MAG_THREADS; i++)
+            free(pfl->mags[i]);
+        free(pfl->mags);
+    }
     epicsMutexDestroy(pfl->lock);
     free(pvt);
 }
 
+/* Blocks in all magazines.  Their owners don't lock them, so the result
+ * may be slightly out of date.
+ */
+static size_t magCount(FREELISTPVT *pfl, unsigned *pnThreads)
+{
+    size_t count = 0;
+    unsigned nThreads = 0;
+    int i;
+
+    if (pfl->mags) {
+        for (i = 0; i < MAG_THREADS; i++) {
+            const volatile magazine *pmag = pfl->mags[i];
+
+            if (pmag) {
+                count += pmag->count;
+                nThreads++;
+            }
+        }
+    }
+    if (pnThreads)
+        *pnThreads = nThreads;
+    return count;
+}
+
 LIBCOM_API size_t epicsStdCall freeListItemsAvail(void *pvt)
 {
     FREELISTPVT *pfl = pvt;
@@ -175,6 +383,32 @@ LIBCOM_API size_t epicsStdCall freeListItemsAvail(void *pvt)
     epicsMutexMustLock(pfl->lock);
     nBlocksAvailable = pfl->nBlocksAvailable;
     epicsMutexUnlock(pfl->lock);
-    return nBlocksAvailable;
+    return nBlocksAvailable + magCount(pfl, NULL);
 }
 
+LIBCOM_API void epicsStdCall freeListShow(void *pvt, unsigned level)
+{
+    FREELISTPVT *pfl = pvt;
+    size_t nBlocks, nAvailable, nCached, nLocks, nContended;
+    unsigned nThreads;
+
+    epicsMutexMustLock(pfl->lock);
+    nBlocks = pfl->nBlocks;
+    nAvailable = pfl->nBlocksAvailable;
+    nLocks = pfl->nLocks;
+    nContended = pfl->nContended;
+    epicsMutexUnlock(pfl->lock);
+    nCached = magCount(pfl, &nThreads);
+
+    printf("freeList %p: %d byte blocks, %lu allocated, %lu in use, "
+        "%lu free\n", pvt, pfl->size, (unsigned long) nBlocks,
+        (unsigned long) (nBlocks - nAvailable - nCached),
+        (unsigned long) (nAvailable + nCached));
+    if (level >= 1) {
+        if (pfl->mags)
+            printf("    %lu of the free blocks in %u thread magazines of %u\n",
+                (unsigned long) nCached, nThreads, pfl->magSize);
+        printf("    %lu of %lu lock operations contended\n",
+            (unsigned long) nContended, (unsigned long) nLocks);
+    }
+}
@@ -10,6 +10,9 @@
 /* Author:  Marty Kraimer Date:    04-07-94 */
 
 /* gph provides a general purpose directory accessed via a hash table*/
+/* The table grows as entries are added.  gphFind() and gphFindParse()
+ * take no lock, and may run while another thread adds or deletes entries.
+ */
 
 #ifndef INC_gpHash_H
 #define INC_gpHash_H
@@ -19,7 +22,7 @@
 #include "ellLib.h"
 
 typedef struct{
-    ELLNODE     node;
+    ELLNODE     node;          /*unused*/
     const char  *name;          /*address of name placed in directory*/
     void        *pvtid;         /*private name for subsystem user*/
     void        *userPvt;       /*private for user*/
@@ -15,6 +15,8 @@
 #include <stddef.h>
 
 #include "cantProceed.h"
+#include "epicsAtomic.h"
+#include "epicsEvent.h"
 #include "epicsMutex.h"
 #include "epicsStdioRedirect.h"
 #include "epicsString.h"
@@ -23,18 +25,139 @@
 #include "epicsPrint.h"
 #include "gpHash.h"
 
-typedef struct gphPvt {
-    int size;
+/*
+ * Open addressing with linear probing.  Each slot keeps the hash of its
+ * entry, so a probe only looks at entries with a matching hash.  The table
+ * grows by building a larger copy, so lookups take no lock.  Replaced
+ * tables and deleted entries are freed once no lookup which started
+ * before they were removed is still running.
+ */
+typedef struct gphSlot {
+    unsigned int hash;
+    GPHENTRY *pentry;       /* NULL if never used */
+} gphSlot;
+
+typedef struct gphTable {
     unsigned int mask;
-    ELLLIST **paplist; /*pointer to array of pointers to ELLLIST */
-    epicsMutexId lock;
+    gphSlot slot[1];
+} gphTable;
+
+typedef struct gphPvt {
+    gphTable *ptable;
+    unsigned int count;     /* entries */
+    unsigned int used;      /* slots of entries and deleted entries */
+    int epoch;              /* lookups starting now count in readers[epoch] */
+    int readers[2];
+    int waiting;            /* a change waits for readers to drain */
+    epicsEventId drained;   /* signalled by the last reader while waiting */
+    epicsMutexId lock;      /* serializes changes */
 } gphPvt;
 
+/* Marks the slot of a deleted entry */
+static GPHENTRY deleted;
+
 #define MIN_SIZE 256
 #define DEFAULT_SIZE 512
-#define MAX_SIZE 65536
 
 
+static unsigned int hashName(const char *name, size_t len, void *pvtid)
+{
+    unsigned int hash = epicsMemHash((char *)&pvtid, sizeof(void *), 0);
+
+    hash = epicsMemHash(name, len, hash);
+    /* Mix all bits into the low ones used as the index */
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3bu;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static gphTable * tableCreate(unsigned int size)
+{
+    gphTable *ptable = calloc(1, sizeof(gphTable) + (size - 1) * sizeof(gphSlot));
+
+    if (ptable)
+        ptable->mask = size - 1;
+    return ptable;
+}
+
+static int readBegin(gphPvt *pgphPvt)
+{
+    for (;;) {
+        int epoch = epicsAtomicGetIntT(&pgphPvt->epoch);
+
+        epicsAtomicIncrIntT(&pgphPvt->readers[epoch]);
+        if (epicsAtomicGetIntT(&pgphPvt->epoch) == epoch)
+            return epoch;
+        epicsAtomicDecrIntT(&pgphPvt->readers[epoch]);
+    }
+}
+
+static void readEnd(gphPvt *pgphPvt, int epoch)
+{
+    if (epicsAtomicDecrIntT(&pgphPvt->readers[epoch]) == 0 &&
+        epicsAtomicGetIntT(&pgphPvt->waiting))
+        epicsEventSignal(pgphPvt->drained);
+}
+
+/* Wait for lookups which may still see something just removed.  This
+ * blocks rather than polls, so a reader of lower priority gets to finish.
+ * Requires pgphPvt->lock.
+ */
+static void synchronize(gphPvt *pgphPvt)
+{
+    int epoch = pgphPvt->epoch;
+
+    epicsAtomicCmpAndSwapIntT(&pgphPvt->epoch, epoch, !epoch);
+    epicsAtomicSetIntT(&pgphPvt->waiting, 1);
+    while (epicsAtomicGetIntT(&pgphPvt->readers[epoch]))
+        epicsEventWaitWithTimeout(pgphPvt->drained, 1.0);
+    epicsAtomicSetIntT(&pgphPvt->waiting, 0);
+}
+
+static void slotSet(gphSlot *pslot, unsigned int hash, GPHENTRY *pentry)
+{
+    pslot->hash = hash;
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetPtrT((EpicsAtomicPtrT *)&pslot->pentry, pentry);
+}
+
+/* Requires pgphPvt->lock */
+static int tableGrow(gphPvt *pgphPvt)
+{
+    gphTable *old = pgphPvt->ptable;
+    gphTable *ptable;
+    unsigned int size = old->mask + 1;
+    unsigned int h;
+
+    /* Rehash at 3/4 full, to a table at most half full */
+    if ((pgphPvt->used + 1) * 4 <= size * 3)
+        return 0;
+    while (size < (pgphPvt->count + 1) * 2)
+        size <<= 1;
+
+    ptable = tableCreate(size);
+    if (!ptable)
+        return -1;
+    for (h = 0; h <= old->mask; h++) {
+        gphSlot *pslot = &old->slot[h];
+        unsigned int i;
+
+        if (!pslot->pentry || pslot->pentry == &deleted)
+            continue;
+        for (i = pslot->hash & ptable->mask; ptable->slot[i].pentry;
+             i = (i + 1) & ptable->mask);
+        ptable->slot[i] = *pslot;
+    }
+    pgphPvt->used = pgphPvt->count;
+
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetPtrT((EpicsAtomicPtrT *)&pgphPvt->ptable, ptable);
+    synchronize(pgphPvt);
+    free(old);
+    return 0;
+}
+
 void epicsStdCall gphInitPvt(gphPvt **ppvt, int size)
 {
     gphPvt *pgphPvt;
@@ -44,49 +167,47 @@ void epicsStdCall gphInitPvt(gphPvt **ppvt, int size)
         size = DEFAULT_SIZE;
     }
 
+    /* This is only the initial size, the table grows as needed */
     if (size < MIN_SIZE)
         size = MIN_SIZE;
 
-    if (size > MAX_SIZE)
-        size = MAX_SIZE;
-
     pgphPvt = callocMustSucceed(1, sizeof(gphPvt), "gphInitPvt");
-    pgphPvt->size = size;
-    pgphPvt->mask = size - 1;
-    pgphPvt->paplist = callocMustSucceed(size, sizeof(ELLLIST *), "gphInitPvt");
+    pgphPvt->ptable = tableCreate(size);
+    if (!pgphPvt->ptable)
+        cantProceed("gphInitPvt: Out of memory\n");
     pgphPvt->lock = epicsMutexMustCreate();
+    pgphPvt->drained = epicsEventMustCreate(epicsEventEmpty);
     *ppvt = pgphPvt;
     return;
 }
 
 GPHENTRY * epicsStdCall gphFindParse(gphPvt *pgphPvt, const char *name, size_t len, void *pvtid)
 {
-    ELLLIST **paplist;
-    ELLLIST *gphlist;
+    gphTable *ptable;
     GPHENTRY *pgphNode;
-    int hash;
+    unsigned int hash, i;
+    int epoch;
 
     if (pgphPvt == NULL) return NULL;
-    paplist = pgphPvt->paplist;
-    hash = epicsMemHash((char *)&pvtid, sizeof(void *), 0);
-    hash = epicsMemHash(name, len, hash) & pgphPvt->mask;
+    hash = hashName(name, len, pvtid);
 
-    epicsMutexMustLock(pgphPvt->lock);
-    gphlist = paplist[hash];
-    if (gphlist == NULL) {
-        pgphNode = NULL;
-    } else {
-        pgphNode = (GPHENTRY *) ellFirst(gphlist);
-    }
+    epoch = readBegin(pgphPvt);
+    ptable = epicsAtomicGetPtrT((EpicsAtomicPtrT *)&pgphPvt->ptable);
+    epicsAtomicReadMemoryBarrier();
+    for (i = hash & ptable->mask; ; i = (i + 1) & ptable->mask) {
+        gphSlot *pslot = &ptable->slot[i];
 
-    while (pgphNode) {
-        if (pvtid == pgphNode->pvtid &&
-            strlen(pgphNode->name) == len &&
-            strncmp(name, pgphNode->name, len) == 0) break;
-        pgphNode = (GPHENTRY *) ellNext((ELLNODE *)pgphNode);
+        pgphNode = epicsAtomicGetPtrT((EpicsAtomicPtrT *)&pslot->pentry);
+        if (!pgphNode)
+            break;
+        epicsAtomicReadMemoryBarrier();
+        if (pslot->hash == hash && pgphNode != &deleted &&
+            pvtid == pgphNode->pvtid &&
+            strncmp(name, pgphNode->name, len) == 0 &&
+            pgphNode->name[len] == '\0')
+            break;
     }
-
-    epicsMutexUnlock(pgphPvt->lock);
+    readEnd(pgphPvt, epoch);
     return pgphNode;
 }
 
@@ -97,43 +218,48 @@ GPHENTRY * epicsStdCall gphFind(gphPvt *pgphPvt, const char *name, void *pvtid)
 
 GPHENTRY * epicsStdCall gphAdd(gphPvt *pgphPvt, const char *name, void *pvtid)
 {
-    ELLLIST **paplist;
-    ELLLIST *plist;
+    gphTable *ptable;
+    gphSlot *pfree = NULL;
     GPHENTRY *pgphNode;
-    int hash;
+    unsigned int hash, i;
 
     if (pgphPvt == NULL) return NULL;
-    paplist = pgphPvt->paplist;
-    hash = epicsMemHash((char *)&pvtid, sizeof(void *), 0);
-    hash = epicsStrHash(name, hash) & pgphPvt->mask;
+    hash = hashName(name, strlen(name), pvtid);
 
     epicsMutexMustLock(pgphPvt->lock);
-    plist = paplist[hash];
-    if (plist == NULL) {
-        plist = calloc(1, sizeof(ELLLIST));
-        if(!plist){
-            epicsMutexUnlock(pgphPvt->lock);
-            return NULL;
-        }
-        ellInit(plist);
-        paplist[hash] = plist;
+    if (tableGrow(pgphPvt)) {
+        epicsMutexUnlock(pgphPvt->lock);
+        return NULL;
     }
+    ptable = pgphPvt->ptable;
+
+    for (i = hash & ptable->mask; ; i = (i + 1) & ptable->mask) {
+        gphSlot *pslot = &ptable->slot[i];
 
-    pgphNode = (GPHENTRY *) ellFirst(plist);
-    while (pgphNode) {
-        if (pvtid == pgphNode->pvtid &&
+        pgphNode = pslot->pentry;
+        if (!pgphNode)
+            break;
+        if (pgphNode == &deleted) {
+            if (!pfree)
+                pfree = pslot;
+        }
+        else if (pslot->hash == hash && pvtid == pgphNode->pvtid &&
             strcmp(name, pgphNode->name) == 0) {
             epicsMutexUnlock(pgphPvt->lock);
             return NULL;
         }
-        pgphNode = (GPHENTRY *) ellNext((ELLNODE *)pgphNode);
     }
 
     pgphNode = calloc(1, sizeof(GPHENTRY));
     if(pgphNode) {
         pgphNode->name = name;
         pgphNode->pvtid = pvtid;
-        ellAdd(plist, (ELLNODE *)pgphNode);
+        if (!pfree) {
+            pfree = &ptable->slot[i];
+            pgphPvt->used++;
+        }
+        slotSet(pfree, hash, pgphNode);
+        pgphPvt->count++;
     }
 
     epicsMutexUnlock(pgphPvt->lock);
@@ -142,32 +268,30 @@ GPHENTRY * epicsStdCall gphAdd(gphPvt *pgphPvt, const char *name, void *pvtid)
 
 void epicsStdCall gphDelete(gphPvt *pgphPvt, const char *name, void *pvtid)
 {
-    ELLLIST **paplist;
-    ELLLIST *plist = NULL;
+    gphTable *ptable;
     GPHENTRY *pgphNode;
-    int hash;
+    unsigned int hash, i;
 
     if (pgphPvt == NULL) return;
-    paplist = pgphPvt->paplist;
-    hash = epicsMemHash((char *)&pvtid, sizeof(void *), 0);
-    hash = epicsStrHash(name, hash) & pgphPvt->mask;
+    hash = hashName(name, strlen(name), pvtid);
 
     epicsMutexMustLock(pgphPvt->lock);
-    if (paplist[hash] == NULL) {
-        pgphNode = NULL;
-    } else {
-        plist = paplist[hash];
-        pgphNode = (GPHENTRY *) ellFirst(plist);
-    }
+    ptable = pgphPvt->ptable;
+    for (i = hash & ptable->mask; ; i = (i + 1) & ptable->mask) {
+        gphSlot *pslot = &ptable->slot[i];
 
-    while(pgphNode) {
-        if (pvtid == pgphNode->pvtid &&
+        pgphNode = pslot->pentry;
+        if (!pgphNode)
+            break;
+        if (pgphNode != &deleted && pslot->hash == hash &&
+            pvtid == pgphNode->pvtid &&
             strcmp(name, pgphNode->name) == 0) {
-            ellDelete(plist, (ELLNODE*)pgphNode);
+            epicsAtomicSetPtrT((EpicsAtomicPtrT *)&pslot->pentry, &deleted);
+            pgphPvt->count--;
+            synchronize(pgphPvt);
             free((void *)pgphNode);
             break;
         }
-        pgphNode = (GPHENTRY *) ellNext((ELLNODE*)pgphNode);
     }
 
     epicsMutexUnlock(pgphPvt->lock);
@@ -176,31 +300,22 @@ void epicsStdCall gphDelete(gphPvt *pgphPvt, const char *name, void *pvtid)
 
 void epicsStdCall gphFreeMem(gphPvt *pgphPvt)
 {
-    ELLLIST **paplist;
-    int h;
+    gphTable *ptable;
+    unsigned int h;
 
     /* Caller must ensure that no other thread is using *pvt */
     if (pgphPvt == NULL) return;
 
-    paplist = pgphPvt->paplist;
-    for (h = 0; h < pgphPvt->size; h++) {
-        ELLLIST *plist = paplist[h];
-        GPHENTRY *pgphNode;
-        GPHENTRY *next;
+    ptable = pgphPvt->ptable;
+    for (h = 0; h <= ptable->mask; h++) {
+        GPHENTRY *pgphNode = ptable->slot[h].pentry;
 
-        if (plist == NULL) continue;
-        pgphNode = (GPHENTRY *) ellFirst(plist);
-
-        while (pgphNode) {
-            next = (GPHENTRY *) ellNext((ELLNODE*)pgphNode);
-            ellDelete(plist, (ELLNODE*)pgphNode);
+        if (pgphNode && pgphNode != &deleted)
             free(pgphNode);
-            pgphNode = next;
-        }
-        free(paplist[h]);
     }
     epicsMutexDestroy(pgphPvt->lock);
-    free(paplist);
+    epicsEventDestroy(pgphPvt->drained);
+    free(ptable);
     free(pgphPvt);
 }
 
@@ -211,34 +326,36 @@ void epicsStdCall gphDump(gphPvt *pgphPvt)
 
 void epicsStdCall gphDumpFP(FILE *fp, gphPvt *pgphPvt)
 {
-    unsigned int empty = 0;
-    ELLLIST **paplist;
-    int h;
+    gphTable *ptable;
+    unsigned int h, probe, longest = 0;
+    double total = 0;
+    int i = 0;
 
     if (pgphPvt == NULL)
         return;
 
-    fprintf(fp, "Hash table has %d buckets", pgphPvt->size);
+    epicsMutexMustLock(pgphPvt->lock);
+    ptable = pgphPvt->ptable;
+    fprintf(fp, "Hash table has %u entries in %u slots",
+        pgphPvt->count, ptable->mask + 1);
 
-    paplist = pgphPvt->paplist;
-    for (h = 0; h < pgphPvt->size; h++) {
-        ELLLIST *plist = paplist[h];
-        GPHENTRY *pgphNode;
-        int i = 0;
+    for (h = 0; h <= ptable->mask; h++) {
+        gphSlot *pslot = &ptable->slot[h];
 
-        if (plist == NULL) {
-            empty++;
+        if (!pslot->pentry || pslot->pentry == &deleted)
             continue;
-        }
-        pgphNode = (GPHENTRY *) ellFirst(plist);
-
-        fprintf(fp, "\n [%3d] %3d  ", h, ellCount(plist));
-        while (pgphNode) {
-            if (!(++i % 3))
-                fprintf(fp, "\n            ");
-            fprintf(fp, "  %s %p", pgphNode->name, pgphNode->pvtid);
-            pgphNode = (GPHENTRY *) ellNext((ELLNODE*)pgphNode);
-        }
+        probe = (h - pslot->hash) & ptable->mask;
+        if (probe > longest)
+            longest = probe;
+        total += probe;
+        if (!(i++ % 3))
+            fprintf(fp, "\n ");
+        fprintf(fp, "  %s %p", pslot->pentry->name, pslot->pentry->pvtid);
     }
-    fprintf(fp, "\n%u buckets empty.\n", empty);
+    fprintf(fp, "\n%u slots hold deleted entries.\n",
+        pgphPvt->used - pgphPvt->count);
+    fprintf(fp, "Entries are on average %.2f and at most %u slots"
+        " past their hash.\n", pgphPvt->count ? total / pgphPvt->count : 0.0,
+        longest);
+    epicsMutexUnlock(pgphPvt->lock);
 }
@@ -25,6 +25,7 @@
 #include "taskwd.h"
 #include "registry.h"
 #include "epicsGeneralTime.h"
+#include "dbmf.h"
 #include "libComRegister.h"
 
 /* Register the PWD environment variable when the cd IOC shell function is
@@ -242,6 +243,16 @@ static void iocLogShowCallFunc(const iocshArgBuf *args)
     iocLogShow (args[0].ival);
 }
 
+/* dbmfShow */
+static const iocshArg dbmfShowArg0 = {"level",iocshArgInt};
+static const iocshArg * const dbmfShowArgs[1] = {&dbmfShowArg0};
+static const iocshFuncDef dbmfShowFuncDef = {"dbmfShow",1,dbmfShowArgs,
+                                             "Show the memory used while loading databases\n"};
+static void dbmfShowCallFunc(const iocshArgBuf *args)
+{
+    dbmfShow (args[0].ival);
+}
+
 /* eltc */
 static const iocshArg eltcArg0 = {"(0,1)=>(false,true)",iocshArgInt};
 static const iocshArg * const eltcArgs[1] = {&eltcArg0};
@@ -488,6 +499,7 @@ void epicsStdCall libComRegister(void)
     iocshRegister(&iocLogInitFuncDef, iocLogInitCallFunc);
     iocshRegister(&iocLogDisableFuncDef, iocLogDisableCallFunc);
     iocshRegister(&iocLogShowFuncDef, iocLogShowCallFunc);
+    iocshRegister(&dbmfShowFuncDef, dbmfShowCallFunc);
     iocshRegister(&eltcFuncDef, eltcCallFunc);
     iocshRegister(&errlogInitFuncDef,errlogInitCallFunc);
     iocshRegister(&errlogInit2FuncDef,errlogInit2CallFunc);
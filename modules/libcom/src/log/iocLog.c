@@ -109,6 +109,15 @@ static logClientId iocLogClientInit (void)
     }
     id = logClientCreate (addr, port);
     if (id != NULL) {
+        const char *spool = envGetConfigParamPtr (&EPICS_IOC_LOG_SPOOL_FILE);
+
+        if (spool) {
+            long limit = 1000000;
+
+            envGetLongConfigParam (&EPICS_IOC_LOG_SPOOL_LIMIT, &limit);
+            if (limit > 0)
+                logClientSpool (id, spool, (size_t) limit);
+        }
         errlogAddListener (logClientSendMessage, id);
         epicsAtExit (iocLogClientDestroy, id);
     }
@@ -17,6 +17,7 @@
  */
 #include <stdlib.h>
 #include <stddef.h>
+#include <errno.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -38,26 +39,65 @@
 int logClientDebug = 0;
 epicsExportAddress (int, logClientDebug);
 
+/* Size of each of the two message buffers of a new client */
+int logClientBufferSize = 0x4000;
+epicsExportAddress (int, logClientBufferSize);
+
+/* Longest time messages wait to be sent together */
+double logClientFlushDelay = 0.2; /* sec */
+epicsExportAddress (double, logClientFlushDelay);
+
+/*
+ * Messages are appended to msgBuf by logClientSend().  The sender thread
+ * moves them to sendBuf in bulk and writes them out without holding the
+ * mutex.  While the server can't be reached, messages which don't fit in
+ * msgBuf go to the spool file, and so do all messages after them until
+ * the spool has been replayed.  The spool file is a ring of spoolLimit
+ * bytes, so it doesn't grow while messages keep arriving during a replay.
+ * It is only accessed with the spoolMutex, never while holding the mutex.  Messages too long for msgBuf
+ * are sent in pieces straight from sendBuf.
+ */
 typedef struct {
-    char                msgBuf[0x4000];
+    char               *msgBuf;
+    char               *sendBuf;
+    unsigned            bufSize;
     struct sockaddr_in  addr;
     char                name[64];
     epicsMutexId        mutex;
+    epicsMutexId        sendMutex;  /* sendBuf, sendLen and backlog */
+    epicsMutexId        spoolMutex; /* spool, spoolRead, spoolUsed, spoolPos */
     SOCKET              sock;
     epicsThreadId       restartThreadId;
     epicsEventId        stateChangeNotify;
-    epicsEventId        shutdownNotify;
+    epicsEventId        senderWakeup;
     unsigned            connectCount;
     unsigned            nextMsgIndex;
+    unsigned            sendLen;
     unsigned            backlog;
+    unsigned            unsentLen;  /* sendLen - backlog after a send */
     unsigned            connected;
     unsigned            shutdown;
     unsigned            shutdownConfirm;
+    unsigned            urgent;
+    unsigned            spooling;   /* spool has messages to replay */
+    unsigned            spoolWriters;
     int                 connFailStatus;
+    epicsTimeStamp      firstPending;
+    FILE               *spool;
+    char               *spoolName;
+    size_t              spoolLimit;
+    size_t              spoolRead;  /* file offset of the oldest byte */
+    size_t              spoolUsed;
+    long                spoolPos;   /* after the last write, -1 if unknown */
+    unsigned long       nLost;
+    unsigned long       nSends;
+    double              bytesSent;
 } logClient;
 
 static const double      LOG_RESTART_DELAY = 5.0; /* sec */
 static const double      LOG_SERVER_SHUTDOWN_TIMEOUT = 30.0; /* sec */
+static const double      LOG_FLUSH_MIN_INTERVAL = 0.05; /* sec */
+static const int         LOG_LONG_MESSAGE_WAITS = 20;
 
 /*
  * If set using iocLogPrefix() this string is prepended to all log messages:
@@ -113,7 +153,7 @@ static void logClientDestroy (logClientId id)
     epicsMutexMustLock ( pClient->mutex );
     pClient->shutdown = 1u;
     epicsMutexUnlock ( pClient->mutex );
-    epicsEventSignal ( pClient->shutdownNotify );
+    epicsEventSignal ( pClient->senderWakeup );
 
     /* unblock log client thread blocking in send() or connect() */
     interruptInfo =
@@ -158,84 +198,272 @@ static void logClientDestroy (logClientId id)
     logClientClose ( pClient );
 
     epicsMutexDestroy ( pClient->mutex );
+    epicsMutexDestroy ( pClient->sendMutex );
+    epicsMutexDestroy ( pClient->spoolMutex );
     epicsEventDestroy ( pClient->stateChangeNotify );
-    epicsEventDestroy ( pClient->shutdownNotify );
+    epicsEventDestroy ( pClient->senderWakeup );
 
+    if ( pClient->spool ) {
+        fclose ( pClient->spool );
+    }
+    free ( pClient->spoolName );
+    free ( pClient->msgBuf );
+    free ( pClient->sendBuf );
     free ( pClient );
 }
 
 /*
- * This method requires the pClient->mutex be owned already.
+ * Requires the pClient->mutex.  Bytes which the kernel has accepted but
+ * not yet sent don't count, they are kept in sendBuf only to be sent
+ * again after a reconnect.
  */
-static void sendMessageChunk(logClient * pClient, const char * message) {
-    unsigned strSize;
+static int logClientPending ( const logClient * pClient )
+{
+    return pClient->nextMsgIndex > 0u || pClient->unsentLen > 0u ||
+        pClient->spooling;
+}
 
-    strSize = strlen ( message );
-    while ( strSize ) {
-        unsigned msgBufBytesLeft =
-            sizeof ( pClient->msgBuf ) - pClient->nextMsgIndex;
+/*
+ * These methods require the pClient->spoolMutex.
+ */
+/* Write at offset *pOffset of the ring, wrapping at spoolLimit */
+static int spoolPut ( logClient * pClient, size_t * pOffset,
+    const char * buf, size_t len )
+{
+    while ( len > 0u ) {
+        size_t n = pClient->spoolLimit - *pOffset;
 
-        if ( msgBufBytesLeft < strSize && pClient->nextMsgIndex != 0u && pClient->connected)
-        {
-            /* buffer is full, thus flush it */
-            logClientFlush ( pClient );
-            msgBufBytesLeft = sizeof ( pClient->msgBuf ) - pClient->nextMsgIndex;
+        if ( n > len ) {
+            n = len;
         }
-        if ( msgBufBytesLeft == 0u ) {
-            fprintf ( stderr, "log client: messages to \"%s\" are lost\n",
-                pClient->name );
-            break;
+        /* consecutive writes don't seek, so stdio can buffer them */
+        if ( pClient->spoolPos != (long) *pOffset &&
+                fseek ( pClient->spool, (long) *pOffset, SEEK_SET ) ) {
+            return 0;
+        }
+        if ( fwrite ( buf, 1, n, pClient->spool ) != n ) {
+            pClient->spoolPos = -1;
+            return 0;
+        }
+        pClient->spoolPos = (long) ( *pOffset + n );
+        *pOffset = ( *pOffset + n ) % pClient->spoolLimit;
+        buf += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int spoolAppend ( logClient * pClient, const char * prefix,
+    size_t prefixLen, const char * message, size_t msgLen )
+{
+    size_t offset;
+
+    if ( ! pClient->spool || ! pClient->spoolLimit || pClient->spoolUsed +
+            prefixLen + msgLen > pClient->spoolLimit ) {
+        return 0;
+    }
+    offset = ( pClient->spoolRead + pClient->spoolUsed ) % pClient->spoolLimit;
+    if ( ! spoolPut ( pClient, & offset, prefix, prefixLen ) ||
+            ! spoolPut ( pClient, & offset, message, msgLen ) ) {
+        /* the next write overwrites what was written in part */
+        fprintf ( stderr, "log client: can't write spool file '%s'\n",
+            pClient->spoolName );
+        return 0;
+    }
+    pClient->spoolUsed += prefixLen + msgLen;
+    return 1;
+}
+
+static unsigned spoolRead ( logClient * pClient, char * buf, unsigned space )
+{
+    size_t got = 0u;
+
+    if ( space > pClient->spoolUsed ) {
+        space = (unsigned) pClient->spoolUsed;
+    }
+    while ( got < space ) {
+        size_t n = pClient->spoolLimit - pClient->spoolRead;
+
+        if ( n > space - got ) {
+            n = space - got;
         }
-        if ( msgBufBytesLeft > strSize) msgBufBytesLeft = strSize;
-        memcpy ( & pClient->msgBuf[pClient->nextMsgIndex],
-            message, msgBufBytesLeft );
-        pClient->nextMsgIndex += msgBufBytesLeft;
-        strSize -= msgBufBytesLeft;
-        message += msgBufBytesLeft;
+        /* a read after a write must seek */
+        pClient->spoolPos = -1;
+        if ( fseek ( pClient->spool, (long) pClient->spoolRead, SEEK_SET ) ||
+                fread ( & buf[got], 1, n, pClient->spool ) != n ) {
+            fprintf ( stderr, "log client: can't read spool file '%s'"
+                " - spooled messages are lost\n", pClient->spoolName );
+            pClient->spoolRead = pClient->spoolUsed = 0u;
+            return 0u;
+        }
+        pClient->spoolRead = ( pClient->spoolRead + n ) % pClient->spoolLimit;
+        pClient->spoolUsed -= n;
+        got += n;
     }
+    return (unsigned) got;
+}
+
+/*
+ * Requires the pClient->mutex.  Returns 1 if the message was queued in
+ * msgBuf, 0 if it doesn't fit.
+ */
+static int appendMessage ( logClient * pClient, const char * prefix,
+    size_t prefixLen, const char * message, size_t msgLen )
+{
+    if ( pClient->bufSize - pClient->nextMsgIndex < prefixLen + msgLen ) {
+        return 0;
+    }
+    memcpy ( & pClient->msgBuf[pClient->nextMsgIndex], prefix, prefixLen );
+    pClient->nextMsgIndex += prefixLen;
+    memcpy ( & pClient->msgBuf[pClient->nextMsgIndex], message, msgLen );
+    pClient->nextMsgIndex += msgLen;
+    return 1;
 }
 
+static void logClientSendLong ( logClient * pClient, const char * prefix,
+    size_t prefixLen, const char * message, size_t msgLen );
+
 /*
  * logClientSend ()
  */
 void epicsStdCall logClientSend ( logClientId id, const char * message )
 {
     logClient * pClient = ( logClient * ) id;
+    const char * prefix = logClientPrefix ? logClientPrefix : "";
+    size_t prefixLen, msgLen;
+    int wasPending, ok = 0, toSpool = 0, wakeup;
 
     if ( ! pClient || ! message ) {
         return;
     }
+    prefixLen = strlen ( prefix );
+    msgLen = strlen ( message );
 
     epicsMutexMustLock ( pClient->mutex );
 
-    if (logClientPrefix) {
-        sendMessageChunk(pClient, logClientPrefix);
+    wasPending = logClientPending ( pClient );
+    if ( ! pClient->spooling ) {
+        ok = appendMessage ( pClient, prefix, prefixLen, message, msgLen );
+    }
+    if ( ! ok && ! pClient->spooling && pClient->connected ) {
+        epicsMutexUnlock ( pClient->mutex );
+        if ( prefixLen + msgLen > pClient->bufSize ) {
+            logClientSendLong ( pClient, prefix, prefixLen, message, msgLen );
+            return;
+        }
+        /* buffer is full, thus flush it */
+        logClientFlush ( pClient );
+        epicsMutexMustLock ( pClient->mutex );
+        wasPending = logClientPending ( pClient );
+        if ( ! pClient->spooling ) {
+            ok = appendMessage ( pClient, prefix, prefixLen, message, msgLen );
+        }
+    }
+    if ( ! ok && pClient->spool &&
+            ( pClient->spooling || ! pClient->connected ) ) {
+        /* this and all later messages go to the spool until it's replayed */
+        pClient->spooling = 1u;
+        pClient->spoolWriters++;
+        toSpool = 1;
+    }
+    else if ( ! ok ) {
+        pClient->nLost++;
     }
-    sendMessageChunk(pClient, message);
 
-    epicsMutexUnlock (pClient->mutex);
-}
+    if ( ! wasPending && ! toSpool ) {
+        epicsTimeGetMonotonic ( & pClient->firstPending );
+    }
+    if ( pClient->nextMsgIndex >= pClient->bufSize / 2u ) {
+        pClient->urgent = 1u;
+    }
+    wakeup = ! wasPending || pClient->urgent;
 
+    epicsMutexUnlock ( pClient->mutex );
 
-void epicsStdCall logClientFlush ( logClientId id )
-{
-    unsigned nSent;
-    int status = 0;
+    if ( toSpool ) {
+        int last;
 
-    logClient * pClient = ( logClient * ) id;
+        epicsMutexMustLock ( pClient->spoolMutex );
+        ok = spoolAppend ( pClient, prefix, prefixLen, message, msgLen );
 
-    if ( ! pClient || ! pClient->connected ) {
-        return;
+        epicsMutexMustLock ( pClient->mutex );
+        last = --pClient->spoolWriters == 0u;
+        if ( ! ok ) {
+            pClient->nLost++;
+        }
+        epicsMutexUnlock ( pClient->mutex );
+
+        /* threads spooling at once leave the writing to the last one */
+        if ( last && pClient->spoolPos >= 0 ) {
+            fflush ( pClient->spool );
+        }
+        epicsMutexUnlock ( pClient->spoolMutex );
+    }
+
+    if ( wakeup ) {
+        epicsEventSignal ( pClient->senderWakeup );
     }
+}
+
+/*
+ * Move messages to the free space of sendBuf, oldest first.  Returns the
+ * number of bytes moved.  Requires the pClient->sendMutex.
+ */
+static unsigned logClientFill ( logClient * pClient )
+{
+    unsigned n, nSpool = 0u;
+    int replay;
 
     epicsMutexMustLock ( pClient->mutex );
 
+    n = pClient->bufSize - pClient->sendLen;
+    if ( n > pClient->nextMsgIndex ) {
+        n = pClient->nextMsgIndex;
+    }
+    if ( n > 0u ) {
+        memcpy ( & pClient->sendBuf[pClient->sendLen], pClient->msgBuf, n );
+        pClient->sendLen += n;
+        pClient->nextMsgIndex -= n;
+        memmove ( pClient->msgBuf, & pClient->msgBuf[n], pClient->nextMsgIndex );
+    }
+    replay = pClient->nextMsgIndex == 0u && pClient->spooling;
+    pClient->urgent = 0u;
+
+    epicsMutexUnlock ( pClient->mutex );
+
+    if ( replay ) {
+        epicsMutexMustLock ( pClient->spoolMutex );
+        nSpool = spoolRead ( pClient, & pClient->sendBuf[pClient->sendLen],
+            pClient->bufSize - pClient->sendLen );
+        pClient->sendLen += nSpool;
+        if ( pClient->spoolUsed == 0u ) {
+            epicsMutexMustLock ( pClient->mutex );
+            if ( ! pClient->spoolWriters ) {
+                pClient->spooling = 0u;
+            }
+            epicsMutexUnlock ( pClient->mutex );
+        }
+        epicsMutexUnlock ( pClient->spoolMutex );
+    }
+    return n + nSpool;
+}
+
+/*
+ * Requires the pClient->sendMutex.  Returns 0 if the connection was lost.
+ */
+static int logClientSendBuf ( logClient * pClient )
+{
+    unsigned nSent;
+    int status = 0;
+
     nSent = pClient->backlog;
-    while ( nSent < pClient->nextMsgIndex && pClient->connected ) {
-        status = send ( pClient->sock, pClient->msgBuf + nSent,
-            pClient->nextMsgIndex - nSent, 0 );
+    while ( nSent < pClient->sendLen && pClient->connected ) {
+        status = send ( pClient->sock, pClient->sendBuf + nSent,
+            pClient->sendLen - nSent, 0 );
         if ( status < 0 ) break;
         nSent += status;
+        pClient->nSends++;
+        pClient->bytesSent += status;
     }
 
     if ( pClient->backlog > 0 && status >= 0 ) {
@@ -255,20 +483,177 @@ void epicsStdCall logClientFlush ( logClientId id )
         }
         pClient->backlog = 0;
         logClientClose ( pClient );
+        return 0;
     }
-    else if ( nSent > 0 && pClient->nextMsgIndex > 0 ) {
+    else if ( nSent > 0 && pClient->sendLen > 0 ) {
         int backlog = epicsSocketUnsentCount ( pClient->sock );
         if (backlog >= 0) {
             pClient->backlog = backlog;
             nSent -= backlog;
         }
-        pClient->nextMsgIndex -= nSent;
-        if ( nSent > 0 && pClient->nextMsgIndex > 0 ) {
-            memmove ( pClient->msgBuf, & pClient->msgBuf[nSent],
-                pClient->nextMsgIndex );
+        pClient->sendLen -= nSent;
+        if ( nSent > 0 && pClient->sendLen > 0 ) {
+            memmove ( pClient->sendBuf, & pClient->sendBuf[nSent],
+                pClient->sendLen );
         }
     }
+
+    epicsMutexMustLock ( pClient->mutex );
+    pClient->unsentLen = pClient->sendLen - pClient->backlog;
     epicsMutexUnlock ( pClient->mutex );
+
+    return pClient->connected;
+}
+
+/*
+ * Send everything queued, until the connection is lost or the server
+ * stops reading so sendBuf can't take more.  Requires the pClient->sendMutex.
+ */
+static void logClientSendAll ( logClient * pClient )
+{
+    unsigned long nLost;
+    unsigned moved;
+    int more;
+
+    do {
+        moved = logClientFill ( pClient );
+        if ( ! logClientSendBuf ( pClient ) ) {
+            break;
+        }
+        epicsMutexMustLock ( pClient->mutex );
+        more = pClient->nextMsgIndex > 0u || pClient->spooling;
+        nLost = pClient->nLost;
+        pClient->nLost = 0u;
+        epicsMutexUnlock ( pClient->mutex );
+
+        if ( nLost ) {
+            fprintf ( stderr, "log client: %lu messages to \"%s\" were lost\n",
+                nLost, pClient->name );
+        }
+    } while ( more && moved );
+
+    /* what arrived meanwhile waits for the next flush delay */
+    epicsMutexMustLock ( pClient->mutex );
+    epicsTimeGetMonotonic ( & pClient->firstPending );
+    epicsMutexUnlock ( pClient->mutex );
+}
+
+void epicsStdCall logClientFlush ( logClientId id )
+{
+    logClient * pClient = ( logClient * ) id;
+
+    if ( ! pClient || ! pClient->connected ) {
+        return;
+    }
+
+    epicsMutexMustLock ( pClient->sendMutex );
+    logClientSendAll ( pClient );
+    epicsMutexUnlock ( pClient->sendMutex );
+}
+
+/*
+ * Sends a message that is longer than msgBuf in pieces, after the
+ * messages queued before it.
+ */
+static void logClientSendLong ( logClient * pClient, const char * prefix,
+    size_t prefixLen, const char * message, size_t msgLen )
+{
+    int waits = 0;
+
+    epicsMutexMustLock ( pClient->sendMutex );
+
+    logClientSendAll ( pClient );
+    while ( prefixLen + msgLen > 0u && pClient->connected ) {
+        unsigned space = pClient->bufSize - pClient->sendLen;
+        unsigned n;
+
+        if ( space == 0u ) {
+            /* sendBuf holds only bytes the kernel hasn't sent yet */
+            if ( ++waits > LOG_LONG_MESSAGE_WAITS ) {
+                break;
+            }
+            epicsThreadSleep ( LOG_FLUSH_MIN_INTERVAL );
+            if ( ! logClientSendBuf ( pClient ) ) {
+                break;
+            }
+            continue;
+        }
+        waits = 0;
+        if ( prefixLen > 0u ) {
+            n = prefixLen < space ? (unsigned) prefixLen : space;
+            memcpy ( & pClient->sendBuf[pClient->sendLen], prefix, n );
+            prefix += n;
+            prefixLen -= n;
+        }
+        else {
+            n = msgLen < space ? (unsigned) msgLen : space;
+            memcpy ( & pClient->sendBuf[pClient->sendLen], message, n );
+            message += n;
+            msgLen -= n;
+        }
+        pClient->sendLen += n;
+        if ( ! logClientSendBuf ( pClient ) ) {
+            break;
+        }
+    }
+
+    if ( prefixLen + msgLen > 0u ) {
+        epicsMutexMustLock ( pClient->mutex );
+        pClient->nLost++;
+        epicsMutexUnlock ( pClient->mutex );
+    }
+
+    epicsMutexUnlock ( pClient->sendMutex );
+}
+
+/*
+ * logClientSpool ()
+ */
+int epicsStdCall logClientSpool ( logClientId id, const char * path,
+    size_t maxBytes )
+{
+    logClient * pClient = ( logClient * ) id;
+    FILE * spool;
+    char * name;
+
+    if ( ! pClient || ! path || ! *path ) {
+        return -1;
+    }
+
+    name = malloc ( strlen ( path ) + 1 );
+    if ( ! name ) {
+        return -1;
+    }
+    strcpy ( name, path );
+
+    spool = fopen ( path, "w+b" );
+    if ( ! spool ) {
+        fprintf ( stderr, "log client: can't open spool file '%s' - %s\n",
+            path, strerror ( errno ) );
+        free ( name );
+        return -1;
+    }
+
+    epicsMutexMustLock ( pClient->spoolMutex );
+    epicsMutexMustLock ( pClient->mutex );
+    if ( pClient->spool ) {
+        epicsMutexUnlock ( pClient->mutex );
+        epicsMutexUnlock ( pClient->spoolMutex );
+        fclose ( spool );
+        free ( name );
+        fprintf ( stderr, "log client: already spooling to '%s'\n",
+            pClient->spoolName );
+        return -1;
+    }
+    pClient->spool = spool;
+    pClient->spoolName = name;
+    pClient->spoolLimit = maxBytes;
+    pClient->spoolRead = pClient->spoolUsed = 0u;
+    pClient->spoolPos = 0;
+    epicsMutexUnlock ( pClient->mutex );
+    epicsMutexUnlock ( pClient->spoolMutex );
+
+    return 0;
 }
 
 /*
@@ -421,24 +806,64 @@ static void logClientConnect (logClient *pClient)
 
 /*
  * logClientRestart ()
+ *
+ * Connects to the server, and sends messages once logClientFlushDelay
+ * has passed since the oldest was queued, or sooner if msgBuf is half full.
  */
 static void logClientRestart ( logClientId id )
 {
     logClient *pClient = (logClient *)id;
+    epicsTimeStamp lastConnect, lastFlush;
+    int tried = 0;
+
+    epicsTimeGetMonotonic ( & lastFlush );
 
     /* SMP safe state inspection */
     epicsMutexMustLock ( pClient->mutex );
     while ( ! pClient->shutdown ) {
-        unsigned isConn;
+        double delay = LOG_RESTART_DELAY;
+        int connect = 0, flush = 0;
+        epicsTimeStamp now;
 
-        isConn = pClient->connected;
+        epicsTimeGetMonotonic ( & now );
+        if ( ! pClient->connected ) {
+            double since = tried ?
+                epicsTimeDiffInSeconds ( & now, & lastConnect ) : delay;
 
-        epicsMutexUnlock ( pClient->mutex );
+            connect = since >= LOG_RESTART_DELAY;
+            delay -= since;
+        }
+        else if ( logClientPending ( pClient ) ) {
+            double minDelay = LOG_FLUSH_MIN_INTERVAL -
+                epicsTimeDiffInSeconds ( & now, & lastFlush );
+
+            delay = pClient->urgent ? 0.0 : logClientFlushDelay -
+                epicsTimeDiffInSeconds ( & now, & pClient->firstPending );
+            if ( delay < minDelay ) {
+                delay = minDelay;
+            }
+            flush = delay <= 0.0;
+        }
+        else {
+            /* check the connection now and then */
+            delay -= epicsTimeDiffInSeconds ( & now, & lastFlush );
+            flush = delay <= 0.0;
+        }
 
-        if ( ! isConn ) logClientConnect ( pClient );
-        logClientFlush ( pClient );
+        epicsMutexUnlock ( pClient->mutex );
 
-        epicsEventWaitWithTimeout ( pClient->shutdownNotify, LOG_RESTART_DELAY);
+        if ( connect ) {
+            lastConnect = now;
+            tried = 1;
+            logClientConnect ( pClient );
+        }
+        else if ( flush ) {
+            lastFlush = now;
+            logClientFlush ( pClient );
+        }
+        else {
+            epicsEventWaitWithTimeout ( pClient->senderWakeup, delay );
+        }
 
         epicsMutexMustLock ( pClient->mutex );
     }
@@ -466,10 +891,20 @@ logClientId epicsStdCall logClientCreate (
     pClient->addr.sin_port = htons(server_port);
     ipAddrToDottedIP (&pClient->addr, pClient->name, sizeof(pClient->name));
 
+    pClient->bufSize = logClientBufferSize > 0x400 ?
+        (unsigned) logClientBufferSize : 0x400;
+    pClient->msgBuf = malloc ( pClient->bufSize );
+    pClient->sendBuf = malloc ( pClient->bufSize );
     pClient->mutex = epicsMutexCreate ();
-    if ( ! pClient->mutex ) {
-        free ( pClient );
-        return NULL;
+    pClient->sendMutex = epicsMutexCreate ();
+    pClient->spoolMutex = epicsMutexCreate ();
+    pClient->stateChangeNotify = epicsEventCreate (epicsEventEmpty);
+    pClient->senderWakeup = epicsEventCreate (epicsEventEmpty);
+    if ( ! pClient->msgBuf || ! pClient->sendBuf || ! pClient->mutex ||
+            ! pClient->sendMutex || ! pClient->spoolMutex ||
+            ! pClient->stateChangeNotify ||
+            ! pClient->senderWakeup ) {
+        goto fail;
     }
 
     pClient->sock = INVALID_SOCKET;
@@ -478,37 +913,34 @@ logClientId epicsStdCall logClientCreate (
     pClient->shutdown = 0;
     pClient->shutdownConfirm = 0;
 
-    epicsAtExit (logClientDestroy, (void*) pClient);
-
-    pClient->stateChangeNotify = epicsEventCreate (epicsEventEmpty);
-    if ( ! pClient->stateChangeNotify ) {
-        epicsMutexDestroy ( pClient->mutex );
-        free ( pClient );
-        return NULL;
-    }
-
-    pClient->shutdownNotify = epicsEventCreate (epicsEventEmpty);
-    if ( ! pClient->shutdownNotify ) {
-        epicsMutexDestroy ( pClient->mutex );
-        epicsEventDestroy ( pClient->stateChangeNotify );
-        free ( pClient );
-        return NULL;
-    }
-
     pClient->restartThreadId = epicsThreadCreate (
         "logRestart", epicsThreadPriorityLow,
         epicsThreadGetStackSize(epicsThreadStackSmall),
         logClientRestart, pClient );
     if ( pClient->restartThreadId == NULL ) {
-        epicsMutexDestroy ( pClient->mutex );
-        epicsEventDestroy ( pClient->stateChangeNotify );
-        epicsEventDestroy ( pClient->shutdownNotify );
-        free (pClient);
         fprintf(stderr, "log client: unable to start reconnection thread\n");
-        return NULL;
+        goto fail;
     }
 
+    epicsAtExit (logClientDestroy, (void*) pClient);
+
     return (void *) pClient;
+
+fail:
+    if ( pClient->mutex )
+        epicsMutexDestroy ( pClient->mutex );
+    if ( pClient->sendMutex )
+        epicsMutexDestroy ( pClient->sendMutex );
+    if ( pClient->spoolMutex )
+        epicsMutexDestroy ( pClient->spoolMutex );
+    if ( pClient->stateChangeNotify )
+        epicsEventDestroy ( pClient->stateChangeNotify );
+    if ( pClient->senderWakeup )
+        epicsEventDestroy ( pClient->senderWakeup );
+    free ( pClient->msgBuf );
+    free ( pClient->sendBuf );
+    free ( pClient );
+    return NULL;
 }
 
 /*
@@ -534,9 +966,18 @@ void epicsStdCall logClientShow (logClientId id, unsigned level)
         printf ("log client: sock %s, connect cycles = %u\n",
             pClient->sock==INVALID_SOCKET?"INVALID":"OK",
             pClient->connectCount);
+        printf ("log client: %.0f bytes sent in %lu sends, %lu messages lost\n",
+            pClient->bytesSent, pClient->nSends, pClient->nLost);
+        if (pClient->spool) {
+            printf ("log client: spool file '%s' holds %lu of %lu bytes\n",
+                pClient->spoolName,
+                (unsigned long) pClient->spoolUsed,
+                (unsigned long) pClient->spoolLimit);
+        }
     }
     if (level>1) {
-        printf ("log client: %u bytes in buffer\n", pClient->nextMsgIndex);
+        printf ("log client: %u bytes being sent, %u bytes in buffer\n",
+            pClient->sendLen, pClient->nextMsgIndex);
         if (pClient->nextMsgIndex)
             printf("-------------------------\n"
                 "%.*s-------------------------\n",
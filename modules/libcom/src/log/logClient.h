@@ -33,6 +33,12 @@ LIBCOM_API logClientId epicsStdCall logClientCreate (
 LIBCOM_API void epicsStdCall logClientSend (logClientId id, const char *message);
 LIBCOM_API void epicsStdCall logClientShow (logClientId id, unsigned level);
 LIBCOM_API void epicsStdCall logClientFlush (logClientId id);
+/* Messages which can't be buffered while the server is unreachable are
+ * written to the file at path, up to maxBytes, and sent after reconnecting.
+ * The file is reused as a ring and never grows beyond maxBytes.
+ * Returns 0 on success. */
+LIBCOM_API int epicsStdCall logClientSpool (logClientId id,
+    const char *path, size_t maxBytes);
 LIBCOM_API void epicsStdCall iocLogPrefix(const char* prefix);
 
 /* deprecated interface; retained for backward compatibility */
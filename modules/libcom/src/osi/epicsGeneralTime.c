@@ -14,6 +14,7 @@
 #include <stdlib.h>
 
 #include "epicsTypes.h"
+#include "epicsAtomic.h"
 #include "epicsEvent.h"
 #include "epicsMutex.h"
 #include "epicsMessageQueue.h"
@@ -64,6 +65,13 @@ static struct {
     ELLLIST         timeProviders;
     gtProvider      *lastTimeProvider;
     epicsTimeStamp  lastProvidedTime;
+    /* timeProviders in priority order and NULL terminated, for lookups
+     * without the lock.  Providers are only registered during startup,
+     * so replaced copies are not freed as they might still be in use.
+     */
+    gtProvider      **timeSnapshot;
+    size_t          lastTime;   /* lastProvidedTime if size_t has 64 bits */
+    size_t          lastSeq;    /* odd while lastProvidedTime changes */
 
     epicsMutexId    eventListLock;
     ELLLIST         eventProviders;
@@ -105,7 +113,7 @@ void generalTime_Init(void)
 
 int generalTimeGetExceptPriority(epicsTimeStamp *pDest, int *pPrio, int ignore)
 {
-    gtProvider *ptp;
+    gtProvider **pptp, *ptp = NULL;
     int status = S_time_noProvider;
 
     if(useOsdGetCurrent)
@@ -116,9 +124,9 @@ int generalTimeGetExceptPriority(epicsTimeStamp *pDest, int *pPrio, int ignore)
     IFDEBUG(2)
         printf("generalTimeGetExceptPriority(ignore=%d)\n", ignore);
 
-    epicsMutexMustLock(gtPvt.timeListLock);
-    for (ptp = (gtProvider *)ellFirst(&gtPvt.timeProviders);
-         ptp; ptp = (gtProvider *)ellNext(&ptp->node)) {
+    pptp = epicsAtomicGetPtrT((EpicsAtomicPtrT *)&gtPvt.timeSnapshot);
+    epicsAtomicReadMemoryBarrier();
+    for (; pptp && (ptp = *pptp); pptp++) {
         if ((ignore > 0 && ptp->priority == ignore) ||
             (ignore < 0 && ptp->priority != -ignore))
             continue;
@@ -133,7 +141,6 @@ int generalTimeGetExceptPriority(epicsTimeStamp *pDest, int *pPrio, int ignore)
         else IFDEBUG(2)
             printf("gTGExP provider '%s' returned error\n", ptp->name);
     }
-    epicsMutexUnlock(gtPvt.timeListLock);
 
     IFDEBUG(2) {
         if (ptp && status == epicsTimeOK) {
@@ -150,11 +157,96 @@ int generalTimeGetExceptPriority(epicsTimeStamp *pDest, int *pPrio, int ignore)
     return status;
 }
 
+/* The last time returned by epicsTimeGetCurrent() is packed into
+ * gtPvt.lastTime if size_t has 64 bits.  Otherwise it is in
+ * gtPvt.lastProvidedTime, with gtPvt.lastSeq as a sequence counter that
+ * is odd while the time is being changed.
+ */
+static size_t lastSeqWait(void)
+{
+    size_t seq;
+    int spins = 0;
+
+    while ((seq = epicsAtomicGetSizeT(&gtPvt.lastSeq)) & 1) {
+        /* Let a preempted writer of lower priority finish */
+        if (++spins > 100)
+            epicsThreadSleep(epicsThreadSleepQuantum());
+    }
+    epicsAtomicReadMemoryBarrier();
+    return seq;
+}
+
+static void lastTimeGet(epicsTimeStamp *pts)
+{
+    if (sizeof(size_t) >= 8) {
+        size_t last = epicsAtomicGetSizeT(&gtPvt.lastTime);
+
+        pts->secPastEpoch = (epicsUInt32) (last >> 16 >> 16);
+        pts->nsec = (epicsUInt32) (last & 0xffffffffu);
+    }
+    else {
+        size_t seq;
+
+        do {
+            seq = lastSeqWait();
+            *pts = gtPvt.lastProvidedTime;
+            epicsAtomicReadMemoryBarrier();
+        } while (epicsAtomicGetSizeT(&gtPvt.lastSeq) != seq);
+    }
+}
+
+/* Stop *pts from going back before an earlier result.
+ * Returns non-zero if *pts was changed.
+ */
+static int ratchetTime(epicsTimeStamp *pts)
+{
+    if (sizeof(size_t) >= 8) {
+        size_t now = ((size_t) pts->secPastEpoch << 16 << 16) | pts->nsec;
+        size_t last = epicsAtomicGetSizeT(&gtPvt.lastTime);
+
+        while (now > last) {
+            size_t prev = epicsAtomicCmpAndSwapSizeT(&gtPvt.lastTime,
+                last, now);
+
+            if (prev == last)
+                return 0;
+            last = prev;
+        }
+        if (now == last)
+            return 0;
+        pts->secPastEpoch = (epicsUInt32) (last >> 16 >> 16);
+        pts->nsec = (epicsUInt32) (last & 0xffffffffu);
+        return 1;
+    }
+    else {
+        for (;;) {
+            size_t seq = lastSeqWait();
+            epicsTimeStamp last = gtPvt.lastProvidedTime;
+
+            epicsAtomicReadMemoryBarrier();
+            if (epicsAtomicGetSizeT(&gtPvt.lastSeq) != seq)
+                continue;
+            if (epicsTimeEqual(pts, &last))
+                return 0;
+            if (!epicsTimeGreaterThan(pts, &last)) {
+                *pts = last;
+                return 1;
+            }
+            if (epicsAtomicCmpAndSwapSizeT(&gtPvt.lastSeq, seq, seq + 1) != seq)
+                continue;
+            gtPvt.lastProvidedTime = *pts;
+            epicsAtomicWriteMemoryBarrier();
+            epicsAtomicSetSizeT(&gtPvt.lastSeq, seq + 2);
+            return 0;
+        }
+    }
+}
+
 int epicsStdCall epicsTimeGetCurrent(epicsTimeStamp *pDest)
 {
-    gtProvider *ptp;
+    gtProvider **pptp, *ptp = NULL;
     int status = S_time_noProvider;
-    epicsTimeStamp ts;
+    epicsTimeStamp ts, before;
 
     if(useOsdGetCurrent)
         return osdTimeGetCurrent(pDest);
@@ -164,41 +256,44 @@ int epicsStdCall epicsTimeGetCurrent(epicsTimeStamp *pDest)
     IFDEBUG(20)
         printf("epicsTimeGetCurrent()\n");
 
-    epicsMutexMustLock(gtPvt.timeListLock);
-    for (ptp = (gtProvider *)ellFirst(&gtPvt.timeProviders);
-         ptp; ptp = (gtProvider *)ellNext(&ptp->node)) {
+    lastTimeGet(&before);
 
+    pptp = epicsAtomicGetPtrT((EpicsAtomicPtrT *)&gtPvt.timeSnapshot);
+    epicsAtomicReadMemoryBarrier();
+    for (; pptp && (ptp = *pptp); pptp++) {
         status = ptp->get.Time(&ts);
-        if (status == epicsTimeOK) {
-            /* check time is monotonic */
-            if (epicsTimeGreaterThanEqual(&ts, &gtPvt.lastProvidedTime)) {
-                *pDest = ts;
-                gtPvt.lastProvidedTime = ts;
-                gtPvt.lastTimeProvider = ptp;
-            } else {
-                int key;
-
-                *pDest = gtPvt.lastProvidedTime;
-                key = epicsInterruptLock();
-                gtPvt.ErrorCounts++;
-                epicsInterruptUnlock(key);
-
-                IFDEBUG(10) {
-                    char last[40], buff[40];
-
-                    epicsTimeToStrftime(last, sizeof(last), tsfmt,
-                        &gtPvt.lastProvidedTime);
-                    epicsTimeToStrftime(buff, sizeof(buff), tsfmt, &ts);
-                    printf("eTGC provider '%s' returned older time\n"
-                        "    %s, using %s instead\n", ptp->name, buff, last);
-                }
-            }
+        if (status == epicsTimeOK)
             break;
-        }
     }
-    if (status)
+    if (status) {
         gtPvt.lastTimeProvider = NULL;
-    epicsMutexUnlock(gtPvt.timeListLock);
+    }
+    else {
+        epicsTimeStamp provided = ts;
+
+        gtPvt.lastTimeProvider = ptp;
+        /* check time is monotonic.  A result which is only older than
+         * one another thread got after this call started is not an error.
+         */
+        if (ratchetTime(&ts) &&
+            !epicsTimeGreaterThanEqual(&provided, &before)) {
+            int key;
+
+            key = epicsInterruptLock();
+            gtPvt.ErrorCounts++;
+            epicsInterruptUnlock(key);
+
+            IFDEBUG(10) {
+                char last[40], buff[40];
+
+                epicsTimeToStrftime(last, sizeof(last), tsfmt, &ts);
+                epicsTimeToStrftime(buff, sizeof(buff), tsfmt, &provided);
+                printf("eTGC provider '%s' returned older time\n"
+                    "    %s, using %s instead\n", ptp->name, buff, last);
+            }
+        }
+        *pDest = ts;
+    }
 
     IFDEBUG(20) {
         if (ptp && status == epicsTimeOK) {
@@ -389,6 +484,18 @@ static void insertProvider(gtProvider *ptp, ELLLIST *plist, epicsMutexId lock)
         ellAdd(plist, &ptp->node);
     }
 
+    if (plist == &gtPvt.timeProviders) {
+        gtProvider **pptp = callocMustSucceed(ellCount(plist) + 1,
+            sizeof(gtProvider *), "insertProvider");
+        int i = 0;
+
+        for (ptpref = (gtProvider *)ellFirst(plist);
+             ptpref; ptpref = (gtProvider *)ellNext(&ptpref->node))
+            pptp[i++] = ptpref;
+        epicsAtomicWriteMemoryBarrier();
+        epicsAtomicSetPtrT((EpicsAtomicPtrT *)&gtPvt.timeSnapshot, pptp);
+    }
+
     /* Check to see if we have more than just the OS default time source */
     if(plist==&gtPvt.timeProviders && (ellCount(plist)!=1 || ptp->get.Time!=&osdTimeGetCurrent)) {
         useOsdGetCurrent = 0;
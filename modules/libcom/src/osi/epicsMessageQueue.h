@@ -184,6 +184,25 @@ LIBCOM_API epicsMessageQueueId epicsStdCall epicsMessageQueueCreate(
     unsigned int capacity,
     unsigned int maximumMessageSize);
 
+/**
+ *  \brief Create a lock-free message queue.
+ *
+ *  The queue behaves like one from epicsMessageQueueCreate(), but
+ *  senders and receivers don't take a lock and only block when the
+ *  queue is full or empty.  Blocked senders are not served in order of
+ *  arrival.  Useful where several threads pass many small messages.
+ *  On targets without a lock-free implementation this is the same as
+ *  epicsMessageQueueCreate().
+ *  \param capacity  Maximum number of messages to queue
+ *  \param maximumMessageSize  Number of bytes of the largest
+ *  message that may be queued
+ *  \return An identifier for the new queue, or 0.
+ *  \since UNRELEASED
+ **/
+LIBCOM_API epicsMessageQueueId epicsStdCall epicsMessageQueueCreateLockFree(
+    unsigned int capacity,
+    unsigned int maximumMessageSize);
+
 /**
  *  \brief Destroy a message queue, release all its memory.
  **/
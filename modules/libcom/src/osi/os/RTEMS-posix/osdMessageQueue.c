@@ -52,6 +52,13 @@ epicsMessageQueueCreate(unsigned int capacity, unsigned int maximumMessageSize)
     return id;
 }
 
+LIBCOM_API epicsMessageQueueId epicsStdCall
+epicsMessageQueueCreateLockFree(unsigned int capacity,
+    unsigned int maximumMessageSize)
+{
+    return epicsMessageQueueCreate(capacity, maximumMessageSize);
+}
+
 LIBCOM_API void epicsStdCall epicsMessageQueueDestroy(
     epicsMessageQueueId id)
 {
@@ -14,6 +14,7 @@
  */
 
 #include <stdexcept>
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -21,8 +22,10 @@
 #include "epicsMessageQueue.h"
 #include <ellLib.h>
 #include <epicsAssert.h>
+#include <epicsAtomic.h>
 #include <epicsEvent.h>
 #include <epicsMutex.h>
+#include <epicsTime.h>
 
 /*
  * Event cache
@@ -43,10 +46,43 @@ struct threadNode {
     volatile bool       eventSent;
 };
 
+/*
+ * Lock-free queue slot, followed by the message
+ */
+struct lfSlot {
+    size_t          seq;
+    unsigned int    size;
+};
+
+/*
+ * Lock-free queue, a bounded ring of sequence-numbered slots
+ *
+ * A slot at ring position p is free for the sender claiming position p
+ * when its seq equals p, and holds a message for the receiver claiming
+ * position p when its seq equals p + 1.  The receiver frees it for the
+ * next lap by setting seq to p + ringSize.  Senders and receivers only
+ * take the mutex to block when the queue is full or empty, or to wake a
+ * thread blocked on the sendQueue or receiveQueue.
+ */
+#define LF_PAD 64
+
+struct lfQueue {
+    size_t          inPos;
+    char            pad1[LF_PAD - sizeof(size_t)];
+    size_t          outPos;
+    char            pad2[LF_PAD - sizeof(size_t)];
+    int             sendersWaiting;     /* ellCount(&sendQueue) */
+    int             receiversWaiting;   /* ellCount(&receiveQueue) */
+    size_t          ringSize;       /* power of 2, >= capacity */
+    size_t          slotSize;
+    char           *slots;
+};
+
 /*
  * Message info
  */
 struct epicsMessageQueueOSD {
+    struct lfQueue *lf;             /* non-NULL for a lock-free queue */
     ELLLIST         sendQueue;
     ELLLIST         receiveQueue;
     ELLLIST         eventFreeList;
@@ -106,6 +142,60 @@ LIBCOM_API epicsMessageQueueId epicsStdCall epicsMessageQueueCreate(
     return pmsg;
 }
 
+static struct lfSlot *
+lfSlotAt(struct lfQueue *lf, size_t pos)
+{
+    return (struct lfSlot *)
+        (lf->slots + (pos & (lf->ringSize - 1)) * lf->slotSize);
+}
+
+LIBCOM_API epicsMessageQueueId epicsStdCall epicsMessageQueueCreateLockFree(
+    unsigned int capacity,
+    unsigned int maxMessageSize)
+{
+    epicsMessageQueueId pmsg;
+    struct lfQueue *lf;
+    size_t i;
+
+    if(capacity == 0)
+        return NULL;
+
+    pmsg = (epicsMessageQueueId)calloc(1, sizeof(*pmsg));
+    lf = (struct lfQueue *)calloc(1, sizeof(*lf));
+    if(!pmsg || !lf) {
+        free(pmsg);
+        free(lf);
+        return NULL;
+    }
+
+    pmsg->lf = lf;
+    pmsg->capacity = capacity;
+    pmsg->maxMessageSize = maxMessageSize;
+
+    lf->ringSize = 1;
+    while (lf->ringSize < capacity)
+        lf->ringSize <<= 1;
+    lf->slotSize = (sizeof(struct lfSlot) + maxMessageSize + 15) & ~(size_t)15;
+    lf->slots = (char *)calloc(lf->ringSize, lf->slotSize);
+    pmsg->mutex = epicsMutexCreate();
+    if(!lf->slots || !pmsg->mutex) {
+        if(pmsg->mutex)
+            epicsMutexDestroy(pmsg->mutex);
+        free(lf->slots);
+        free(lf);
+        free(pmsg);
+        return NULL;
+    }
+
+    for (i = 0; i < lf->ringSize; i++)
+        lfSlotAt(lf, i)->seq = i;
+
+    ellInit(&pmsg->sendQueue);
+    ellInit(&pmsg->receiveQueue);
+    ellInit(&pmsg->eventFreeList);
+    return pmsg;
+}
+
 static void
 destroyEventNode(struct eventNode *enode)
 {
@@ -118,6 +208,10 @@ epicsMessageQueueDestroy(epicsMessageQueueId pmsg)
 {
     struct eventNode *evp;
 
+    if (pmsg->lf) {
+        free(pmsg->lf->slots);
+        free(pmsg->lf);
+    }
     while ((evp = reinterpret_cast < struct eventNode * >
             ( ellGet(&pmsg->eventFreeList) ) ) != NULL) {
         destroyEventNode(evp);
@@ -156,6 +250,226 @@ freeEventNode(epicsMessageQueueId pmsg, eventNode *evp, epicsEventStatus status)
     ellAdd(&pmsg->eventFreeList, &evp->link);
 }
 
+/*
+ * Claim the next slot to fill, or return NULL if the queue is full
+ */
+static struct lfSlot *
+lfClaimIn(epicsMessageQueueId pmsg, size_t *ppos)
+{
+    struct lfQueue *lf = pmsg->lf;
+    size_t pos = epicsAtomicGetSizeT(&lf->inPos);
+
+    for (;;) {
+        struct lfSlot *slot = lfSlotAt(lf, pos);
+        ptrdiff_t dif = (ptrdiff_t)(epicsAtomicGetSizeT(&slot->seq) - pos);
+
+        if (dif == 0) {
+            size_t old;
+
+            if (pos - epicsAtomicGetSizeT(&lf->outPos) >= pmsg->capacity)
+                return NULL;
+            old = epicsAtomicCmpAndSwapSizeT(&lf->inPos, pos, pos + 1);
+            if (old == pos) {
+                *ppos = pos;
+                return slot;
+            }
+            pos = old;
+        }
+        else if (dif < 0) {
+            /* Last lap's message is still being received */
+            return NULL;
+        }
+        else {
+            pos = epicsAtomicGetSizeT(&lf->inPos);
+        }
+    }
+}
+
+/*
+ * Claim the next slot to empty, or return NULL if the queue is empty
+ */
+static struct lfSlot *
+lfClaimOut(struct lfQueue *lf)
+{
+    size_t pos = epicsAtomicGetSizeT(&lf->outPos);
+
+    for (;;) {
+        struct lfSlot *slot = lfSlotAt(lf, pos);
+        ptrdiff_t dif = (ptrdiff_t)(epicsAtomicGetSizeT(&slot->seq) - (pos + 1));
+
+        if (dif == 0) {
+            size_t old = epicsAtomicCmpAndSwapSizeT(&lf->outPos, pos, pos + 1);
+
+            if (old == pos)
+                return slot;
+            pos = old;
+        }
+        else if (dif < 0) {
+            /* Empty, or the message is still being sent */
+            return NULL;
+        }
+        else {
+            pos = epicsAtomicGetSizeT(&lf->outPos);
+        }
+    }
+}
+
+static bool
+lfCanSend(epicsMessageQueueId pmsg)
+{
+    struct lfQueue *lf = pmsg->lf;
+    size_t pos = epicsAtomicGetSizeT(&lf->inPos);
+
+    return epicsAtomicGetSizeT(&lfSlotAt(lf, pos)->seq) == pos &&
+        pos - epicsAtomicGetSizeT(&lf->outPos) < pmsg->capacity;
+}
+
+static bool
+lfCanReceive(epicsMessageQueueId pmsg)
+{
+    struct lfQueue *lf = pmsg->lf;
+    size_t pos = epicsAtomicGetSizeT(&lf->outPos);
+
+    return epicsAtomicGetSizeT(&lfSlotAt(lf, pos)->seq) == pos + 1;
+}
+
+/*
+ * Wait on the given queue until woken, returns false if the timeout has
+ * expired.  The waiter count is raised before checking the ring again,
+ * and the other side changes the ring before reading the count, so a
+ * wakeup can't be missed.  A wakeup that arrives just as the timeout
+ * expires still counts, so the caller tries once more to claim the slot
+ * it was woken for instead of leaving it to nobody.
+ */
+static bool
+lfWait(epicsMessageQueueId pmsg, ELLLIST *waitQueue, int *pwaiting,
+    bool (*ready)(epicsMessageQueueId), double timeout, epicsUInt64 *pdeadline)
+{
+    struct threadNode threadNode;
+    epicsEventStatus status = epicsEventOK;
+    bool expired = false;
+
+    if (timeout == 0)
+        return false;
+    if (timeout > 0 && *pdeadline == 0)
+        *pdeadline = epicsMonotonicGet() + (epicsUInt64)(timeout * 1e9);
+
+    epicsMutexMustLock(pmsg->mutex);
+    threadNode.evp = getEventNode(pmsg);
+    threadNode.eventSent = false;
+    if (!threadNode.evp) {
+        epicsMutexUnlock(pmsg->mutex);
+        return false;
+    }
+    ellAdd(waitQueue, &threadNode.link);
+    epicsAtomicIncrIntT(pwaiting);
+    epicsMutexUnlock(pmsg->mutex);
+
+    if (ready(pmsg)) {
+        status = epicsEventWaitTimeout;     /* not waiting, reset event */
+    }
+    else if (timeout < 0) {
+        status = epicsEventWait(threadNode.evp->event);
+    }
+    else {
+        epicsUInt64 now = epicsMonotonicGet();
+
+        status = now < *pdeadline ?
+            epicsEventWaitWithTimeout(threadNode.evp->event,
+                (*pdeadline - now) * 1e-9) :
+            epicsEventWaitTimeout;
+        expired = status == epicsEventWaitTimeout;
+    }
+
+    epicsMutexMustLock(pmsg->mutex);
+    if (threadNode.eventSent) {
+        expired = false;
+    }
+    else {
+        ellDelete(waitQueue, &threadNode.link);
+        epicsAtomicDecrIntT(pwaiting);
+    }
+    freeEventNode(pmsg, threadNode.evp, status);
+    epicsMutexUnlock(pmsg->mutex);
+    return !expired;
+}
+
+/*
+ * Wake the oldest thread waiting on the given queue, if any
+ */
+static void
+lfWake(epicsMessageQueueId pmsg, ELLLIST *waitQueue, int *pwaiting)
+{
+    struct threadNode *pthr;
+
+    if (epicsAtomicGetIntT(pwaiting) == 0)
+        return;
+
+    epicsMutexMustLock(pmsg->mutex);
+    if ((pthr = reinterpret_cast < struct threadNode * >
+         ( ellGet(waitQueue) ) ) != NULL) {
+        epicsAtomicDecrIntT(pwaiting);
+        pthr->eventSent = true;
+        epicsEventSignal(pthr->evp->event);
+    }
+    epicsMutexUnlock(pmsg->mutex);
+}
+
+static int
+lfSend(epicsMessageQueueId pmsg, void *message, unsigned int size,
+    double timeout)
+{
+    struct lfQueue *lf = pmsg->lf;
+    struct lfSlot *slot;
+    epicsUInt64 deadline = 0;
+    size_t pos;
+
+    if(size > pmsg->maxMessageSize)
+        return -1;
+
+    while (!(slot = lfClaimIn(pmsg, &pos))) {
+        if (!lfWait(pmsg, &pmsg->sendQueue, &lf->sendersWaiting, lfCanSend,
+                timeout, &deadline))
+            return -1;
+    }
+
+    slot->size = size;
+    memcpy(slot + 1, message, size);
+    epicsAtomicIncrSizeT(&slot->seq);       /* publish, seq = pos + 1 */
+
+    lfWake(pmsg, &pmsg->receiveQueue, &lf->receiversWaiting);
+    return 0;
+}
+
+static int
+lfReceive(epicsMessageQueueId pmsg, void *message, unsigned int size,
+    double timeout)
+{
+    struct lfQueue *lf = pmsg->lf;
+    struct lfSlot *slot;
+    epicsUInt64 deadline = 0;
+    int ret;
+
+    while (!(slot = lfClaimOut(lf))) {
+        if (!lfWait(pmsg, &pmsg->receiveQueue, &lf->receiversWaiting,
+                lfCanReceive, timeout, &deadline))
+            return -1;
+    }
+
+    if (slot->size <= size) {
+        memcpy(message, slot + 1, slot->size);
+        ret = slot->size;
+    }
+    else {
+        ret = -1;
+    }
+    /* free for the next lap, seq = pos + ringSize */
+    epicsAtomicAddSizeT(&slot->seq, lf->ringSize - 1);
+
+    lfWake(pmsg, &pmsg->sendQueue, &lf->sendersWaiting);
+    return ret;
+}
+
 static int
 mySend(epicsMessageQueueId pmsg, void *message, unsigned int size,
     double timeout)
@@ -163,6 +477,9 @@ mySend(epicsMessageQueueId pmsg, void *message, unsigned int size,
     char *myInPtr, *nextPtr;
     struct threadNode *pthr;
 
+    if (pmsg->lf)
+        return lfSend(pmsg, message, size, timeout);
+
     if(size > pmsg->maxMessageSize)
         return -1;
 
@@ -281,6 +598,9 @@ myReceive(epicsMessageQueueId pmsg, void *message, unsigned int size,
     unsigned long l;
     struct threadNode *pthr;
 
+    if (pmsg->lf)
+        return lfReceive(pmsg, message, size, timeout);
+
     /*
      * If there's a message on the queue, copy it
      */
@@ -400,6 +720,14 @@ epicsMessageQueuePending(epicsMessageQueueId pmsg)
     char *myInPtr, *myOutPtr;
     int nmsg;
 
+    if (pmsg->lf) {
+        size_t out = epicsAtomicGetSizeT(&pmsg->lf->outPos);
+        size_t n = epicsAtomicGetSizeT(&pmsg->lf->inPos) - out;
+
+        /* includes messages still being sent */
+        return n < pmsg->capacity ? (int) n : (int) pmsg->capacity;
+    }
+
     epicsMutexMustLock(pmsg->mutex);
     myInPtr = (char *)pmsg->inPtr;
     myOutPtr = (char *)pmsg->outPtr;
@@ -419,6 +747,7 @@ epicsMessageQueueShow(epicsMessageQueueId pmsg, int level)
     printf("Message Queue Used:%d  Slots:%lu",
         epicsMessageQueuePending(pmsg), pmsg->capacity);
     if (level >= 1)
-        printf("  Maximum size:%lu", pmsg->maxMessageSize);
+        printf("  Maximum size:%lu%s", pmsg->maxMessageSize,
+            pmsg->lf ? "  Lock-free" : "");
     printf("\n");
 }
@@ -20,6 +20,7 @@
 #include <limits.h>
 
 #define epicsMessageQueueCreate(c,s) ((epicsMessageQueueId)msgQCreate((c),(s),MSG_Q_FIFO))
+#define epicsMessageQueueCreateLockFree(c,s) epicsMessageQueueCreate(c,s)
 #define epicsMessageQueueDestroy(q) (msgQDelete((MSG_Q_ID)(q)))
 
 #define epicsMessageQueueTrySend(q,m,l) (msgQSend((MSG_Q_ID)(q), (char*)(m), (l), NO_WAIT, MSG_PRI_NORMAL))
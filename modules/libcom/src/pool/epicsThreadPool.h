@@ -23,6 +23,7 @@
 #define S_pool_paused    (M_pool| 4) /*Pool not currently accepting jobs*/
 #define S_pool_noThreads (M_pool| 5) /*Can't create worker thread*/
 #define S_pool_timeout   (M_pool| 6) /*Pool still busy after timeout*/
+#define S_pool_badPriority (M_pool| 7) /*Invalid job priority*/
 
 #ifdef __cplusplus
 extern "C" {
@@ -54,6 +55,16 @@ typedef void (*epicsJobFunction)(void* arg, epicsJobMode mode);
 
 typedef struct epicsJob epicsJob;
 
+/* Job priorities.
+ * Idle workers run queued jobs of higher priority first.
+ * A running job is never interrupted.
+ */
+typedef enum {
+    epicsJobPriorityLow,
+    epicsJobPriorityMedium, /* default for new jobs */
+    epicsJobPriorityHigh
+} epicsJobPriority;
+
 /* Pool operations */
 
 /* Initialize a pool config with default values.
@@ -138,6 +149,22 @@ LIBCOM_API int epicsJobMove(epicsJob* job, epicsThreadPool* pool);
  */
 LIBCOM_API int epicsJobQueue(epicsJob*);
 
+/* Adds several jobs to the run queue, taking the pool lock once
+ * and waking as many idle workers as there are jobs.
+ * All jobs must belong to the same pool.
+ * Safe to call from a running job function.
+ * returns 0 if all jobs were queued, or the error for the first job
+ * which could not be.  The other jobs are queued anyway.
+ */
+LIBCOM_API int epicsJobQueueMany(epicsJob** jobs, unsigned int njobs);
+
+/* Change the priority of a job.
+ * A queued job moves to the end of the queue for its new priority.
+ * Safe to call from a running job function.
+ * returns 0 on success, non-zero on error.
+ */
+LIBCOM_API int epicsJobSetPriority(epicsJob* job, epicsJobPriority prio);
+
 /* Remove a job from the run queue if it is queued.
  * Safe to call from a running job function.
  * returns 0 if job was queued and now is not.
@@ -147,7 +174,10 @@ LIBCOM_API int epicsJobQueue(epicsJob*);
 LIBCOM_API int epicsJobUnqueue(epicsJob*);
 
 
-/* Mostly useful for debugging */
+/* Mostly useful for debugging.
+ * Also shows how many jobs each worker has run, how many of those it
+ * took from other workers, and the fraction of time it was busy.
+ */
 
 LIBCOM_API void epicsThreadPoolReport(epicsThreadPool *pool, FILE *fd);
 
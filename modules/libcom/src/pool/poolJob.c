@@ -12,91 +12,266 @@
 
 
 #include "dbDefs.h"
+#include "epicsAtomic.h"
 #include "errlog.h"
 #include "ellLib.h"
 #include "epicsThread.h"
 #include "epicsMutex.h"
 #include "epicsEvent.h"
 #include "epicsInterrupt.h"
+#include "epicsTime.h"
 
 #include "epicsThreadPool.h"
 #include "poolPriv.h"
 
 void *epicsJobArgSelfMagic = &epicsJobArgSelfMagic;
 
+static epicsThreadOnceId workerSelfOnce = EPICS_THREAD_ONCE_INIT;
+static epicsThreadPrivateId workerSelfId;
+
 static
-void workerMain(void *arg)
+void workerSelfInit(void *unused)
 {
-    epicsThreadPool *pool = arg;
-    unsigned int nrun, ocnt;
+    workerSelfId = epicsThreadPrivateCreate();
+}
 
-    /* workers are created with counts
-     * in the running, sleeping, and (possibly) waking counters
-     */
+/* The worker running the calling thread if it belongs to pool */
+static
+poolWorker* workerSelf(epicsThreadPool *pool)
+{
+    poolWorker *worker;
 
-    epicsMutexMustLock(pool->guard);
-    pool->threadsAreAwake++;
-    pool->threadsSleeping--;
+    epicsThreadOnce(&workerSelfOnce, &workerSelfInit, NULL);
+    worker = epicsThreadPrivateGet(workerSelfId);
+    return worker && worker->pool == pool ? worker : NULL;
+}
 
-    while (1) {
-        ELLNODE *cur;
+/* Lock and return the home of job, which may change until it is locked */
+static
+poolQueue* lockJob(epicsJob *job)
+{
+    for (;;) {
+        poolQueue *q = epicsAtomicGetPtrT((EpicsAtomicPtrT *)&job->home);
 
-        pool->threadsAreAwake--;
-        pool->threadsSleeping++;
-        epicsMutexUnlock(pool->guard);
+        epicsMutexMustLock(q->lock);
+        if (q == job->home)
+            return q;
+        epicsMutexUnlock(q->lock);
+    }
+}
 
-        epicsEventMustWait(pool->workerWakeup);
+static
+void setHome(epicsJob *job, poolQueue *q)
+{
+    epicsAtomicSetPtrT((EpicsAtomicPtrT *)&job->home, q);
+}
 
-        epicsMutexMustLock(pool->guard);
-        pool->threadsSleeping--;
-        pool->threadsAreAwake++;
+/* Both job->home and runq must be locked */
+static
+void addJob(epicsThreadPool *pool, poolQueue *runq, epicsJob *job)
+{
+    size_t n, max;
 
-        if (pool->threadsWaking==0)
-            continue;
+    setHome(job, runq);
+    ellAdd(&runq->jobs[job->priority], &job->jobnode);
 
-        pool->threadsWaking--;
+    n = epicsAtomicIncrSizeT(&pool->jobsQueued);
+    while ((max = epicsAtomicGetSizeT(&pool->maxQueued)) < n &&
+           epicsAtomicCmpAndSwapSizeT(&pool->maxQueued, max, n) != max)
+        ;
+}
 
-        CHECKCOUNT(pool);
+/* job->home must be locked */
+static
+void removeJob(epicsThreadPool *pool, epicsJob *job)
+{
+    ellDelete(&job->home->jobs[job->priority], &job->jobnode);
+    epicsAtomicDecrSizeT(&pool->jobsQueued);
+}
 
-        if (pool->shutdown)
-            break;
+/* Both job->home and worker->queue must be locked */
+static
+epicsJob* startJob(epicsThreadPool *pool, poolWorker *worker, ELLNODE *cur)
+{
+    epicsJob *job = CONTAINER(cur, epicsJob, jobnode);
 
-        if (pool->pauserun)
+    assert(job->queued && !job->running);
+
+    setHome(job, &worker->queue);
+    job->queued = 0;
+    job->running = 1;
+    epicsAtomicDecrSizeT(&pool->jobsQueued);
+    return job;
+}
+
+/* Take a job from the oldest end of another worker's queue.  Called
+ * with worker->queue locked, so a victim which is busy is skipped.
+ */
+static
+epicsJob* stealJob(epicsThreadPool *pool, poolWorker *worker, int prio)
+{
+    unsigned int i, n = epicsAtomicGetIntT(&pool->nworkers);
+
+    epicsAtomicReadMemoryBarrier();
+    for (i = 1; i < n; i++) {
+        poolWorker *victim = pool->workerv[(worker->index + i) % n];
+        epicsJob *job = NULL;
+        ELLNODE *node;
+
+        if (epicsMutexTryLock(victim->queue.lock) != epicsMutexLockOK)
             continue;
+        if ((node = ellGet(&victim->queue.jobs[prio])) != NULL) {
+            job = startJob(pool, worker, node);
+            worker->nstolen++;
+        }
+        epicsMutexUnlock(victim->queue.lock);
+        if (job)
+            return job;
+    }
+    return NULL;
+}
 
-        /* more threads to wakeup */
-        if (pool->threadsWaking) {
-            epicsEventSignal(pool->workerWakeup);
+static
+epicsJob* pickJob(epicsThreadPool *pool, poolWorker *worker)
+{
+    /* Now and then look at the pool queue first, so jobs which
+     * keep re-queueing themselves can't starve the others.
+     */
+    int poolFirst = (++worker->picks % 16u) == 0;
+    poolQueue *mine = &worker->queue, *pq = &pool->queue;
+    epicsJob *job = NULL;
+    int prio;
+
+    epicsMutexMustLock(mine->lock);
+    for (prio = epicsJobPriorityHigh; !job && prio >= epicsJobPriorityLow;
+         prio--) {
+        ELLNODE *cur = NULL;
+
+        if (!poolFirst && (cur = ellGet(&mine->jobs[prio])) != NULL) {
+            job = startJob(pool, worker, cur);
+            break;
         }
 
-        while ((cur=ellGet(&pool->jobs)) != NULL) {
-            epicsJob *job = CONTAINER(cur, epicsJob, jobnode);
+        epicsMutexMustLock(pq->lock);
+        if (poolFirst)
+            cur = ellGet(&pq->jobs[prio]);
+        if (!cur)
+            cur = ellGet(&mine->jobs[prio]);
+        if (!cur)
+            cur = ellGet(&pq->jobs[prio]);
+        if (cur)
+            job = startJob(pool, worker, cur);
+        epicsMutexUnlock(pq->lock);
+
+        if (!job)
+            job = stealJob(pool, worker, prio);
+    }
+    epicsMutexUnlock(mine->lock);
+    return job;
+}
 
-            assert(job->queued && !job->running);
+static
+void runJob(epicsThreadPool *pool, poolWorker *worker, epicsJob *job)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    int dead = 0;
 
-            job->queued=0;
-            job->running=1;
+    (*job->func)(job->arg, epicsJobModeRun);
+    start = epicsMonotonicGet() - start;
 
-            epicsMutexUnlock(pool->guard);
-            (*job->func)(job->arg, epicsJobModeRun);
-            epicsMutexMustLock(pool->guard);
+    epicsMutexMustLock(worker->queue.lock);
 
-            if (job->freewhendone) {
-                job->dead=1;
-                free(job);
-            }
-            else {
-                job->running=0;
-                /* job may be re-queued from within callback */
-                if (job->queued)
-                    ellAdd(&pool->jobs, &job->jobnode);
-                else
-                    ellAdd(&pool->owned, &job->jobnode);
-            }
+    worker->nrun++;
+    worker->busy += start;
+
+    if (job->freewhendone) {
+        job->dead = dead = 1;
+    }
+    else {
+        job->running = 0;
+        /* job may be re-queued from within callback */
+        if (job->queued)
+            addJob(pool, &worker->queue, job);
+    }
+
+    epicsMutexUnlock(worker->queue.lock);
+
+    if (dead) {
+        epicsMutexMustLock(pool->guard);
+        ellDelete(&pool->owned, &job->ownednode);
+        epicsMutexUnlock(pool->guard);
+        free(job);
+    }
+}
+
+static
+void workerAwake(epicsThreadPool *pool, poolWorker *worker)
+{
+    pool->threadsSleeping--;
+    pool->threadsAreAwake++;
+    if (worker->woken) {
+        worker->woken = 0;
+        pool->threadsWaking--;
+    }
+    CHECKCOUNT(pool);
+}
+
+static
+void workerMain(void *arg)
+{
+    poolWorker *worker = arg;
+    epicsThreadPool *pool = worker->pool;
+    unsigned int nrun, ocnt;
+
+    epicsThreadPrivateSet(workerSelfId, worker);
+
+    /* workers are created with counts
+     * in the running, sleeping, and (possibly) waking counters
+     */
+
+    epicsMutexMustLock(pool->guard);
+    workerAwake(pool, worker);
+    epicsMutexUnlock(pool->guard);
+
+    for (;;) {
+        epicsJob *job = NULL;
+
+        if (!epicsAtomicGetIntT(&pool->pauserun))
+            job = pickJob(pool, worker);
+        if (job) {
+            runJob(pool, worker, job);
+            continue;
+        }
+
+        epicsMutexMustLock(pool->guard);
+        if (pool->shutdown)
+            break;
+
+        ellInsert(&pool->sleepers, NULL, &worker->sleepnode);
+        epicsAtomicIncrIntT(&pool->idle);
+
+        /* A job queued after pickJob() looked by a thread which didn't
+         * see this worker in the sleepers list would never be woken for.
+         */
+        if (!pool->pauserun && epicsAtomicGetSizeT(&pool->jobsQueued)) {
+            ellDelete(&pool->sleepers, &worker->sleepnode);
+            epicsAtomicDecrIntT(&pool->idle);
+            epicsMutexUnlock(pool->guard);
+            continue;
         }
 
+        pool->threadsAreAwake--;
+        pool->threadsSleeping++;
+
         if (pool->observerCount)
             epicsEventSignal(pool->observerWakeup);
+        epicsMutexUnlock(pool->guard);
+
+        epicsEventMustWait(worker->wakeup);
+
+        epicsMutexMustLock(pool->guard);
+        workerAwake(pool, worker);
+        epicsMutexUnlock(pool->guard);
     }
 
     pool->threadsAreAwake--;
@@ -109,29 +284,87 @@ void workerMain(void *arg)
     if (ocnt)
         epicsEventSignal(pool->observerWakeup);
 
-    if (nrun)
-        epicsEventSignal(pool->workerWakeup); /* pass along */
-    else
+    if (!nrun)
         epicsEventSignal(pool->shutdownEvent);
 }
 
-int createPoolThread(epicsThreadPool *pool)
+/* Called with the pool guard held.  If woken, the new worker is counted
+ * as a wakeup and will look for jobs as soon as it starts.
+ */
+int createPoolThread(epicsThreadPool *pool, int woken)
 {
+    poolWorker *worker;
     epicsThreadId tid;
+    int i;
+
+    epicsThreadOnce(&workerSelfOnce, &workerSelfInit, NULL);
+
+    if (pool->nworkers >= (int)pool->conf.maxThreads)
+        return S_pool_noThreads;
+
+    worker = calloc(1, sizeof(*worker));
+    if (!worker)
+        return S_pool_noThreads;
+    worker->pool = pool;
+    worker->index = pool->nworkers;
+    worker->started = epicsMonotonicGet();
+    for (i = 0; i < POOL_NPRIO; i++)
+        ellInit(&worker->queue.jobs[i]);
+    worker->queue.lock = epicsMutexCreate();
+    worker->wakeup = epicsEventCreate(epicsEventEmpty);
+    if (!worker->queue.lock || !worker->wakeup) {
+        if (worker->queue.lock)
+            epicsMutexDestroy(worker->queue.lock);
+        if (worker->wakeup)
+            epicsEventDestroy(worker->wakeup);
+        free(worker);
+        return S_pool_noThreads;
+    }
 
     tid = epicsThreadCreate("PoolWorker",
                             pool->conf.workerPriority,
                             pool->conf.workerStack,
                             &workerMain,
-                            pool);
-    if (!tid)
+                            worker);
+    if (!tid) {
+        epicsMutexDestroy(worker->queue.lock);
+        epicsEventDestroy(worker->wakeup);
+        free(worker);
         return S_pool_noThreads;
+    }
+
+    /* Others may steal from it once counted in nworkers */
+    pool->workerv[worker->index] = worker;
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetIntT(&pool->nworkers, worker->index + 1);
 
     pool->threadsRunning++;
     pool->threadsSleeping++;
+    if (woken) {
+        worker->woken = 1;
+        pool->threadsWaking++;
+    }
     return 0;
 }
 
+/* Called with the pool guard held.  Takes the worker which went idle
+ * most recently and counts its wakeup.  The caller must signal its
+ * wakeup event, which may be done after releasing the guard.
+ */
+poolWorker* wakeSleeper(epicsThreadPool *pool)
+{
+    ELLNODE *cur = ellGet(&pool->sleepers);
+    poolWorker *worker;
+
+    if (!cur)
+        return NULL;
+    epicsAtomicDecrIntT(&pool->idle);
+    worker = CONTAINER(cur, poolWorker, sleepnode);
+    worker->woken = 1;
+    pool->threadsWaking++;
+    return worker;
+}
+
 epicsJob* epicsJobCreate(epicsThreadPool *pool,
                          epicsJobFunction func,
                          void *arg)
@@ -147,15 +380,31 @@ epicsJob* epicsJobCreate(epicsThreadPool *pool,
     job->pool = NULL;
     job->func = func;
     job->arg = arg;
+    job->priority = epicsJobPriorityMedium;
 
     epicsJobMove(job, pool);
 
     return job;
 }
 
+/* Called with job->home locked */
+static
+int unqueueLocked(epicsThreadPool *pool, epicsJob *job)
+{
+    if (!job->queued)
+        return S_pool_jobIdle;
+    if (!job->running)
+        removeJob(pool, job);
+    job->queued = 0;
+    return 0;
+}
+
 void epicsJobDestroy(epicsJob *job)
 {
     epicsThreadPool *pool;
+    poolQueue *q;
+    int dead = 0;
+
     if (!job || !job->pool) {
         free(job);
         return;
@@ -163,21 +412,26 @@ void epicsJobDestroy(epicsJob *job)
     pool = job->pool;
 
     epicsMutexMustLock(pool->guard);
+    q = lockJob(job);
 
     assert(!job->dead);
 
-    epicsJobUnqueue(job);
+    unqueueLocked(pool, job);
 
+    /* A running job is freed by its worker */
     if (job->running || job->freewhendone) {
         job->freewhendone = 1;
     }
     else {
-        ellDelete(&pool->owned, &job->jobnode);
-        job->dead = 1;
-        free(job);
+        ellDelete(&pool->owned, &job->ownednode);
+        job->dead = dead = 1;
     }
 
+    epicsMutexUnlock(q->lock);
     epicsMutexUnlock(pool->guard);
+
+    if (dead)
+        free(job);
 }
 
 int epicsJobMove(epicsJob *job, epicsThreadPool *newpool)
@@ -186,14 +440,20 @@ int epicsJobMove(epicsJob *job, epicsThreadPool *newpool)
 
     /* remove from current pool */
     if (pool) {
+        poolQueue *q;
+        int busy;
+
         epicsMutexMustLock(pool->guard);
+        q = lockJob(job);
+        busy = job->queued || job->running;
+        epicsMutexUnlock(q->lock);
 
-        if (job->queued || job->running) {
+        if (busy) {
             epicsMutexUnlock(pool->guard);
             return S_pool_jobBusy;
         }
 
-        ellDelete(&pool->owned, &job->jobnode);
+        ellDelete(&pool->owned, &job->ownednode);
 
         epicsMutexUnlock(pool->guard);
     }
@@ -204,124 +464,258 @@ int epicsJobMove(epicsJob *job, epicsThreadPool *newpool)
     if (pool) {
         epicsMutexMustLock(pool->guard);
 
-        ellAdd(&pool->owned, &job->jobnode);
+        setHome(job, &pool->queue);
+        ellAdd(&pool->owned, &job->ownednode);
 
         epicsMutexUnlock(pool->guard);
     }
+    else {
+        setHome(job, NULL);
+    }
 
     return 0;
 }
 
-int epicsJobQueue(epicsJob *job)
+/* Returns 1 if the job was put on a run queue, 0 if not, or an error
+ * code.  Only the job's old and new homes are locked, not the guard.
+ */
+static
+int queueJob(epicsThreadPool *pool, epicsJob *job, poolWorker *self)
 {
-    int ret = 0;
-    epicsThreadPool *pool = job->pool;
+    poolQueue *q, *runq;
+    int ret = 1;
 
-    if (!pool)
-        return S_pool_noPool;
+    for (;;) {
+        q = lockJob(job);
+        runq = self ? &self->queue : &pool->queue;
 
-    epicsMutexMustLock(pool->guard);
+        if (job->queued || job->running || runq == q) {
+            runq = q;
+            break;
+        }
+        /* A job queued by a running job stays with that worker,
+         * unless an idle worker steals it.
+         */
+        if (!self) {
+            epicsMutexMustLock(runq->lock);
+            break;
+        }
+        if (epicsMutexTryLock(runq->lock) == epicsMutexLockOK)
+            break;
+        /* Another worker is stealing from us, wait without holding q */
+        epicsMutexUnlock(q->lock);
+        epicsMutexMustLock(runq->lock);
+        epicsMutexUnlock(runq->lock);
+    }
 
     assert(!job->dead);
 
-    if (pool->pauseadd) {
+    if (epicsAtomicGetIntT(&pool->pauseadd))
         ret = S_pool_paused;
-        goto done;
-    }
-    else if (job->freewhendone) {
+    else if (job->freewhendone)
         ret = S_pool_jobBusy;
-        goto done;
-    }
-    else if (job->queued) {
-        goto done;
-    }
-
-    job->queued = 1;
-    /* Job may be queued from within a callback */
-    if (!job->running) {
-        ellDelete(&pool->owned, &job->jobnode);
-        ellAdd(&pool->jobs, &job->jobnode);
+    else if (job->queued)
+        ret = 0;
+    else if (job->running) {
+        /* Job queued from within a callback.  Its worker re-adds it
+         * when the callback returns.
+         */
+        job->queued = 1;
+        ret = 0;
     }
     else {
-        /* some worker will find it again before sleeping */
-        goto done;
+        job->queued = 1;
+        addJob(pool, runq, job);
     }
 
-    /* Since we hold the lock, we can be certain that all awake worker are
-     * executing work functions.  The current thread may be a worker.
-     * We prefer to wakeup a new worker rather then wait for a busy worker to
-     * finish.  However, after we initiate a wakeup there will be a race
+    if (runq != q)
+        epicsMutexUnlock(runq->lock);
+    epicsMutexUnlock(q->lock);
+    return ret;
+}
+
+/* Wake or start a worker for each of njobs newly queued jobs.  Workers
+ * to be woken are added to the *pwake chain so that the caller can
+ * signal them after unlocking the guard.  Fails if the pool has no
+ * workers and none could be started.
+ */
+static
+int wakeLocked(epicsThreadPool *pool, unsigned int njobs, poolWorker **pwake)
+{
+    /* We prefer to wakeup a new worker rather then wait for a busy worker
+     * to finish.  However, after we initiate a wakeup there will be a race
      * between the worker waking up, and a busy worker finishing.
      * Thus we can't avoid spurious wakeups.
      */
+    while (njobs--) {
+        poolWorker *worker;
 
-    if (pool->threadsRunning >= pool->conf.maxThreads) {
-        /* all workers created... */
-        /* ... but some are sleeping, so wake one up */
-        if (pool->threadsWaking < pool->threadsSleeping) {
-            pool->threadsWaking++;
-            epicsEventSignal(pool->workerWakeup);
+        if ((worker = wakeSleeper(pool)) != NULL) {
+            worker->wakenext = *pwake;
+            *pwake = worker;
+        }
+        else if (pool->threadsRunning < pool->conf.maxThreads) {
+            /* all sleeping workers have already been woken.
+             * start a new worker for this job
+             */
+            if (createPoolThread(pool, 1) && pool->threadsRunning == 0)
+                return S_pool_noThreads;
         }
         /*else one of the running workers will find this job before sleeping */
-        CHECKCOUNT(pool);
+    }
+    CHECKCOUNT(pool);
+    return 0;
+}
 
+/* Signalling the wakeup events after unlocking lets the workers
+ * take the guard without first waiting for us to release it.
+ */
+static
+void wakeWorkers(poolWorker *wake)
+{
+    while (wake) {
+        poolWorker *next = wake->wakenext;
+
+        epicsEventSignal(wake->wakeup);
+        wake = next;
     }
-    else {
-        /* could create more workers so
-         * will either create a new worker, or wakeup an existing worker
+}
+
+/* Wake workers for njobs newly queued jobs.  The guard is only needed
+ * if some worker is idle or another may be started.  Otherwise a worker
+ * about to sleep is certain to see pool->jobsQueued, which was raised
+ * before pool->idle is read here.
+ */
+static
+int wakeForJobs(epicsThreadPool *pool, epicsJob **jobs, unsigned int njobs,
+                unsigned int nqueued)
+{
+    poolWorker *wake = NULL;
+    int ret = 0;
+
+    if (!nqueued)
+        return 0;
+    if (!epicsAtomicGetIntT(&pool->idle) &&
+        epicsAtomicGetIntT(&pool->nworkers) >= (int)pool->conf.maxThreads)
+        return 0;
+
+    epicsMutexMustLock(pool->guard);
+    if (wakeLocked(pool, nqueued, &wake)) {
+        unsigned int i;
+
+        /* oops, we couldn't lazy create our first worker
+         * so these jobs would never run!
          */
+        for (i = 0; i < njobs; i++) {
+            if (jobs[i]->pool == pool) {
+                poolQueue *q = lockJob(jobs[i]);
 
-        if (pool->threadsWaking >= pool->threadsSleeping) {
-            /* all sleeping workers have already been woken.
-             * start a new worker for this job
-             */
-            if (createPoolThread(pool) && pool->threadsRunning == 0) {
-                /* oops, we couldn't lazy create our first worker
-                 * so this job would never run!
-                 */
-                ret = S_pool_noThreads;
-                job->queued = 0;
                 /* if threadsRunning==0 then no jobs can be running */
-                assert(!job->running);
-                ellDelete(&pool->jobs, &job->jobnode);
-                ellAdd(&pool->owned, &job->jobnode);
+                assert(!jobs[i]->running);
+                unqueueLocked(pool, jobs[i]);
+                epicsMutexUnlock(q->lock);
             }
         }
-        if (ret == 0) {
-            pool->threadsWaking++;
-            epicsEventSignal(pool->workerWakeup);
-        }
-        CHECKCOUNT(pool);
+        ret = S_pool_noThreads;
     }
-
-done:
     epicsMutexUnlock(pool->guard);
+
+    wakeWorkers(wake);
     return ret;
 }
 
+int epicsJobQueue(epicsJob *job)
+{
+    epicsThreadPool *pool = job->pool;
+    int ret, err;
+
+    if (!pool)
+        return S_pool_noPool;
+
+    ret = queueJob(pool, job, workerSelf(pool));
+    if (ret == 1) {
+        err = wakeForJobs(pool, &job, 1, 1);
+        ret = err ? err : 0;
+    }
+    return ret;
+}
+
+int epicsJobQueueMany(epicsJob **jobs, unsigned int njobs)
+{
+    int ret = 0, err;
+    unsigned int i, nqueued = 0;
+    epicsThreadPool *pool;
+    poolWorker *self;
+
+    if (!njobs)
+        return 0;
+    pool = jobs[0]->pool;
+    if (!pool)
+        return S_pool_noPool;
+
+    self = workerSelf(pool);
+
+    for (i = 0; i < njobs; i++) {
+        err = jobs[i]->pool == pool ?
+            queueJob(pool, jobs[i], self) : S_pool_noPool;
+
+        if (err == 1)
+            nqueued++;
+        else if (err && !ret)
+            ret = err;
+    }
+
+    err = wakeForJobs(pool, jobs, njobs, nqueued);
+    return err ? err : ret;
+}
+
 int epicsJobUnqueue(epicsJob *job)
 {
-    int ret = S_pool_jobIdle;
+    int ret;
     epicsThreadPool *pool = job->pool;
+    poolQueue *q;
 
     if (!pool)
         return S_pool_noPool;
 
-    epicsMutexMustLock(pool->guard);
+    q = lockJob(job);
 
     assert(!job->dead);
 
-    if (job->queued) {
-        if (!job->running) {
-            ellDelete(&pool->jobs, &job->jobnode);
-            ellAdd(&pool->owned, &job->jobnode);
-        }
-        job->queued = 0;
-        ret = 0;
-    }
+    ret = unqueueLocked(pool, job);
 
-    epicsMutexUnlock(pool->guard);
+    epicsMutexUnlock(q->lock);
 
     return ret;
 }
 
+int epicsJobSetPriority(epicsJob *job, epicsJobPriority prio)
+{
+    epicsThreadPool *pool = job->pool;
+    poolQueue *q;
+
+    if (prio < epicsJobPriorityLow || prio > epicsJobPriorityHigh)
+        return S_pool_badPriority;
+
+    if (!pool) {
+        job->priority = prio;
+        return 0;
+    }
+
+    q = lockJob(job);
+
+    assert(!job->dead);
+
+    if (job->queued && !job->running) {
+        ellDelete(&q->jobs[job->priority], &job->jobnode);
+        job->priority = prio;
+        ellAdd(&q->jobs[prio], &job->jobnode);
+    }
+    else {
+        job->priority = prio;
+    }
+
+    epicsMutexUnlock(q->lock);
+
+    return 0;
+}
@@ -14,13 +14,64 @@
 #include "epicsThread.h"
 #include "epicsEvent.h"
 #include "epicsMutex.h"
+#include "epicsTypes.h"
+
+#define POOL_NPRIO (epicsJobPriorityHigh+1)
+
+/* A run queue, one list per priority.  Its lock also guards the state
+ * of each job whose home it is (see struct epicsJob).
+ *
+ * Lock order is pool->guard, then a worker's queue, then the pool queue.
+ * Other workers' queues are only taken with epicsMutexTryLock().
+ */
+typedef struct poolQueue {
+    epicsMutexId lock;
+    ELLLIST jobs[POOL_NPRIO];
+} poolQueue;
+
+/* Each worker has its own run queue.  Jobs queued from within a running
+ * job go to the queue of the worker running it.  Idle workers take jobs
+ * from their own queue, then from the pool queue, then steal from the
+ * other workers.
+ */
+typedef struct poolWorker {
+    ELLNODE sleepnode; /* in pool->sleepers while waiting for a job */
+    struct poolWorker *wakenext; /* wakeups to signal after unlock */
+    epicsThreadPool *pool;
+    epicsEventId wakeup;
+    unsigned int index; /* in pool->workerv */
+
+    poolQueue queue;
+
+    /* set with the wakeup counted in pool->threadsWaking */
+    unsigned int woken:1;
+    unsigned int picks;
+
+    /* statistics, guarded by queue.lock */
+    unsigned long nrun;
+    unsigned long nstolen;
+    epicsUInt64 started; /* ns */
+    epicsUInt64 busy; /* ns spent running jobs */
+} poolWorker;
 
 struct epicsThreadPool {
     ELLNODE sharedNode;
     size_t sharedCount;
 
-    ELLLIST jobs; /* run queue */
-    ELLLIST owned; /* unqueued jobs. */
+    poolQueue queue; /* jobs queued by other threads */
+    ELLLIST owned; /* all jobs of this pool, by ownednode */
+
+    /* conf.maxThreads entries, of which nworkers are in use.  Workers are
+     * only added, so nworkers may be read without the guard.
+     */
+    poolWorker **workerv;
+    int nworkers;
+    ELLLIST sleepers; /* idle workers not yet woken, most recent first */
+    int idle; /* # of workers in sleepers */
+
+    /* # of jobs in all run queues, and the largest value seen */
+    size_t jobsQueued;
+    size_t maxQueued;
 
     /* Worker state counters.
      * The life cycle of a worker is
@@ -32,7 +83,7 @@ struct epicsThreadPool {
     unsigned int threadsAreAwake;
     /* # of sleeping workers which need to be awakened */
     unsigned int threadsWaking;
-    /* # of workers waiting on the workerWakeup event */
+    /* # of workers waiting on their wakeup event */
     unsigned int threadsSleeping;
     /* # of threads started and not stopped */
     unsigned int threadsRunning;
@@ -40,19 +91,20 @@ struct epicsThreadPool {
     /* # of observers waiting on pool events */
     unsigned int observerCount;
 
-    epicsEventId workerWakeup;
     epicsEventId shutdownEvent;
 
     epicsEventId observerWakeup;
 
+    /* Changed with the guard held, but read without it */
     /* Disallow epicsJobQueue */
-    unsigned int pauseadd:1;
+    int pauseadd;
     /* Prevent workers from running new jobs */
-    unsigned int pauserun:1;
+    int pauserun;
+    /* tell workers to exit */
+    int shutdown;
+
     /* Prevent further changes to pool options */
     unsigned int freezeopt:1;
-    /* tell workers to exit */
-    unsigned int shutdown:1;
 
     epicsMutexId guard;
 
@@ -68,26 +120,32 @@ struct epicsThreadPool {
     } \
 } while(0)
 
-/* When created a job is idle.  queued and running are false
- * and jobnode is in the thread pool's owned list.
+/* When created a job is idle.  queued and running are false and its
+ * home is the pool queue.
  *
- * When the job is added, the queued flag is set and jobnode
- * is in the jobs list.
+ * When the job is added, the queued flag is set and jobnode is in the
+ * list for its priority in a run queue, which becomes its home.
  *
- * When the job starts running the queued flag is cleared and
- * the running flag is set.  jobnode is not in any list
- * (held locally by worker).
+ * When the job starts running the queued flag is cleared and the
+ * running flag is set.  jobnode is not in any list, and its home is
+ * the queue of the worker running it.
  *
  * When the job has finished running, the running flag is cleared.
- * The queued flag may be set if the job re-added itself.
- * Based on the queued flag jobnode is added to the appropriate
- * list.
+ * The queued flag may be set if the job re-added itself, in which
+ * case jobnode goes back into the worker's queue.
+ *
+ * The flags and jobnode are guarded by the lock of the job's home.
+ * The home only changes while both the old and new queues are locked.
+ * ownednode is guarded by pool->guard.
  */
 struct epicsJob {
     ELLNODE jobnode;
+    ELLNODE ownednode;
     epicsJobFunction func;
     void *arg;
     epicsThreadPool *pool;
+    poolQueue *home;
+    epicsJobPriority priority;
 
     unsigned int queued:1;
     unsigned int running:1;
@@ -99,7 +157,8 @@ struct epicsJob {
 extern "C" {
 #endif
 
-int createPoolThread(epicsThreadPool *pool);
+int createPoolThread(epicsThreadPool *pool, int woken);
+poolWorker* wakeSleeper(epicsThreadPool *pool);
 
 #ifdef __cplusplus
 }
@@ -12,12 +12,14 @@
 
 
 #include "dbDefs.h"
+#include "epicsAtomic.h"
 #include "errlog.h"
 #include "ellLib.h"
 #include "epicsThread.h"
 #include "epicsMutex.h"
 #include "epicsEvent.h"
 #include "epicsInterrupt.h"
+#include "epicsTime.h"
 #include "cantProceed.h"
 
 #include "epicsThreadPool.h"
@@ -58,22 +60,25 @@ epicsThreadPool* epicsThreadPoolCreate(epicsThreadPoolConfig *opts)
     if (pool->conf.initialThreads > pool->conf.maxThreads)
         pool->conf.initialThreads = pool->conf.maxThreads;
 
-    pool->workerWakeup = epicsEventCreate(epicsEventEmpty);
+    pool->workerv = calloc(pool->conf.maxThreads, sizeof(*pool->workerv));
     pool->shutdownEvent = epicsEventCreate(epicsEventEmpty);
     pool->observerWakeup = epicsEventCreate(epicsEventEmpty);
     pool->guard = epicsMutexCreate();
+    pool->queue.lock = epicsMutexCreate();
 
-    if (!pool->workerWakeup || !pool->shutdownEvent ||
-       !pool->observerWakeup || !pool->guard)
+    if (!pool->workerv || !pool->shutdownEvent ||
+       !pool->observerWakeup || !pool->guard || !pool->queue.lock)
         goto cleanup;
 
-    ellInit(&pool->jobs);
+    for (i = 0; i < POOL_NPRIO; i++)
+        ellInit(&pool->queue.jobs[i]);
     ellInit(&pool->owned);
+    ellInit(&pool->sleepers);
 
     epicsMutexMustLock(pool->guard);
 
     for (i = 0; i < pool->conf.initialThreads; i++) {
-        createPoolThread(pool);
+        createPoolThread(pool, 0);
     }
 
     if (pool->threadsRunning == 0 && pool->conf.initialThreads != 0) {
@@ -92,15 +97,16 @@ epicsThreadPool* epicsThreadPoolCreate(epicsThreadPoolConfig *opts)
     return pool;
 
 cleanup:
-    if (pool->workerWakeup)
-        epicsEventDestroy(pool->workerWakeup);
     if (pool->shutdownEvent)
         epicsEventDestroy(pool->shutdownEvent);
     if (pool->observerWakeup)
         epicsEventDestroy(pool->observerWakeup);
     if (pool->guard)
         epicsMutexDestroy(pool->guard);
+    if (pool->queue.lock)
+        epicsMutexDestroy(pool->queue.lock);
 
+    free(pool->workerv);
     free(pool);
     return NULL;
 }
@@ -112,35 +118,25 @@ void epicsThreadPoolControlImpl(epicsThreadPool *pool, epicsThreadPoolOption opt
         return;
 
     if (opt == epicsThreadPoolQueueAdd) {
-        pool->pauseadd = !val;
+        epicsAtomicSetIntT(&pool->pauseadd, !val);
     }
     else if (opt == epicsThreadPoolQueueRun) {
         if (!val && !pool->pauserun)
-            pool->pauserun = 1;
+            epicsAtomicSetIntT(&pool->pauserun, 1);
 
         else if (val && pool->pauserun) {
-            int jobs = ellCount(&pool->jobs);
-            pool->pauserun = 0;
-
-            if (jobs) {
-                int wakeable = pool->threadsSleeping - pool->threadsWaking;
-
-                /* first try to give jobs to sleeping workers */
-                if (wakeable) {
-                    int wakeup = jobs > wakeable ? wakeable : jobs;
-                    assert(wakeup > 0);
-                    jobs -= wakeup;
-                    pool->threadsWaking += wakeup;
-                    epicsEventSignal(pool->workerWakeup);
-                    CHECKCOUNT(pool);
-                }
+            size_t jobs = epicsAtomicGetSizeT(&pool->jobsQueued);
+            poolWorker *worker;
+            epicsAtomicSetIntT(&pool->pauserun, 0);
+
+            /* first try to give jobs to sleeping workers */
+            while (jobs && (worker = wakeSleeper(pool)) != NULL) {
+                jobs--;
+                epicsEventSignal(worker->wakeup);
             }
+            CHECKCOUNT(pool);
             while (jobs-- && pool->threadsRunning < pool->conf.maxThreads) {
-                if (createPoolThread(pool) == 0) {
-                    pool->threadsWaking++;
-                    epicsEventSignal(pool->workerWakeup);
-                }
-                else
+                if (createPoolThread(pool, 1) != 0)
                     break; /* oops, couldn't create worker */
             }
             CHECKCOUNT(pool);
@@ -162,7 +158,10 @@ int epicsThreadPoolWait(epicsThreadPool *pool, double timeout)
     int ret = 0;
     epicsMutexMustLock(pool->guard);
 
-    while (ellCount(&pool->jobs) > 0 || pool->threadsAreAwake > 0) {
+    /* Also wait for woken workers, which may not have been signalled yet */
+    while (epicsAtomicGetSizeT(&pool->jobsQueued) > 0 ||
+           pool->threadsAreAwake > 0 ||
+           pool->threadsWaking > 0) {
         pool->observerCount++;
         epicsMutexUnlock(pool->guard);
 
@@ -202,6 +201,8 @@ void epicsThreadPoolDestroy(epicsThreadPool *pool)
     unsigned int nThr;
     ELLLIST notify;
     ELLNODE *cur;
+    poolWorker *worker;
+    int i, n;
 
     if (!pool)
         return;
@@ -223,15 +224,13 @@ void epicsThreadPoolDestroy(epicsThreadPool *pool)
 
     epicsMutexMustLock(pool->guard);
 
-    pool->shutdown = 1;
+    epicsAtomicSetIntT(&pool->shutdown, 1);
     /* wakeup all */
-    if (pool->threadsWaking < pool->threadsSleeping) {
-        pool->threadsWaking = pool->threadsSleeping;
-        epicsEventSignal(pool->workerWakeup);
-    }
+    while ((worker = wakeSleeper(pool)) != NULL)
+        epicsEventSignal(worker->wakeup);
 
+    /* Every job which hasn't been freed, whether queued or not */
     ellConcat(&notify, &pool->owned);
-    ellConcat(&notify, &pool->jobs);
 
     epicsMutexUnlock(pool->guard);
 
@@ -244,36 +243,75 @@ void epicsThreadPoolDestroy(epicsThreadPool *pool)
 
     /* notify remaining jobs that pool is being destroyed */
     while ((cur = ellGet(&notify)) != NULL) {
-        epicsJob *job = CONTAINER(cur, epicsJob, jobnode);
+        epicsJob *job = CONTAINER(cur, epicsJob, ownednode);
 
         job->running = 1;
         job->func(job->arg, epicsJobModeCleanup);
         job->running = 0;
         if (job->freewhendone)
             free(job);
-        else
+        else {
             job->pool = NULL; /* orphan */
+            job->home = NULL;
+        }
+    }
+
+    /* Jobs may have used the queue locks until now */
+    n = epicsAtomicGetIntT(&pool->nworkers);
+    for (i = 0; i < n; i++) {
+        worker = pool->workerv[i];
+        epicsMutexDestroy(worker->queue.lock);
+        epicsEventDestroy(worker->wakeup);
+        free(worker);
     }
 
-    epicsEventDestroy(pool->workerWakeup);
     epicsEventDestroy(pool->shutdownEvent);
     epicsEventDestroy(pool->observerWakeup);
     epicsMutexDestroy(pool->guard);
+    epicsMutexDestroy(pool->queue.lock);
 
+    free(pool->workerv);
     free(pool);
 }
 
 
-void epicsThreadPoolReport(epicsThreadPool *pool, FILE *fd)
+static
+void reportJobs(ELLLIST *list, FILE *fd)
 {
     ELLNODE *cur;
+
+    for (cur = ellFirst(list); cur; cur = ellNext(cur)) {
+        epicsJob *job = CONTAINER(cur, epicsJob, jobnode);
+
+        fprintf(fd, "  job %p func: %p, arg: %p ",
+                job, job->func,
+                job->arg);
+        if (job->queued)
+            fprintf(fd, "Queued ");
+        if (job->running)
+            fprintf(fd, "Running ");
+        if (job->freewhendone)
+            fprintf(fd, "Free ");
+        fprintf(fd, "\n");
+    }
+}
+
+void epicsThreadPoolReport(epicsThreadPool *pool, FILE *fd)
+{
+    static const char * const prioName[POOL_NPRIO] = {"low", "medium", "high"};
+    epicsUInt64 now = epicsMonotonicGet();
+    unsigned int nqueued[POOL_NPRIO];
+    int i, w, n;
+
     epicsMutexMustLock(pool->guard);
 
+    n = epicsAtomicGetIntT(&pool->nworkers);
+
     fprintf(fd, "Thread Pool with %u/%u threads\n"
-            " running %d jobs with %u threads\n",
+            " running %u jobs with %u threads\n",
             pool->threadsRunning,
             pool->conf.maxThreads,
-            ellCount(&pool->jobs),
+            (unsigned int)epicsAtomicGetSizeT(&pool->jobsQueued),
             pool->threadsAreAwake);
     if (pool->pauseadd)
         fprintf(fd, "  Inhibit queueing\n");
@@ -282,19 +320,47 @@ void epicsThreadPoolReport(epicsThreadPool *pool, FILE *fd)
     if (pool->shutdown)
         fprintf(fd, "  Shutdown in progress\n");
 
-    for (cur = ellFirst(&pool->jobs); cur; cur = ellNext(cur)) {
-        epicsJob *job = CONTAINER(cur, epicsJob, jobnode);
+    epicsMutexMustLock(pool->queue.lock);
+    for (i = 0; i < POOL_NPRIO; i++)
+        nqueued[i] = ellCount(&pool->queue.jobs[i]);
+    epicsMutexUnlock(pool->queue.lock);
+    for (w = 0; w < n; w++) {
+        poolWorker *worker = pool->workerv[w];
+
+        epicsMutexMustLock(worker->queue.lock);
+        for (i = 0; i < POOL_NPRIO; i++)
+            nqueued[i] += ellCount(&worker->queue.jobs[i]);
+        epicsMutexUnlock(worker->queue.lock);
+    }
+    fprintf(fd, " queued high/medium/low %u/%u/%u, at most %u\n",
+            nqueued[epicsJobPriorityHigh], nqueued[epicsJobPriorityMedium],
+            nqueued[epicsJobPriorityLow],
+            (unsigned int)epicsAtomicGetSizeT(&pool->maxQueued));
+
+    for (w = 0; w < n; w++) {
+        poolWorker *worker = pool->workerv[w];
+        double age = (now - worker->started) * 1e-9;
+
+        epicsMutexMustLock(worker->queue.lock);
+        fprintf(fd, "  worker %p: ran %lu jobs, %lu stolen, %.1f%% busy\n",
+                worker, worker->nrun, worker->nstolen,
+                age > 0.0 ? 100.0 * worker->busy * 1e-9 / age : 0.0);
+        epicsMutexUnlock(worker->queue.lock);
+    }
 
-        fprintf(fd, "  job %p func: %p, arg: %p ",
-                job, job->func,
-                job->arg);
-        if (job->queued)
-            fprintf(fd, "Queued ");
-        if (job->running)
-            fprintf(fd, "Running ");
-        if (job->freewhendone)
-            fprintf(fd, "Free ");
-        fprintf(fd, "\n");
+    for (i = POOL_NPRIO - 1; i >= 0; i--) {
+        if (nqueued[i])
+            fprintf(fd, " %s priority\n", prioName[i]);
+        epicsMutexMustLock(pool->queue.lock);
+        reportJobs(&pool->queue.jobs[i], fd);
+        epicsMutexUnlock(pool->queue.lock);
+        for (w = 0; w < n; w++) {
+            poolWorker *worker = pool->workerv[w];
+
+            epicsMutexMustLock(worker->queue.lock);
+            reportJobs(&worker->queue.jobs[i], fd);
+            epicsMutexUnlock(worker->queue.lock);
+        }
     }
 
     epicsMutexUnlock(pool->guard);
@@ -21,6 +21,7 @@
 #include <stddef.h>
 #include <stdio.h>
 
+#include "epicsAtomic.h"
 #include "epicsSpin.h"
 #include "dbDefs.h"
 #include "epicsRingBytes.h"
@@ -33,15 +34,41 @@
  */
 #define SLOP    16
 
+/*
+ * The writer and the reader update their index on separate cache lines.
+ */
+#define CACHE_LINE 64
+
 typedef struct ringPvt {
     epicsSpinId    lock;
-    volatile int   nextPut;
-    volatile int   nextGet;
     int            size;
+    char           pad0[CACHE_LINE];
+    int            nextPut;
     int            highWaterMark;
+    char           pad1[CACHE_LINE];
+    int            nextGet;
+    char           pad2[CACHE_LINE];
     volatile char buffer[1]; /* actually larger */
 }ringPvt;
 
+/*
+ * Without the lock, the reader only reads nextPut and the writer only
+ * reads nextGet.  Whoever owns the index stores it after copying the data,
+ * the other side loads it before copying.
+ */
+static int loadAcquire(const int *p)
+{
+    int val = epicsAtomicGetIntT(p);
+    epicsAtomicReadMemoryBarrier();
+    return val;
+}
+
+static void storeRelease(int *p, int val)
+{
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetIntT(p, val);
+}
+
 LIBCOM_API epicsRingBytesId  epicsStdCall epicsRingBytesCreate(int size)
 {
     ringPvt *pring = malloc(sizeof(ringPvt) + size + SLOP);
@@ -80,7 +107,7 @@ LIBCOM_API int epicsStdCall epicsRingBytesGet(
 
     if (pring->lock) epicsSpinLock(pring->lock);
     nextGet = pring->nextGet;
-    nextPut = pring->nextPut;
+    nextPut = loadAcquire(&pring->nextPut);
     size = pring->size;
 
     if (nextGet <= nextPut) {
@@ -109,7 +136,7 @@ LIBCOM_API int epicsStdCall epicsRingBytesGet(
             nbytes = count;
         }
     }
-    pring->nextGet = nextGet;
+    storeRelease(&pring->nextGet, nextGet);
 
     if (pring->lock) epicsSpinUnlock(pring->lock);
     return nbytes;
@@ -123,7 +150,7 @@ LIBCOM_API int epicsStdCall epicsRingBytesPut(
     int freeCount, copyCount, topCount, used;
 
     if (pring->lock) epicsSpinLock(pring->lock);
-    nextGet = pring->nextGet;
+    nextGet = loadAcquire(&pring->nextGet);
     nextPut = pring->nextPut;
     size = pring->size;
 
@@ -157,7 +184,7 @@ LIBCOM_API int epicsStdCall epicsRingBytesPut(
             nextPut = nLeft;
         }
     }
-    pring->nextPut = nextPut;
+    storeRelease(&pring->nextPut, nextPut);
 
     used = nextPut - nextGet;
     if (used < 0) used += pring->size;
@@ -172,7 +199,7 @@ LIBCOM_API void epicsStdCall epicsRingBytesFlush(epicsRingBytesId id)
     ringPvt *pring = (ringPvt *)id;
 
     if (pring->lock) epicsSpinLock(pring->lock);
-    pring->nextGet = pring->nextPut;
+    storeRelease(&pring->nextGet, loadAcquire(&pring->nextPut));
     if (pring->lock) epicsSpinUnlock(pring->lock);
 }
 
@@ -182,8 +209,8 @@ LIBCOM_API int epicsStdCall epicsRingBytesFreeBytes(epicsRingBytesId id)
     int nextGet, nextPut;
 
     if (pring->lock) epicsSpinLock(pring->lock);
-    nextGet = pring->nextGet;
-    nextPut = pring->nextPut;
+    nextGet = loadAcquire(&pring->nextGet);
+    nextPut = loadAcquire(&pring->nextPut);
     if (pring->lock) epicsSpinUnlock(pring->lock);
 
     if (nextPut < nextGet)
@@ -199,8 +226,8 @@ LIBCOM_API int epicsStdCall epicsRingBytesUsedBytes(epicsRingBytesId id)
     int used;
 
     if (pring->lock) epicsSpinLock(pring->lock);
-    nextGet = pring->nextGet;
-    nextPut = pring->nextPut;
+    nextGet = loadAcquire(&pring->nextGet);
+    nextPut = loadAcquire(&pring->nextPut);
     if (pring->lock) epicsSpinUnlock(pring->lock);
 
     used = nextPut - nextGet;
@@ -222,7 +249,8 @@ LIBCOM_API int epicsStdCall epicsRingBytesIsEmpty(epicsRingBytesId id)
     int isEmpty;
 
     if (pring->lock) epicsSpinLock(pring->lock);
-    isEmpty = (pring->nextPut == pring->nextGet);
+    isEmpty = (loadAcquire(&pring->nextPut) ==
+               loadAcquire(&pring->nextGet));
     if (pring->lock) epicsSpinUnlock(pring->lock);
 
     return isEmpty;
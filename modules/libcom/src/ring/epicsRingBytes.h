@@ -23,6 +23,8 @@
  * \note If there is only one writer it is not necessary to lock for puts.
  * If there is a single reader it is not necessary to lock for gets.
  * epicsRingBytesLocked uses a spinlock.
+ * \note The index the writer updates and the index the reader updates are
+ * kept on separate cache lines.
  */
 
 #ifndef INCepicsRingBytesh
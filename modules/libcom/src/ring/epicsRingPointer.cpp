@@ -37,6 +37,12 @@ LIBCOM_API epicsRingPointerId  epicsStdCall epicsRingPointerLockedCreate(int siz
     return(reinterpret_cast<void *>(pvoidPointer));
 }
 
+LIBCOM_API epicsRingPointerId  epicsStdCall epicsRingPointerMPSCCreate(int size)
+{
+    voidPointer *pvoidPointer = new voidPointer(size, false, true);
+    return(reinterpret_cast<void *>(pvoidPointer));
+}
+
 LIBCOM_API void epicsStdCall epicsRingPointerDelete(epicsRingPointerId id)
 {
     voidPointer *pvoidPointer = reinterpret_cast<voidPointer*>(id);
@@ -55,6 +61,20 @@ LIBCOM_API int epicsStdCall epicsRingPointerPush(epicsRingPointerId id, void *p)
     return((pvoidPointer->push(p) ? 1 : 0));
 }
 
+LIBCOM_API int epicsStdCall epicsRingPointerPushMany(epicsRingPointerId id,
+    void * const *p, int n)
+{
+    voidPointer *pvoidPointer = reinterpret_cast<voidPointer*>(id);
+    return pvoidPointer->pushMany(p, n);
+}
+
+LIBCOM_API int epicsStdCall epicsRingPointerPopMany(epicsRingPointerId id,
+    void **p, int n)
+{
+    voidPointer *pvoidPointer = reinterpret_cast<voidPointer*>(id);
+    return pvoidPointer->popMany(p, n);
+}
+
 LIBCOM_API void epicsStdCall epicsRingPointerFlush(epicsRingPointerId id)
 {
     voidPointer *pvoidPointer = reinterpret_cast<voidPointer*>(id);
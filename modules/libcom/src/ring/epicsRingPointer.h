@@ -17,18 +17,25 @@
  * epicsRingPointer.h provides both C and C++ APIs for creating and using ring
  * buffers (first in first out circular buffers) that store pointers. The
  * unlocked kind is designed so that one writer thread and one reader thread
- * can access the ring simultaneously without requiring mutual exclusion. The
+ * can access the ring simultaneously without requiring mutual exclusion,
+ * and neither ever has to wait for the other. The MPSC kind allows any
+ * number of writer threads and one reader thread, without locking. The
  * locked variant uses an epicsSpinLock, and works with any numbers of writer
  * and reader threads.
  * \note If there is only one writer it is not necessary to lock pushes.
  * If there is a single reader it is not necessary to lock pops.
  * epicsRingPointerLocked uses a spinlock.
+ * \note The index the writers update and the index the reader updates are
+ * kept on separate cache lines.
  */
 
 #ifndef INCepicsRingPointerh
 #define INCepicsRingPointerh
 
 
+#include <stddef.h>
+
+#include "epicsAtomic.h"
 #include "epicsSpin.h"
 #include "libComAPI.h"
 
@@ -44,8 +51,10 @@ public: /* Functions */
     /**\brief Constructor
      * \param size Maximum number of elements (pointers) that can be stored
      * \param locked If true, the spin lock secured variant is created
+     * \param multiPush If true, any number of threads may push without
+     * locking. Such a ring can't hold NULL pointers.
      */
-    epicsRingPointer(int size, bool locked);
+    epicsRingPointer(int size, bool locked, bool multiPush = false);
     /**\brief Destructor
      */
     ~epicsRingPointer();
@@ -57,6 +66,17 @@ public: /* Functions */
      * \return The element, or NULL if the ring was empty
      */
     T* pop();
+    /**\brief Push several entries on the ring
+     *
+     * Stores as many of the \c n entries as there is space for, in order.
+     * A ring created with \c multiPush stops at the first NULL entry.
+     * \return The number of entries pushed
+     */
+    int pushMany(T * const *p, int n);
+    /**\brief Take up to \c n elements off the ring
+     * \return The number of elements stored into \c p
+     */
+    int popMany(T **p, int n);
     /**\brief Remove all elements from the ring.
      * \note If this operation is performed on a ring buffer of the
      * unsecured kind, all access to the ring should be locked.
@@ -102,14 +122,24 @@ private: /* Prevent compiler-generated member functions */
     epicsRingPointer(const epicsRingPointer &);
     epicsRingPointer& operator=(const epicsRingPointer &);
     int getUsedNoLock() const;
+    static size_t loadAcquire(const size_t *p);
+    static void storeRelease(size_t *p, size_t val);
+
+    enum { cacheLine = 64 };
 
 private: /* Data */
     epicsSpinId lock;
-    volatile int nextPush;
-    volatile int nextPop;
     int size;
-    int highWaterMark;
+    size_t mask;
+    bool multiPush;
     T  * volatile * buffer;
+    /* nextPush and nextPop count all entries ever pushed and popped */
+    char pad0[cacheLine];
+    size_t nextPush;
+    int highWaterMark;
+    char pad1[cacheLine];
+    size_t nextPop;
+    char pad2[cacheLine];
 };
 
 extern "C" {
@@ -130,6 +160,19 @@ LIBCOM_API epicsRingPointerId  epicsStdCall epicsRingPointerCreate(int size);
  * \return Ring buffer identifier or NULL on failure
  */
 LIBCOM_API epicsRingPointerId  epicsStdCall epicsRingPointerLockedCreate(int size);
+/**
+ * \brief Create a new ring buffer for many writers and one reader
+ *
+ * Any number of threads may push to this ring without locking, but only
+ * one may pop from it. NULL pointers can't be pushed.
+ * While the entry at the head of the ring is still being written
+ * epicsRingPointerIsEmpty() returns 1 and epicsRingPointerPop() NULL,
+ * although epicsRingPointerGetUsed() counts it.
+ * \param size Size of ring buffer to create
+ * \return Ring buffer identifier or NULL on failure
+ * \since UNRELEASED
+ */
+LIBCOM_API epicsRingPointerId  epicsStdCall epicsRingPointerMPSCCreate(int size);
 /**
  * \brief Delete the ring buffer and free any associated memory
  * \param id Ring buffer identifier
@@ -148,6 +191,27 @@ LIBCOM_API int  epicsStdCall epicsRingPointerPush(epicsRingPointerId id,void *p)
  * \return The pointer from the buffer, or NULL if the ring was empty
  */
 LIBCOM_API void* epicsStdCall epicsRingPointerPop(epicsRingPointerId id) ;
+/**
+ * \brief Push several pointers into the ring buffer
+ * \param id Ring buffer identifier
+ * \param p Array of pointers to be pushed to the ring
+ * \param n Number of pointers in \c p
+ * \return The number of pointers pushed, less than \c n if the ring
+ * filled up
+ * \since UNRELEASED
+ */
+LIBCOM_API int  epicsStdCall epicsRingPointerPushMany(epicsRingPointerId id,
+    void * const *p, int n);
+/**
+ * \brief Take up to \c n elements off the ring
+ * \param id Ring buffer identifier
+ * \param p Where to store the pointers
+ * \param n Maximum number of pointers to take
+ * \return The number of pointers stored into \c p
+ * \since UNRELEASED
+ */
+LIBCOM_API int  epicsStdCall epicsRingPointerPopMany(epicsRingPointerId id,
+    void **p, int n);
 /**
  * \brief Remove all elements from the ring
  * \param id Ring buffer identifier
@@ -217,10 +281,16 @@ LIBCOM_API void epicsStdCall epicsRingPointerResetHighWaterMark(epicsRingPointer
 #ifdef __cplusplus
 
 template <class T>
-inline epicsRingPointer<T>::epicsRingPointer(int sz, bool locked) :
-    lock(0), nextPush(0), nextPop(0), size(sz+1), highWaterMark(0),
-    buffer(new T* [sz+1])
+inline epicsRingPointer<T>::epicsRingPointer(int sz, bool locked,
+        bool mpsc) :
+    lock(0), size(sz), mask(0), multiPush(mpsc), buffer(0),
+    nextPush(0), highWaterMark(0), nextPop(0)
 {
+    size_t n = 1;
+    while (n < size_t(sz)) n <<= 1;
+    mask = n - 1;
+    buffer = new T* [n];
+    for (size_t i = 0; i < n; i++) buffer[i] = 0;
     if (locked)
         lock = epicsSpinCreate();
 }
@@ -232,67 +302,126 @@ inline epicsRingPointer<T>::~epicsRingPointer()
     delete [] buffer;
 }
 
+template <class T>
+inline size_t epicsRingPointer<T>::loadAcquire(const size_t *p)
+{
+    size_t val = epicsAtomicGetSizeT(p);
+    epicsAtomicReadMemoryBarrier();
+    return val;
+}
+
+template <class T>
+inline void epicsRingPointer<T>::storeRelease(size_t *p, size_t val)
+{
+    epicsAtomicWriteMemoryBarrier();
+    epicsAtomicSetSizeT(p, val);
+}
+
 template <class T>
 inline bool epicsRingPointer<T>::push(T *p)
 {
+    return pushMany(&p, 1) == 1;
+}
+
+template <class T>
+inline T* epicsRingPointer<T>::pop()
+{
+    T *p;
+    return popMany(&p, 1) ? p : 0;
+}
+
+template <class T>
+inline int epicsRingPointer<T>::pushMany(T * const *p, int n)
+{
+    size_t next, used;
+    int i;
+
     if (lock) epicsSpinLock(lock);
-    int next = nextPush;
-    int newNext = next + 1;
-    if(newNext>=size) newNext=0;
-    if (newNext == nextPop) {
-        if (lock) epicsSpinUnlock(lock);
-        return(false);
+    if (multiPush) {
+        /* An empty slot tells the reader it hasn't been written yet */
+        for (i = 0; i < n && p[i]; i++) {}
+        n = i;
+        for (;;) {
+            used = loadAcquire(&nextPop);
+            next = epicsAtomicGetSizeT(&nextPush);
+            used = next - used;
+            if (n > size - int(used)) n = size - int(used);
+            if (n <= 0) break;
+            size_t old = epicsAtomicCmpAndSwapSizeT(&nextPush, next, next + n);
+            if (old == next) break;
+        }
+        if (n > 0) {
+            epicsAtomicWriteMemoryBarrier();
+            for (i = 0; i < n; i++)
+                buffer[(next + i) & mask] = p[i];
+        }
+    }
+    else {
+        next = nextPush;
+        used = next - loadAcquire(&nextPop);
+        if (n > size - int(used)) n = size - int(used);
+        for (i = 0; i < n; i++)
+            buffer[(next + i) & mask] = p[i];
+        if (n > 0)
+            storeRelease(&nextPush, next + n);
     }
-    buffer[next] = p;
-    nextPush = newNext;
-    int used = getUsedNoLock();
-    if (used > highWaterMark) highWaterMark = used;
+    if (n > 0 && int(used) + n > highWaterMark)
+        highWaterMark = int(used) + n;
     if (lock) epicsSpinUnlock(lock);
-    return(true);
+    return n > 0 ? n : 0;
 }
 
 template <class T>
-inline T* epicsRingPointer<T>::pop()
+inline int epicsRingPointer<T>::popMany(T **p, int n)
 {
+    size_t next;
+    int i;
+
     if (lock) epicsSpinLock(lock);
-    int next = nextPop;
-    if (next == nextPush) {
-        if (lock) epicsSpinUnlock(lock);
-        return(0);
+    next = nextPop;
+    if (multiPush) {
+        for (i = 0; i < n; i++) {
+            T *q = buffer[(next + i) & mask];
+            if (!q) break;
+            p[i] = q;
+            buffer[(next + i) & mask] = 0;
+        }
+        epicsAtomicReadMemoryBarrier();
+    }
+    else {
+        int avail = int(loadAcquire(&nextPush) - next);
+        if (n > avail) n = avail;
+        for (i = 0; i < n; i++)
+            p[i] = buffer[(next + i) & mask];
     }
-    T*p  = buffer[next];
-    ++next;
-    if(next >=size) next = 0;
-    nextPop = next;
+    if (i > 0)
+        storeRelease(&nextPop, next + i);
     if (lock) epicsSpinUnlock(lock);
-    return(p);
+    return i;
 }
 
 template <class T>
 inline void epicsRingPointer<T>::flush()
 {
     if (lock) epicsSpinLock(lock);
-    nextPop = 0;
-    nextPush = 0;
+    size_t next = loadAcquire(&nextPush);
+    for (size_t i = nextPop; i != next; i++)
+        buffer[i & mask] = 0;
+    storeRelease(&nextPop, next);
     if (lock) epicsSpinUnlock(lock);
 }
 
 template <class T>
 inline int epicsRingPointer<T>::getFree() const
 {
-    if (lock) epicsSpinLock(lock);
-    int n = nextPop - nextPush - 1;
-    if (n < 0) n += size;
-    if (lock) epicsSpinUnlock(lock);
-    return n;
+    return size - getUsed();
 }
 
 template <class T>
 inline int epicsRingPointer<T>::getUsedNoLock() const
 {
-    int n = nextPush - nextPop;
-    if (n < 0) n += size;
-    return n;
+    size_t pop = loadAcquire(&nextPop);
+    return int(loadAcquire(&nextPush) - pop);
 }
 
 template <class T>
@@ -307,7 +436,7 @@ inline int epicsRingPointer<T>::getUsed() const
 template <class T>
 inline int epicsRingPointer<T>::getSize() const
 {
-    return(size-1);
+    return size;
 }
 
 template <class T>
@@ -315,7 +444,10 @@ inline bool epicsRingPointer<T>::isEmpty() const
 {
     bool isEmpty;
     if (lock) epicsSpinLock(lock);
-    isEmpty = (nextPush == nextPop);
+    if (multiPush)
+        isEmpty = !buffer[loadAcquire(&nextPop) & mask];
+    else
+        isEmpty = (getUsedNoLock() == 0);
     if (lock) epicsSpinUnlock(lock);
     return isEmpty;
 }
@@ -323,10 +455,7 @@ inline bool epicsRingPointer<T>::isEmpty() const
 template <class T>
 inline bool epicsRingPointer<T>::isFull() const
 {
-    if (lock) epicsSpinLock(lock);
-    int count = nextPush - nextPop +1;
-    if (lock) epicsSpinUnlock(lock);
-    return((count == 0) || (count == size));
+    return getUsed() >= size;
 }
 
 template <class T>
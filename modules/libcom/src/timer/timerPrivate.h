@@ -17,7 +17,9 @@
 #define epicsTimerPrivate_h
 
 #include <typeinfo>
+#include <vector>
 
+#include "epicsTypes.h"
 #include "tsFreeList.h"
 #include "epicsSingleton.h"
 #include "tsDLList.h"
@@ -32,7 +34,7 @@
 
 template < class T > class epicsGuard;
 
-class timer : public epicsTimer, public tsDLNode < timer > {
+class timer : public epicsTimer {
 public:
     void destroy ();
     void start ( class epicsTimerNotify &, const epicsTime & );
@@ -49,6 +51,8 @@ protected:
 private:
     enum state { statePending = 45, stateActive = 56, stateLimbo = 78 };
     epicsTime exp; // expiration time
+    epicsUInt64 startSeq; // orders timers with equal expiration times
+    size_t heapIndex; // position in timerQueue::timerHeap while pending
     state curState; // current state
     epicsTimerNotify * pNotify; // callback
     void privateStart ( epicsTimerNotify & notify, const epicsTime & );
@@ -99,15 +103,24 @@ private:
     tsFreeList < epicsTimerForC, 0x20 > timerForCFreeList;
     mutable epicsMutex mutex;
     epicsEvent cancelBlockingEvent;
-    tsDLList < timer > timerList;
+    // pending timers, a binary min-heap ordered by expiration time
+    std :: vector < timer * > timerHeap;
     epicsTimerQueueNotify & notify;
     timer * pExpireTmr;
     epicsThreadId processThread;
     epicsTime exceptMsgTimeStamp;
+    epicsUInt64 startCount;
     bool cancelPending;
     static const double exceptMsgMinPeriod;
     void printExceptMsg ( const char * pName,
                 const type_info & type );
+    timer * first () const;
+    bool earlier ( const timer &, const timer & ) const;
+    void heapPlace ( size_t index, timer & );
+    void heapUp ( size_t index, timer & );
+    void heapDown ( size_t index, timer & );
+    bool insert ( timer & );
+    void remove ( timer & );
     timerQueue ( const timerQueue & );
     timerQueue & operator = ( const timerQueue & );
     friend class timer;
@@ -236,6 +249,19 @@ inline unsigned timerQueueActive::threadPriority () const
     return thread.getPriority ();
 }
 
+inline timer * timerQueue::first () const
+{
+    return this->timerHeap.empty () ? 0 : this->timerHeap.front ();
+}
+
+inline bool timerQueue::earlier ( const timer & a, const timer & b ) const
+{
+    if ( a.exp < b.exp ) {
+        return true;
+    }
+    return a.exp == b.exp && a.startSeq < b.startSeq;
+}
+
 inline void * timer::operator new ( size_t size,
                      tsFreeList < timer, 0x20 > & freeList )
 {
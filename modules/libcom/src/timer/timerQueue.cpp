@@ -31,15 +31,85 @@ timerQueue::timerQueue ( epicsTimerQueueNotify & notifyIn ) :
     processThread ( 0 ),
     exceptMsgTimeStamp (
         epicsTime :: getCurrent () - exceptMsgMinPeriod ),
+    startCount ( 0u ),
     cancelPending ( false )
 {
 }
 
 timerQueue::~timerQueue ()
 {
-    timer *pTmr;
-    while ( ( pTmr = this->timerList.get () ) ) {
-        pTmr->curState = timer::stateLimbo;
+    for ( size_t i = 0u; i < this->timerHeap.size (); i++ ) {
+        this->timerHeap[i]->curState = timer::stateLimbo;
+    }
+}
+
+inline void timerQueue::heapPlace ( size_t index, timer & tmr )
+{
+    this->timerHeap[index] = & tmr;
+    tmr.heapIndex = index;
+}
+
+// move tmr from index towards the root until its parent is earlier
+void timerQueue::heapUp ( size_t index, timer & tmr )
+{
+    while ( index > 0u ) {
+        size_t parent = ( index - 1u ) / 2u;
+        timer & up = * this->timerHeap[parent];
+        if ( ! this->earlier ( tmr, up ) ) {
+            break;
+        }
+        this->heapPlace ( index, up );
+        index = parent;
+    }
+    this->heapPlace ( index, tmr );
+}
+
+// move tmr from index towards the leaves until no child is earlier
+void timerQueue::heapDown ( size_t index, timer & tmr )
+{
+    const size_t count = this->timerHeap.size ();
+    while ( true ) {
+        size_t child = 2u * index + 1u;
+        if ( child >= count ) {
+            break;
+        }
+        if ( child + 1u < count && this->earlier (
+                * this->timerHeap[child + 1u], * this->timerHeap[child] ) ) {
+            child++;
+        }
+        timer & down = * this->timerHeap[child];
+        if ( ! this->earlier ( down, tmr ) ) {
+            break;
+        }
+        this->heapPlace ( index, down );
+        index = child;
+    }
+    this->heapPlace ( index, tmr );
+}
+
+// add a timer, returns true if it is now the first to expire
+bool timerQueue::insert ( timer & tmr )
+{
+    tmr.startSeq = this->startCount++;
+    this->timerHeap.push_back ( & tmr );
+    this->heapUp ( this->timerHeap.size () - 1u, tmr );
+    return tmr.heapIndex == 0u;
+}
+
+void timerQueue::remove ( timer & tmr )
+{
+    size_t index = tmr.heapIndex;
+    timer & last = * this->timerHeap.back ();
+    this->timerHeap.pop_back ();
+    if ( & last != & tmr ) {
+        // fill the hole with the last timer, which may have to go either way
+        if ( index > 0u && this->earlier ( last,
+                * this->timerHeap[( index - 1u ) / 2u] ) ) {
+            this->heapUp ( index, last );
+        }
+        else {
+            this->heapDown ( index, last );
+        }
     }
 }
 
@@ -83,7 +153,7 @@ double timerQueue::process ( const epicsTime & currentTime )
     if ( this->pExpireTmr ) {
         // if some other thread is processing the queue
         // (or if this is a recursive call)
-        timer * pTmr = this->timerList.first ();
+        timer * pTmr = this->first ();
         if ( pTmr ) {
             double delay = pTmr->exp - currentTime;
             if ( delay < 0.0 ) {
@@ -100,10 +170,10 @@ double timerQueue::process ( const epicsTime & currentTime )
     // Tag current expired tmr so that we can detect if call back
     // is in progress when canceling the timer.
     //
-    if ( this->timerList.first () ) {
-        if ( currentTime >= this->timerList.first ()->exp ) {
-            this->pExpireTmr = this->timerList.first ();
-            this->timerList.remove ( *this->pExpireTmr );
+    if ( this->first () ) {
+        if ( currentTime >= this->first ()->exp ) {
+            this->pExpireTmr = this->first ();
+            this->remove ( *this->pExpireTmr );
             this->pExpireTmr->curState = timer::stateActive;
             this->processThread = epicsThreadGetIdSelf ();
 #           ifdef DEBUG
@@ -111,7 +181,7 @@ double timerQueue::process ( const epicsTime & currentTime )
 #           endif
         }
         else {
-            double delay = this->timerList.first ()->exp - currentTime;
+            double delay = this->first ()->exp - currentTime;
             debugPrintf ( ( "no activity process %f to next\n", delay ) );
             return delay;
         }
@@ -178,17 +248,17 @@ double timerQueue::process ( const epicsTime & currentTime )
         }
         this->pExpireTmr = 0;
 
-        if ( this->timerList.first () ) {
-            if ( currentTime >= this->timerList.first ()->exp ) {
-                this->pExpireTmr = this->timerList.first ();
-                this->timerList.remove ( *this->pExpireTmr );
+        if ( this->first () ) {
+            if ( currentTime >= this->first ()->exp ) {
+                this->pExpireTmr = this->first ();
+                this->remove ( *this->pExpireTmr );
                 this->pExpireTmr->curState = timer::stateActive;
 #               ifdef DEBUG
                     this->pExpireTmr->show ( 0u );
 #               endif
             }
             else {
-                delay = this->timerList.first ()->exp - currentTime;
+                delay = this->first ()->exp - currentTime;
                 this->processThread = 0;
                 break;
             }
@@ -215,12 +285,12 @@ epicsTimerForC & timerQueue::createTimerForC ( epicsTimerCallback pCallback, voi
 void timerQueue::show ( unsigned level ) const
 {
     epicsGuard < epicsMutex > locker ( this->mutex );
-    printf ( "epicsTimerQueue with %u items pending\n", this->timerList.count () );
+    printf ( "epicsTimerQueue with %u items pending\n",
+        static_cast < unsigned > ( this->timerHeap.size () ) );
     if ( level >= 1u ) {
-        tsDLIterConst < timer > iter = this->timerList.firstIter ();
-        while ( iter.valid () ) {
-            iter->show ( level - 1u );
-            ++iter;
+        // heap order, only the first timer listed is the next to expire
+        for ( size_t i = 0u; i < this->timerHeap.size (); i++ ) {
+            this->timerHeap[i]->show ( level - 1u );
         }
     }
 }
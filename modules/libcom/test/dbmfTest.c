@@ -0,0 +1,190 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbmf.h"
+#include "epicsStdio.h"
+#include "epicsTempFile.h"
+#include "epicsUnitTest.h"
+#include "testMain.h"
+
+/* What dbmfShow(0) reports */
+typedef struct {
+    unsigned long size, blockSize, firstBlock;
+    int nAlloc, nFree, nChunks, nGtSize;
+    unsigned long inUse, peak, blockBytes, blockPeak;
+    unsigned long calls, fallback;
+} dbmfStats;
+
+static int getStats(dbmfStats *st)
+{
+    FILE *fp = epicsTempFile();
+    char line[3][160];
+    int ok;
+
+    if (!fp)
+        return 0;
+    epicsSetThreadStdout(fp);
+    dbmfShow(0);
+    epicsSetThreadStdout(NULL);
+    rewind(fp);
+
+    ok = fgets(line[0], sizeof(line[0]), fp) &&
+        fgets(line[1], sizeof(line[1]), fp) &&
+        fgets(line[2], sizeof(line[2]), fp) &&
+        sscanf(line[0], "size %lu blockSize %lu firstBlock %lu "
+            "nAlloc %d nFree %d nChunks %d nGtSize %d",
+            &st->size, &st->blockSize, &st->firstBlock, &st->nAlloc,
+            &st->nFree, &st->nChunks, &st->nGtSize) == 7 &&
+        sscanf(line[1], "%lu bytes in use, peak %lu, "
+            "in blocks of %lu bytes, peak %lu",
+            &st->inUse, &st->peak, &st->blockBytes, &st->blockPeak) == 4 &&
+        sscanf(line[2], "%lu calls, %lu larger",
+            &st->calls, &st->fallback) == 2;
+    fclose(fp);
+    return ok;
+}
+
+static void testRounding(void)
+{
+    dbmfStats a, b;
+    char *p, *q, *r, *s;
+
+    testDiag("Size classes");
+
+    testOk1(getStats(&a));
+
+    p = dbmfMalloc(20);
+    memset(p, 0xa5, 20);
+    testOk1(getStats(&b) && b.inUse - a.inUse == 32);
+
+    dbmfFree(p);
+    q = dbmfMalloc(30);
+    testOk(q == p, "freed item reused for a request of the same class");
+
+    r = dbmfMalloc(33);
+    s = dbmfMalloc(1);
+    testOk1(r != p && s != p && r != s);
+    testOk1(getStats(&b) && b.inUse - a.inUse == 32 + 48 + 16);
+
+    dbmfFree(q);
+    dbmfFree(r);
+    dbmfFree(s);
+    testOk1(getStats(&b) && b.inUse == a.inUse && b.nAlloc == a.nAlloc);
+}
+
+static void testFallback(void)
+{
+    dbmfStats a, b;
+    size_t n;
+    char *p;
+
+    testDiag("Requests larger than size");
+
+    testOk1(getStats(&a));
+    n = a.size + 1;
+
+    p = dbmfMalloc(n);
+    memset(p, 0x5a, n);
+    testOk1(getStats(&b));
+    testOk(b.fallback == a.fallback + 1 && b.nGtSize == a.nGtSize + 1,
+        "counted as passed to malloc()");
+    testOk1(b.calls == a.calls + 1);
+    testOk1(b.inUse == a.inUse + n && b.nAlloc == a.nAlloc + 1);
+    testOk(b.blockBytes == a.blockBytes, "no block space used");
+
+    dbmfFree(p);
+    testOk1(getStats(&b) && b.inUse == a.inUse && b.nAlloc == a.nAlloc);
+}
+
+static void testFreeChunks(void)
+{
+    dbmfStats a, b, c;
+    size_t i, n;
+    char **items, *keep, *p;
+
+    testDiag("dbmfFreeChunks with one block still in use");
+
+    dbmfFreeChunks();
+    testOk1(getStats(&a) && a.nChunks == 0);
+
+    /* Items of 64 bytes and their headers fill at least three blocks */
+    n = (a.firstBlock + 2 * a.blockSize) / 64;
+    items = malloc(n * sizeof(*items));
+    if (!items)
+        testAbort("malloc failed");
+    for (i = 0; i < n; i++)
+        items[i] = dbmfMalloc(64);
+    keep = items[n - 1];
+    memset(keep, 0x3c, 64);
+    testOk1(getStats(&b) && b.nChunks >= 3);
+
+    for (i = 0; i < n - 1; i++)
+        dbmfFree(items[i]);
+    dbmfFreeChunks();
+    testOk1(getStats(&c));
+    testOk(c.nChunks == 1, "kept the block in use (%d)", c.nChunks);
+    testOk1(c.blockBytes < b.blockBytes);
+    testOk(c.nFree > 0 && c.nFree < (int)(n - 1),
+        "dropped free items of released blocks (%d)", c.nFree);
+    testOk1(keep[0] == 0x3c && keep[63] == 0x3c);
+
+    testDiag("Reuse after a free");
+
+    p = dbmfMalloc(60);
+    testOk1(getStats(&b) && b.nFree == c.nFree - 1 && b.nChunks == 1);
+    dbmfFree(p);
+    dbmfFree(keep);
+    free(items);
+
+    dbmfFreeChunks();
+    testOk1(getStats(&c) && c.nChunks == 0 && c.nFree == 0 &&
+        c.blockBytes == 0);
+    testOk(c.blockSize == a.blockSize, "block size unchanged");
+    testOk(c.firstBlock > c.blockSize,
+        "next first block sized from this load (%lu)", c.firstBlock);
+}
+
+static void testNextLoad(void)
+{
+    dbmfStats a, b;
+    char *p;
+
+    testDiag("Block sizes of the following loads");
+
+    testOk1(getStats(&a));
+
+    p = dbmfMalloc(16);
+    testOk1(getStats(&b) && b.nChunks == 1);
+    testOk(b.blockBytes == a.firstBlock, "first block of %lu bytes",
+        b.blockBytes);
+    testOk1(b.firstBlock == 0);
+    dbmfFree(p);
+    dbmfFreeChunks();
+
+    p = dbmfMalloc(16);
+    testOk(getStats(&b) && b.blockBytes == b.blockSize,
+        "small load uses the normal block size again");
+    dbmfFree(p);
+    dbmfFreeChunks();
+}
+
+MAIN(dbmfTest)
+{
+    testPlan(29);
+
+    /* May already be initialized by other users */
+    dbmfInit(1024, 64);
+
+    testRounding();
+    testFallback();
+    testFreeChunks();
+    testNextLoad();
+    return testDone();
+}
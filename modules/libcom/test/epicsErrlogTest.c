@@ -88,8 +88,265 @@ typedef struct {
 } clientPvt;
 
 static void testLogPrefix(void);
+static void testErrPrintf(void);
+static void testRateLimit(void);
+static void testConcurrent(void);
+static void testLogSpool(void);
 static void acceptNewClient( void *pParam );
 static void readFromClient( void *pParam );
+/*
+ * Messages which don't fit in the buffer of a log client which
+ * can't connect go to the spool file.
+ */
+static void testLogSpool(void)
+{
+    const char *spoolName = "epicsErrlogTest.spool";
+    struct sockaddr_in addr;
+    osiSocklen_t addrSize = sizeof addr;
+    SOCKET closed;
+    logClientId id;
+    char msg[64], buf[64];
+    FILE *fp;
+    int i, n;
+
+    testDiag("Testing logClientSpool");
+
+    /* A bound socket which doesn't listen refuses connections */
+    closed = epicsSocketCreate(AF_INET, SOCK_STREAM, 0);
+    if (closed == INVALID_SOCKET)
+        testAbort("epicsSocketCreate failed.");
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(closed, (struct sockaddr *) &addr, sizeof addr) < 0 ||
+        getsockname(closed, (struct sockaddr *) &addr, &addrSize) < 0)
+        testAbort("Can't bind a port");
+
+    id = logClientCreate(addr.sin_addr, ntohs(addr.sin_port));
+    testOk1(id != NULL);
+    testOk1(logClientSpool(id, spoolName, 1000) == 0);
+
+    /* Overflow the 16k byte buffer with 39 byte messages */
+    for (i = 0; i < 500; i++) {
+        sprintf(msg, "spool test message %8d ..........\n", i);
+        logClientSend(id, msg);
+    }
+
+    fp = fopen(spoolName, "r");
+    testOk(fp != NULL, "Opened spool file");
+    n = 0;
+    if (fp) {
+        while (fgets(buf, sizeof buf, fp))
+            n++;
+        fclose(fp);
+    }
+    /* 1000 bytes holds 25 messages */
+    testOk(n == 25, "Spooled %d messages", n);
+
+    logClientShow(id, 1);
+    remove(spoolName);
+    epicsSocketDestroy(closed);
+}
+
+typedef struct {
+    SOCKET conn;
+    char line[64];
+    size_t len;
+    int received;
+    int last;
+    int bad;
+    int done;
+} replayPvt;
+
+/* Read what has arrived within timeout seconds, returns 0 if nothing */
+static int replayReceive(replayPvt *pvt, long timeout)
+{
+    struct timeval tv;
+    fd_set fds;
+    char buf[256];
+    int i, n;
+
+    tv.tv_sec = timeout;
+    tv.tv_usec = 0;
+    FD_ZERO(&fds);
+    FD_SET(pvt->conn, &fds);
+    if (select(pvt->conn + 1, &fds, NULL, NULL, &tv) <= 0)
+        return 0;
+    n = recv(pvt->conn, buf, sizeof buf, 0);
+    if (n <= 0)
+        return 0;
+
+    for (i = 0; i < n; i++) {
+        int num;
+
+        if (pvt->len < sizeof pvt->line - 1)
+            pvt->line[pvt->len++] = buf[i];
+        if (buf[i] != '\n')
+            continue;
+        pvt->line[pvt->len] = '\0';
+        pvt->len = 0;
+        if (strcmp(pvt->line, "spool test done\n") == 0)
+            pvt->done = 1;
+        else if (sscanf(pvt->line, "spool test message %d", &num) == 1 &&
+                 strlen(pvt->line) == 39 && num > pvt->last) {
+            pvt->last = num;
+            pvt->received++;
+        }
+        else
+            pvt->bad++;
+    }
+    return 1;
+}
+
+/*
+ * Messages keep arriving while the spool is being replayed.  They must
+ * still be sent in order, and the spool file must not grow.
+ */
+static void testLogSpoolReplay(void)
+{
+    const char *spoolName = "epicsErrlogReplay.spool";
+    struct sockaddr_in addr;
+    osiSocklen_t addrSize = sizeof addr;
+    SOCKET listener;
+    logClientId id;
+    replayPvt pvt;
+    char msg[64];
+    FILE *fp;
+    long size = -1;
+    int rcvbuf = 1024;
+    int i;
+
+    testDiag("Testing logging during a spool replay");
+
+    memset(&pvt, 0, sizeof pvt);
+    pvt.last = -1;
+
+    listener = epicsSocketCreate(AF_INET, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET)
+        testAbort("epicsSocketCreate failed.");
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    /* A slow server, so that sendBuf doesn't take all of the spool */
+    setsockopt(listener, SOL_SOCKET, SO_RCVBUF, (char *) &rcvbuf, sizeof rcvbuf);
+    if (bind(listener, (struct sockaddr *) &addr, sizeof addr) < 0 ||
+        getsockname(listener, (struct sockaddr *) &addr, &addrSize) < 0)
+        testAbort("Can't bind a port");
+
+    id = logClientCreate(addr.sin_addr, ntohs(addr.sin_port));
+    testOk1(logClientSpool(id, spoolName, 1000) == 0);
+
+    /* Fill the buffer and the spool while the server is down */
+    for (i = 0; i < 500; i++) {
+        sprintf(msg, "spool test message %8d ..........\n", i);
+        logClientSend(id, msg);
+    }
+
+    /* The client reconnects after its restart delay */
+    if (listen(listener, 1) < 0)
+        testAbort("Can't listen on a port");
+    pvt.conn = accept(listener, NULL, NULL);
+    testOk1(pvt.conn != INVALID_SOCKET);
+
+    for (; i < 5000; i++) {
+        sprintf(msg, "spool test message %8d ..........\n", i);
+        logClientSend(id, msg);
+        if (i % 100 == 0)
+            replayReceive(&pvt, 0);
+    }
+    while (replayReceive(&pvt, 1))
+        ;
+    logClientSend(id, "spool test done\n");
+    logClientFlush(id);
+    while (!pvt.done && replayReceive(&pvt, 5))
+        ;
+
+    fp = fopen(spoolName, "rb");
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp);
+        fclose(fp);
+    }
+
+    testOk(pvt.done, "All messages sent after the replay");
+    testOk(pvt.bad == 0, "Received %d messages in order, %d bad",
+        pvt.received, pvt.bad);
+    testOk(size >= 0 && size <= 1000, "Spool file size %ld", size);
+
+    logClientShow(id, 1);
+    remove(spoolName);
+    epicsSocketDestroy(pvt.conn);
+    epicsSocketDestroy(listener);
+}
+
+/*
+ * A message longer than the log client's buffer is sent in pieces.
+ */
+static void testLogLong(void)
+{
+    const size_t len = 40000;
+    struct sockaddr_in addr;
+    osiSocklen_t addrSize = sizeof addr;
+    SOCKET listener, conn;
+    logClientId id;
+    char *msg, *buf;
+    size_t i, got = 0;
+
+    testDiag("Testing a message longer than the log client buffer");
+
+    listener = epicsSocketCreate(AF_INET, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET)
+        testAbort("epicsSocketCreate failed.");
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, (struct sockaddr *) &addr, sizeof addr) < 0 ||
+        getsockname(listener, (struct sockaddr *) &addr, &addrSize) < 0 ||
+        listen(listener, 1) < 0)
+        testAbort("Can't listen on a port");
+
+    id = logClientCreate(addr.sin_addr, ntohs(addr.sin_port));
+    testOk1(id != NULL);
+    conn = accept(listener, NULL, NULL);
+    testOk1(conn != INVALID_SOCKET);
+    /* the client is connected once connect() has returned there */
+    epicsThreadSleep(0.5);
+
+    msg = malloc(len + 1);
+    buf = malloc(len);
+    if (!msg || !buf)
+        testAbort("malloc failed");
+    for (i = 0; i < len - 1; i++)
+        msg[i] = 'a' + i % 26;
+    msg[len - 1] = '\n';
+    msg[len] = '\0';
+    logClientSend(id, msg);
+
+    while (got < len) {
+        struct timeval timeout;
+        fd_set fds;
+        int n;
+
+        timeout.tv_sec = 5;
+        timeout.tv_usec = 0;
+        FD_ZERO(&fds);
+        FD_SET(conn, &fds);
+        if (select(conn + 1, &fds, NULL, NULL, &timeout) <= 0)
+            break;
+        n = recv(conn, buf + got, len - got, 0);
+        if (n <= 0)
+            break;
+        got += n;
+    }
+    testOk(got == len && memcmp(buf, msg, len) == 0,
+        "Received %lu of %lu bytes", (unsigned long) got, (unsigned long) len);
+
+    free(msg);
+    free(buf);
+    epicsSocketDestroy(conn);
+    epicsSocketDestroy(listener);
+}
+
 static void testPrefixLogandCompare( const char* logmessage);
 
 static void *pfdctx;
@@ -203,7 +460,7 @@ MAIN(epicsErrlogTest)
     char msg[256];
     clientPvt pvt, pvt2;
 
-    testPlan(48);
+    testPlan(73);
 
     testANSIStrip();
 
@@ -410,10 +667,153 @@ MAIN(epicsErrlogTest)
     testOk(1 == errlogRemoveListeners(&logClient, &pvt),
         "Removed 1 listener");
 
+    testErrPrintf();
+    testRateLimit();
+    testConcurrent();
+    testLogSpool();
+    testLogSpoolReplay();
+    testLogLong();
     testLogPrefix();
 
     return testDone();
 }
+typedef struct {
+    unsigned int count;
+    unsigned int bad;
+    char last[256];
+    epicsEventId done;
+} recordPvt;
+
+static
+void recordClient(void* raw, const char* msg)
+{
+    recordPvt *pvt = raw;
+    int thread = -1, num = -1;
+    char expect[64];
+
+    if (strncmp(msg, "thread ", 7) == 0) {
+        sscanf(msg, "thread %d msg %d", &thread, &num);
+        sprintf(expect, "thread %d msg %d\n", thread, num);
+        if (strcmp(msg, expect) != 0)
+            pvt->bad++;
+    }
+    strncpy(pvt->last, msg, sizeof(pvt->last) - 1);
+    pvt->last[sizeof(pvt->last) - 1] = '\0';
+    pvt->count++;
+    epicsEventSignal(pvt->done);
+}
+
+/* errPrintf() entries are formatted by the errlog thread */
+static void testErrPrintf(void)
+{
+    recordPvt pvt;
+
+    testDiag("Check errPrintf");
+
+    memset(&pvt, 0, sizeof(pvt));
+    pvt.done = epicsEventMustCreate(epicsEventEmpty);
+    errlogAddListener(&recordClient, &pvt);
+
+    errPrintf(0, "file.c", 42, "%s %d", "value", 5);
+    errlogFlush();
+    testOk(strcmp(pvt.last, "filename=\"file.c\" line number=42value 5") == 0,
+        "Message is \"%s\"", pvt.last);
+
+    errPrintf(-1, NULL, 7, "x");
+    errlogFlush();
+    testOk(strcmp(pvt.last, " filename=\"\" line number=7x") == 0,
+        "Message is \"%s\"", pvt.last);
+
+    testOk1(1 == errlogRemoveListeners(&recordClient, &pvt));
+    epicsEventDestroy(pvt.done);
+}
+
+static void testRateLimit(void)
+{
+    static errlogRateLimit site = ERRLOG_RATE_LIMIT_INIT(3, 0.5);
+    recordPvt pvt;
+    int i, nlogged = 0;
+
+    testDiag("Check rate limiting");
+
+    memset(&pvt, 0, sizeof(pvt));
+    pvt.done = epicsEventMustCreate(epicsEventEmpty);
+    errlogAddListener(&recordClient, &pvt);
+    eltc(0);
+
+    for (i = 0; i < 10; i++) {
+        if (errlogRatePrintf(&site, "rate %d\n", i) > 0)
+            nlogged++;
+    }
+    errlogFlush();
+    testOk(nlogged == 3, "Logged %d messages", nlogged);
+    testOk(pvt.count == 3, "Received %u messages", pvt.count);
+
+    /* the summary comes once the interval is over */
+    while (pvt.count < 4 &&
+           epicsEventWaitWithTimeout(pvt.done, 5.0) == epicsEventWaitOK)
+        ;
+    testOk(pvt.count == 4 &&
+        strncmp(pvt.last, "errlog: 7 messages suppressed from ", 35) == 0,
+        "Summary of suppressed messages");
+    testDiag("%s", pvt.last);
+    testOk(strstr(pvt.last, __FILE__) != NULL, "Summary names this file");
+
+    testOk1(errlogRatePrintf(&site, "rate again\n") > 0);
+    errlogFlush();
+    testOk1(strcmp(pvt.last, "rate again\n") == 0);
+
+    eltc(1);
+    testOk1(1 == errlogRemoveListeners(&recordClient, &pvt));
+    epicsEventDestroy(pvt.done);
+}
+
+#define NWRITERS 4
+#define NWRITES 200
+
+static
+void writerThread(void *arg)
+{
+    int id = (int)(size_t) arg, i;
+
+    for (i = 0; i < NWRITES; i++) {
+        errlogPrintfNoConsole("thread %d msg %d\n", id, i);
+        if (i % 16 == 0)
+            epicsThreadSleep(0.0);
+    }
+}
+
+/* Several threads log at once, check that no message is garbled */
+static void testConcurrent(void)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    epicsThreadId tid[NWRITERS];
+    recordPvt pvt;
+    size_t i;
+
+    testDiag("Check concurrent writers");
+
+    memset(&pvt, 0, sizeof(pvt));
+    pvt.done = epicsEventMustCreate(epicsEventEmpty);
+    errlogAddListener(&recordClient, &pvt);
+
+    opts.joinable = 1;
+    opts.priority = epicsThreadGetPrioritySelf();
+    for (i = 0; i < NWRITERS; i++)
+        tid[i] = epicsThreadCreateOpt("writer", &writerThread, (void *) i, &opts);
+    for (i = 0; i < NWRITERS; i++)
+        epicsThreadMustJoin(tid[i]);
+    errlogFlush();
+
+    testDiag("Received %u of %u messages", pvt.count, NWRITERS * NWRITES);
+    testOk(pvt.count > 0 && pvt.count <= NWRITERS * NWRITES,
+        "Received %u messages", pvt.count);
+    testOk(pvt.bad == 0, "%u garbled messages", pvt.bad);
+
+    testOk1(1 == errlogRemoveListeners(&recordClient, &pvt));
+    epicsEventDestroy(pvt.done);
+}
+
 /*
  * Tests the log prefix code
  * The prefix is only applied to log messages as they go out to the socket,
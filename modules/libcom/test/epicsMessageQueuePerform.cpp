@@ -0,0 +1,125 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+// Measures message queue throughput with several producer and consumer
+// threads, as when drivers hand frames to a pool of processing threads.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "epicsMessageQueue.h"
+#include "epicsThread.h"
+#include "epicsTime.h"
+#include "epicsUnitTest.h"
+#include "testMain.h"
+
+#define TOTAL_MESSAGES 1000000u
+#define MESSAGE_SIZE 16u
+#define MAX_THREADS 8u
+
+struct perfWorker {
+    epicsMessageQueueId q;
+    unsigned count;
+};
+
+extern "C" void producer ( void *arg )
+{
+    perfWorker *pw = static_cast < perfWorker * > ( arg );
+    char msg[MESSAGE_SIZE];
+
+    memset ( msg, 0, sizeof msg );
+    for ( unsigned i = 0u; i < pw->count; i++ ) {
+        epicsMessageQueueSend ( pw->q, msg, sizeof msg );
+    }
+}
+
+extern "C" void consumer ( void *arg )
+{
+    perfWorker *pw = static_cast < perfWorker * > ( arg );
+    char msg[MESSAGE_SIZE];
+
+    // a zero length message tells the consumer to stop
+    while ( epicsMessageQueueReceive ( pw->q, msg, sizeof msg ) > 0 ) {
+        pw->count++;
+    }
+}
+
+static double throughput ( epicsMessageQueueId q,
+    unsigned nProducers, unsigned nConsumers )
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    perfWorker prod[MAX_THREADS], cons[MAX_THREADS];
+    epicsThreadId prodId[MAX_THREADS], consId[MAX_THREADS];
+    char stop[1] = { 0 };
+    unsigned i;
+
+    opts.joinable = 1;
+    opts.priority = epicsThreadPriorityMedium;
+    epicsTime beg = epicsTime::getMonotonic ();
+    for ( i = 0u; i < nConsumers; i++ ) {
+        cons[i].q = q;
+        cons[i].count = 0u;
+        consId[i] = epicsThreadCreateOpt ( "consumer", consumer,
+            & cons[i], & opts );
+    }
+    for ( i = 0u; i < nProducers; i++ ) {
+        prod[i].q = q;
+        prod[i].count = TOTAL_MESSAGES / nProducers;
+        prodId[i] = epicsThreadCreateOpt ( "producer", producer,
+            & prod[i], & opts );
+    }
+    for ( i = 0u; i < nProducers; i++ ) {
+        epicsThreadMustJoin ( prodId[i] );
+    }
+    for ( i = 0u; i < nConsumers; i++ ) {
+        epicsMessageQueueSend ( q, stop, 0u );
+    }
+    for ( i = 0u; i < nConsumers; i++ ) {
+        epicsThreadMustJoin ( consId[i] );
+    }
+    epicsTime end = epicsTime::getMonotonic ();
+
+    unsigned received = 0u;
+    for ( i = 0u; i < nConsumers; i++ ) {
+        received += cons[i].count;
+    }
+    return received / ( end - beg );
+}
+
+static void compare ( unsigned nProducers, unsigned nConsumers )
+{
+    epicsMessageQueueId locked =
+        epicsMessageQueueCreate ( 1024u, MESSAGE_SIZE );
+    epicsMessageQueueId lockFree =
+        epicsMessageQueueCreateLockFree ( 1024u, MESSAGE_SIZE );
+
+    if ( ! locked || ! lockFree )
+        testAbort ( "Can't create message queues" );
+
+    double lockedRate = throughput ( locked, nProducers, nConsumers );
+    double lockFreeRate = throughput ( lockFree, nProducers, nConsumers );
+
+    testDiag ( "%4u %4u %14.0f %14.0f", nProducers, nConsumers,
+        lockedRate, lockFreeRate );
+
+    epicsMessageQueueDestroy ( locked );
+    epicsMessageQueueDestroy ( lockFree );
+}
+
+MAIN(epicsMessageQueuePerform)
+{
+    testPlan(0);
+    testDiag ( "Messages per second, %u byte messages, %u CPUs",
+        MESSAGE_SIZE, epicsThreadGetCPUs () );
+    testDiag ( "%4s %4s %14s %14s", "prod", "cons", "locked", "lock-free" );
+    compare ( 1u, 1u );
+    compare ( 2u, 2u );
+    compare ( 4u, 4u );
+    compare ( 8u, 8u );
+    compare ( 8u, 1u );
+    compare ( 1u, 8u );
+    return testDone();
+}
@@ -442,6 +442,182 @@ extern "C" void messageQueueTest(void *parm)
     epicsThreadMustJoin(rxThread);
 }
 
+#define LF_THREADS 4
+#define LF_MESSAGES 20000
+
+struct lfWorker {
+    epicsMessageQueueId q;
+    epicsThreadId tid;
+    int count;
+    double sum;
+};
+
+extern "C" void
+lfProducer(void *arg)
+{
+    lfWorker *pw = (lfWorker *)arg;
+    int i;
+
+    for (i = 1; i <= LF_MESSAGES; i++) {
+        if (epicsMessageQueueSend(pw->q, &i, sizeof i) == 0) {
+            pw->count++;
+            pw->sum += i;
+        }
+    }
+}
+
+extern "C" void
+lfConsumer(void *arg)
+{
+    lfWorker *pw = (lfWorker *)arg;
+    int i;
+
+    while (epicsMessageQueueReceive(pw->q, &i, sizeof i) == sizeof i &&
+           i > 0) {
+        pw->count++;
+        pw->sum += i;
+    }
+}
+
+static void
+lockFreeTest(void)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    lfWorker prod[LF_THREADS], cons[LF_THREADS];
+    epicsMessageQueueId q = epicsMessageQueueCreateLockFree(3, 20);
+    char cbuf[80];
+    int sent = 0, received = 0;
+    double sentSum = 0.0, receivedSum = 0.0;
+    unsigned int i;
+    bool ok = true;
+
+    testDiag("Lock-free queue tests:");
+    if (!q)
+        testAbort("epicsMessageQueueCreateLockFree failed");
+
+    for (i = 0; i < 3; i++)
+        ok &= epicsMessageQueueTrySend(q, (void *)msg1, i) == 0;
+    testOk(ok, "trySend filled the queue");
+    testOk1(epicsMessageQueuePending(q) == 3);
+    testOk1(epicsMessageQueueTrySend(q, (void *)msg1, 3) < 0);
+    testOk1(epicsMessageQueueSendWithTimeout(q, (void *)msg1, 3, 0.1) < 0);
+
+    ok = true;
+    for (i = 0; i < 3; i++)
+        ok &= epicsMessageQueueTryReceive(q, cbuf, sizeof cbuf) == (int)i;
+    testOk(ok, "received messages in order");
+    testOk1(epicsMessageQueueTryReceive(q, cbuf, sizeof cbuf) < 0);
+    testOk1(epicsMessageQueueReceiveWithTimeout(q, cbuf, sizeof cbuf, 0.1) < 0);
+
+    testOk1(epicsMessageQueueTrySend(q, (void *)msg1, 21) < 0);
+    epicsMessageQueueTrySend(q, (void *)msg1, 10);
+    testOk(epicsMessageQueueTryReceive(q, cbuf, 5) < 0 &&
+        epicsMessageQueuePending(q) == 0,
+        "undersized buffer consumes the message");
+
+    testDiag("%d producers, %d consumers", LF_THREADS, LF_THREADS);
+    memset(prod, 0, sizeof prod);
+    memset(cons, 0, sizeof cons);
+    opts.joinable = 1;
+    for (i = 0; i < LF_THREADS; i++) {
+        cons[i].q = q;
+        cons[i].tid = epicsThreadCreateOpt("lfConsumer", lfConsumer,
+            &cons[i], &opts);
+        prod[i].q = q;
+        prod[i].tid = epicsThreadCreateOpt("lfProducer", lfProducer,
+            &prod[i], &opts);
+        if (!cons[i].tid || !prod[i].tid)
+            testAbort("epicsThreadCreate failed");
+    }
+    for (i = 0; i < LF_THREADS; i++) {
+        epicsThreadMustJoin(prod[i].tid);
+        sent += prod[i].count;
+        sentSum += prod[i].sum;
+    }
+    for (i = 0; i < LF_THREADS; i++) {
+        int stop = 0;
+        epicsMessageQueueSend(q, &stop, sizeof stop);
+    }
+    for (i = 0; i < LF_THREADS; i++) {
+        epicsThreadMustJoin(cons[i].tid);
+        received += cons[i].count;
+        receivedSum += cons[i].sum;
+    }
+    testOk(sent == LF_THREADS * LF_MESSAGES, "sent %d messages", sent);
+    testOk(received == sent && receivedSum == sentSum,
+        "received %d messages", received);
+
+    epicsMessageQueueDestroy(q);
+}
+
+#define RACE_ROUNDS 200
+
+struct raceWaiter {
+    epicsMessageQueueId q;
+    double timeout;
+    int received;
+};
+
+extern "C" void
+raceReceiver(void *arg)
+{
+    raceWaiter *pw = (raceWaiter *)arg;
+    int i;
+
+    pw->received = epicsMessageQueueReceiveWithTimeout(pw->q, &i, sizeof i,
+        pw->timeout) == sizeof i;
+}
+
+/*
+ * The oldest of two waiting receivers times out just as a sender wakes
+ * it.  The message must then still reach a receiver instead of staying
+ * queued while the other one sleeps on.
+ */
+static void
+lockFreeRaceTest(void)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    epicsMessageQueueId q = epicsMessageQueueCreateLockFree(1, sizeof(int));
+    const double shortWait = 0.01;
+    int round, lost = 0, early = 0;
+
+    testDiag("Lock-free queue, timeout racing a wakeup");
+    if (!q)
+        testAbort("epicsMessageQueueCreateLockFree failed");
+
+    opts.joinable = 1;
+    for (round = 0; round < RACE_ROUNDS; round++) {
+        raceWaiter first = {q, shortWait, 0}, second = {q, 1.0, 0};
+        epicsThreadId tid1, tid2;
+        int i = round;
+
+        tid1 = epicsThreadCreateOpt("raceFirst", raceReceiver, &first, &opts);
+        epicsThreadSleep(shortWait / 4);
+        tid2 = epicsThreadCreateOpt("raceSecond", raceReceiver, &second,
+            &opts);
+        if (!tid1 || !tid2)
+            testAbort("epicsThreadCreate failed");
+
+        /* Sweep the send across the end of the first receiver's wait */
+        epicsThreadSleep(shortWait * (0.7 + 0.005 * (round % 50)));
+        epicsMessageQueueSend(q, &i, sizeof i);
+
+        epicsThreadMustJoin(tid1);
+        epicsThreadMustJoin(tid2);
+        if (first.received + second.received != 1) {
+            lost++;
+            while (epicsMessageQueueTryReceive(q, &i, sizeof i) >= 0) {}
+        }
+        if (first.received)
+            early++;
+    }
+    testOk(lost == 0, "message received in all %d rounds (%d lost)",
+        RACE_ROUNDS, lost);
+    testDiag("first receiver got %d messages", early);
+
+    epicsMessageQueueDestroy(q);
+}
+
 MAIN(epicsMessageQueueTest)
 {
     epicsThreadOpts opts = {
@@ -451,7 +627,7 @@ MAIN(epicsMessageQueueTest)
     };
     epicsThreadId testThread;
 
-    testPlan(70 + NUM_SENDERS);
+    testPlan(82 + NUM_SENDERS);
 
     testThread = epicsThreadCreateOpt("messageQueueTest",
         messageQueueTest, NULL, &opts);
@@ -460,5 +636,8 @@ MAIN(epicsMessageQueueTest)
 
     epicsThreadMustJoin(testThread);
 
+    lockFreeTest();
+    lockFreeRaceTest();
+
     return testDone();
 }
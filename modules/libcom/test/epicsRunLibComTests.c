@@ -50,6 +50,9 @@ int epicsTimeZoneTest(void);
 #endif
 int epicsTypesTest(void);
 int epicsInlineTest(void);
+int freeListTest(void);
+int gpHashTest(void);
+int dbmfTest(void);
 int initHookTest(void);
 int ipAddrToAsciiTest(void);
 int macDefExpandTest(void);
@@ -106,6 +109,9 @@ void epicsRunLibComTests(void)
     runTest(epicsTimeZoneTest);
 #endif
     runTest(epicsTypesTest);
+    runTest(freeListTest);
+    runTest(gpHashTest);
+    runTest(dbmfTest);
     runTest(initHookTest);
     runTest(ipAddrToAsciiTest);
     runTest(macDefExpandTest);
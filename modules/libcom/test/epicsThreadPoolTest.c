@@ -18,6 +18,7 @@
 #include "epicsEvent.h"
 #include "epicsMutex.h"
 #include "epicsThread.h"
+#include "dbDefs.h"
 
 /* Do nothing */
 static void nullop(void)
@@ -421,9 +422,197 @@ void testshared(void)
 
 }
 
+static epicsMutexId orderGuard;
+static int order[6];
+static unsigned int norder;
+
+static
+void orderjob(void *arg, epicsJobMode mode)
+{
+    if(mode==epicsJobModeCleanup)
+        return;
+    epicsMutexMustLock(orderGuard);
+    if(norder<NELEMENTS(order))
+        order[norder++] = (int)(size_t)arg;
+    epicsMutexUnlock(orderGuard);
+}
+
+/* Jobs of higher priority run first */
+static
+void testpriority(void)
+{
+    static const epicsJobPriority prio[6] = {
+        epicsJobPriorityLow, epicsJobPriorityMedium, epicsJobPriorityHigh,
+        epicsJobPriorityLow, epicsJobPriorityMedium, epicsJobPriorityHigh
+    };
+    epicsThreadPoolConfig conf;
+    epicsThreadPool *pool;
+    epicsJob *job[6];
+    unsigned int i;
+
+    testDiag("testpriority");
+
+    orderGuard = epicsMutexMustCreate();
+    epicsThreadPoolConfigDefaults(&conf);
+    conf.maxThreads = 1;
+    testOk1((pool=epicsThreadPoolCreate(&conf))!=NULL);
+    if(!pool)
+        return;
+
+    epicsThreadPoolControl(pool, epicsThreadPoolQueueRun, 0);
+
+    for(i=0; i<6; i++) {
+        job[i] = epicsJobCreate(pool, &orderjob, (void*)(size_t)i);
+        epicsJobSetPriority(job[i], prio[i]);
+        epicsJobQueue(job[i]);
+    }
+    testOk1(epicsJobSetPriority(job[0], (epicsJobPriority)7)==S_pool_badPriority);
+    /* raise a queued job, which goes behind the others */
+    testOk1(epicsJobSetPriority(job[4], epicsJobPriorityHigh)==0);
+
+    epicsThreadPoolControl(pool, epicsThreadPoolQueueRun, 1);
+    testOk1(epicsThreadPoolWait(pool, 5.0)==0);
+
+    testOk(norder==6, "%u jobs ran", norder);
+    testOk1(order[0]==2 && order[1]==5 && order[2]==4);
+    testOk1(order[3]==1 && order[4]==0 && order[5]==3);
+
+    for(i=0; i<6; i++)
+        epicsJobDestroy(job[i]);
+    epicsThreadPoolDestroy(pool);
+    epicsMutexDestroy(orderGuard);
+}
+
+#define NMANY 20
+
+typedef struct {
+    epicsMutexId guard;
+    unsigned int count;
+    epicsEventId done;
+    epicsJob *job[NMANY];
+} manyPriv;
+
+static
+void countmany(void *arg, epicsJobMode mode)
+{
+    manyPriv *priv=arg;
+    if(mode==epicsJobModeCleanup)
+        return;
+    epicsMutexMustLock(priv->guard);
+    if(++priv->count==NMANY)
+        epicsEventSignal(priv->done);
+    epicsMutexUnlock(priv->guard);
+}
+
+/* Queue a batch of jobs, one of which belongs to another pool */
+static
+void testqueuemany(void)
+{
+    epicsThreadPoolConfig conf;
+    epicsThreadPool *pool, *other;
+    manyPriv *priv=callocMustSucceed(1, sizeof(*priv), "testqueuemany priv");
+    epicsJob *stray;
+    unsigned int i;
+
+    testDiag("testqueuemany");
+
+    priv->guard = epicsMutexMustCreate();
+    priv->done = epicsEventMustCreate(epicsEventEmpty);
+
+    epicsThreadPoolConfigDefaults(&conf);
+    conf.maxThreads = 4;
+    testOk1((pool=epicsThreadPoolCreate(&conf))!=NULL);
+    testOk1((other=epicsThreadPoolCreate(&conf))!=NULL);
+    if(!pool || !other)
+        return;
+
+    for(i=0; i<NMANY; i++)
+        priv->job[i] = epicsJobCreate(pool, &countmany, priv);
+    stray = priv->job[NMANY/2];
+    priv->job[NMANY/2] = epicsJobCreate(other, &countmany, priv);
+
+    testOk1(epicsJobQueueMany(priv->job, NMANY)==S_pool_noPool);
+    testOk1(epicsThreadPoolWait(pool, 5.0)==0);
+    testOk(priv->count==NMANY-1, "%u jobs ran", priv->count);
+
+    testOk1(epicsJobQueue(priv->job[NMANY/2])==0);
+    epicsEventMustWait(priv->done);
+    testOk1(priv->count==NMANY);
+
+    testOk1(epicsJobQueueMany(priv->job, 0)==0);
+
+    priv->job[NMANY/2] = stray;
+    for(i=0; i<NMANY; i++)
+        epicsJobDestroy(priv->job[i]);
+    epicsThreadPoolDestroy(pool);
+    epicsThreadPoolDestroy(other);
+    epicsMutexDestroy(priv->guard);
+    epicsEventDestroy(priv->done);
+    free(priv);
+}
+
+/* A job queues more jobs from within itself, then blocks until
+ * they have run.  They can only run if another worker steals them.
+ */
+static manyPriv *stealPriv;
+
+static
+void parentjob(void *arg, epicsJobMode mode)
+{
+    if(mode==epicsJobModeCleanup)
+        return;
+    testOk1(epicsJobQueueMany(stealPriv->job, NMANY)==0);
+    epicsEventMustWait(stealPriv->done);
+}
+
+static
+void teststeal(void)
+{
+    epicsThreadPoolConfig conf;
+    epicsThreadPool *pool;
+    epicsJob *parent;
+    unsigned long nstolen = 0;
+    unsigned int i;
+
+    testDiag("teststeal");
+
+    stealPriv = callocMustSucceed(1, sizeof(*stealPriv), "teststeal priv");
+    stealPriv->guard = epicsMutexMustCreate();
+    stealPriv->done = epicsEventMustCreate(epicsEventEmpty);
+
+    epicsThreadPoolConfigDefaults(&conf);
+    conf.initialThreads = 2;
+    conf.maxThreads = 2;
+    testOk1((pool=epicsThreadPoolCreate(&conf))!=NULL);
+    if(!pool)
+        return;
+
+    for(i=0; i<NMANY; i++)
+        stealPriv->job[i] = epicsJobCreate(pool, &countmany, stealPriv);
+    parent = epicsJobCreate(pool, &parentjob, NULL);
+
+    testOk1(epicsJobQueue(parent)==0);
+    testOk1(epicsThreadPoolWait(pool, 5.0)==0);
+    testOk1(stealPriv->count==NMANY);
+
+    epicsMutexMustLock(pool->guard);
+    for(i=0; i<(unsigned int)pool->nworkers; i++)
+        nstolen += pool->workerv[i]->nstolen;
+    epicsMutexUnlock(pool->guard);
+    testOk(nstolen==NMANY, "%lu jobs stolen", nstolen);
+
+    epicsJobDestroy(parent);
+    for(i=0; i<NMANY; i++)
+        epicsJobDestroy(stealPriv->job[i]);
+    epicsThreadPoolDestroy(pool);
+    epicsMutexDestroy(stealPriv->guard);
+    epicsEventDestroy(stealPriv->done);
+    free(stealPriv);
+}
+
 MAIN(epicsThreadPoolTest)
 {
-    testPlan(171);
+    testPlan(192);
 
     nullop();
     oneop();
@@ -443,6 +632,9 @@ MAIN(epicsThreadPoolTest)
     testreadd();
     testcancel();
     testshared();
+    testpriority();
+    testqueuemany();
+    teststeal();
 
     return testDone();
 }
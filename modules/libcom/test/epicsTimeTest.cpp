@@ -20,8 +20,11 @@
 #include <climits>
 #include <cstring>
 
+#include "dbDefs.h"
 #include "envDefs.h"
 #include "epicsTime.h"
+#include "epicsGeneralTime.h"
+#include "generalTimeSup.h"
 #include "epicsThread.h"
 #include "errlog.h"
 #include "epicsUnitTest.h"
@@ -140,12 +143,49 @@ static void testTMGames()
            unsigned(now.secPastEpoch), unsigned(ltime.secPastEpoch));
 }
 
+static epicsTimeStamp scripted[2];
+static unsigned nScripted;
+
+extern "C" int scriptedTime(epicsTimeStamp *pDest)
+{
+    if (nScripted >= NELEMENTS(scripted))
+        return S_time_noProvider;
+    *pDest = scripted[nScripted++];
+    return epicsTimeOK;
+}
+
+static void testProviderRatchet()
+{
+    testDiag("testProviderRatchet()");
+
+    // The provider stays registered but falls back to the OS clock
+    // after these, which is never behind them.
+    epicsTimeStamp now, ts;
+    epicsTimeGetCurrent(&now);
+    scripted[0] = now;
+    scripted[1] = now;
+    epicsTimeAddSeconds(&scripted[1], -1.0);
+
+    testOk1(!generalTimeRegisterCurrentProvider("Scripted", 1, scriptedTime));
+    generalTimeResetErrorCounts();
+
+    epicsTimeGetCurrent(&ts);
+    testOk(epicsTimeEqual(&ts, &scripted[0]) &&
+        generalTimeGetErrorCounts() == 0, "Provider time used");
+    epicsTimeGetCurrent(&ts);
+    testOk(epicsTimeEqual(&ts, &scripted[0]) &&
+        generalTimeGetErrorCounts() == 1, "Earlier time replaced and counted");
+    epicsTimeGetCurrent(&ts);
+    testOk(epicsTimeGreaterThanEqual(&ts, &scripted[0]) &&
+        generalTimeGetErrorCounts() == 1, "Falls back to the OS clock");
+}
+
 MAIN(epicsTimeTest)
 {
     const int wasteTime = 100000;
     const int nTimes = 10;
 
-    testPlan(52 + nTimes * 19);
+    testPlan(56 + nTimes * 19);
 
     testDiag("$TZ = \"%s\"", getenv("TZ"));
     testDiag("EPICS_TZ = \"%s\"", envGetConfigParamPtr(&EPICS_TZ));
@@ -389,6 +429,7 @@ MAIN(epicsTimeTest)
 
     testMonotonic();
     testTMGames();
+    testProviderRatchet();
 
     return testDone();
 }
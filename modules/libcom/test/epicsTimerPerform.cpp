@@ -0,0 +1,99 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+// Measures the cost of starting, restarting and expiring timers with many
+// timers pending, as with lots of delayed callbacks or CA channels.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epicsTimer.h"
+#include "epicsTime.h"
+#include "epicsUnitTest.h"
+#include "testMain.h"
+
+class perfNotify : public epicsTimerQueueNotify {
+public:
+    void reschedule () {}
+    double quantum () { return 0.0; }
+};
+
+class perfTimer : public epicsTimerNotify {
+public:
+    expireStatus expire ( const epicsTime & )
+    {
+        return expireStatus ( noRestart );
+    }
+};
+
+static double randomDelay ()
+{
+    return 1.0 + ( rand () % 100000 ) / 1000.0;
+}
+
+static void timerChurn ( unsigned nTimers, unsigned nOps )
+{
+    perfNotify notify;
+    perfTimer action;
+    epicsTimerQueuePassive &queue = epicsTimerQueuePassive::create ( notify );
+    epicsTimer **pTimers = new epicsTimer * [nTimers];
+    epicsTime base = epicsTime::getCurrent ();
+    unsigned i;
+
+    for ( i = 0u; i < nTimers; i++ ) {
+        pTimers[i] = & queue.createTimer ();
+    }
+
+    epicsTime beg = epicsTime::getMonotonic ();
+    for ( i = 0u; i < nTimers; i++ ) {
+        pTimers[i]->start ( action, base + randomDelay () );
+    }
+    epicsTime end = epicsTime::getMonotonic ();
+    double start = ( end - beg ) / nTimers;
+
+    beg = epicsTime::getMonotonic ();
+    for ( i = 0u; i < nOps; i++ ) {
+        pTimers[rand () % nTimers]->start ( action, base + randomDelay () );
+    }
+    end = epicsTime::getMonotonic ();
+    double restart = ( end - beg ) / nOps;
+
+    beg = epicsTime::getMonotonic ();
+    for ( i = 0u; i < nOps; i++ ) {
+        epicsTimer *pTmr = pTimers[rand () % nTimers];
+        pTmr->cancel ();
+        pTmr->start ( action, base + randomDelay () );
+    }
+    end = epicsTime::getMonotonic ();
+    double cancelStart = ( end - beg ) / nOps;
+
+    beg = epicsTime::getMonotonic ();
+    queue.process ( base + 1000.0 );
+    end = epicsTime::getMonotonic ();
+    double expire = ( end - beg ) / nTimers;
+
+    testDiag ( "%8u %12.3f %12.3f %12.3f %12.3f", nTimers,
+        start * 1e6, restart * 1e6, cancelStart * 1e6, expire * 1e6 );
+
+    for ( i = 0u; i < nTimers; i++ ) {
+        pTimers[i]->destroy ();
+    }
+    delete [] pTimers;
+    delete & queue;
+}
+
+MAIN(epicsTimerPerform)
+{
+    testPlan(0);
+    testDiag ( "Per timer operation times (us) with N timers pending" );
+    testDiag ( "%8s %12s %12s %12s %12s", "N",
+        "start", "restart", "cancel+start", "expire" );
+    timerChurn ( 100u, 100000u );
+    timerChurn ( 1000u, 100000u );
+    timerChurn ( 10000u, 100000u );
+    timerChurn ( 50000u, 100000u );
+    return testDone();
+}
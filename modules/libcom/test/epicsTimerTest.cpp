@@ -14,6 +14,7 @@
  */
 
 #include <math.h>
+#include <float.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -451,13 +452,101 @@ void testPeriodic ()
     queue.release ();
 }
 
+class passiveNotify : public epicsTimerQueueNotify {
+public:
+    void reschedule () {}
+    double quantum () { return 0.0; }
+};
+
+class orderVerify : public epicsTimerNotify {
+public:
+    orderVerify () : nExpired ( 0u ), outOfOrder ( 0u ) {}
+    epicsTime last;
+    unsigned nExpired;
+    unsigned outOfOrder;
+    expireStatus expire ( const epicsTime & );
+};
+
+// the queue passes the same current time to every timer expired by one
+// call of process(), so each records its own expiration time instead
+static epicsTime orderExpireTime;
+
+epicsTimerNotify::expireStatus orderVerify::expire ( const epicsTime & )
+{
+    if ( this->nExpired++ && orderExpireTime < this->last ) {
+        this->outOfOrder++;
+    }
+    this->last = orderExpireTime;
+    return expireStatus ( noRestart );
+}
+
+class orderTimer : public epicsTimerNotify {
+public:
+    orderTimer ( epicsTimerQueue & queue, orderVerify & checkIn ) :
+        timer ( queue.createTimer () ), check ( checkIn ) {}
+    ~orderTimer () { timer.destroy (); }
+    epicsTimer & timer;
+    orderVerify & check;
+    expireStatus expire ( const epicsTime & cur )
+    {
+        orderExpireTime = this->timer.getExpireInfo ().expireTime;
+        return this->check.expire ( cur );
+    }
+};
+
+//
+// verify that many timers started, restarted and canceled in random
+// order expire in order of their expiration times
+//
+void testOrder ()
+{
+    static const unsigned nTimers = 2000u;
+    passiveNotify notify;
+    orderVerify check;
+    orderTimer *pTimers[nTimers];
+    unsigned i, nCanceled = 0u;
+
+    testDiag ( "Testing expiration order of %u timers", nTimers );
+
+    epicsTimerQueuePassive &queue = epicsTimerQueuePassive::create ( notify );
+    epicsTime base = epicsTime::getCurrent ();
+
+    for ( i = 0u; i < nTimers; i++ ) {
+        pTimers[i] = new orderTimer ( queue, check );
+        pTimers[i]->timer.start ( *pTimers[i], base + 1 + rand () % 1000 );
+    }
+    for ( i = 0u; i < nTimers; i += 3u ) {
+        pTimers[i]->timer.start ( *pTimers[i], base + 1 + rand () % 1000 );
+    }
+    for ( i = 1u; i < nTimers; i += 7u ) {
+        pTimers[i]->timer.cancel ();
+        nCanceled++;
+    }
+
+    double delay = queue.process ( base );
+    testOk ( check.nExpired == 0u && delay > 0.0,
+        "nothing expires early" );
+    delay = queue.process ( base + 1000.0 );
+    testOk ( check.nExpired == nTimers - nCanceled,
+        "%u of %u timers expired", check.nExpired, nTimers - nCanceled );
+    testOk ( check.outOfOrder == 0u,
+        "%u expired out of order", check.outOfOrder );
+    testOk ( delay == DBL_MAX, "queue is empty" );
+
+    for ( i = 0u; i < nTimers; i++ ) {
+        delete pTimers[i];
+    }
+    delete & queue;
+}
+
 MAIN(epicsTimerTest)
 {
-    testPlan(41);
+    testPlan(45);
     testRefCount();
     testAccuracy ();
     testCancel ();
     testExpireDestroy ();
     testPeriodic ();
+    testOrder ();
     return testDone();
 }
@@ -0,0 +1,178 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+
+#include "epicsEvent.h"
+#include "epicsRingPointer.h"
+#include "epicsThread.h"
+#include "freeList.h"
+#include "epicsUnitTest.h"
+#include "testMain.h"
+
+#define NELEM 100
+#define NPASS 20000
+#define BATCH 40
+
+typedef struct elem {
+    size_t tag;
+    char data[40];
+} elem;
+
+static void fill(elem *pelem, size_t tag)
+{
+    pelem->tag = tag;
+    memset(pelem->data, (int)(tag & 0xff), sizeof(pelem->data));
+}
+
+static int check(const elem *pelem)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(pelem->data); i++) {
+        if (pelem->data[i] != (char)(pelem->tag & 0xff))
+            return 0;
+    }
+    return 1;
+}
+
+static void testSingle(int cached)
+{
+    void *pfl;
+    elem *pelem[NELEM];
+    int i, distinct = 1, intact = 1;
+    size_t avail;
+
+    testDiag("Single thread, %s", cached ? "cached" : "plain");
+
+    if (cached)
+        freeListInitPvtCached(&pfl, sizeof(elem), 16);
+    else
+        freeListInitPvt(&pfl, sizeof(elem), 16);
+
+    for (i = 0; i < NELEM; i++) {
+        pelem[i] = freeListMalloc(pfl);
+        if (pelem[i])
+            fill(pelem[i], i);
+        else
+            testAbort("freeListMalloc() failed");
+    }
+    for (i = 0; i < NELEM; i++) {
+        intact &= check(pelem[i]) && pelem[i]->tag == (size_t) i;
+        if (i && pelem[i] == pelem[i - 1])
+            distinct = 0;
+    }
+    testOk(intact && distinct, "%d distinct elements", NELEM);
+
+    /* 7 chunks of 16 were needed */
+    avail = freeListItemsAvail(pfl);
+    testOk(avail == 112 - NELEM, "%u available", (unsigned) avail);
+
+    for (i = 0; i < NELEM; i++)
+        freeListFree(pfl, pelem[i]);
+    avail = freeListItemsAvail(pfl);
+    testOk(avail == 112, "%u available after free", (unsigned) avail);
+
+    pelem[0] = freeListCalloc(pfl);
+    testOk(pelem[0] && pelem[0]->tag == 0 && pelem[0]->data[0] == 0,
+        "freeListCalloc() zeroes");
+    freeListFree(pfl, pelem[0]);
+
+    freeListCleanup(pfl);
+}
+
+typedef struct {
+    void *pfl;
+    epicsRingPointerId ring;
+    epicsEventId done;
+    int bad;
+} xferInfo;
+
+/* Allocates elements and passes them to the main thread, which frees them,
+ * and also allocates and frees some of its own.
+ */
+static void producer(void *arg)
+{
+    xferInfo *pinfo = arg;
+    elem *local[BATCH];
+    int pass, i;
+
+    for (pass = 0; pass < NPASS; pass++) {
+        elem *pelem = freeListMalloc(pinfo->pfl);
+
+        if (!pelem) {
+            pinfo->bad++;
+            break;
+        }
+        fill(pelem, pass);
+        while (!epicsRingPointerPush(pinfo->ring, pelem))
+            epicsThreadSleep(0.0);
+
+        if (pass % 1000 == 0) {
+            for (i = 0; i < BATCH; i++) {
+                local[i] = freeListMalloc(pinfo->pfl);
+                fill(local[i], i);
+            }
+            for (i = 0; i < BATCH; i++) {
+                if (!check(local[i]) || local[i]->tag != (size_t) i)
+                    pinfo->bad++;
+                freeListFree(pinfo->pfl, local[i]);
+            }
+        }
+    }
+    epicsEventMustTrigger(pinfo->done);
+}
+
+static void testThreads(void)
+{
+    xferInfo info;
+    int n = 0, bad = 0;
+    size_t avail;
+
+    testDiag("Elements allocated in one thread and freed in another");
+
+    freeListInitPvtCached(&info.pfl, sizeof(elem), 64);
+    info.ring = epicsRingPointerLockedCreate(256);
+    info.done = epicsEventMustCreate(epicsEventEmpty);
+    info.bad = 0;
+
+    epicsThreadMustCreate("producer", epicsThreadPriorityMedium,
+        epicsThreadGetStackSize(epicsThreadStackSmall), producer, &info);
+
+    while (n < NPASS) {
+        elem *pelem = epicsRingPointerPop(info.ring);
+
+        if (!pelem) {
+            epicsThreadSleep(0.0);
+            continue;
+        }
+        if (!check(pelem) || pelem->tag != (size_t) n)
+            bad++;
+        n++;
+        freeListFree(info.pfl, pelem);
+    }
+    epicsEventMustWait(info.done);
+
+    testOk(bad == 0 && info.bad == 0, "%d elements passed intact", n);
+    avail = freeListItemsAvail(info.pfl);
+    testOk(avail > 0 && avail % 64 == 0,
+        "all %u allocated elements available", (unsigned) avail);
+    testOk(avail <= 64 * 16, "blocks were reused");
+
+    epicsRingPointerDelete(info.ring);
+    epicsEventDestroy(info.done);
+    freeListCleanup(info.pfl);
+}
+
+MAIN(freeListTest)
+{
+    testPlan(11);
+    testSingle(0);
+    testSingle(1);
+    testThreads();
+    return testDone();
+}
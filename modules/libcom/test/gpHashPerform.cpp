@@ -0,0 +1,75 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+// Measures gpHash insert and lookup times with as many names as the
+// records of a large IOC.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gpHash.h"
+#include "epicsTime.h"
+#include "epicsUnitTest.h"
+#include "testMain.h"
+
+#define NAME_SIZE 24u
+
+static void hashChurn ( unsigned nNames, unsigned nOps )
+{
+    char *names = new char [ nNames * NAME_SIZE ];
+    struct gphPvt *pvt;
+    char miss[NAME_SIZE];
+    unsigned i, found = 0u;
+
+    for ( i = 0u; i < nNames; i++ ) {
+        sprintf ( & names[i * NAME_SIZE], "IOC:sys%04u:dev%06u", i % 1000u, i );
+    }
+    gphInitPvt ( & pvt, 256 );
+
+    epicsTime beg = epicsTime::getMonotonic ();
+    for ( i = 0u; i < nNames; i++ ) {
+        gphAdd ( pvt, & names[i * NAME_SIZE], NULL );
+    }
+    epicsTime end = epicsTime::getMonotonic ();
+    double add = ( end - beg ) / nNames;
+
+    beg = epicsTime::getMonotonic ();
+    for ( i = 0u; i < nOps; i++ ) {
+        if ( gphFind ( pvt, & names[( rand () % nNames ) * NAME_SIZE], NULL ) )
+            found++;
+    }
+    end = epicsTime::getMonotonic ();
+    double hit = ( end - beg ) / nOps;
+
+    beg = epicsTime::getMonotonic ();
+    for ( i = 0u; i < nOps; i++ ) {
+        sprintf ( miss, "IOC:sys%04u:dex%06u", i % 1000u, i );
+        if ( gphFind ( pvt, miss, NULL ) )
+            found++;
+    }
+    end = epicsTime::getMonotonic ();
+    double notFound = ( end - beg ) / nOps;
+
+    testDiag ( "%8u %12.3f %12.3f %12.3f", nNames,
+        add * 1e6, hit * 1e6, notFound * 1e6 );
+    if ( found != nOps )
+        testDiag ( "found %u of %u names", found, nOps );
+
+    gphFreeMem ( pvt );
+    delete [] names;
+}
+
+MAIN(gpHashPerform)
+{
+    testPlan(0);
+    testDiag ( "Per operation times (us) with N names" );
+    testDiag ( "%8s %12s %12s %12s", "N", "add", "find", "find missing" );
+    hashChurn ( 10000u, 1000000u );
+    hashChurn ( 100000u, 1000000u );
+    hashChurn ( 1000000u, 1000000u );
+    hashChurn ( 2000000u, 1000000u );
+    return testDone();
+}
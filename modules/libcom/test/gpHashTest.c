@@ -0,0 +1,187 @@
+/*************************************************************************\
+* SPDX-License-Identifier: EPICS
+* EPICS BASE is distributed subject to a Software License Agreement found
+* in file LICENSE that is included with this distribution.
+\*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "epicsAtomic.h"
+#include "epicsThread.h"
+#include "gpHash.h"
+#include "epicsUnitTest.h"
+#include "testMain.h"
+
+/* Enough to grow a 256 slot table several times */
+#define NNAMES 5000
+
+static char names[NNAMES][16];
+static int pvtA, pvtB;
+
+static int findAll(struct gphPvt *pvt, int step, int offset)
+{
+    int i, found = 0;
+
+    for (i = offset; i < NNAMES; i += step) {
+        GPHENTRY *pentry = gphFind(pvt, names[i], &pvtA);
+
+        if (pentry && pentry->name == names[i] &&
+            pentry->userPvt == (void *) &names[i])
+            found++;
+    }
+    return found;
+}
+
+static void testGrow(struct gphPvt *pvt)
+{
+    int i, added = 0, dups = 0;
+
+    testDiag("Growing the table");
+
+    for (i = 0; i < NNAMES; i++) {
+        GPHENTRY *pentry;
+
+        sprintf(names[i], "rec%d", i);
+        pentry = gphAdd(pvt, names[i], &pvtA);
+        if (pentry) {
+            pentry->userPvt = (void *) &names[i];
+            added++;
+        }
+    }
+    testOk(added == NNAMES, "Added %d of %d names", added, NNAMES);
+    testOk(findAll(pvt, 1, 0) == NNAMES, "All names found");
+
+    for (i = 0; i < NNAMES; i += 100) {
+        if (!gphAdd(pvt, names[i], &pvtA))
+            dups++;
+    }
+    testOk(dups == NNAMES / 100, "Duplicates are refused");
+    testOk1(gphFind(pvt, "missing", &pvtA) == NULL);
+}
+
+static void testDeleteReadd(struct gphPvt *pvt)
+{
+    int i, gone = 0, readded = 0;
+
+    testDiag("Delete and re-add");
+
+    for (i = 0; i < NNAMES; i += 2)
+        gphDelete(pvt, names[i], &pvtA);
+    for (i = 0; i < NNAMES; i += 2) {
+        if (!gphFind(pvt, names[i], &pvtA))
+            gone++;
+    }
+    testOk(gone == NNAMES / 2, "%d deleted names not found", gone);
+    testOk(findAll(pvt, 2, 1) == NNAMES / 2, "The others are still found");
+
+    for (i = 0; i < NNAMES; i += 2) {
+        GPHENTRY *pentry = gphAdd(pvt, names[i], &pvtA);
+
+        if (pentry) {
+            pentry->userPvt = (void *) &names[i];
+            readded++;
+        }
+    }
+    testOk(readded == NNAMES / 2, "Re-added %d names", readded);
+    testOk(findAll(pvt, 1, 0) == NNAMES, "All names found again");
+}
+
+static void testParse(struct gphPvt *pvt)
+{
+    GPHENTRY *pabc = gphAdd(pvt, "abc", &pvtA);
+    GPHENTRY *pabcdef = gphAdd(pvt, "abcdef", &pvtA);
+
+    testDiag("gphFindParse");
+
+    testOk1(pabc && pabcdef && pabc != pabcdef);
+    testOk1(gphFindParse(pvt, "abcdef", 3, &pvtA) == pabc);
+    testOk1(gphFindParse(pvt, "abc.VAL", 3, &pvtA) == pabc);
+    testOk1(gphFindParse(pvt, "abcdef", 6, &pvtA) == pabcdef);
+    testOk1(gphFindParse(pvt, "abcdef", 4, &pvtA) == NULL);
+    testOk1(gphFindParse(pvt, "abcdef", 3, &pvtB) == NULL);
+}
+
+static void testPvtid(struct gphPvt *pvt)
+{
+    GPHENTRY *pa, *pb;
+
+    testDiag("Same name with different pvtid");
+
+    pa = gphAdd(pvt, "shared", &pvtA);
+    pb = gphAdd(pvt, "shared", &pvtB);
+    testOk1(pa && pb && pa != pb);
+    testOk1(gphFind(pvt, "shared", &pvtA) == pa);
+    testOk1(gphFind(pvt, "shared", &pvtB) == pb);
+    testOk1(gphFind(pvt, "shared", NULL) == NULL);
+
+    gphDelete(pvt, "shared", &pvtA);
+    testOk1(gphFind(pvt, "shared", &pvtA) == NULL);
+    testOk1(gphFind(pvt, "shared", &pvtB) == pb);
+}
+
+#define NREADERS 2
+
+static struct gphPvt *sharedPvt;
+static int stopReaders;
+static int misses;
+
+static void reader(void *arg)
+{
+    while (!epicsAtomicGetIntT(&stopReaders)) {
+        int found = findAll(sharedPvt, 2, 1);
+
+        if (found != NNAMES / 2)
+            epicsAtomicIncrIntT(&misses);
+    }
+}
+
+/* Lookups of names which stay put run while others are deleted and added */
+static void testConcurrent(struct gphPvt *pvt)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    epicsThreadId tid[NREADERS];
+    int i, pass;
+
+    testDiag("Lookups during changes");
+
+    sharedPvt = pvt;
+    opts.joinable = 1;
+    opts.priority = epicsThreadPriorityLow;
+    for (i = 0; i < NREADERS; i++)
+        tid[i] = epicsThreadCreateOpt("reader", &reader, NULL, &opts);
+
+    for (pass = 0; pass < 5; pass++) {
+        for (i = 0; i < NNAMES; i += 2)
+            gphDelete(pvt, names[i], &pvtA);
+        for (i = 0; i < NNAMES; i += 2) {
+            GPHENTRY *pentry = gphAdd(pvt, names[i], &pvtA);
+
+            if (pentry)
+                pentry->userPvt = (void *) &names[i];
+        }
+    }
+
+    epicsAtomicSetIntT(&stopReaders, 1);
+    for (i = 0; i < NREADERS; i++)
+        epicsThreadMustJoin(tid[i]);
+    testOk(misses == 0, "%d lookups missed names that stayed", misses);
+}
+
+MAIN(gpHashTest)
+{
+    struct gphPvt *pvt = NULL;
+
+    testPlan(21);
+
+    gphInitPvt(&pvt, 256);
+    testGrow(pvt);
+    testDeleteReadd(pvt);
+    testParse(pvt);
+    testPvtid(pvt);
+    testConcurrent(pvt);
+    gphFreeMem(pvt);
+
+    return testDone();
+}
@@ -18,6 +18,7 @@
 #include <time.h>
 
 #include "epicsThread.h"
+#include "epicsTime.h"
 #include "epicsRingBytes.h"
 #include "errlog.h"
 #include "epicsEvent.h"
@@ -51,6 +52,73 @@ static void check(epicsRingBytesId ring, int expectedFree,
            highWaterMark, expectedHighWaterMark);
 }
 
+/* One writer and one reader thread stream bytes through a ring */
+
+#define NSTREAM (1024 * 1024)
+
+typedef struct stream {
+    epicsRingBytesId ring;
+    int chunk;
+    int corrupt;
+} stream;
+
+static void streamReader(void *arg)
+{
+    stream *pstream = arg;
+    char buf[256];
+    unsigned char expect = 0;
+    int n = 0;
+
+    while (n < NSTREAM) {
+        int i, k = epicsRingBytesGet(pstream->ring, buf, pstream->chunk);
+
+        if (!k)
+            epicsThreadSleep(0.0);
+        for (i = 0; i < k; i++) {
+            if ((unsigned char) buf[i] != expect++)
+                pstream->corrupt = 1;
+        }
+        n += k;
+    }
+}
+
+static int streamTest(const char *kind, epicsRingBytesId ring, int chunk)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    epicsThreadId tid;
+    epicsTimeStamp beg, end;
+    stream strm;
+    char buf[512];
+    int i, n = 0;
+
+    for (i = 0; i < 512; i++)
+        buf[i] = i;
+    strm.ring = ring;
+    strm.chunk = chunk;
+    strm.corrupt = 0;
+    opts.priority = epicsThreadGetPrioritySelf();
+    opts.joinable = 1;
+
+    epicsTimeGetMonotonic(&beg);
+    tid = epicsThreadCreateOpt("reader", streamReader, &strm, &opts);
+    if (!tid)
+        testAbort("epicsThreadCreate failed");
+    while (n < NSTREAM) {
+        int k = epicsRingBytesPut(ring, buf + n % 256, chunk);
+
+        if (!k)
+            epicsThreadSleep(0.0);
+        n += k;
+    }
+    epicsThreadMustJoin(tid);
+    epicsTimeGetMonotonic(&end);
+
+    testDiag("%-8s %3d byte chunks: %7.1f MB/s", kind, chunk,
+        NSTREAM / epicsTimeDiffInSeconds(&end, &beg) / 1e6);
+    epicsRingBytesDelete(ring);
+    return !strm.corrupt;
+}
+
 MAIN(ringBytesTest)
 {
     int i, n;
@@ -60,7 +128,7 @@ MAIN(ringBytesTest)
     char get[RINGSIZE+1];
     epicsRingBytesId ring;
 
-    testPlan(292);
+    testPlan(294);
 
     pinfo = calloc(1,sizeof(info));
     if (!pinfo) {
@@ -128,5 +196,15 @@ MAIN(ringBytesTest)
     epicsEventDestroy(consumerEvent);
     free(pinfo);
 
+    testDiag("Throughput, one writer and one reader thread");
+    testOk(streamTest("unlocked", epicsRingBytesCreate(4096), 1) &&
+        streamTest("unlocked", epicsRingBytesCreate(4096), 16) &&
+        streamTest("unlocked", epicsRingBytesCreate(4096), 256),
+        "Unlocked ring data intact");
+    testOk(streamTest("locked", epicsRingBytesLockedCreate(4096), 1) &&
+        streamTest("locked", epicsRingBytesLockedCreate(4096), 16) &&
+        streamTest("locked", epicsRingBytesLockedCreate(4096), 256),
+        "Locked ring data intact");
+
     return testDone();
 }
@@ -21,6 +21,7 @@
 #include <time.h>
 
 #include "epicsThread.h"
+#include "epicsTime.h"
 #include "epicsRingPointer.h"
 #include "errlog.h"
 #include "epicsEvent.h"
@@ -49,16 +50,17 @@ size_t ptr2int(void *p)
     return i&0xffff;
 }
 
-static void testSingle(void)
+static void testSingle(int mpsc)
 {
     int i;
     const int rsize = 100;
     void *addr = 0;
-    epicsRingPointerId ring = epicsRingPointerCreate(rsize);
+    epicsRingPointerId ring = mpsc ? epicsRingPointerMPSCCreate(rsize) :
+        epicsRingPointerCreate(rsize);
 
     foundCorruption = 0;
 
-    testDiag("Testing operations w/o threading");
+    testDiag("Testing operations w/o threading%s", mpsc ? ", MPSC" : "");
 
     testOk1(epicsRingPointerIsEmpty(ring));
     testOk1(!epicsRingPointerIsFull(ring));
@@ -240,16 +242,192 @@ static void testPair(int locked)
     epicsRingPointerDelete(ring);
 }
 
+static void testMany(int mpsc)
+{
+    const int rsize = 10;
+    void *in[16], *out[16];
+    epicsRingPointerId ring = mpsc ? epicsRingPointerMPSCCreate(rsize) :
+        epicsRingPointerCreate(rsize);
+    int i, n, ok;
+
+    testDiag("Batch operations%s", mpsc ? ", MPSC" : "");
+
+    for (i = 0; i < 16; i++)
+        in[i] = int2ptr(i + 1);
+
+    testOk1(epicsRingPointerPushMany(ring, in, 6) == 6);
+    n = epicsRingPointerPushMany(ring, in + 6, 6);
+    testOk(n == 4, "Pushed %d of 6 into the remaining space", n);
+    testOk1(epicsRingPointerIsFull(ring));
+
+    n = epicsRingPointerPopMany(ring, out, 7);
+    testOk(n == 7, "Popped %d of 7", n);
+    n += epicsRingPointerPopMany(ring, out + n, 16 - n);
+    for (ok = n == rsize, i = 0; ok && i < n; i++)
+        ok = out[i] == in[i];
+    testOk(ok, "Popped all %d in order", n);
+    testOk1(epicsRingPointerIsEmpty(ring));
+
+    /* wraps around the end of the ring */
+    epicsRingPointerPushMany(ring, in, 7);
+    n = epicsRingPointerPopMany(ring, out, 16);
+    for (ok = n == 7, i = 0; ok && i < n; i++)
+        ok = out[i] == in[i];
+    testOk(ok, "Wrapped around, popped %d", n);
+
+    epicsRingPointerDelete(ring);
+}
+
+#define NPRODUCERS 4
+#define NPUSHES 100000
+
+typedef struct {
+    epicsRingPointerId ring;
+    int id;
+    epicsThreadId tid;
+} mpscPvt;
+
+static void mpscProducer(void *raw)
+{
+    mpscPvt *pvt = raw;
+    char *zero = 0;
+    int i;
+
+    for (i = 1; i <= NPUSHES; i++) {
+        while (!epicsRingPointerPush(pvt->ring, zero + (pvt->id << 24 | i)))
+            epicsThreadSleep(0.0);
+    }
+}
+
+static void testMPSC(void)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    mpscPvt pvt[NPRODUCERS];
+    epicsRingPointerId ring = epicsRingPointerMPSCCreate(64);
+    size_t last[NPRODUCERS + 1];
+    int i, n = 0, inOrder = 1;
+
+    testDiag("%d producers, single consumer, MPSC", NPRODUCERS);
+
+    memset(last, 0, sizeof(last));
+    opts.priority = epicsThreadGetPrioritySelf();
+    opts.joinable = 1;
+    for (i = 0; i < NPRODUCERS; i++) {
+        pvt[i].ring = ring;
+        pvt[i].id = i + 1;
+        pvt[i].tid = epicsThreadCreateOpt("mpsc", mpscProducer, &pvt[i],
+            &opts);
+        if (!pvt[i].tid)
+            testAbort("epicsThreadCreate failed");
+    }
+
+    while (n < NPRODUCERS * NPUSHES) {
+        void *out[16];
+        int j, k = epicsRingPointerPopMany(ring, out, 16);
+
+        if (!k)
+            epicsThreadSleep(0.0);
+        for (j = 0; j < k; j++) {
+            char *zero = 0;
+            size_t v = (char *) out[j] - zero;
+            size_t id = v >> 24;
+
+            if (id < 1 || id > NPRODUCERS || (v & 0xffffff) != last[id] + 1)
+                inOrder = 0;
+            else
+                last[id]++;
+        }
+        n += k;
+    }
+    for (i = 0; i < NPRODUCERS; i++)
+        epicsThreadMustJoin(pvt[i].tid);
+
+    testOk(inOrder, "Each producer's entries arrived in order");
+    testOk1(epicsRingPointerIsEmpty(ring));
+    epicsRingPointerDelete(ring);
+}
+
+/* Throughput of one producer and one consumer thread */
+
+#define NTHROUGH 500000
+
+typedef struct {
+    epicsRingPointerId ring;
+    int batch;
+} throughPvt;
+
+static void throughConsumer(void *raw)
+{
+    throughPvt *pvt = raw;
+    void *out[64];
+    int n = 0;
+
+    while (n < NTHROUGH) {
+        int k = epicsRingPointerPopMany(pvt->ring, out, pvt->batch);
+
+        if (!k)
+            epicsThreadSleep(0.0);
+        n += k;
+    }
+}
+
+static void throughput(const char *kind, epicsRingPointerId ring, int batch)
+{
+    epicsThreadOpts opts = EPICS_THREAD_OPTS_INIT;
+    throughPvt pvt;
+    epicsThreadId tid;
+    epicsTimeStamp beg, end;
+    void *in[64];
+    int i, n = 0;
+
+    for (i = 0; i < 64; i++)
+        in[i] = int2ptr(i + 1);
+    pvt.ring = ring;
+    pvt.batch = batch;
+    opts.priority = epicsThreadGetPrioritySelf();
+    opts.joinable = 1;
+
+    epicsTimeGetMonotonic(&beg);
+    tid = epicsThreadCreateOpt("through", throughConsumer, &pvt, &opts);
+    if (!tid)
+        testAbort("epicsThreadCreate failed");
+    while (n < NTHROUGH) {
+        int k = epicsRingPointerPushMany(ring, in, batch);
+
+        if (!k)
+            epicsThreadSleep(0.0);
+        n += k;
+    }
+    epicsThreadMustJoin(tid);
+    epicsTimeGetMonotonic(&end);
+
+    testDiag("%-8s batch %2d: %6.1f M entries/s", kind, batch,
+        NTHROUGH / epicsTimeDiffInSeconds(&end, &beg) / 1e6);
+    epicsRingPointerDelete(ring);
+}
+
 MAIN(ringPointerTest)
 {
     int prio = epicsThreadGetPrioritySelf();
 
-    testPlan(42);
-    testSingle();
+    testPlan(94);
+    testSingle(0);
+    testSingle(1);
+    testMany(0);
+    testMany(1);
+    testMPSC();
     if (prio)
         epicsThreadSetPriority(epicsThreadGetIdSelf(), epicsThreadPriorityScanLow);
     testPair(0);
     testPair(1);
+
+    testDiag("Throughput, one producer and one consumer thread");
+    throughput("unlocked", epicsRingPointerCreate(1024), 1);
+    throughput("unlocked", epicsRingPointerCreate(1024), 32);
+    throughput("locked", epicsRingPointerLockedCreate(1024), 1);
+    throughput("locked", epicsRingPointerLockedCreate(1024), 32);
+    throughput("MPSC", epicsRingPointerMPSCCreate(1024), 1);
+    throughput("MPSC", epicsRingPointerMPSCCreate(1024), 32);
     if (prio)
         epicsThreadSetPriority(epicsThreadGetIdSelf(), prio);
     return testDone();